@@ -36,6 +36,12 @@ IndexBuffer create_index_buffer(const uint16_t* const data_ptr, const size_t byt
 void        update_index_buffer(IndexBuffer& index_buffer, const uint16_t* const data_ptr,
                                 const size_t byte_length);
 
+// On OpenGL, storage buffers require 4.3.
+StorageBuffer create_storage_buffer(const size_t byte_length);
+StorageBuffer create_storage_buffer(const void* const data_ptr, const size_t byte_length);
+void          update_storage_buffer(StorageBuffer& storage_buffer, const void* const data_ptr,
+                                    const size_t byte_length);
+
 Mesh create_mesh(const std::initializer_list<std::tuple<uint32_t, const VertexBuffer&>> bindings);
 Mesh create_mesh(const std::initializer_list<std::tuple<uint32_t, const VertexBuffer&>> bindings,
                  const IndexBuffer& index_buffer);
@@ -73,6 +79,17 @@ void update_vertex_buffer(VertexBuffer& vertex_buffer, const Container& containe
                               sizeof(container.data()[0]) * container.size());
 }
 
+template <typename Container>
+StorageBuffer create_storage_buffer(const Container& container) {
+  return create_storage_buffer(container.data(), sizeof(container.data()[0]) * container.size());
+}
+
+template <typename Container>
+void update_storage_buffer(StorageBuffer& storage_buffer, const Container& container) {
+  return update_storage_buffer(storage_buffer, container.data(),
+                               sizeof(container.data()[0]) * container.size());
+}
+
 template <typename Container>
 IndexBuffer create_index_buffer(const Container& container) {
   static_assert(std::is_same<decltype(container.data()[0]), uint16_t>::value ||
@@ -72,6 +72,13 @@ struct VertexBufferDesc {
   StepFunction step_function;
 };
 
+// Overrides the default value of one of the pipeline's `const` parameters. The value is converted
+// to the type of the constant, which may be a bool, an int or a float.
+struct ConstantDesc {
+  uint32_t id;
+  double   value;
+};
+
 struct PipelineDesc {
   std::string_view                           name;
   CullMode                                   cull_mode;
@@ -84,6 +91,18 @@ struct PipelineDesc {
   AlphaBlend                                 blend_dst;
   std::initializer_list<VertexAttributeDesc> vertex_attributes;
   std::initializer_list<VertexBufferDesc>    vertex_buffers;
+  std::initializer_list<ConstantDesc>        constants;
+
+  // Selects the variant of a pipeline with features, as a mask of the bits in the generated
+  // `<pipeline>_features` struct.
+  uint32_t features;
+};
+
+// Describes a pipeline with a `compute` function, which has no fixed function state.
+struct ComputePipelineDesc {
+  std::string_view                    name;
+  std::initializer_list<ConstantDesc> constants;
+  uint32_t                            features;
 };
 
 }  // namespace crystal
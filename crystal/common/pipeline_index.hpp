@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "crystal/common/proto/proto.hpp"
+
+namespace crystal::common {
+
+// Finds a pipeline of a library by its name and feature mask, without scanning the pipelines.
+class PipelineIndex {
+  struct Entry {
+    int                   index = -1;
+    std::vector<uint32_t> variants;  // Indexed by feature mask, for a pipeline with features.
+  };
+
+  absl::flat_hash_map<std::string, Entry> entries_;
+
+public:
+  PipelineIndex() = default;
+
+  // `pipelines` are those of one of the backends, which all list them in the same order.
+  template <typename Pipelines>
+  PipelineIndex(const proto::Library& lib_pb, const Pipelines& pipelines) {
+    for (int i = 0; i < pipelines.size(); ++i) {
+      entries_[pipelines.Get(i).name()].index = i;
+    }
+    for (const auto& variants_pb : lib_pb.variants()) {
+      entries_[variants_pb.name()].variants.assign(variants_pb.pipelines().begin(),
+                                                   variants_pb.pipelines().end());
+    }
+  }
+
+  // Returns the index of the pipeline, or -1 if the library doesn't have it. A pipeline without
+  // features is only found with a mask of 0.
+  [[nodiscard]] int find(const std::string_view name, const uint32_t features) const {
+    const auto it = entries_.find(name);
+    if (it == entries_.end()) {
+      return -1;
+    }
+
+    const Entry& entry = it->second;
+    if (entry.variants.empty()) {
+      return features == 0 ? entry.index : -1;
+    }
+    return features < entry.variants.size() ? static_cast<int>(entry.variants[features]) : -1;
+  }
+};
+
+}  // namespace crystal::common
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace crystal::compiler::ast {
+
+// A bump allocator that owns the nodes of a module.
+//
+// Allocations are carved out of large blocks that are never moved or reallocated, so pointers into
+// the arena stay valid for as long as the arena (or whatever it has been moved into) is alive.
+// Everything is released at once when the arena is destroyed. Only objects that aren't trivially
+// destructible are tracked, so that their destructors can be run in reverse order of construction.
+class Arena {
+  static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+  struct Destructor {
+    void (*fn)(void*);
+    void* ptr;
+  };
+
+  std::vector<std::unique_ptr<std::byte[]>> blocks_;
+  std::byte*                                next_ = nullptr;
+  std::byte*                                end_  = nullptr;
+  std::vector<Destructor>                   destructors_;
+  size_t                                    objects_ = 0;
+  size_t                                    bytes_   = 0;
+
+public:
+  Arena() = default;
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  Arena(Arena&& other) noexcept
+      : blocks_(std::move(other.blocks_)),
+        next_(std::exchange(other.next_, nullptr)),
+        end_(std::exchange(other.end_, nullptr)),
+        destructors_(std::move(other.destructors_)),
+        objects_(std::exchange(other.objects_, 0)),
+        bytes_(std::exchange(other.bytes_, 0)) {}
+
+  Arena& operator=(Arena&& other) noexcept {
+    if (this != &other) {
+      release_();
+      blocks_      = std::move(other.blocks_);
+      next_        = std::exchange(other.next_, nullptr);
+      end_         = std::exchange(other.end_, nullptr);
+      destructors_ = std::move(other.destructors_);
+      objects_     = std::exchange(other.objects_, 0);
+      bytes_       = std::exchange(other.bytes_, 0);
+    }
+    return *this;
+  }
+
+  ~Arena() { release_(); }
+
+  // The number of objects constructed by `make`, and the bytes handed out for everything.
+  [[nodiscard]] size_t objects() const { return objects_; }
+  [[nodiscard]] size_t bytes() const { return bytes_; }
+
+  // Returns uninitialized storage for `size` bytes aligned to `align`.
+  [[nodiscard]] void* allocate(const size_t size, const size_t align) {
+    std::byte* ptr = align_(next_, align);
+    if (next_ == nullptr || ptr + size > end_) {
+      const size_t block_size = std::max(BLOCK_SIZE, size + align);
+      blocks_.emplace_back(new std::byte[block_size]);
+      next_ = blocks_.back().get();
+      end_  = next_ + block_size;
+      ptr   = align_(next_, align);
+    }
+    next_ = ptr + size;
+    bytes_ += size;
+    return ptr;
+  }
+
+  // Constructs a `T` in the arena.
+  template <typename T, typename... Args>
+  [[nodiscard]] T* make(Args&&... args) {
+    T* const obj = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    ++objects_;
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      destructors_.push_back(Destructor{[](void* ptr) { static_cast<T*>(ptr)->~T(); }, obj});
+    }
+    return obj;
+  }
+
+  // Copies `str` into the arena.
+  [[nodiscard]] std::string_view copy(const std::string_view str) {
+    char* const ptr = static_cast<char*>(allocate(str.size(), 1));
+    std::memcpy(ptr, str.data(), str.size());
+    return std::string_view(ptr, str.size());
+  }
+
+private:
+  static std::byte* align_(std::byte* ptr, const size_t align) {
+    const uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+    return ptr + ((align - addr % align) % align);
+  }
+
+  void release_() {
+    for (auto it = destructors_.rbegin(); it != destructors_.rend(); ++it) {
+      it->fn(it->ptr);
+    }
+    destructors_.clear();
+    blocks_.clear();
+    objects_ = 0;
+    bytes_   = 0;
+    next_ = nullptr;
+    end_  = nullptr;
+  }
+};
+
+}  // namespace crystal::compiler::ast
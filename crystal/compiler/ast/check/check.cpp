@@ -0,0 +1,378 @@
+#include "crystal/compiler/ast/check/check.hpp"
+
+#include "crystal/compiler/ast/expr/bin_op_expression.hpp"
+#include "crystal/compiler/ast/expr/un_op_expression.hpp"
+#include "crystal/compiler/ast/module.hpp"
+#include "crystal/compiler/ast/type/struct_type.hpp"
+#include "util/msg/msg.hpp"
+
+namespace crystal::compiler::ast::check {
+
+namespace {
+
+using util::memory::Ref;
+
+// How the result type of a builtin function relates to its arguments.
+enum class Result {
+  Widest = 0,  // The widest argument, eg: `mix(vec4, vec4, float)` is a `vec4`.
+  Scalar,      // Always a float, eg: `length`.
+  Integral,    // The widest argument, which stays an int when every argument is one, eg: `abs`.
+};
+
+struct Function {
+  std::string_view name;
+  uint32_t         min_args;
+  uint32_t         max_args;
+  Result           result;
+};
+
+constexpr Function FUNCTIONS[] = {
+    {"abs", 1, 1, Result::Integral},
+    {"acos", 1, 1, Result::Widest},
+    {"asin", 1, 1, Result::Widest},
+    {"atan", 1, 2, Result::Widest},
+    {"ceil", 1, 1, Result::Widest},
+    {"clamp", 3, 3, Result::Integral},
+    {"cos", 1, 1, Result::Widest},
+    {"cross", 2, 2, Result::Widest},
+    {"degrees", 1, 1, Result::Widest},
+    {"determinant", 1, 1, Result::Scalar},
+    {"distance", 2, 2, Result::Scalar},
+    {"dot", 2, 2, Result::Scalar},
+    {"exp", 1, 1, Result::Widest},
+    {"exp2", 1, 1, Result::Widest},
+    {"floor", 1, 1, Result::Widest},
+    {"fract", 1, 1, Result::Widest},
+    {"inverse", 1, 1, Result::Widest},
+    {"inversesqrt", 1, 1, Result::Widest},
+    {"length", 1, 1, Result::Scalar},
+    {"log", 1, 1, Result::Widest},
+    {"log2", 1, 1, Result::Widest},
+    {"max", 2, 2, Result::Integral},
+    {"min", 2, 2, Result::Integral},
+    {"mix", 3, 3, Result::Widest},
+    {"mod", 2, 2, Result::Widest},
+    {"normalize", 1, 1, Result::Widest},
+    {"pow", 2, 2, Result::Widest},
+    {"radians", 1, 1, Result::Widest},
+    {"reflect", 2, 2, Result::Widest},
+    {"refract", 3, 3, Result::Widest},
+    {"round", 1, 1, Result::Widest},
+    {"sign", 1, 1, Result::Widest},
+    {"sin", 1, 1, Result::Widest},
+    {"smoothstep", 3, 3, Result::Widest},
+    {"sqrt", 1, 1, Result::Widest},
+    {"step", 2, 2, Result::Widest},
+    {"tan", 1, 1, Result::Widest},
+    {"trunc", 1, 1, Result::Widest},
+};
+
+bool is_number(const type::Type& type) {
+  return (type.kind() == type::Kind::Int || type.kind() == type::Kind::Float) && type.count() == 1;
+}
+
+bool is_arithmetic(const type::Type& type) {
+  return type.kind() == type::Kind::Int || type.kind() == type::Kind::Float ||
+         type.kind() == type::Kind::Matrix;
+}
+
+bool is_bool(const type::Type& type) {
+  return type.kind() == type::Kind::Bool && type.count() == 1;
+}
+
+// Returns the number of components selected by a swizzle, or 0 if `name` isn't a valid swizzle of
+// a vector with `count` components.
+uint32_t swizzle_size(const std::string_view name, const uint32_t count) {
+  constexpr std::string_view SETS[] = {"xyzw", "rgba", "stpq"};
+  if (name.empty() || name.size() > 4) {
+    return 0;
+  }
+
+  for (const auto set : SETS) {
+    const std::string_view components = set.substr(0, count);
+    if (name.find_first_not_of(components) == std::string_view::npos) {
+      return static_cast<uint32_t>(name.size());
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+
+Context::Context(Module& mod, Ref<type::Type> return_type)
+    : mod_(mod), return_type_(return_type) {
+  bool_       = mod.find_type("bool").value();
+  int_        = mod.find_type("int").value();
+  vectors_[1] = mod.find_type("float").value();
+  vectors_[2] = mod.find_type("vec2").value();
+  vectors_[3] = mod.find_type("vec3").value();
+  vectors_[4] = mod.find_type("vec4").value();
+}
+
+void Context::declare(const Symbol name, Binding binding) {
+  if (!scope_.emplace(name, std::move(binding)).second) {
+    util::msg::fatal("redeclaration of [", name, "]");
+  }
+  if (!blocks_.empty()) {
+    blocks_.back().push_back(name);
+  }
+}
+
+void Context::close_block() {
+  for (const auto& name : blocks_.back()) {
+    scope_.erase(name);
+  }
+  blocks_.pop_back();
+}
+
+const Binding& Context::lookup(const Symbol name) const {
+  const auto it = scope_.find(name);
+  if (it == scope_.end()) {
+    util::msg::fatal("unknown identifier [", name, "]");
+  }
+  return it->second;
+}
+
+bool assignable(const type::Type& to, const type::Type& from) {
+  if (&to == &from) {
+    return true;
+  }
+  return to.kind() == type::Kind::Float && to.count() == 1 && from.kind() == type::Kind::Int &&
+         from.count() == 1;
+}
+
+Ref<type::Type> unary(const Context& ctx, const expr::UnOp op, const Ref<type::Type>& rhs) {
+  if (!is_arithmetic(rhs)) {
+    util::msg::fatal("operator [", expr::to_string(op), "] is not defined for [", rhs->name(),
+                     "]");
+  }
+  return rhs;
+}
+
+Ref<type::Type> binary(const Context& ctx, const expr::BinOp op, const Ref<type::Type>& lhs,
+                       const Ref<type::Type>& rhs) {
+  switch (op) {
+    case expr::BinOp::And:
+    case expr::BinOp::Or:
+      if (is_bool(lhs) && is_bool(rhs)) {
+        return ctx.bool_type();
+      }
+      break;
+
+    case expr::BinOp::Eq:
+    case expr::BinOp::Ne:
+      if (assignable(lhs, rhs) || assignable(rhs, lhs)) {
+        return ctx.bool_type();
+      }
+      break;
+
+    case expr::BinOp::Lt:
+    case expr::BinOp::Le:
+    case expr::BinOp::Gt:
+    case expr::BinOp::Ge:
+      if (is_number(lhs) && is_number(rhs)) {
+        return ctx.bool_type();
+      }
+      break;
+
+    case expr::BinOp::Add:
+    case expr::BinOp::Sub:
+    case expr::BinOp::Mul:
+    case expr::BinOp::Div:
+      if (!is_arithmetic(lhs) || !is_arithmetic(rhs)) {
+        break;
+      }
+      if (lhs == rhs) {
+        return lhs;
+      }
+      if (is_number(lhs) && is_number(rhs)) {
+        // Mixing integers and floats promotes to float.
+        return ctx.float_type();
+      }
+      if (is_number(lhs)) {
+        return rhs;
+      }
+      if (is_number(rhs)) {
+        return lhs;
+      }
+      if (op == expr::BinOp::Mul) {
+        if (lhs->kind() == type::Kind::Matrix && rhs->is_vector() &&
+            rhs->count() == lhs->count()) {
+          return rhs;
+        }
+        if (lhs->is_vector() && rhs->kind() == type::Kind::Matrix &&
+            lhs->count() == rhs->count()) {
+          return lhs;
+        }
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  util::msg::fatal("operator [", expr::to_string(op), "] is not defined for [", lhs->name(),
+                   "] and [", rhs->name(), "]");
+  return lhs;
+}
+
+Ref<type::Type> property(const Context& ctx, const Ref<type::Type>& type,
+                         const std::string_view name) {
+  if (type->kind() == type::Kind::Float && type->is_vector()) {
+    const uint32_t size = swizzle_size(name, type->count());
+    if (size > 0) {
+      return ctx.float_type(size);
+    }
+  } else if (type->kind() == type::Kind::Struct) {
+    const Ref<type::StructType> struct_type = type;
+    for (const auto& prop : struct_type->properties()) {
+      if (prop.name == name) {
+        if (prop.array) {
+          util::msg::fatal("runtime sized array [", name, "] can only be indexed");
+        }
+        return prop.type;
+      }
+    }
+  }
+
+  util::msg::fatal("type [", type->name(), "] has no property [", name, "]");
+  return type;
+}
+
+Ref<type::Type> element(const Context& ctx, const Ref<type::Type>& type,
+                        const std::string_view name, const Ref<type::Type>& index) {
+  if (index->kind() != type::Kind::Int || index->count() != 1) {
+    util::msg::fatal("the index into [", name, "] must be an int, not [", index->name(), "]");
+  }
+  if (type->kind() == type::Kind::Struct) {
+    const Ref<type::StructType> struct_type = type;
+    for (const auto& prop : struct_type->properties()) {
+      if (prop.name == name && prop.array) {
+        return prop.type;
+      }
+    }
+  }
+
+  util::msg::fatal("type [", type->name(), "] has no runtime sized array [", name, "]");
+  return type;
+}
+
+Ref<type::Type> construct(const Context& ctx, const Ref<type::Type>& type,
+                          const std::vector<Ref<type::Type>>& args) {
+  bool valid = false;
+  switch (type->kind()) {
+    case type::Kind::Struct: {
+      const Ref<type::StructType> struct_type = type;
+      if (struct_type->packed()) {
+        // The arguments would be matched against the reordered properties.
+        util::msg::fatal("packed struct [", type->name(), "] can not be constructed");
+      }
+      if (struct_type->runtime_sized()) {
+        util::msg::fatal("struct [", type->name(), "] can not be constructed, as it ends in a ",
+                         "runtime sized array");
+      }
+
+      const auto& properties = struct_type->properties();
+      valid                  = args.size() == properties.size();
+      for (size_t i = 0; valid && i < args.size(); ++i) {
+        valid = assignable(properties[i].type, args[i]);
+      }
+      break;
+    }
+
+    case type::Kind::Bool:
+    case type::Kind::Int:
+    case type::Kind::Float:
+      if (args.size() == 1) {
+        // A single argument is either splatted across every component, or truncated.
+        valid = is_number(args[0]) || is_bool(args[0]) ||
+                (args[0]->is_vector() && args[0]->count() >= type->count());
+      } else {
+        uint32_t count = 0;
+        valid          = true;
+        for (const auto& arg : args) {
+          valid = valid && (arg->kind() == type::Kind::Int || arg->kind() == type::Kind::Float);
+          count += arg->count();
+        }
+        valid = valid && count == type->count();
+      }
+      break;
+
+    case type::Kind::Matrix:
+      if (args.size() == 1) {
+        // A scalar sets the diagonal.
+        valid = is_number(args[0]) || args[0] == type;
+      } else if (args.size() == type->count()) {
+        valid = true;
+        for (const auto& arg : args) {
+          valid = valid && arg->kind() == type::Kind::Float && arg->count() == 4;
+        }
+      } else if (args.size() == type->count() * 4) {
+        valid = true;
+        for (const auto& arg : args) {
+          valid = valid && is_number(arg);
+        }
+      }
+      break;
+
+    case type::Kind::Texture:
+      break;
+  }
+
+  if (!valid) {
+    util::msg::fatal("invalid arguments to constructor [", type->name(), "]");
+  }
+  return type;
+}
+
+Ref<type::Type> builtin(const Context& ctx, const std::string_view name,
+                        const std::vector<Ref<type::Type>>& args) {
+  const Function* function = nullptr;
+  for (const auto& f : FUNCTIONS) {
+    if (f.name == name) {
+      function = &f;
+      break;
+    }
+  }
+  if (function == nullptr) {
+    util::msg::fatal("unknown function [", name, "]");
+  }
+  if (args.size() < function->min_args || args.size() > function->max_args) {
+    util::msg::fatal("wrong number of arguments to function [", name, "]");
+  }
+
+  // Scalar arguments are widened to match the vector (or matrix) ones.
+  Ref<type::Type> widest = args[0];
+  for (const auto& arg : args) {
+    if (!is_arithmetic(arg)) {
+      util::msg::fatal("invalid arguments to function [", name, "]");
+    }
+    if (arg->kind() == type::Kind::Matrix || arg->count() > widest->count()) {
+      widest = arg;
+    }
+  }
+  for (const auto& arg : args) {
+    if (!is_number(arg) && arg != widest) {
+      util::msg::fatal("invalid arguments to function [", name, "]");
+    }
+  }
+  if (name == "cross" && (widest->kind() != type::Kind::Float || widest->count() != 3)) {
+    util::msg::fatal("function [cross] takes two vec3 arguments");
+  }
+
+  // Integer arguments are converted to floats, unless the function has an integer overload that
+  // they all match.
+  bool integral = function->result == Result::Integral;
+  for (const auto& arg : args) {
+    integral = integral && arg->kind() == type::Kind::Int;
+  }
+  if (integral) {
+    return ctx.int_type();
+  }
+  if (function->result == Result::Scalar || widest->kind() == type::Kind::Int) {
+    return ctx.float_type();
+  }
+  return widest;
+}
+
+}  // namespace crystal::compiler::ast::check
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "crystal/compiler/ast/symbol.hpp"
+#include "crystal/compiler/ast/type/type.hpp"
+#include "util/memory/ref_count.hpp"
+
+namespace crystal::compiler::ast {
+
+class Module;
+
+}  // namespace crystal::compiler::ast
+
+namespace crystal::compiler::ast::expr {
+
+enum class BinOp;
+enum class UnOp;
+
+}  // namespace crystal::compiler::ast::expr
+
+namespace crystal::compiler::ast::stmt {
+
+class VariableStatement;
+
+}  // namespace crystal::compiler::ast::stmt
+
+namespace crystal::compiler::ast::check {
+
+// Where the value named by an identifier comes from.
+enum class BindingKind {
+  Undefined = 0,
+  Local,
+  Vertex,
+  Instanced,
+  Uniform,
+  Storage,
+  ReadOnlyStorage,  // A storage buffer that the pipeline only reads from.
+  Texture,
+  Varying,
+  Invocation,  // A component of the invocation id of a compute function.
+  Instance,    // The index of the instance that a vertex function runs for.
+  Constant,
+  Feature,
+  Counter,  // The counter of a `for` loop, which only the loop itself advances.
+};
+
+// The declaration that an identifier resolves to.
+struct Binding {
+  BindingKind                    kind = BindingKind::Undefined;
+  util::memory::Ref<type::Type>  type;
+  int32_t                        index = -1;       // The slot of a function input.
+  const stmt::VariableStatement* local = nullptr;  // The statement that declares a local.
+};
+
+// Type checking state for a single function body.
+class Context {
+  Module&                              mod_;
+  util::memory::Ref<type::Type>        return_type_;
+  absl::flat_hash_map<Symbol, Binding> scope_;
+
+  // The names declared in each of the blocks that are open, innermost last.
+  std::vector<std::vector<Symbol>> blocks_;
+
+  util::memory::Ref<type::Type> bool_;
+  util::memory::Ref<type::Type> int_;
+  util::memory::Ref<type::Type> vectors_[5];  // Indexed by component count; 1 is float.
+
+public:
+  Context(Module& mod, util::memory::Ref<type::Type> return_type);
+
+  [[nodiscard]] Module&                              mod() const { return mod_; }
+  [[nodiscard]] const util::memory::Ref<type::Type>& return_type() const { return return_type_; }
+
+  void                         declare(Symbol name, Binding binding);
+  [[nodiscard]] const Binding& lookup(Symbol name) const;
+
+  // Opens a block, such as the branch of an `if`. What is declared inside of it is forgotten again
+  // by `close_block`, although it may still not be redeclared while the block is open.
+  void open_block() { blocks_.emplace_back(); }
+  void close_block();
+
+  [[nodiscard]] const util::memory::Ref<type::Type>& bool_type() const { return bool_; }
+  [[nodiscard]] const util::memory::Ref<type::Type>& int_type() const { return int_; }
+  [[nodiscard]] const util::memory::Ref<type::Type>& float_type() const { return vectors_[1]; }
+  [[nodiscard]] const util::memory::Ref<type::Type>& float_type(const uint32_t count) const {
+    return vectors_[count];
+  }
+};
+
+// Whether a value of type `from` may be stored in a location of type `to`. Integers implicitly
+// convert to floats, as they do in glsl.
+[[nodiscard]] bool assignable(const type::Type& to, const type::Type& from);
+
+// The following return the type of the result, following glsl's rules for mixing scalars, vectors
+// and matrices. They fail with an error if the operation is not defined for the given types.
+
+[[nodiscard]] util::memory::Ref<type::Type> unary(const Context& ctx, expr::UnOp op,
+                                                  const util::memory::Ref<type::Type>& rhs);
+
+[[nodiscard]] util::memory::Ref<type::Type> binary(const Context& ctx, expr::BinOp op,
+                                                   const util::memory::Ref<type::Type>& lhs,
+                                                   const util::memory::Ref<type::Type>& rhs);
+
+// Accesses a member of a struct, or a swizzle of a vector.
+[[nodiscard]] util::memory::Ref<type::Type> property(const Context&                        ctx,
+                                                     const util::memory::Ref<type::Type>& type,
+                                                     std::string_view                     name);
+
+// Indexes the runtime sized array property of a struct. `index` is the type of the index.
+[[nodiscard]] util::memory::Ref<type::Type> element(const Context&                        ctx,
+                                                    const util::memory::Ref<type::Type>& type,
+                                                    std::string_view                     name,
+                                                    const util::memory::Ref<type::Type>& index);
+
+// Calls the constructor of `type`.
+[[nodiscard]] util::memory::Ref<type::Type> construct(
+    const Context& ctx, const util::memory::Ref<type::Type>& type,
+    const std::vector<util::memory::Ref<type::Type>>& args);
+
+// Calls one of the builtin functions, such as `normalize` or `mix`.
+[[nodiscard]] util::memory::Ref<type::Type> builtin(
+    const Context& ctx, std::string_view name,
+    const std::vector<util::memory::Ref<type::Type>>& args);
+
+}  // namespace crystal::compiler::ast::check
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "crystal/compiler/ast/decl/compute_declaration.hpp"
 #include "crystal/compiler/ast/decl/declaration.hpp"
 #include "crystal/compiler/ast/decl/fragment_declaration.hpp"
 #include "crystal/compiler/ast/decl/struct_declaration.hpp"
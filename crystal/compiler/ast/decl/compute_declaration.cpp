@@ -0,0 +1,396 @@
+#include "crystal/compiler/ast/decl/compute_declaration.hpp"
+
+#include "crystal/compiler/ast/module.hpp"
+#include "crystal/compiler/ast/output/glsl.hpp"
+#include "crystal/compiler/ast/output/metal.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
+#include "crystal/compiler/ast/type/struct_type.hpp"
+
+namespace crystal::compiler::ast::decl {
+
+namespace {
+
+// The components of the invocation id, in the order of the arguments that take them.
+constexpr std::string_view COMPONENTS = "xyz";
+
+}  // namespace
+
+std::array<uint32_t, MAX_INVOCATION_DIMENSIONS> workgroup_size(
+    const std::string_view attr, const std::initializer_list<unsigned long long> sizes) {
+  if (attr != "workgroup_size") {
+    util::msg::fatal("unknown compute attribute [", attr, "]");
+  }
+
+  std::array<uint32_t, MAX_INVOCATION_DIMENSIONS> result{1, 1, 1};
+  size_t                                          i = 0;
+  for (const auto size : sizes) {
+    if (size == 0 || size > UINT32_MAX) {
+      util::msg::fatal("invalid workgroup size [", size, "]");
+    }
+    result[i++] = static_cast<uint32_t>(size);
+  }
+  return result;
+}
+
+util::memory::Ref<ComputeDeclaration> ComputeDeclaration::specialize(
+    Module& mod, const absl::flat_hash_map<Symbol, bool>& values) const {
+  std::vector<ComputeInput> inputs;
+  for (const auto& input : inputs_) {
+    if (input.input_type == ComputeInputType::Invocation) {
+      inputs.push_back(input);
+    }
+  }
+  return util::memory::Ref<ComputeDeclaration>::make(
+      workgroup_size_, std::move(inputs), stmt::specialize(mod.arena(), implementation_, values));
+}
+
+void ComputeDeclaration::typecheck(Module& mod) {
+  // A compute function doesn't return anything, its results are written to the storage buffers.
+  check::Context ctx(mod, nullptr);
+  for (const auto& input : inputs_) {
+    check::BindingKind kind = check::BindingKind::Undefined;
+    switch (input.input_type) {
+      case ComputeInputType::Invocation:
+        if (input.index >= static_cast<int32_t>(MAX_INVOCATION_DIMENSIONS)) {
+          util::msg::fatal("a compute function takes at most [", MAX_INVOCATION_DIMENSIONS,
+                           "] arguments");
+        }
+        if (input.type->kind() != type::Kind::Int || input.type->count() != 1) {
+          util::msg::fatal("compute argument [", input.name, "] must be an int");
+        }
+        kind = check::BindingKind::Invocation;
+        break;
+      case ComputeInputType::Uniform:
+        kind = check::BindingKind::Uniform;
+        break;
+      case ComputeInputType::Storage:
+        kind = check::BindingKind::Storage;
+        break;
+      case ComputeInputType::ReadOnlyStorage:
+        kind = check::BindingKind::ReadOnlyStorage;
+        break;
+      case ComputeInputType::Constant:
+        kind = check::BindingKind::Constant;
+        break;
+      default:
+        util::msg::fatal("unhandled compute input type [", static_cast<uint32_t>(input.input_type),
+                         "]");
+        break;
+    }
+    ctx.declare(mod.intern(input.name), check::Binding{kind, input.type, input.index});
+  }
+  for (const auto& feature : features_) {
+    ctx.declare(mod.intern(feature), check::Binding{check::BindingKind::Feature, ctx.bool_type()});
+  }
+
+  for (const auto& stmt : implementation_) {
+    stmt->typecheck(ctx);
+  }
+}
+
+void ComputeDeclaration::optimize(Module& mod) {
+  opt::Context ctx(mod, nullptr);
+  for (const auto& stmt : implementation_) {
+    stmt->optimize(ctx);
+  }
+  opt::eliminate_common_subexpressions(ctx, implementation_);
+}
+
+void ComputeDeclaration::eliminate_dead_code(Module& mod) {
+  opt::Liveness live;
+  for (const auto& input : inputs_) {
+    if (input.input_type == ComputeInputType::Storage) {
+      live.keep(mod.intern(input.name));
+    }
+  }
+  opt::eliminate_dead_code(live, implementation_);
+}
+
+void ComputeDeclaration::add_types(type::TypeSet& types) const {
+  for (const auto& input : inputs_) {
+    types.add(input.type);
+  }
+  stmt::add_types(types, implementation_);
+}
+
+void ComputeDeclaration::to_glsl(output::Writer& out, const Module& mod, bool pretty, bool vulkan,
+                                 output::glsl::Names* names) const {
+  const output::glsl::Options opts{mod, nullptr, nullptr, 0, pretty, vulkan, names};
+
+  // Output the version header. This must come first.
+  out << output::glsl::CS_HDR;
+  if (opts.pretty) {
+    out << "\n";
+  }
+
+  // Output the constants, which have to follow the version header directly, as they may start with
+  // preprocessor directives.
+  bool constants = false;
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::ComputeInputType::Constant) {
+      continue;
+    }
+    output::glsl::declare_constant(out, opts, input.type, input.name,
+                                   static_cast<uint32_t>(input.index), input.value);
+    constants = true;
+  }
+  if (opts.pretty && constants) {
+    out << "\n";
+  }
+
+  // Output the struct types that are used. Those that end in a runtime sized array are only
+  // declared as storage blocks.
+  type::TypeSet types;
+  add_types(types);
+  for (const auto& type : mod.types()) {
+    if (!types.contains(type) || type::runtime_sized(type)) {
+      continue;
+    }
+
+    {
+      out << "struct " << output::glsl::type_name{type, names} << (opts.pretty ? " {\n" : "{");
+      const util::memory::Ref<type::StructType> struct_type = type;
+      const auto                                struct_opts = opts.incr_indent();
+      for (const auto& prop : struct_type->properties()) {
+        out << output::glsl::indent{struct_opts.indent} << output::glsl::type_name{prop.type, names}
+            << " " << output::glsl::member_name{prop.name, names}
+            << (struct_opts.pretty ? ";\n" : ";");
+      }
+      out << (opts.pretty ? "};\n\n" : "};");
+    }
+  }
+
+  // Output the uniform blocks.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::ComputeInputType::Uniform) {
+      continue;
+    }
+
+    {
+      out << output::glsl::indent{opts.indent};
+      // The layout is spelled out to match the structs in the generated C++ header.
+      out << "layout(std140";
+      if (opts.vulkan) {
+        out << ", set=0, binding=" << input.index;
+      }
+      out << (opts.pretty ? ") " : ")") << "uniform U" << input.index
+          << (opts.pretty ? " {\n" : "{");
+      const util::memory::Ref<type::StructType> struct_type = input.type;
+      const auto                                struct_opts = opts.incr_indent();
+      for (const auto& prop : struct_type->properties()) {
+        out << output::glsl::indent{struct_opts.indent} << output::glsl::type_name{prop.type, names}
+            << " " << output::glsl::member_name{prop.name, names}
+            << (struct_opts.pretty ? ";\n" : ";");
+      }
+      out << output::glsl::indent{opts.indent} << (opts.pretty ? "} " : "}")
+          << output::glsl::mangle_name{input.name, names} << (opts.pretty ? ";\n" : ";");
+    }
+  }
+
+  // Output the storage blocks.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::ComputeInputType::Storage &&
+        input.input_type != decl::ComputeInputType::ReadOnlyStorage) {
+      continue;
+    }
+
+    const util::memory::Ref<type::StructType> struct_type = input.type;
+    output::glsl::declare_storage(out, opts, struct_type, input.name,
+                                  static_cast<uint32_t>(input.index),
+                                  input.input_type == decl::ComputeInputType::ReadOnlyStorage);
+  }
+
+  if (opts.pretty) {
+    out << "\n";
+  }
+
+  // Output the workgroup size.
+  out << output::glsl::indent{opts.indent} << "layout(local_size_x=" << workgroup_size_[0]
+      << (opts.pretty ? ", " : ",") << "local_size_y=" << workgroup_size_[1]
+      << (opts.pretty ? ", " : ",") << "local_size_z=" << workgroup_size_[2]
+      << (opts.pretty ? ") in;\n\n" : ")in;");
+
+  {  // Finally output the function implementation.
+    out << output::glsl::indent{opts.indent} << "void main()" << (opts.pretty ? " {\n" : "{");
+
+    const auto main_opts = opts.incr_indent();
+    for (const auto& input : inputs_) {
+      if (input.input_type != decl::ComputeInputType::Invocation) {
+        continue;
+      }
+
+      out << output::glsl::indent{main_opts.indent} << output::glsl::type_name{input.type, names}
+          << " " << output::glsl::mangle_name{input.name, names}
+          << (main_opts.pretty ? " = " : "=") << "int(gl_GlobalInvocationID."
+          << COMPONENTS[input.index] << (main_opts.pretty ? ");\n" : ");");
+    }
+    if (main_opts.pretty) {
+      out << "\n";
+    }
+    for (const auto& stmt : implementation_) {
+      stmt->to_glsl(out, main_opts);
+    }
+
+    out << (opts.pretty ? "}\n" : "}");
+  }
+}
+
+void ComputeDeclaration::to_metal(output::Writer& out, const Module& mod,
+                                  const PipelineDeclaration& pipeline) const {
+  const output::metal::Options opts{mod, nullptr, nullptr, 0};
+
+  // Output the function implementation.
+  out << "kernel void " << name() << "(";
+
+  bool first      = true;
+  bool invocation = false;
+  for (const auto& input : inputs_) {
+    if (input.input_type == decl::ComputeInputType::Constant) {
+      // Declared as locals instead, see below.
+      continue;
+    }
+    if (input.input_type == decl::ComputeInputType::Invocation) {
+      // Taken from the position in the grid instead, see below.
+      invocation = true;
+      continue;
+    }
+    if (!first) {
+      out << ", ";
+    } else {
+      first = false;
+    }
+
+    if (input.input_type == decl::ComputeInputType::Uniform) {
+      out << "constant " << input.type->metal_name() << "& "
+          << output::metal::mangle_name{input.name} << " [[ buffer("
+          << output::metal::uniform_binding(pipeline, input.index) << ") ]]";
+    }
+    if (input.input_type == decl::ComputeInputType::Storage ||
+        input.input_type == decl::ComputeInputType::ReadOnlyStorage) {
+      out << (input.input_type == decl::ComputeInputType::Storage ? "device " : "const device ")
+          << input.type->metal_name() << "& "
+          << output::metal::mangle_name{input.name} << " [[ buffer("
+          << output::metal::storage_binding(pipeline, input.index) << ") ]]";
+    }
+  }
+  if (invocation) {
+    out << (first ? "" : ", ") << "uint3 gid [[ thread_position_in_grid ]]";
+  }
+  out << ") {\n";
+  for (const auto& input : inputs_) {
+    if (input.input_type == decl::ComputeInputType::Constant) {
+      output::metal::declare_constant(out, input.type, input.name,
+                                      static_cast<uint32_t>(input.index), input.value);
+    }
+  }
+  for (const auto& input : inputs_) {
+    if (input.input_type == decl::ComputeInputType::Invocation) {
+      out << output::metal::indent{1} << input.type->metal_name() << " "
+          << output::metal::mangle_name{input.name} << " = int(gid." << COMPONENTS[input.index]
+          << ");\n";
+    }
+  }
+  for (const auto& stmt : implementation_) {
+    stmt->to_metal(out, opts);
+  }
+  out << "}\n";
+}
+
+void ComputeDeclaration::to_spirv(output::spirv::Builder& builder, const Module& mod) const {
+  output::spirv::Function      function;
+  const output::spirv::Options opts{mod, nullptr, nullptr, builder, function};
+  std::vector<uint32_t>        interface;
+
+  // Bind the constants, which are shared with the other pipelines.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::ComputeInputType::Constant) {
+      continue;
+    }
+
+    const output::spirv::ValueType type = output::spirv::ValueType::from(input.type);
+    const uint32_t id = builder.spec_constant(type, static_cast<uint32_t>(input.index), input.value,
+                                              output::spirv::mangle_name(input.name));
+    function.constants.insert_or_assign(input.name, output::spirv::Value{id, type});
+  }
+
+  // Bind the uniform blocks.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::ComputeInputType::Uniform) {
+      continue;
+    }
+
+    const util::memory::Ref<type::StructType> struct_type = input.type;
+    const uint32_t var =
+        builder.variable(spv::StorageClass::Uniform, builder.type_block(struct_type),
+                         output::spirv::mangle_name(input.name));
+    builder.decorate(var, spv::Decoration::DescriptorSet, {0});
+    builder.decorate(var, spv::Decoration::Binding, {static_cast<uint32_t>(input.index)});
+    function.scope.insert_or_assign(
+        input.name, output::spirv::Pointer{var, output::spirv::ValueType::from(input.type),
+                                           spv::StorageClass::Uniform, {},
+                                           output::spirv::Layout::Std140});
+  }
+
+  // Bind the storage blocks.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::ComputeInputType::Storage &&
+        input.input_type != decl::ComputeInputType::ReadOnlyStorage) {
+      continue;
+    }
+
+    const util::memory::Ref<type::StructType> struct_type = input.type;
+    function.scope.insert_or_assign(
+        input.name,
+        output::spirv::storage(builder, struct_type, input.name, static_cast<uint32_t>(input.index),
+                               input.input_type == decl::ComputeInputType::ReadOnlyStorage));
+  }
+
+  // Bind the invocation id, and copy the components that the arguments take into locals. It's
+  // declared as signed, the same as the arguments, which the builtin allows.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::ComputeInputType::Invocation) {
+      continue;
+    }
+
+    const output::spirv::ValueType ids = output::spirv::ValueType::vector(
+        output::spirv::Kind::Int, MAX_INVOCATION_DIMENSIONS);
+    const uint32_t var =
+        builder.variable(spv::StorageClass::Input, builder.type_id(ids), "gl_GlobalInvocationID");
+    builder.decorate(var, spv::Decoration::BuiltIn,
+                     {static_cast<uint32_t>(spv::BuiltIn::GlobalInvocationId)});
+    interface.push_back(var);
+
+    const output::spirv::Value value{opts.emit(spv::Op::OpLoad, ids, {var}), ids};
+    for (const auto& component : inputs_) {
+      if (component.input_type != decl::ComputeInputType::Invocation) {
+        continue;
+      }
+
+      const output::spirv::ValueType type = output::spirv::ValueType::from(component.type);
+      const output::spirv::Pointer   local =
+          output::spirv::local(opts, type, output::spirv::mangle_name(component.name));
+      output::spirv::store(
+          opts, local,
+          output::spirv::Value{opts.emit(spv::Op::OpCompositeExtract, type,
+                                         {value.id, static_cast<uint32_t>(component.index)}),
+                               type});
+      function.scope.insert_or_assign(component.name, local);
+    }
+    break;
+  }
+
+  // Finally output the function implementation.
+  for (const auto& stmt : implementation_) {
+    output::spirv::ensure_block(opts);
+    stmt->to_spirv(opts);
+  }
+
+  // The entry point is named after the pipeline, matching the vulkan runtime.
+  const uint32_t id = builder.add_function(function, name());
+  builder.entry_point(spv::ExecutionModel::GLCompute, id, name().substr(0, name().size() - 5),
+                      interface);
+  builder.execution_mode(id, spv::ExecutionMode::LocalSize,
+                         {workgroup_size_[0], workgroup_size_[1], workgroup_size_[2]});
+}
+
+}  // namespace crystal::compiler::ast::decl
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "crystal/compiler/ast/decl/declaration.hpp"
+#include "crystal/compiler/ast/opt/opt.hpp"
+#include "crystal/compiler/ast/output/glsl.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
+#include "crystal/compiler/ast/output/writer.hpp"
+#include "crystal/compiler/ast/stmt/statement.hpp"
+#include "crystal/compiler/ast/symbol.hpp"
+#include "crystal/compiler/ast/type/type.hpp"
+#include "crystal/compiler/ast/type/type_set.hpp"
+#include "util/memory/ref_count.hpp"
+
+namespace crystal::compiler::ast {
+
+class Module;
+
+}  // namespace crystal::compiler::ast
+
+namespace crystal::compiler::ast::decl {
+
+class PipelineDeclaration;
+
+// The workgroup size of a compute function may have at most this many dimensions.
+constexpr size_t MAX_INVOCATION_DIMENSIONS = 3;
+
+// Validates a `[[workgroup_size(x, y, z)]]` attribute, where the dimensions that are left out
+// default to 1.
+[[nodiscard]] std::array<uint32_t, MAX_INVOCATION_DIMENSIONS> workgroup_size(
+    std::string_view attr, std::initializer_list<unsigned long long> sizes);
+
+enum class ComputeInputType {
+  Undefined = 0,
+  Invocation,  // A component of the global invocation id, where `index` selects x, y or z.
+  Uniform,
+  Storage,
+  ReadOnlyStorage,
+  Constant,
+};
+
+struct ComputeInput {
+  std::string                   name;
+  util::memory::Ref<type::Type> type;
+  ComputeInputType              input_type;
+  int32_t                       index;
+  double                        value = 0.0;  // The default of a constant.
+
+  ComputeInput(std::string_view name, util::memory::Ref<type::Type> type,
+               ComputeInputType input_type, int32_t index, double value = 0.0)
+      : name(name), type(type), input_type(input_type), index(index), value(value) {}
+};
+
+class ComputeDeclaration : public Declaration {
+  std::array<uint32_t, MAX_INVOCATION_DIMENSIONS> workgroup_size_;
+  std::vector<ComputeInput>                       inputs_;
+  std::vector<stmt::Statement*>                   implementation_;
+
+  // The feature toggles of the pipeline, which are only declared in the function that each of its
+  // variants is specialized from.
+  std::vector<std::string> features_;
+
+public:
+  ComputeDeclaration(std::array<uint32_t, MAX_INVOCATION_DIMENSIONS> workgroup_size,
+                     std::vector<decl::ComputeInput>&&               inputs,
+                     std::vector<stmt::Statement*>&&                 implementation)
+      : Declaration(""),
+        workgroup_size_(workgroup_size),
+        inputs_(std::move(inputs)),
+        implementation_(std::move(implementation)) {}
+
+  virtual ~ComputeDeclaration() = default;
+
+  [[nodiscard]] const std::array<uint32_t, MAX_INVOCATION_DIMENSIONS>& workgroup_size() const {
+    return workgroup_size_;
+  }
+  [[nodiscard]] const std::vector<ComputeInput>& inputs() const { return inputs_; }
+
+  void set_name(const std::string_view name) { name_ = name; }
+
+  void add_uniform(util::memory::Ref<type::Type> type, std::string name, int32_t index) {
+    inputs_.emplace_back(name, type, ComputeInputType::Uniform, index);
+  }
+  void add_storage(util::memory::Ref<type::Type> type, std::string name, int32_t index,
+                   bool readonly) {
+    inputs_.emplace_back(name, type,
+                         readonly ? ComputeInputType::ReadOnlyStorage : ComputeInputType::Storage,
+                         index);
+  }
+  void add_constant(util::memory::Ref<type::Type> type, std::string name, int32_t actual,
+                    double value) {
+    inputs_.emplace_back(name, type, ComputeInputType::Constant, actual, value);
+  }
+
+  void add_feature(std::string name) { features_.emplace_back(std::move(name)); }
+
+  // Copies the function, with every reference to a feature replaced by its value in `values`. The
+  // copy takes only the invocation ids, as the pipeline adds the rest of the inputs again, and is
+  // yet to be type checked.
+  [[nodiscard]] util::memory::Ref<ComputeDeclaration> specialize(
+      Module& mod, const absl::flat_hash_map<Symbol, bool>& values) const;
+
+  // Resolves the types of, and the declarations referred to by, every expression in the body.
+  void typecheck(Module& mod);
+
+  // Folds constants, and computes repeated subexpressions once, in the body. Requires
+  // `typecheck`.
+  void optimize(Module& mod);
+
+  // Removes the statements whose results are never needed. The writable storage buffers are the
+  // only results of a compute function, so everything written to them is kept. Requires
+  // `typecheck`.
+  void eliminate_dead_code(Module& mod);
+
+  // Adds the types of the inputs and the locals of the function to `types`.
+  void add_types(type::TypeSet& types) const;
+
+  // Shortens every identifier with `names` when it's set, other than those of the blocks.
+  void to_glsl(output::Writer& out, const Module& mod, bool pretty, bool vulkan,
+               output::glsl::Names* names = nullptr) const;
+  void to_metal(output::Writer& out, const Module& mod,
+                const PipelineDeclaration& pipeline) const;
+  void to_spirv(output::spirv::Builder& builder, const Module& mod) const;
+};
+
+}  // namespace crystal::compiler::ast::decl
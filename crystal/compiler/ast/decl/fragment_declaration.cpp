@@ -1,36 +1,128 @@
 #include "crystal/compiler/ast/decl/fragment_declaration.hpp"
 
+#include <algorithm>
+
 #include "crystal/compiler/ast/module.hpp"
 #include "crystal/compiler/ast/output/glsl.hpp"
 #include "crystal/compiler/ast/output/metal.hpp"
-#include "crystal/compiler/ast/output/print.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
 #include "crystal/compiler/ast/type/struct_type.hpp"
 
 namespace crystal::compiler::ast::decl {
 
-void FragmentDeclaration::to_glsl(std::ostream& out, const Module& mod, bool pretty,
-                                  bool vulkan) const {
-  const output::glsl::Options opts{mod, nullptr, this, 0, pretty, vulkan};
+util::memory::Ref<FragmentDeclaration> FragmentDeclaration::specialize(
+    Module& mod, const absl::flat_hash_map<Symbol, bool>& values) const {
+  std::vector<FragmentInput> inputs;
+  for (const auto& input : inputs_) {
+    if (input.input_type == FragmentInputType::Varying) {
+      inputs.push_back(input);
+    }
+  }
+  return util::memory::Ref<FragmentDeclaration>::make(
+      return_type_, std::move(inputs), stmt::specialize(mod.arena(), implementation_, values));
+}
+
+void FragmentDeclaration::typecheck(Module& mod) {
+  check::Context ctx(mod, return_type_);
+  for (const auto& input : inputs_) {
+    check::BindingKind kind = check::BindingKind::Undefined;
+    switch (input.input_type) {
+      case FragmentInputType::Varying:
+        kind = check::BindingKind::Varying;
+        break;
+      case FragmentInputType::Uniform:
+        kind = check::BindingKind::Uniform;
+        break;
+      case FragmentInputType::Texture:
+        kind = check::BindingKind::Texture;
+        break;
+      case FragmentInputType::Storage:
+        kind = check::BindingKind::ReadOnlyStorage;
+        break;
+      case FragmentInputType::Constant:
+        kind = check::BindingKind::Constant;
+        break;
+      default:
+        util::msg::fatal("unhandled fragment input type [",
+                         static_cast<uint32_t>(input.input_type), "]");
+        break;
+    }
+    ctx.declare(mod.intern(input.name), check::Binding{kind, input.type, input.index});
+  }
+  for (const auto& feature : features_) {
+    ctx.declare(mod.intern(feature), check::Binding{check::BindingKind::Feature, ctx.bool_type()});
+  }
+
+  for (const auto& stmt : implementation_) {
+    stmt->typecheck(ctx);
+  }
+}
+
+void FragmentDeclaration::optimize(Module& mod) {
+  opt::Context ctx(mod, return_type_);
+  for (const auto& stmt : implementation_) {
+    stmt->optimize(ctx);
+  }
+  opt::eliminate_common_subexpressions(ctx, implementation_);
+}
+
+void FragmentDeclaration::eliminate_dead_code(opt::Liveness& live) {
+  opt::eliminate_dead_code(live, implementation_);
+}
+
+void FragmentDeclaration::add_types(type::TypeSet& types) const {
+  types.add(return_type_);
+  for (const auto& input : inputs_) {
+    types.add(input.type);
+  }
+  stmt::add_types(types, implementation_);
+}
+
+void FragmentDeclaration::to_glsl(output::Writer& out, const Module& mod, bool pretty,
+                                  bool vulkan, output::glsl::Names* names) const {
+  const output::glsl::Options opts{mod, nullptr, this, 0, pretty, vulkan, names};
 
   // Output the version header. This must come first.
-  out << (opts.vulkan ? output::glsl::VK_HDR : output::glsl::GL_HDR);
+  const bool storage = std::any_of(inputs_.begin(), inputs_.end(), [](const FragmentInput& input) {
+    return input.input_type == FragmentInputType::Storage;
+  });
+  out << (storage ? output::glsl::CS_HDR
+                  : (opts.vulkan ? output::glsl::VK_HDR : output::glsl::GL_HDR));
   if (opts.pretty) {
     out << "\n";
   }
 
-  // TODO: Output only the used types.
-  // Output the struct types.
+  // Output the constants, which have to follow the version header directly, as they may start with
+  // preprocessor directives.
+  bool constants = false;
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::FragmentInputType::Constant) {
+      continue;
+    }
+    output::glsl::declare_constant(out, opts, input.type, input.name,
+                                   static_cast<uint32_t>(input.index), input.value);
+    constants = true;
+  }
+  if (opts.pretty && constants) {
+    out << "\n";
+  }
+
+  // Output the struct types that are used. Those that end in a runtime sized array are only
+  // declared as storage blocks.
+  type::TypeSet types;
+  add_types(types);
   for (const auto& type : mod.types()) {
-    if (type->builtin()) {
+    if (!types.contains(type) || type::runtime_sized(type)) {
       continue;
     }
 
     {
-      out << "struct " << type->name() << (opts.pretty ? " {\n" : "{");
+      out << "struct " << output::glsl::type_name{type, names} << (opts.pretty ? " {\n" : "{");
       const util::memory::Ref<type::StructType> struct_type = type;
       const auto                                struct_opts = opts.incr_indent();
       for (const auto& prop : struct_type->properties()) {
-        out << output::glsl::indent{struct_opts.indent} << prop.type->name() << " " << prop.name
+        out << output::glsl::indent{struct_opts.indent} << output::glsl::type_name{prop.type, names}
+            << " " << output::glsl::member_name{prop.name, names}
             << (struct_opts.pretty ? ";\n" : ";");
       }
       out << (opts.pretty ? "};\n\n" : "};");
@@ -45,21 +137,36 @@ void FragmentDeclaration::to_glsl(std::ostream& out, const Module& mod, bool pre
 
     {
       out << output::glsl::indent{opts.indent};
+      // The layout is spelled out to match the structs in the generated C++ header.
+      out << "layout(std140";
       if (opts.vulkan) {
-        out << "layout(set=0, binding=" << input.index << (opts.pretty ? ") " : ")");
+        out << ", set=0, binding=" << input.index;
       }
-      out << "uniform U" << input.index << (opts.pretty ? " {\n" : "{");
+      out << (opts.pretty ? ") " : ")") << "uniform U" << input.index
+          << (opts.pretty ? " {\n" : "{");
       const util::memory::Ref<type::StructType> struct_type = input.type;
       const auto                                struct_opts = opts.incr_indent();
       for (const auto& prop : struct_type->properties()) {
-        out << output::glsl::indent{struct_opts.indent} << prop.type->name() << " " << prop.name
+        out << output::glsl::indent{struct_opts.indent} << output::glsl::type_name{prop.type, names}
+            << " " << output::glsl::member_name{prop.name, names}
             << (struct_opts.pretty ? ";\n" : ";");
       }
       out << output::glsl::indent{opts.indent} << (opts.pretty ? "} " : "}")
-          << output::glsl::mangle_name{input.name} << (opts.pretty ? ";\n" : ";");
+          << output::glsl::mangle_name{input.name, names} << (opts.pretty ? ";\n" : ";");
     }
   }
 
+  // Output the storage blocks.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::FragmentInputType::Storage) {
+      continue;
+    }
+
+    const util::memory::Ref<type::StructType> struct_type = input.type;
+    output::glsl::declare_storage(out, opts, struct_type, input.name,
+                                  static_cast<uint32_t>(input.index), true);
+  }
+
   if (opts.pretty) {
     out << "\n";
   }
@@ -75,8 +182,8 @@ void FragmentDeclaration::to_glsl(std::ostream& out, const Module& mod, bool pre
       if (opts.vulkan) {
         out << "layout(set=1, binding=" << input.index << (opts.pretty ? ") " : ")");
       }
-      out << "uniform " << input.type->glsl_name() << " " << output::glsl::mangle_name{input.name}
-          << (opts.pretty ? ";\n" : ";");
+      out << "uniform " << input.type->glsl_name() << " "
+          << output::glsl::mangle_name{input.name, names} << (opts.pretty ? ";\n" : ";");
     }
   }
 
@@ -90,15 +197,10 @@ void FragmentDeclaration::to_glsl(std::ostream& out, const Module& mod, bool pre
       continue;
     }
 
-    const util::memory::Ref<type::StructType> struct_type = input.type;
-    for (const auto& prop : struct_type->properties()) {
-      if (prop.index < 0) {
-        // Skip properties that don't have an input index.
-        continue;
-      }
-      out << output::glsl::indent{opts.indent} << "layout(location=" << prop.index
-          << (opts.pretty ? ") in " : ")in ") << prop.type->name() << " "
-          << output::glsl::varying_name{static_cast<uint32_t>(prop.index), prop.name}
+    for (const auto& interpolator : varyings_.interpolators) {
+      out << output::glsl::indent{opts.indent} << "layout(location=" << interpolator.location
+          << (opts.pretty ? ") in " : ")in ") << interpolator.type->name() << " "
+          << output::glsl::varying_name{interpolator.location, interpolator.name(), names}
           << (opts.pretty ? ";\n" : ";");
     }
     break;
@@ -119,7 +221,7 @@ void FragmentDeclaration::to_glsl(std::ostream& out, const Module& mod, bool pre
 
     out << output::glsl::indent{opts.indent} << "layout(location=" << prop.index
         << (opts.pretty ? ") out " : ")out ") << prop.type->name() << " "
-        << output::glsl::fragment_output_name{static_cast<uint32_t>(prop.index), prop.name}
+        << output::glsl::fragment_output_name{static_cast<uint32_t>(prop.index), prop.name, names}
         << (opts.pretty ? ";\n" : ";");
   }
 
@@ -136,28 +238,34 @@ void FragmentDeclaration::to_glsl(std::ostream& out, const Module& mod, bool pre
         continue;
       }
 
-      const util::memory::Ref<type::StructType> struct_type = input.type;
-      out << output::glsl::indent{main_opts.indent} << input.type->name() << " "
-          << output::glsl::mangle_name{input.name} << (main_opts.pretty ? ";\n" : ";");
-      for (const auto& prop : struct_type->properties()) {
-        out << output::glsl::indent{main_opts.indent} << output::glsl::mangle_name{input.name}
-            << "." << prop.name << (main_opts.pretty ? " = " : "=")
-            << output::glsl::varying_name{static_cast<uint32_t>(prop.index), prop.name}
-            << (main_opts.pretty ? ";\n" : ";");
+      out << output::glsl::indent{main_opts.indent} << output::glsl::type_name{input.type, names}
+          << " " << output::glsl::mangle_name{input.name, names}
+          << (main_opts.pretty ? ";\n" : ";");
+      for (const auto& interpolator : varyings_.interpolators) {
+        for (const auto& varying : interpolator.varyings) {
+          out << output::glsl::indent{main_opts.indent}
+              << output::glsl::mangle_name{input.name, names} << "."
+              << output::glsl::member_name{varying.name, names} << (main_opts.pretty ? " = " : "=")
+              << output::glsl::varying_name{interpolator.location, interpolator.name(), names};
+          if (interpolator.packed()) {
+            out << "." << Interpolator::swizzle(varying);
+          }
+          out << (main_opts.pretty ? ";\n" : ";");
+        }
       }
     }
     if (main_opts.pretty) {
       out << "\n";
     }
     for (const auto& stmt : implementation_) {
-      out << stmt->to_glsl(main_opts);
+      stmt->to_glsl(out, main_opts);
     }
 
     out << (opts.pretty ? "}\n" : "}");
   }
 }
 
-void FragmentDeclaration::to_metal(std::ostream& out, const Module& mod,
+void FragmentDeclaration::to_metal(output::Writer& out, const Module& mod,
                                    const PipelineDeclaration& pipeline) const {
   const output::metal::Options opts{mod, nullptr, this, 0};
 
@@ -166,6 +274,10 @@ void FragmentDeclaration::to_metal(std::ostream& out, const Module& mod,
 
   bool first = true;
   for (const auto& input : inputs_) {
+    if (input.input_type == decl::FragmentInputType::Constant) {
+      // Declared as locals instead, see below.
+      continue;
+    }
     if (!first) {
       out << ", ";
     } else {
@@ -173,14 +285,26 @@ void FragmentDeclaration::to_metal(std::ostream& out, const Module& mod,
     }
 
     if (input.input_type == decl::FragmentInputType::Varying) {
+      // Unless the struct can be passed as it is, it's gathered from the interpolators below.
       std::string short_name = name().substr(0, name().size() - 5);
-      out << short_name << "_v " << output::metal::mangle_name{input.name} << " [[ stage_in ]]";
+      out << short_name << "_v ";
+      if (varyings_.direct) {
+        out << output::metal::mangle_name{input.name};
+      } else {
+        out << "in";
+      }
+      out << " [[ stage_in ]]";
     }
     if (input.input_type == decl::FragmentInputType::Uniform) {
       out << "constant " << input.type->metal_name() << "& "
           << output::metal::mangle_name{input.name} << " [[ buffer("
           << output::metal::uniform_binding(pipeline, input.index) << ") ]]";
     }
+    if (input.input_type == decl::FragmentInputType::Storage) {
+      out << "const device " << input.type->metal_name() << "& "
+          << output::metal::mangle_name{input.name} << " [[ buffer("
+          << output::metal::storage_binding(pipeline, input.index) << ") ]]";
+    }
     if (input.input_type == decl::FragmentInputType::Texture) {
       out << "texture2d<float> " << output::metal::mangle_name{input.name} << " [[ texture("
           << input.index << ") ]], "
@@ -189,10 +313,156 @@ void FragmentDeclaration::to_metal(std::ostream& out, const Module& mod,
     }
   }
   out << ") {\n";
+  for (const auto& input : inputs_) {
+    if (input.input_type == decl::FragmentInputType::Constant) {
+      output::metal::declare_constant(out, input.type, input.name,
+                                      static_cast<uint32_t>(input.index), input.value);
+    }
+  }
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::FragmentInputType::Varying || varyings_.direct) {
+      continue;
+    }
+
+    out << output::metal::indent{1} << input.type->metal_name() << " "
+        << output::metal::mangle_name{input.name} << ";\n";
+    for (const auto& interpolator : varyings_.interpolators) {
+      for (const auto& varying : interpolator.varyings) {
+        out << output::metal::indent{1} << output::metal::mangle_name{input.name} << "."
+            << varying.name << " = in." << interpolator.name();
+        if (interpolator.packed()) {
+          out << "." << Interpolator::swizzle(varying);
+        }
+        out << ";\n";
+      }
+    }
+    out << "\n";
+  }
   for (const auto& stmt : implementation_) {
-    out << stmt->to_metal(opts);
+    stmt->to_metal(out, opts);
   }
   out << "}\n";
 }
 
+void FragmentDeclaration::to_spirv(output::spirv::Builder& builder, const Module& mod) const {
+  output::spirv::Function      function;
+  const output::spirv::Options opts{mod, nullptr, this, builder, function};
+  std::vector<uint32_t>        interface;
+
+  // Bind the constants, which are shared with the other stage of the pipeline.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::FragmentInputType::Constant) {
+      continue;
+    }
+
+    const output::spirv::ValueType type = output::spirv::ValueType::from(input.type);
+    const uint32_t id = builder.spec_constant(type, static_cast<uint32_t>(input.index), input.value,
+                                              output::spirv::mangle_name(input.name));
+    function.constants.insert_or_assign(input.name, output::spirv::Value{id, type});
+  }
+
+  // Bind the uniform blocks.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::FragmentInputType::Uniform) {
+      continue;
+    }
+
+    const util::memory::Ref<type::StructType> struct_type = input.type;
+    const uint32_t var =
+        builder.variable(spv::StorageClass::Uniform, builder.type_block(struct_type),
+                         output::spirv::mangle_name(input.name));
+    builder.decorate(var, spv::Decoration::DescriptorSet, {0});
+    builder.decorate(var, spv::Decoration::Binding, {static_cast<uint32_t>(input.index)});
+    function.scope.insert_or_assign(
+        input.name, output::spirv::Pointer{var, output::spirv::ValueType::from(input.type),
+                                           spv::StorageClass::Uniform, {},
+                                           output::spirv::Layout::Std140});
+  }
+
+  // Bind the storage blocks.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::FragmentInputType::Storage) {
+      continue;
+    }
+
+    const util::memory::Ref<type::StructType> struct_type = input.type;
+    function.scope.insert_or_assign(
+        input.name, output::spirv::storage(builder, struct_type, input.name,
+                                           static_cast<uint32_t>(input.index), true));
+  }
+
+  // Bind the textures.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::FragmentInputType::Texture) {
+      continue;
+    }
+
+    const output::spirv::ValueType type = output::spirv::ValueType::from(input.type);
+    const uint32_t var = builder.variable(spv::StorageClass::UniformConstant, builder.type_id(type),
+                                          output::spirv::mangle_name(input.name));
+    builder.decorate(var, spv::Decoration::DescriptorSet, {1});
+    builder.decorate(var, spv::Decoration::Binding, {static_cast<uint32_t>(input.index)});
+    function.scope.insert_or_assign(
+        input.name, output::spirv::Pointer{var, type, spv::StorageClass::UniformConstant, {}});
+  }
+
+  // Bind the varyings, and gather them into their struct.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::FragmentInputType::Varying) {
+      continue;
+    }
+
+    const output::spirv::Pointer local = output::spirv::local(
+        opts, output::spirv::ValueType::from(input.type), output::spirv::mangle_name(input.name));
+    for (const auto& interpolator : varyings_.interpolators) {
+      const output::spirv::ValueType type = output::spirv::ValueType::from(interpolator.type);
+      const uint32_t var = builder.variable(
+          spv::StorageClass::Input, builder.type_id(type),
+          output::spirv::varying_name(interpolator.location, interpolator.name()));
+      builder.decorate(var, spv::Decoration::Location, {interpolator.location});
+      interface.push_back(var);
+
+      const output::spirv::Value value{opts.emit(spv::Op::OpLoad, type, {var}), type};
+      for (const auto& varying : interpolator.varyings) {
+        output::spirv::store(opts, output::spirv::access(opts, local, varying.name),
+                             interpolator.packed()
+                                 ? output::spirv::extract(opts, value,
+                                                          Interpolator::swizzle(varying))
+                                 : value);
+      }
+    }
+    function.scope.insert_or_assign(input.name, local);
+    break;
+  }
+
+  // Bind the outputs.
+  // This is the decomposed form of the return struct type from the fragment function.
+  const util::memory::Ref<type::StructType> return_struct_type = return_type_;
+  for (const auto& prop : return_struct_type->properties()) {
+    if (prop.index < 0) {
+      // Skip properties that don't have an output index.
+      continue;
+    }
+
+    const uint32_t var = builder.variable(
+        spv::StorageClass::Output, builder.type_id(output::spirv::ValueType::from(prop.type)),
+        output::spirv::fragment_output_name(static_cast<uint32_t>(prop.index), prop.name));
+    builder.decorate(var, spv::Decoration::Location, {static_cast<uint32_t>(prop.index)});
+    interface.push_back(var);
+    function.outputs.insert_or_assign(prop.index, var);
+  }
+
+  // Finally output the function implementation.
+  for (const auto& stmt : implementation_) {
+    output::spirv::ensure_block(opts);
+    stmt->to_spirv(opts);
+  }
+
+  // The entry point is named after the pipeline, matching the vulkan runtime.
+  const uint32_t id = builder.add_function(function, name());
+  builder.entry_point(spv::ExecutionModel::Fragment, id, name().substr(0, name().size() - 5),
+                      interface);
+  builder.execution_mode(id, spv::ExecutionMode::OriginUpperLeft);
+}
+
 }  // namespace crystal::compiler::ast::decl
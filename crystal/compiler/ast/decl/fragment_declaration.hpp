@@ -3,11 +3,20 @@
 #include <iostream>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "crystal/compiler/ast/decl/declaration.hpp"
+#include "crystal/compiler/ast/decl/varyings.hpp"
+#include "crystal/compiler/ast/opt/opt.hpp"
+#include "crystal/compiler/ast/output/glsl.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
+#include "crystal/compiler/ast/output/writer.hpp"
 #include "crystal/compiler/ast/stmt/statement.hpp"
+#include "crystal/compiler/ast/symbol.hpp"
 #include "crystal/compiler/ast/type/type.hpp"
+#include "crystal/compiler/ast/type/type_set.hpp"
 #include "util/memory/ref_count.hpp"
 
 namespace crystal::compiler::ast {
@@ -23,6 +32,8 @@ enum class FragmentInputType {
   Varying,
   Uniform,
   Texture,
+  Storage,  // Always readonly, see `PipelineStorage`.
+  Constant,
 };
 
 struct FragmentInput {
@@ -30,21 +41,27 @@ struct FragmentInput {
   util::memory::Ref<type::Type> type;
   FragmentInputType             input_type;
   int32_t                       index;
+  double                        value = 0.0;  // The default of a constant.
 
   FragmentInput(std::string_view name, util::memory::Ref<type::Type> type,
-                FragmentInputType input_type, int32_t index)
-      : name(name), type(type), input_type(input_type), index(index) {}
+                FragmentInputType input_type, int32_t index, double value = 0.0)
+      : name(name), type(type), input_type(input_type), index(index), value(value) {}
 };
 
 class FragmentDeclaration : public Declaration {
-  util::memory::Ref<type::Type>                   return_type_;
-  std::vector<FragmentInput>                      inputs_;
-  std::vector<util::memory::Ref<stmt::Statement>> implementation_;
+  util::memory::Ref<type::Type> return_type_;
+  std::vector<FragmentInput>    inputs_;
+  std::vector<stmt::Statement*> implementation_;
+  VaryingLayout                 varyings_;
+
+  // The feature toggles of the pipeline, which are only declared in the function that each of its
+  // variants is specialized from.
+  std::vector<std::string> features_;
 
 public:
-  FragmentDeclaration(util::memory::Ref<type::Type>                     return_type,
-                      std::vector<decl::FragmentInput>&&                inputs,
-                      std::vector<util::memory::Ref<stmt::Statement>>&& implementation)
+  FragmentDeclaration(util::memory::Ref<type::Type>      return_type,
+                      std::vector<decl::FragmentInput>&& inputs,
+                      std::vector<stmt::Statement*>&&    implementation)
       : Declaration(""),
         return_type_(return_type),
         inputs_(std::move(inputs)),
@@ -53,19 +70,56 @@ public:
   virtual ~FragmentDeclaration() = default;
 
   [[nodiscard]] util::memory::Ref<type::Type>    return_type() const { return return_type_; }
-  [[nodiscard]] const std::vector<FragmentInput> inputs() const { return inputs_; }
+  [[nodiscard]] const std::vector<FragmentInput>& inputs() const { return inputs_; }
 
   void set_name(const std::string_view name) { name_ = name; }
 
+  // How the varyings struct is passed between the functions of the pipeline.
+  [[nodiscard]] const VaryingLayout& varyings() const { return varyings_; }
+  void set_varyings(VaryingLayout varyings) { varyings_ = std::move(varyings); }
+
   void add_uniform(util::memory::Ref<type::Type> type, std::string name, int32_t index) {
     inputs_.emplace_back(name, type, FragmentInputType::Uniform, index);
   }
   void add_texture(util::memory::Ref<type::Type> type, std::string name, int32_t index) {
     inputs_.emplace_back(name, type, FragmentInputType::Texture, index);
   }
+  void add_storage(util::memory::Ref<type::Type> type, std::string name, int32_t index) {
+    inputs_.emplace_back(name, type, FragmentInputType::Storage, index);
+  }
+  void add_constant(util::memory::Ref<type::Type> type, std::string name, int32_t actual,
+                    double value) {
+    inputs_.emplace_back(name, type, FragmentInputType::Constant, actual, value);
+  }
+
+  void add_feature(std::string name) { features_.emplace_back(std::move(name)); }
+
+  // Copies the function, with every reference to a feature replaced by its value in `values`. The
+  // copy takes only the varyings, as the pipeline adds the rest of the inputs again, and is yet to
+  // be type checked.
+  [[nodiscard]] util::memory::Ref<FragmentDeclaration> specialize(
+      Module& mod, const absl::flat_hash_map<Symbol, bool>& values) const;
+
+  // Resolves the types of, and the declarations referred to by, every expression in the body.
+  void typecheck(Module& mod);
+
+  // Folds constants, and computes repeated subexpressions once, in the body. Requires
+  // `typecheck`.
+  void optimize(Module& mod);
+
+  // Removes the statements whose results are never needed. Afterwards `live` holds what the body
+  // reads from the inputs. Requires `typecheck`.
+  void eliminate_dead_code(opt::Liveness& live);
+
+  // Adds the types of the inputs, the output and the locals of the function to `types`.
+  void add_types(type::TypeSet& types) const;
 
-  void to_glsl(std::ostream& out, const Module& mod, bool pretty, bool vulkan) const;
-  void to_metal(std::ostream& out, const Module& mod, const PipelineDeclaration& pipeline) const;
+  // Shortens every identifier with `names` when it's set, other than those of the uniform blocks.
+  void to_glsl(output::Writer& out, const Module& mod, bool pretty, bool vulkan,
+               output::glsl::Names* names = nullptr) const;
+  void to_metal(output::Writer& out, const Module& mod,
+                const PipelineDeclaration& pipeline) const;
+  void to_spirv(output::spirv::Builder& builder, const Module& mod) const;
 };
 
 }  // namespace crystal::compiler::ast::decl
@@ -1,15 +1,25 @@
 #include "crystal/compiler/ast/decl/pipeline_declaration.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <sstream>
+#include <string>
 #include <tuple>
+#include <utility>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/hash/hash.h"
+#include "crystal/compiler/ast/decl/compute_declaration.hpp"
 #include "crystal/compiler/ast/decl/fragment_declaration.hpp"
+#include "crystal/compiler/ast/decl/varyings.hpp"
 #include "crystal/compiler/ast/decl/vertex_declaration.hpp"
 #include "crystal/compiler/ast/module.hpp"
+#include "crystal/compiler/ast/opt/opt.hpp"
 #include "crystal/compiler/ast/output/metal.hpp"
 #include "crystal/compiler/ast/type/struct_type.hpp"
+#include "crystal/compiler/ast/type/type_set.hpp"
 
 namespace crystal::compiler::ast::decl {
 
@@ -138,29 +148,158 @@ void PipelineSettings::set_property(const std::string_view name, const bool valu
   }
 }
 
+void PipelineSettings::add_constant(util::memory::Ref<type::Type> type, const std::string_view name,
+                                    const uint32_t id, const ConstantValue value,
+                                    const uint32_t actual) {
+  const bool scalar = type->count() == 1 && (type->kind() == type::Kind::Bool ||
+                                             type->kind() == type::Kind::Int ||
+                                             type->kind() == type::Kind::Float);
+  if (!scalar) {
+    util::msg::fatal("constant [", name, "] must be a bool, int or float");
+  }
+
+  // Integers are also accepted for floats, as they are everywhere else.
+  const bool valid = value.kind == type->kind() ||
+                     (type->kind() == type::Kind::Float && value.kind == type::Kind::Int);
+  if (!valid) {
+    util::msg::fatal("invalid default value for constant [", name, "]");
+  }
+
+  if (type->kind() == type::Kind::Int && std::fabs(value.value) > INT32_MAX) {
+    util::msg::fatal("default value of constant [", name, "] is out of range");
+  }
+
+  for (const auto& constant : constants) {
+    if (constant.id == id) {
+      util::msg::fatal("constants [", constant.name, "] and [", name, "] share the id [", id, "]");
+    }
+  }
+  constants.push_back(
+      PipelineConstant{std::move(type), std::string(name), id, actual, value.value});
+}
+
+void PipelineSettings::add_features(const std::string_view block,
+                                    const std::vector<std::string>& names) {
+  if (block != "features") {
+    util::msg::fatal("unknown pipeline block [", block, "]");
+  }
+
+  features.insert(features.end(), names.begin(), names.end());
+  if (features.size() > MAX_FEATURES) {
+    util::msg::fatal("a pipeline can have at most [", MAX_FEATURES, "] features");
+  }
+}
+
+crystal::common::proto::ConstantType PipelineConstant::proto_type() const {
+  switch (type->kind()) {
+    case type::Kind::Bool:
+      return crystal::common::proto::CONSTANT_BOOL;
+    case type::Kind::Int:
+      return crystal::common::proto::CONSTANT_INT;
+    default:
+      return crystal::common::proto::CONSTANT_FLOAT;
+  }
+}
+
 PipelineDeclaration::PipelineDeclaration(std::string_view name, const PipelineSettings& settings)
     : Declaration(name),
       vertex_function_(settings.vertex_function),
       fragment_function_(settings.fragment_function),
+      compute_function_(settings.compute_function),
       uniforms_(settings.uniforms),
-      textures_(settings.textures) {
+      textures_(settings.textures),
+      storage_buffers_(settings.storage_buffers),
+      constants_(settings.constants),
+      features_(settings.features) {
+  if (compute_function_ != nullptr) {
+    if (vertex_function_ != nullptr || fragment_function_ != nullptr) {
+      util::msg::fatal("pipeline [", name,
+                       "] can not have a compute function along with vertex or fragment functions");
+    }
+    if (!textures_.empty()) {
+      util::msg::fatal("compute pipeline [", name, "] can not use textures");
+    }
+  }
+  for (const auto& storage : storage_buffers_) {
+    if (storage.type->kind() != type::Kind::Struct || storage.type->builtin()) {
+      util::msg::fatal("storage buffer [", storage.name, "] must be a struct");
+    }
+    // Vulkan only allows the vertex stage to write to buffers with an optional feature.
+    if (compute_function_ == nullptr && !storage.readonly) {
+      util::msg::fatal("storage buffer [", storage.name, "] of pipeline [", name,
+                       "] must be readonly, as only a compute function can write to one");
+    }
+  }
+  for (const auto& [type, name, index] : uniforms_) {
+    if (type::runtime_sized(type)) {
+      util::msg::fatal("uniform [", name, "] can not be of type [", type->name(),
+                       "], as it ends in a runtime sized array");
+    }
+  }
+
   if (vertex_function_ != nullptr) {
     vertex_function_->set_name(std::string(name) + "_vert");
+    for (const auto& feature : settings.features) {
+      vertex_function_->add_feature(feature);
+    }
     for (const auto& [type, name, index] : settings.uniforms) {
       vertex_function_->add_uniform(type, name, index);
     }
+    for (const auto& storage : settings.storage_buffers) {
+      vertex_function_->add_storage(storage.type, storage.name, storage.binding);
+    }
+    for (const auto& constant : settings.constants) {
+      vertex_function_->add_constant(constant.type, constant.name, constant.actual, constant.value);
+    }
   }
 
   if (fragment_function_ != nullptr) {
     fragment_function_->set_name(std::string(name) + "_frag");
+    for (const auto& feature : settings.features) {
+      fragment_function_->add_feature(feature);
+    }
     for (const auto& [type, name, index] : settings.uniforms) {
       fragment_function_->add_uniform(type, name, index);
     }
+    for (const auto& storage : settings.storage_buffers) {
+      fragment_function_->add_storage(storage.type, storage.name, storage.binding);
+    }
+    for (const auto& constant : settings.constants) {
+      fragment_function_->add_constant(constant.type, constant.name, constant.actual,
+                                       constant.value);
+    }
     for (const auto& [type, name, index] : settings.textures) {
       fragment_function_->add_texture(type, name, index);
     }
   }
 
+  if (compute_function_ != nullptr) {
+    compute_function_->set_name(std::string(name) + "_comp");
+    for (const auto& feature : settings.features) {
+      compute_function_->add_feature(feature);
+    }
+    for (const auto& [type, name, index] : settings.uniforms) {
+      compute_function_->add_uniform(type, name, index);
+    }
+    for (const auto& storage : settings.storage_buffers) {
+      compute_function_->add_storage(storage.type, storage.name, storage.binding,
+                                     storage.readonly);
+    }
+    for (const auto& constant : settings.constants) {
+      compute_function_->add_constant(constant.type, constant.name, constant.actual,
+                                      constant.value);
+    }
+  }
+
+  // The vertex function's return type is the varyings struct, which the fragment function takes.
+  if (vertex_function_ != nullptr) {
+    const util::memory::Ref<type::StructType> varyings = vertex_function_->return_type();
+    vertex_function_->set_varyings(unpacked_varyings(varyings));
+    if (fragment_function_ != nullptr) {
+      fragment_function_->set_varyings(unpacked_varyings(varyings));
+    }
+  }
+
   cull_mode_         = settings.cull_mode;
   winding_           = settings.winding;
   depth_test_        = settings.depth_test;
@@ -171,6 +310,169 @@ PipelineDeclaration::PipelineDeclaration(std::string_view name, const PipelineSe
   blend_dst_         = settings.blend_dst;
 }
 
+std::vector<util::memory::Ref<PipelineDeclaration>> PipelineDeclaration::distinct_variants() const {
+  std::vector<util::memory::Ref<PipelineDeclaration>> distinct;
+  for (const auto& variant : variants_) {
+    if (std::find(distinct.begin(), distinct.end(), variant) == distinct.end()) {
+      distinct.push_back(variant);
+    }
+  }
+  return distinct;
+}
+
+void PipelineDeclaration::typecheck(Module& mod) {
+  if (vertex_function_ != nullptr) {
+    vertex_function_->typecheck(mod);
+  }
+  if (fragment_function_ != nullptr) {
+    fragment_function_->typecheck(mod);
+  }
+  if (compute_function_ != nullptr) {
+    compute_function_->typecheck(mod);
+  }
+  if (features_.empty()) {
+    return;
+  }
+
+  variants_.clear();
+  for (uint32_t mask = 0; mask < (1u << features_.size()); ++mask) {
+    absl::flat_hash_map<Symbol, bool> values;
+    for (size_t i = 0; i < features_.size(); ++i) {
+      values.emplace(mod.intern(features_[i]), (mask & (1u << i)) != 0);
+    }
+
+    PipelineSettings settings;
+    if (vertex_function_ != nullptr) {
+      settings.vertex_function = vertex_function_->specialize(mod, values);
+    }
+    if (fragment_function_ != nullptr) {
+      settings.fragment_function = fragment_function_->specialize(mod, values);
+    }
+    if (compute_function_ != nullptr) {
+      settings.compute_function = compute_function_->specialize(mod, values);
+    }
+    settings.uniforms          = uniforms_;
+    settings.textures          = textures_;
+    settings.storage_buffers   = storage_buffers_;
+    settings.constants         = constants_;
+    settings.cull_mode         = cull_mode_;
+    settings.winding           = winding_;
+    settings.depth_test        = depth_test_;
+    settings.depth_write       = depth_write_;
+    settings.depth_bias        = depth_bias_;
+    settings.depth_slope_scale = depth_slope_scale_;
+    settings.blend_src         = blend_src_;
+    settings.blend_dst         = blend_dst_;
+
+    // The variant without any features keeps the name of the pipeline.
+    const std::string variant_name = mask == 0 ? name() : name() + "_" + std::to_string(mask);
+    const auto variant = util::memory::Ref<PipelineDeclaration>::make(variant_name, settings);
+    variant->typecheck(mod);
+    variants_.push_back(variant);
+  }
+  merge_variants(mod);
+}
+
+void PipelineDeclaration::merge_variants(const Module& mod) {
+  std::vector<std::string>                            sources;
+  std::vector<util::memory::Ref<PipelineDeclaration>> distinct;
+  for (auto& variant : variants_) {
+    output::Writer out;
+    if (variant->vertex_function_ != nullptr) {
+      variant->vertex_function_->to_glsl(out, mod, false, false);
+    }
+    out << "\n";
+    if (variant->fragment_function_ != nullptr) {
+      variant->fragment_function_->to_glsl(out, mod, false, false);
+    }
+    if (variant->compute_function_ != nullptr) {
+      variant->compute_function_->to_glsl(out, mod, false, false);
+    }
+
+    const std::string source = out.take();
+    const auto        it     = std::find(sources.begin(), sources.end(), source);
+    if (it != sources.end()) {
+      variant = distinct[it - sources.begin()];
+      continue;
+    }
+    sources.push_back(source);
+    distinct.push_back(variant);
+  }
+}
+
+void PipelineDeclaration::optimize(Module& mod) {
+  if (compute_function_ != nullptr) {
+    compute_function_->optimize(mod);
+    compute_function_->eliminate_dead_code(mod);
+    return;
+  }
+
+  if (vertex_function_ == nullptr) {
+    if (fragment_function_ != nullptr) {
+      fragment_function_->optimize(mod);
+    }
+    return;
+  }
+
+  vertex_function_->optimize(mod);
+  const util::memory::Ref<type::StructType> varyings = vertex_function_->return_type();
+
+  // Find the properties of the varyings that the fragment function reads, ignoring any reads that
+  // are dead themselves.
+  absl::flat_hash_set<Symbol> needed;
+  if (fragment_function_ != nullptr) {
+    fragment_function_->optimize(mod);
+
+    opt::Liveness live;
+    fragment_function_->eliminate_dead_code(live);
+    for (const auto& input : fragment_function_->inputs()) {
+      if (input.input_type != FragmentInputType::Varying) {
+        continue;
+      }
+      if (input.type != vertex_function_->return_type()) {
+        // The varyings can't be matched up by name.
+        return;
+      }
+
+      const Symbol symbol = mod.intern(input.name);
+      for (const auto& prop : varyings->properties()) {
+        const Symbol property = mod.intern(prop.name);
+        if (live.needed(symbol, property)) {
+          needed.insert(property);
+        }
+      }
+    }
+  }
+
+  // The position is always needed for rasterization.
+  for (const auto& prop : varyings->properties()) {
+    if (prop.index == 0) {
+      needed.insert(mod.intern(prop.name));
+    }
+  }
+
+  opt::Liveness live(needed);
+  vertex_function_->eliminate_dead_code(live);
+
+  VaryingLayout layout = packed_varyings(mod, varyings, needed);
+  if (fragment_function_ != nullptr) {
+    fragment_function_->set_varyings(layout);
+  }
+  vertex_function_->set_varyings(std::move(layout));
+}
+
+void PipelineDeclaration::add_types(type::TypeSet& types) const {
+  if (vertex_function_ != nullptr) {
+    vertex_function_->add_types(types);
+  }
+  if (fragment_function_ != nullptr) {
+    fragment_function_->add_types(types);
+  }
+  if (compute_function_ != nullptr) {
+    compute_function_->add_types(types);
+  }
+}
+
 void PipelineDeclaration::to_cpphdr(std::ostream& out, const Module& mod) const {
   // Iterate over the vertex/fragment function inputs and precalculate all of the necessary
   // information.
@@ -275,6 +577,42 @@ void PipelineDeclaration::to_cpphdr(std::ostream& out, const Module& mod) const
   std::string blend_src_out = "One";
   std::string blend_dst_out = "Zero";
 
+  if (!constants_.empty()) {
+    out << "// The ids of the constants, for overriding them with `PipelineDesc::constants`.\n"
+        << "struct " << name() << "_constants {\n";
+    for (const auto& constant : constants_) {
+      out << "    static constexpr uint32_t " << constant.name << " = " << constant.id << ";\n";
+    }
+    out << "};\n\n";
+  }
+
+  if (!features_.empty()) {
+    out << "// The bits of `PipelineDesc::features`, which select the variant of the pipeline.\n"
+        << "struct " << name() << "_features {\n";
+    for (size_t i = 0; i < features_.size(); ++i) {
+      out << "    static constexpr uint32_t " << features_[i] << " = 1u << " << i << ";\n";
+    }
+    out << "};\n\n";
+  }
+
+  if (compute_function_ != nullptr) {
+    const auto& size = compute_function_->workgroup_size();
+    out << "// The number of invocations in each workgroup, for sizing `CommandBuffer::dispatch`.\n"
+        << "struct " << name() << "_workgroup_size {\n"
+        << "    static constexpr uint32_t x = " << size[0] << ";\n"
+        << "    static constexpr uint32_t y = " << size[1] << ";\n"
+        << "    static constexpr uint32_t z = " << size[2] << ";\n"
+        << "};\n\n";
+
+    // The defaults are already part of the shader.
+    out << "const crystal::ComputePipelineDesc " << name() << "_desc{\n"
+        << "    /* .name      = */ \"" << name() << "\",\n"
+        << "    /* .constants = */ {},\n"
+        << "    /* .features  = */ 0,\n"
+        << "};\n\n";
+    return;
+  }
+
   out << "const crystal::PipelineDesc " << name() << "_desc{\n"
       << "    /* .name              = */ \"" << name() << "\",\n"
       << "    /* .cull_mode         = */ crystal::CullMode::" << cull_out << ",\n"
@@ -333,10 +671,20 @@ void PipelineDeclaration::to_cpphdr(std::ostream& out, const Module& mod) const
     out << "    },\n";
   }
 
+  // The defaults are already part of the shaders.
+  out << "    /* .constants         = */ {},\n";
+
+  out << "    /* .features          = */ 0,\n";
+
   out << "};\n\n";
 }
 
-void PipelineDeclaration::to_metal(std::ostream& out, const Module& mod) const {
+void PipelineDeclaration::to_metal(output::Writer& out, const Module& mod) const {
+  if (compute_function_ != nullptr) {
+    compute_function_->to_metal(out, mod, *this);
+    return;
+  }
+
   vertex_function_->to_metal(out, mod, *this);
 
   if (fragment_function_ != nullptr) {
@@ -345,20 +693,30 @@ void PipelineDeclaration::to_metal(std::ostream& out, const Module& mod) const {
 }
 
 void PipelineDeclaration::make_opengl_crystallib(crystal::common::proto::GLPipeline& pipeline_pb,
-                                                 const Module&                       mod) const {
+                                                 const Module& mod, const bool minify) const {
   pipeline_pb.set_name(name());
 
-  {  // Vertex shader.
-    std::ostringstream out;
-    vertex_function_->to_glsl(out, mod, false, false);
-    pipeline_pb.set_vertex_source(out.str());
+  // Both stages share their short names, so that the varyings still match up by name.
+  output::glsl::Names  minified_names;
+  output::glsl::Names* names = minify ? &minified_names : nullptr;
+
+  if (compute_function_ != nullptr) {  // Compute shader.
+    output::Writer out;
+    compute_function_->to_glsl(out, mod, false, false, names);
+    pipeline_pb.set_compute_source(out.take());
+  }
+
+  if (vertex_function_ != nullptr) {  // Vertex shader.
+    output::Writer out;
+    vertex_function_->to_glsl(out, mod, false, false, names);
+    pipeline_pb.set_vertex_source(out.take());
     // std::cout << "vertex=\n" << out.str() << std::endl;
   }
 
   if (fragment_function_ != nullptr) {  // Fragment shader.
-    std::ostringstream out;
-    fragment_function_->to_glsl(out, mod, false, false);
-    pipeline_pb.set_fragment_source(out.str());
+    output::Writer out;
+    fragment_function_->to_glsl(out, mod, false, false, names);
+    pipeline_pb.set_fragment_source(out.take());
     // std::cout << "fragment=\n" << out.str() << std::endl;
   }
 
@@ -377,12 +735,31 @@ void PipelineDeclaration::make_opengl_crystallib(crystal::common::proto::GLPipel
     for (const auto& [type, name, binding] : textures_) {
       crystal::common::proto::GLTexture* texture_pb = pipeline_pb.add_textures();
 
-      std::stringstream sstream;
-      sstream << output::glsl::mangle_name{name};
-      texture_pb->set_name(sstream.str());
+      output::Writer texture_name;
+      texture_name << output::glsl::mangle_name{name, names};
+      texture_pb->set_name(texture_name.take());
       texture_pb->set_binding(binding);
     }
   }
+
+  {  // Storage buffers, which are bound by the binding in their layout.
+    for (const auto& storage : storage_buffers_) {
+      crystal::common::proto::GLStorage* storage_pb = pipeline_pb.add_storage();
+      storage_pb->set_binding(storage.binding);
+    }
+  }
+
+  {  // Constants.
+    for (const auto& constant : constants_) {
+      crystal::common::proto::GLConstant* constant_pb = pipeline_pb.add_constants();
+
+      output::Writer constant_name;
+      constant_name << output::glsl::constant_name{constant.actual};
+      constant_pb->set_name(constant_name.take());
+      constant_pb->set_id(constant.id);
+      constant_pb->set_type(constant.proto_type());
+    }
+  }
 }
 
 }  // namespace crystal::compiler::ast::decl
@@ -8,6 +8,8 @@
 #include "crystal/common/pipeline_desc.hpp"
 #include "crystal/common/proto/proto.hpp"
 #include "crystal/compiler/ast/decl/declaration.hpp"
+#include "crystal/compiler/ast/output/writer.hpp"
+#include "crystal/compiler/ast/type/type.hpp"
 #include "util/memory/ref_count.hpp"
 
 namespace crystal::compiler::ast {
@@ -18,7 +20,7 @@ class Module;
 
 namespace crystal::compiler::ast::type {
 
-class Type;
+class TypeSet;
 
 }  // namespace crystal::compiler::ast::type
 
@@ -26,12 +28,46 @@ namespace crystal::compiler::ast::decl {
 
 class VertexDeclaration;
 class FragmentDeclaration;
+class ComputeDeclaration;
+
+// Every combination of a pipeline's features is compiled, so only a few of them are allowed.
+constexpr size_t MAX_FEATURES = 8;
+
+// The default value of a `const` parameter, as it was written in the source.
+struct ConstantValue {
+  type::Kind kind;
+  double     value;
+};
+
+// A `const` parameter of a pipeline, which its shaders read like a uniform, but which is fixed when
+// the pipeline is created. The runtime may override the default value by `id`.
+struct PipelineConstant {
+  util::memory::Ref<type::Type> type;
+  std::string                   name;
+  uint32_t                      id;
+  uint32_t                      actual;  // Unique within the module, as the pipelines share spir-v.
+  double                        value;
+
+  [[nodiscard]] crystal::common::proto::ConstantType proto_type() const;
+};
+
+// A `storage` buffer of a pipeline. The vertex and fragment functions can only use `readonly` ones.
+struct PipelineStorage {
+  util::memory::Ref<type::Type> type;
+  std::string                   name;
+  uint32_t                      binding;
+  bool                          readonly;
+};
 
 struct PipelineSettings {
   util::memory::Ref<VertexDeclaration>                                          vertex_function;
   util::memory::Ref<FragmentDeclaration>                                        fragment_function;
+  util::memory::Ref<ComputeDeclaration>                                         compute_function;
   std::vector<std::tuple<util::memory::Ref<type::Type>, std::string, uint32_t>> uniforms;
   std::vector<std::tuple<util::memory::Ref<type::Type>, std::string, uint32_t>> textures;
+  std::vector<PipelineStorage>                                                  storage_buffers;
+  std::vector<PipelineConstant>                                                 constants;
+  std::vector<std::string>                                                      features;
 
   CullMode   cull_mode         = CullMode::None;
   Winding    winding           = Winding::Clockwise;
@@ -45,13 +81,29 @@ struct PipelineSettings {
   void set_property(const std::string_view name, const std::string_view value);
   void set_property(const std::string_view name, const float value);
   void set_property(const std::string_view name, const bool value);
+
+  void add_constant(util::memory::Ref<type::Type> type, std::string_view name, uint32_t id,
+                    ConstantValue value, uint32_t actual);
+
+  // Adds the bool toggles listed in a `features { ... }` block, named `block`.
+  void add_features(std::string_view block, const std::vector<std::string>& names);
 };
 
+// A pipeline has either a vertex function, with an optional fragment function, or a compute
+// function on its own.
 class PipelineDeclaration : public Declaration {
   util::memory::Ref<VertexDeclaration>                                          vertex_function_;
   util::memory::Ref<FragmentDeclaration>                                        fragment_function_;
+  util::memory::Ref<ComputeDeclaration>                                         compute_function_;
   std::vector<std::tuple<util::memory::Ref<type::Type>, std::string, uint32_t>> uniforms_;
   std::vector<std::tuple<util::memory::Ref<type::Type>, std::string, uint32_t>> textures_;
+  std::vector<PipelineStorage>                                                  storage_buffers_;
+  std::vector<PipelineConstant>                                                 constants_;
+  std::vector<std::string>                                                      features_;
+
+  // The pipeline specialized for each feature mask, where masks whose code ends up identical share
+  // one declaration. Empty for a pipeline without features.
+  std::vector<util::memory::Ref<PipelineDeclaration>> variants_;
 
   CullMode   cull_mode_;
   Winding    winding_;
@@ -73,6 +125,9 @@ public:
   [[nodiscard]] const util::memory::Ref<FragmentDeclaration>& fragment_function() const {
     return fragment_function_;
   }
+  [[nodiscard]] const util::memory::Ref<ComputeDeclaration>& compute_function() const {
+    return compute_function_;
+  }
 
   [[nodiscard]] const std::vector<std::tuple<util::memory::Ref<type::Type>, std::string, uint32_t>>&
   uniforms() const {
@@ -82,12 +137,44 @@ public:
   textures() const {
     return textures_;
   }
+  [[nodiscard]] const std::vector<PipelineStorage>& storage_buffers() const {
+    return storage_buffers_;
+  }
+  [[nodiscard]] const std::vector<PipelineConstant>& constants() const { return constants_; }
+
+  // Bit `i` of a feature mask turns on `features()[i]`.
+  [[nodiscard]] const std::vector<std::string>& features() const { return features_; }
+
+  // Indexed by feature mask.
+  [[nodiscard]] const std::vector<util::memory::Ref<PipelineDeclaration>>& variants() const {
+    return variants_;
+  }
+
+  // The variants without duplicates, in the order of their lowest mask.
+  [[nodiscard]] std::vector<util::memory::Ref<PipelineDeclaration>> distinct_variants() const;
+
+  // Type checks the functions, then, for a pipeline with features, makes one copy of it per
+  // feature mask with the features replaced by their values, and type checks those too.
+  void typecheck(Module& mod);
+
+  // Shares one declaration between the variants whose code is identical. Compares the glsl, as it
+  // spells out everything that the other outputs depend on.
+  void merge_variants(const Module& mod);
+
+  // Optimizes the functions, then leaves out the varyings that the fragment function never reads,
+  // along with the vertex computations that only feed them, and packs the rest together. Requires
+  // the functions to be type checked.
+  void optimize(Module& mod);
+
+  // Adds the types that any of the functions use to `types`.
+  void add_types(type::TypeSet& types) const;
 
   void to_cpphdr(std::ostream& out, const Module& mod) const;
-  void to_metal(std::ostream& out, const Module& mod) const;
+  // The function constants are declared separately, as the variants of a pipeline share them.
+  void to_metal(output::Writer& out, const Module& mod) const;
 
-  void make_opengl_crystallib(crystal::common::proto::GLPipeline& pipeline_pb,
-                              const Module&                       mod) const;
+  void make_opengl_crystallib(crystal::common::proto::GLPipeline& pipeline_pb, const Module& mod,
+                              bool minify) const;
 };
 
 }  // namespace crystal::compiler::ast::decl
@@ -0,0 +1,126 @@
+#include "crystal/compiler/ast/decl/varyings.hpp"
+
+#include <algorithm>
+
+#include "crystal/compiler/ast/module.hpp"
+
+namespace crystal::compiler::ast::decl {
+
+namespace {
+
+// Whether the property can share an interpolator with others.
+bool packable(const type::StructProperty& prop) {
+  return prop.index != 0 && prop.type->kind() == type::Kind::Float && prop.type->count() < 4;
+}
+
+// The number of locations that a value of the type takes up.
+uint32_t locations(const type::Type& type) {
+  return type.kind() == type::Kind::Matrix ? type.count() : 1;
+}
+
+}  // namespace
+
+std::string Interpolator::name() const {
+  std::string name;
+  for (const auto& varying : varyings) {
+    if (!name.empty()) {
+      name += "_";
+    }
+    name += varying.name;
+  }
+  return name;
+}
+
+VaryingLayout unpacked_varyings(const type::StructType& varyings) {
+  VaryingLayout layout;
+  for (const auto& prop : varyings.properties()) {
+    if (prop.index < 0) {
+      // Skip properties that don't have an output index.
+      continue;
+    }
+    layout.interpolators.push_back(Interpolator{
+        static_cast<uint32_t>(prop.index), prop.type, {Varying{prop.name, prop.type, 0}}});
+  }
+  return layout;
+}
+
+VaryingLayout packed_varyings(Module& mod, const type::StructType& varyings,
+                              const absl::flat_hash_set<Symbol>& needed) {
+  struct Bin {
+    std::vector<const type::StructProperty*> props;
+    uint32_t                                 size = 0;
+  };
+
+  VaryingLayout                            layout;
+  std::vector<Bin>                         bins;
+  std::vector<const type::StructProperty*> small;
+  for (const auto& prop : varyings.properties()) {
+    if (prop.index < 0) {
+      continue;
+    }
+    if (prop.index != 0 && !needed.contains(mod.intern(prop.name))) {
+      layout.direct = false;
+      continue;
+    }
+
+    if (packable(prop)) {
+      small.push_back(&prop);
+    } else {
+      bins.push_back(Bin{{&prop}, 4});
+    }
+  }
+
+  // First fit, widest first, which is optimal for sizes of up to three in bins of four.
+  std::stable_sort(small.begin(), small.end(), [](const auto* a, const auto* b) {
+    return a->type->count() > b->type->count();
+  });
+  for (const auto* prop : small) {
+    const uint32_t count = prop->type->count();
+    auto           it    = std::find_if(bins.begin(), bins.end(),
+                                        [&](const Bin& bin) { return bin.size + count <= 4; });
+    if (it == bins.end()) {
+      it = bins.insert(bins.end(), Bin{});
+    }
+    it->props.push_back(prop);
+    it->size += count;
+  }
+
+  // Keep the interpolators in the order of the properties, which puts the position first.
+  const auto first_index = [](const Bin& bin) {
+    int32_t index = bin.props[0]->index;
+    for (const auto* prop : bin.props) {
+      index = std::min(index, prop->index);
+    }
+    return index;
+  };
+  std::stable_sort(bins.begin(), bins.end(), [&](const Bin& a, const Bin& b) {
+    return first_index(a) < first_index(b);
+  });
+
+  constexpr std::string_view VECTORS[] = {"", "float", "vec2", "vec3", "vec4"};
+  uint32_t                   location  = 0;
+  for (const auto& bin : bins) {
+    Interpolator interpolator{location, bin.props[0]->type, {}};
+    if (bin.props.size() > 1) {
+      interpolator.type = mod.find_type(VECTORS[bin.size]).value();
+      layout.direct     = false;
+    }
+
+    uint32_t offset = 0;
+    for (const auto* prop : bin.props) {
+      interpolator.varyings.push_back(Varying{prop->name, prop->type, offset});
+      offset += prop->type->count();
+    }
+
+    location += locations(interpolator.type);
+    layout.interpolators.push_back(std::move(interpolator));
+  }
+
+  // Nothing was left out or packed, so the properties may as well keep their own locations.
+  if (layout.direct) {
+    return unpacked_varyings(varyings);
+  }
+  return layout;
+}
+
+}  // namespace crystal::compiler::ast::decl
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "crystal/compiler/ast/symbol.hpp"
+#include "crystal/compiler/ast/type/struct_type.hpp"
+#include "crystal/compiler/ast/type/type.hpp"
+#include "util/memory/ref_count.hpp"
+
+namespace crystal::compiler::ast {
+
+class Module;
+
+}  // namespace crystal::compiler::ast
+
+namespace crystal::compiler::ast::decl {
+
+// A property of the varyings struct, as stored in an interpolator.
+struct Varying {
+  std::string                   name;
+  util::memory::Ref<type::Type> type;
+  uint32_t                      offset;  // The first component it occupies.
+};
+
+// One of the values that is passed from the vertex function to the fragment function.
+struct Interpolator {
+  uint32_t                      location;
+  util::memory::Ref<type::Type> type;
+  std::vector<Varying>          varyings;
+
+  // Whether it holds anything other than a single property as it is.
+  [[nodiscard]] bool packed() const { return varyings.size() != 1 || varyings[0].type != type; }
+
+  // The names of the properties it holds, joined with underscores.
+  [[nodiscard]] std::string name() const;
+
+  // The components that a property occupies, eg: `zw`.
+  [[nodiscard]] static std::string_view swizzle(const Varying& varying) {
+    return std::string_view("xyzw").substr(varying.offset, varying.type->count());
+  }
+};
+
+// How the varyings struct of a pipeline is passed between its functions. Unless the pipeline is
+// optimized, each indexed property gets an interpolator of its own at its index.
+struct VaryingLayout {
+  std::vector<Interpolator> interpolators;
+
+  // Whether the interpolators still match the indexed properties one to one, such that the struct
+  // can be passed as it is.
+  bool direct = true;
+};
+
+// Gives each indexed property an interpolator of its own at its index.
+[[nodiscard]] VaryingLayout unpacked_varyings(const type::StructType& varyings);
+
+// Keeps the position, at index zero, and the `needed` properties. The float scalars and vectors
+// of up to three components among them are packed into as few interpolators as possible.
+[[nodiscard]] VaryingLayout packed_varyings(Module& mod, const type::StructType& varyings,
+                                            const absl::flat_hash_set<Symbol>& needed);
+
+}  // namespace crystal::compiler::ast::decl
@@ -1,36 +1,144 @@
 #include "crystal/compiler/ast/decl/vertex_declaration.hpp"
 
+#include <algorithm>
+
 #include "crystal/compiler/ast/module.hpp"
 #include "crystal/compiler/ast/output/glsl.hpp"
 #include "crystal/compiler/ast/output/metal.hpp"
-#include "crystal/compiler/ast/output/print.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
 #include "crystal/compiler/ast/type/struct_type.hpp"
 
 namespace crystal::compiler::ast::decl {
 
-void VertexDeclaration::to_glsl(std::ostream& out, const Module& mod, bool pretty,
-                                bool vulkan) const {
-  const output::glsl::Options opts{mod, this, nullptr, 0, pretty, vulkan};
+VertexInput vertex_builtin(const std::string_view name, util::memory::Ref<type::Type> type,
+                           const std::string_view builtin) {
+  if (builtin != "instance_id") {
+    util::msg::fatal("unknown vertex builtin [", builtin, "]");
+  }
+  return VertexInput{name, type, VertexInputType::Instance, -1};
+}
+
+util::memory::Ref<VertexDeclaration> VertexDeclaration::specialize(
+    Module& mod, const absl::flat_hash_map<Symbol, bool>& values) const {
+  std::vector<VertexInput> inputs;
+  for (const auto& input : inputs_) {
+    if (input.input_type == VertexInputType::Vertex ||
+        input.input_type == VertexInputType::Instanced ||
+        input.input_type == VertexInputType::Instance) {
+      inputs.push_back(input);
+    }
+  }
+  return util::memory::Ref<VertexDeclaration>::make(
+      return_type_, std::move(inputs), stmt::specialize(mod.arena(), implementation_, values));
+}
+
+void VertexDeclaration::typecheck(Module& mod) {
+  check::Context ctx(mod, return_type_);
+  for (const auto& input : inputs_) {
+    check::BindingKind kind = check::BindingKind::Undefined;
+    switch (input.input_type) {
+      case VertexInputType::Vertex:
+        kind = check::BindingKind::Vertex;
+        break;
+      case VertexInputType::Instanced:
+        kind = check::BindingKind::Instanced;
+        break;
+      case VertexInputType::Instance:
+        if (input.type->kind() != type::Kind::Int || input.type->count() != 1) {
+          util::msg::fatal("vertex argument [", input.name, "] must be an int");
+        }
+        kind = check::BindingKind::Instance;
+        break;
+      case VertexInputType::Uniform:
+        kind = check::BindingKind::Uniform;
+        break;
+      case VertexInputType::Storage:
+        kind = check::BindingKind::ReadOnlyStorage;
+        break;
+      case VertexInputType::Constant:
+        kind = check::BindingKind::Constant;
+        break;
+      default:
+        util::msg::fatal("unhandled vertex input type [", static_cast<uint32_t>(input.input_type),
+                         "]");
+        break;
+    }
+    ctx.declare(mod.intern(input.name), check::Binding{kind, input.type, input.index});
+  }
+  for (const auto& feature : features_) {
+    ctx.declare(mod.intern(feature), check::Binding{check::BindingKind::Feature, ctx.bool_type()});
+  }
+
+  for (const auto& stmt : implementation_) {
+    stmt->typecheck(ctx);
+  }
+}
+
+void VertexDeclaration::optimize(Module& mod) {
+  opt::Context ctx(mod, return_type_);
+  for (const auto& stmt : implementation_) {
+    stmt->optimize(ctx);
+  }
+  opt::eliminate_common_subexpressions(ctx, implementation_);
+}
+
+void VertexDeclaration::eliminate_dead_code(opt::Liveness& live) {
+  opt::eliminate_dead_code(live, implementation_);
+}
+
+void VertexDeclaration::add_types(type::TypeSet& types) const {
+  types.add(return_type_);
+  for (const auto& input : inputs_) {
+    types.add(input.type);
+  }
+  stmt::add_types(types, implementation_);
+}
+
+void VertexDeclaration::to_glsl(output::Writer& out, const Module& mod, bool pretty,
+                                bool vulkan, output::glsl::Names* names) const {
+  const output::glsl::Options opts{mod, this, nullptr, 0, pretty, vulkan, names};
 
   // Output the version header. This must come first.
-  out << (opts.vulkan ? output::glsl::VK_HDR : output::glsl::GL_HDR);
+  const bool storage = std::any_of(inputs_.begin(), inputs_.end(), [](const VertexInput& input) {
+    return input.input_type == VertexInputType::Storage;
+  });
+  out << (storage ? output::glsl::CS_HDR
+                  : (opts.vulkan ? output::glsl::VK_HDR : output::glsl::GL_HDR));
   if (opts.pretty) {
     out << "\n";
   }
 
-  // TODO: Output only the used types.
-  // Output the struct types.
+  // Output the constants, which have to follow the version header directly, as they may start with
+  // preprocessor directives.
+  bool constants = false;
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::VertexInputType::Constant) {
+      continue;
+    }
+    output::glsl::declare_constant(out, opts, input.type, input.name,
+                                   static_cast<uint32_t>(input.index), input.value);
+    constants = true;
+  }
+  if (opts.pretty && constants) {
+    out << "\n";
+  }
+
+  // Output the struct types that are used. Those that end in a runtime sized array are only
+  // declared as storage blocks.
+  type::TypeSet types;
+  add_types(types);
   for (const auto& type : mod.types()) {
-    if (type->builtin()) {
+    if (!types.contains(type) || type::runtime_sized(type)) {
       continue;
     }
 
     {
-      out << "struct " << type->name() << (opts.pretty ? " {\n" : "{");
+      out << "struct " << output::glsl::type_name{type, names} << (opts.pretty ? " {\n" : "{");
       const util::memory::Ref<type::StructType> struct_type = type;
       const auto                                struct_opts = opts.incr_indent();
       for (const auto& prop : struct_type->properties()) {
-        out << output::glsl::indent{struct_opts.indent} << prop.type->name() << " " << prop.name
+        out << output::glsl::indent{struct_opts.indent} << output::glsl::type_name{prop.type, names}
+            << " " << output::glsl::member_name{prop.name, names}
             << (struct_opts.pretty ? ";\n" : ";");
       }
       out << (opts.pretty ? "};\n\n" : "};");
@@ -45,21 +153,36 @@ void VertexDeclaration::to_glsl(std::ostream& out, const Module& mod, bool prett
 
     {
       out << output::glsl::indent{opts.indent};
+      // The layout is spelled out to match the structs in the generated C++ header.
+      out << "layout(std140";
       if (opts.vulkan) {
-        out << "layout(set=0, binding=" << input.index << (opts.pretty ? ") " : ")");
+        out << ", set=0, binding=" << input.index;
       }
-      out << "uniform U" << input.index << (opts.pretty ? " {\n" : "{");
+      out << (opts.pretty ? ") " : ")") << "uniform U" << input.index
+          << (opts.pretty ? " {\n" : "{");
       const util::memory::Ref<type::StructType> struct_type = input.type;
       const auto                                struct_opts = opts.incr_indent();
       for (const auto& prop : struct_type->properties()) {
-        out << output::glsl::indent{struct_opts.indent} << prop.type->name() << " " << prop.name
+        out << output::glsl::indent{struct_opts.indent} << output::glsl::type_name{prop.type, names}
+            << " " << output::glsl::member_name{prop.name, names}
             << (struct_opts.pretty ? ";\n" : ";");
       }
       out << output::glsl::indent{opts.indent} << (opts.pretty ? "} " : "}")
-          << output::glsl::mangle_name{input.name} << (opts.pretty ? ";\n" : ";");
+          << output::glsl::mangle_name{input.name, names} << (opts.pretty ? ";\n" : ";");
     }
   }
 
+  // Output the storage blocks.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::VertexInputType::Storage) {
+      continue;
+    }
+
+    const util::memory::Ref<type::StructType> struct_type = input.type;
+    output::glsl::declare_storage(out, opts, struct_type, input.name,
+                                  static_cast<uint32_t>(input.index), true);
+  }
+
   if (opts.pretty) {
     out << "\n";
   }
@@ -81,7 +204,7 @@ void VertexDeclaration::to_glsl(std::ostream& out, const Module& mod, bool prett
       if (prop.type->name() == "vec4" || prop.type->name() == "mat4") {
         out << output::glsl::indent{opts.indent} << "layout(location=" << prop.index
             << (opts.pretty ? ") in " : ")in ") << prop.type->name() << " "
-            << output::glsl::vertex_input_name{static_cast<uint32_t>(prop.index), prop.name}
+            << output::glsl::vertex_input_name{static_cast<uint32_t>(prop.index), prop.name, names}
             << (opts.pretty ? ";\n" : ";");
       } else {
         util::msg::fatal("unsupported vertex attribute type [", prop.type->name(), "]");
@@ -95,16 +218,10 @@ void VertexDeclaration::to_glsl(std::ostream& out, const Module& mod, bool prett
 
   // Output the varyings.
   // This is the decomposed form of the return struct type from the vertex function.
-  const util::memory::Ref<type::StructType> return_struct_type = return_type_;
-  for (const auto& prop : return_struct_type->properties()) {
-    if (prop.index < 0) {
-      // Skip properties that don't have an output index.
-      continue;
-    }
-
-    out << output::glsl::indent{opts.indent} << "layout(location=" << prop.index
-        << (opts.pretty ? ") out " : ")out ") << prop.type->name() << " "
-        << output::glsl::varying_name{static_cast<uint32_t>(prop.index), prop.name}
+  for (const auto& interpolator : varyings_.interpolators) {
+    out << output::glsl::indent{opts.indent} << "layout(location=" << interpolator.location
+        << (opts.pretty ? ") out " : ")out ") << interpolator.type->name() << " "
+        << output::glsl::varying_name{interpolator.location, interpolator.name(), names}
         << (opts.pretty ? ";\n" : ";");
   }
 
@@ -120,18 +237,29 @@ void VertexDeclaration::to_glsl(std::ostream& out, const Module& mod, bool prett
 
     const auto main_opts = opts.incr_indent();
     for (const auto& input : inputs_) {
+      if (input.input_type == decl::VertexInputType::Instance) {
+        // Only the same in both while the first instance of the draw is 0, see
+        // `VertexInputType::Instance`.
+        out << output::glsl::indent{main_opts.indent} << output::glsl::type_name{input.type, names}
+            << " " << output::glsl::mangle_name{input.name, names}
+            << (main_opts.pretty ? " = " : "=")
+            << (opts.vulkan ? "gl_InstanceIndex" : "gl_InstanceID")
+            << (main_opts.pretty ? ";\n" : ";");
+      }
       if (input.input_type != decl::VertexInputType::Vertex &&
           input.input_type != decl::VertexInputType::Instanced) {
         continue;
       }
 
       const util::memory::Ref<type::StructType> struct_type = input.type;
-      out << output::glsl::indent{main_opts.indent} << input.type->name() << " "
-          << output::glsl::mangle_name{input.name} << (main_opts.pretty ? ";\n" : ";");
+      out << output::glsl::indent{main_opts.indent} << output::glsl::type_name{input.type, names}
+          << " " << output::glsl::mangle_name{input.name, names}
+          << (main_opts.pretty ? ";\n" : ";");
       for (const auto& prop : struct_type->properties()) {
-        out << output::glsl::indent{main_opts.indent} << output::glsl::mangle_name{input.name}
-            << "." << prop.name << (main_opts.pretty ? " = " : "=")
-            << output::glsl::vertex_input_name{static_cast<uint32_t>(prop.index), prop.name}
+        out << output::glsl::indent{main_opts.indent}
+            << output::glsl::mangle_name{input.name, names} << "."
+            << output::glsl::member_name{prop.name, names} << (main_opts.pretty ? " = " : "=")
+            << output::glsl::vertex_input_name{static_cast<uint32_t>(prop.index), prop.name, names}
             << (main_opts.pretty ? ";\n" : ";");
       }
     }
@@ -139,14 +267,14 @@ void VertexDeclaration::to_glsl(std::ostream& out, const Module& mod, bool prett
       out << "\n";
     }
     for (const auto& stmt : implementation_) {
-      out << stmt->to_glsl(main_opts);
+      stmt->to_glsl(out, main_opts);
     }
 
     out << (opts.pretty ? "}\n" : "}");
   }
 }
 
-void VertexDeclaration::to_metal(std::ostream& out, const Module& mod,
+void VertexDeclaration::to_metal(output::Writer& out, const Module& mod,
                                  const PipelineDeclaration& pipeline) const {
   const output::metal::Options opts{mod, this, nullptr, 0};
 
@@ -175,28 +303,62 @@ void VertexDeclaration::to_metal(std::ostream& out, const Module& mod,
   }
   {  // Varying type.
     out << "struct " << short_name << "_v {\n";
-    const util::memory::Ref<type::StructType> struct_type = return_type_;
-    for (auto& prop : struct_type->properties()) {
-      out << output::metal::indent{1} << prop.type->metal_name() << " " << prop.name;
-      if (prop.index == 0) {
-        out << " [[ position ]]";
+    if (varyings_.direct) {
+      const util::memory::Ref<type::StructType> struct_type = return_type_;
+      for (auto& prop : struct_type->properties()) {
+        out << output::metal::indent{1} << prop.type->metal_name() << " " << prop.name;
+        if (prop.index == 0) {
+          out << " [[ position ]]";
+        }
+        out << ";\n";
+      }
+    } else {
+      // The return statement converts the return struct into its interpolators.
+      for (const auto& interpolator : varyings_.interpolators) {
+        out << output::metal::indent{1} << interpolator.type->metal_name() << " "
+            << interpolator.name();
+        if (interpolator.location == 0) {
+          out << " [[ position ]]";
+        }
+        out << ";\n";
       }
-      out << ";\n";
     }
     out << "};\n";
   }
 
   // Output the function implementation.
   out << "vertex " << short_name << "_v " << name() << "(" << short_name << "_i in [[ stage_in ]]";
+  bool instance = false;
   for (const auto& input : inputs_) {
-    if (input.input_type != decl::VertexInputType::Uniform) {
-      continue;
+    if (input.input_type == decl::VertexInputType::Uniform) {
+      out << ", constant " << input.type->metal_name() << "& "
+          << output::metal::mangle_name{input.name} << " [[ buffer("
+          << output::metal::uniform_binding(pipeline, input.index) << ") ]]";
+    }
+    if (input.input_type == decl::VertexInputType::Storage) {
+      out << ", const device " << input.type->metal_name() << "& "
+          << output::metal::mangle_name{input.name} << " [[ buffer("
+          << output::metal::storage_binding(pipeline, input.index) << ") ]]";
     }
-    out << ", constant " << input.type->metal_name() << "& "
-        << output::metal::mangle_name{input.name} << " [[ buffer("
-        << output::metal::uniform_binding(pipeline, input.index) << ") ]]";
+    if (input.input_type == decl::VertexInputType::Instance) {
+      // Taken from the instance id instead, see below.
+      instance = true;
+    }
+  }
+  if (instance) {
+    out << ", uint iid [[ instance_id ]]";
   }
   out << ") {\n";
+  for (const auto& input : inputs_) {
+    if (input.input_type == decl::VertexInputType::Constant) {
+      output::metal::declare_constant(out, input.type, input.name,
+                                      static_cast<uint32_t>(input.index), input.value);
+    }
+    if (input.input_type == decl::VertexInputType::Instance) {
+      out << output::metal::indent{1} << input.type->metal_name() << " "
+          << output::metal::mangle_name{input.name} << " = int(iid);\n";
+    }
+  }
   for (const auto& input : inputs_) {
     if (input.input_type != decl::VertexInputType::Vertex &&
         input.input_type != decl::VertexInputType::Instanced) {
@@ -214,9 +376,143 @@ void VertexDeclaration::to_metal(std::ostream& out, const Module& mod,
   }
   out << "\n";
   for (const auto& stmt : implementation_) {
-    out << stmt->to_metal(opts);
+    stmt->to_metal(out, opts);
   }
   out << "}\n";
 }
 
+void VertexDeclaration::to_spirv(output::spirv::Builder& builder, const Module& mod) const {
+  output::spirv::Function      function;
+  const output::spirv::Options opts{mod, this, nullptr, builder, function};
+  std::vector<uint32_t>        interface;
+
+  // Bind the constants, which are shared with the other stage of the pipeline.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::VertexInputType::Constant) {
+      continue;
+    }
+
+    const output::spirv::ValueType type = output::spirv::ValueType::from(input.type);
+    const uint32_t id = builder.spec_constant(type, static_cast<uint32_t>(input.index), input.value,
+                                              output::spirv::mangle_name(input.name));
+    function.constants.insert_or_assign(input.name, output::spirv::Value{id, type});
+  }
+
+  // Bind the uniform blocks.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::VertexInputType::Uniform) {
+      continue;
+    }
+
+    const util::memory::Ref<type::StructType> struct_type = input.type;
+    const uint32_t var =
+        builder.variable(spv::StorageClass::Uniform, builder.type_block(struct_type),
+                         output::spirv::mangle_name(input.name));
+    builder.decorate(var, spv::Decoration::DescriptorSet, {0});
+    builder.decorate(var, spv::Decoration::Binding, {static_cast<uint32_t>(input.index)});
+    function.scope.insert_or_assign(
+        input.name, output::spirv::Pointer{var, output::spirv::ValueType::from(input.type),
+                                           spv::StorageClass::Uniform, {},
+                                           output::spirv::Layout::Std140});
+  }
+
+  // Bind the storage blocks.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::VertexInputType::Storage) {
+      continue;
+    }
+
+    const util::memory::Ref<type::StructType> struct_type = input.type;
+    function.scope.insert_or_assign(
+        input.name, output::spirv::storage(builder, struct_type, input.name,
+                                           static_cast<uint32_t>(input.index), true));
+  }
+
+  // Bind the instance index, and copy it into a local. It's declared as signed, the same as the
+  // argument, which the builtin allows.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::VertexInputType::Instance) {
+      continue;
+    }
+
+    const output::spirv::ValueType type = output::spirv::ValueType::from(input.type);
+    const uint32_t var = builder.variable(spv::StorageClass::Input, builder.type_id(type),
+                                          "gl_InstanceIndex");
+    builder.decorate(var, spv::Decoration::BuiltIn,
+                     {static_cast<uint32_t>(spv::BuiltIn::InstanceIndex)});
+    interface.push_back(var);
+
+    const output::spirv::Pointer local =
+        output::spirv::local(opts, type, output::spirv::mangle_name(input.name));
+    output::spirv::store(opts, local,
+                         output::spirv::Value{opts.emit(spv::Op::OpLoad, type, {var}), type});
+    function.scope.insert_or_assign(input.name, local);
+  }
+
+  // Bind the input variables (vertex buffers), and gather them into their structs.
+  for (const auto& input : inputs_) {
+    if (input.input_type != decl::VertexInputType::Vertex &&
+        input.input_type != decl::VertexInputType::Instanced) {
+      continue;
+    }
+
+    const output::spirv::Pointer local = output::spirv::local(
+        opts, output::spirv::ValueType::from(input.type), output::spirv::mangle_name(input.name));
+    const util::memory::Ref<type::StructType> struct_type = input.type;
+    for (const auto& prop : struct_type->properties()) {
+      if (prop.index < 0) {
+        // Skip properties that don't have an input index.
+        continue;
+      }
+
+      if (prop.type->name() != "vec4" && prop.type->name() != "mat4") {
+        util::msg::fatal("unsupported vertex attribute type [", prop.type->name(), "]");
+      }
+
+      const output::spirv::ValueType type = output::spirv::ValueType::from(prop.type);
+      const uint32_t var = builder.variable(
+          spv::StorageClass::Input, builder.type_id(type),
+          output::spirv::vertex_input_name(static_cast<uint32_t>(prop.index), prop.name));
+      builder.decorate(var, spv::Decoration::Location, {static_cast<uint32_t>(prop.index)});
+      interface.push_back(var);
+
+      output::spirv::store(opts, output::spirv::access(opts, local, prop.name),
+                           output::spirv::Value{opts.emit(spv::Op::OpLoad, type, {var}), type});
+    }
+    function.scope.insert_or_assign(input.name, local);
+  }
+
+  // Bind the varyings.
+  // This is the decomposed form of the return struct type from the vertex function.
+  for (const auto& interpolator : varyings_.interpolators) {
+    const uint32_t var = builder.variable(
+        spv::StorageClass::Output,
+        builder.type_id(output::spirv::ValueType::from(interpolator.type)),
+        output::spirv::varying_name(interpolator.location, interpolator.name()));
+    builder.decorate(var, spv::Decoration::Location, {interpolator.location});
+    interface.push_back(var);
+    function.outputs.insert_or_assign(interpolator.location, var);
+  }
+
+  function.position =
+      builder.variable(
+          spv::StorageClass::Output,
+          builder.type_id(output::spirv::ValueType::vector(output::spirv::Kind::Float, 4)),
+          "gl_Position");
+  builder.decorate(function.position, spv::Decoration::BuiltIn,
+                   {static_cast<uint32_t>(spv::BuiltIn::Position)});
+  interface.push_back(function.position);
+
+  // Finally output the function implementation.
+  for (const auto& stmt : implementation_) {
+    output::spirv::ensure_block(opts);
+    stmt->to_spirv(opts);
+  }
+
+  // The entry point is named after the pipeline, matching the vulkan runtime.
+  const uint32_t id = builder.add_function(function, name());
+  builder.entry_point(spv::ExecutionModel::Vertex, id, name().substr(0, name().size() - 5),
+                      interface);
+}
+
 }  // namespace crystal::compiler::ast::decl
@@ -3,11 +3,20 @@
 #include <iostream>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "crystal/compiler/ast/decl/declaration.hpp"
+#include "crystal/compiler/ast/decl/varyings.hpp"
+#include "crystal/compiler/ast/opt/opt.hpp"
+#include "crystal/compiler/ast/output/glsl.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
+#include "crystal/compiler/ast/output/writer.hpp"
 #include "crystal/compiler/ast/stmt/statement.hpp"
+#include "crystal/compiler/ast/symbol.hpp"
 #include "crystal/compiler/ast/type/type.hpp"
+#include "crystal/compiler/ast/type/type_set.hpp"
 #include "util/memory/ref_count.hpp"
 
 namespace crystal::compiler::ast {
@@ -22,7 +31,14 @@ enum class VertexInputType {
   Undefined = 0,
   Vertex,
   Instanced,
+  // The index of the instance being drawn. Vulkan and metal count it from the first instance of
+  // the draw, while opengl 4.1 has no way to read that base and always counts from 0. The
+  // runtimes only ever draw from instance 0, so every backend agrees, and draws with a non-zero
+  // first instance must not be added without also passing the base to the opengl shaders.
+  Instance,
   Uniform,
+  Storage,  // Always readonly, see `PipelineStorage`.
+  Constant,
 };
 
 struct VertexInput {
@@ -30,21 +46,32 @@ struct VertexInput {
   util::memory::Ref<type::Type> type;
   VertexInputType               input_type;
   int32_t                       index;
+  double                        value = 0.0;  // The default of a constant.
 
   VertexInput(std::string_view name, util::memory::Ref<type::Type> type, VertexInputType input_type,
-              int32_t index)
-      : name(name), type(type), input_type(input_type), index(index) {}
+              int32_t index, double value = 0.0)
+      : name(name), type(type), input_type(input_type), index(index), value(value) {}
 };
 
+// Validates a vertex argument that is bound to a builtin input, eg: `int i : instance_id`, which
+// is the only one so far.
+[[nodiscard]] VertexInput vertex_builtin(std::string_view name, util::memory::Ref<type::Type> type,
+                                         std::string_view builtin);
+
 class VertexDeclaration : public Declaration {
-  util::memory::Ref<type::Type>                   return_type_;
-  std::vector<VertexInput>                        inputs_;
-  std::vector<util::memory::Ref<stmt::Statement>> implementation_;
+  util::memory::Ref<type::Type> return_type_;
+  std::vector<VertexInput>      inputs_;
+  std::vector<stmt::Statement*> implementation_;
+  VaryingLayout                 varyings_;
+
+  // The feature toggles of the pipeline, which are only declared in the function that each of its
+  // variants is specialized from.
+  std::vector<std::string> features_;
 
 public:
-  VertexDeclaration(util::memory::Ref<type::Type>                     return_type,
-                    std::vector<decl::VertexInput>&&                  inputs,
-                    std::vector<util::memory::Ref<stmt::Statement>>&& implementation)
+  VertexDeclaration(util::memory::Ref<type::Type>    return_type,
+                    std::vector<decl::VertexInput>&& inputs,
+                    std::vector<stmt::Statement*>&&  implementation)
       : Declaration(""),
         return_type_(return_type),
         inputs_(std::move(inputs)),
@@ -53,16 +80,53 @@ public:
   virtual ~VertexDeclaration() = default;
 
   [[nodiscard]] util::memory::Ref<type::Type>  return_type() const { return return_type_; }
-  [[nodiscard]] const std::vector<VertexInput> inputs() const { return inputs_; }
+  [[nodiscard]] const std::vector<VertexInput>& inputs() const { return inputs_; }
 
   void set_name(const std::string_view name) { name_ = name; }
 
+  // How the varyings struct is passed between the functions of the pipeline.
+  [[nodiscard]] const VaryingLayout& varyings() const { return varyings_; }
+  void set_varyings(VaryingLayout varyings) { varyings_ = std::move(varyings); }
+
   void add_uniform(util::memory::Ref<type::Type> type, std::string name, int32_t index) {
     inputs_.emplace_back(name, type, VertexInputType::Uniform, index);
   }
+  void add_storage(util::memory::Ref<type::Type> type, std::string name, int32_t index) {
+    inputs_.emplace_back(name, type, VertexInputType::Storage, index);
+  }
+  void add_constant(util::memory::Ref<type::Type> type, std::string name, int32_t actual,
+                    double value) {
+    inputs_.emplace_back(name, type, VertexInputType::Constant, actual, value);
+  }
+
+  void add_feature(std::string name) { features_.emplace_back(std::move(name)); }
+
+  // Copies the function, with every reference to a feature replaced by its value in `values`. The
+  // copy takes only the arguments, as the pipeline adds the rest of the inputs again, and is yet to
+  // be type checked.
+  [[nodiscard]] util::memory::Ref<VertexDeclaration> specialize(
+      Module& mod, const absl::flat_hash_map<Symbol, bool>& values) const;
+
+  // Resolves the types of, and the declarations referred to by, every expression in the body.
+  void typecheck(Module& mod);
+
+  // Folds constants, and computes repeated subexpressions once, in the body. Requires
+  // `typecheck`.
+  void optimize(Module& mod);
+
+  // Removes the statements whose results are never needed. Afterwards `live` holds what the body
+  // reads from the inputs. Requires `typecheck`.
+  void eliminate_dead_code(opt::Liveness& live);
+
+  // Adds the types of the inputs, the output and the locals of the function to `types`.
+  void add_types(type::TypeSet& types) const;
 
-  void to_glsl(std::ostream& out, const Module& mod, bool pretty, bool vulkan) const;
-  void to_metal(std::ostream& out, const Module& mod, const PipelineDeclaration& pipeline) const;
+  // Shortens every identifier with `names` when it's set, other than those of the uniform blocks.
+  void to_glsl(output::Writer& out, const Module& mod, bool pretty, bool vulkan,
+               output::glsl::Names* names = nullptr) const;
+  void to_metal(output::Writer& out, const Module& mod,
+                const PipelineDeclaration& pipeline) const;
+  void to_spirv(output::spirv::Builder& builder, const Module& mod) const;
 };
 
 }  // namespace crystal::compiler::ast::decl
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "crystal/compiler/ast/expr/bin_op_expression.hpp"
+#include "crystal/compiler/ast/expr/bool_expression.hpp"
 #include "crystal/compiler/ast/expr/call_expression.hpp"
 #include "crystal/compiler/ast/expr/expression.hpp"
 #include "crystal/compiler/ast/expr/float_expression.hpp"
 #include "crystal/compiler/ast/expr/identifier_expression.hpp"
+#include "crystal/compiler/ast/expr/index_expression.hpp"
 #include "crystal/compiler/ast/expr/integer_expression.hpp"
 #include "crystal/compiler/ast/expr/parenthesis_expression.hpp"
 #include "crystal/compiler/ast/expr/property_expression.hpp"
@@ -1,8 +1,9 @@
 #pragma once
 
+#include <string_view>
+
 #include "crystal/compiler/ast/expr/expression.hpp"
-#include "crystal/compiler/ast/output/print.hpp"
-#include "util/memory/ref_count.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
 #include "util/msg/msg.hpp"
 
 namespace crystal::compiler::ast::expr {
@@ -23,152 +24,86 @@ enum class BinOp {
   Or,
 };
 
+inline std::string_view to_string(const BinOp op) {
+  switch (op) {
+    case BinOp::Add:
+      return "+";
+    case BinOp::Sub:
+      return "-";
+    case BinOp::Mul:
+      return "*";
+    case BinOp::Div:
+      return "/";
+    case BinOp::Eq:
+      return "==";
+    case BinOp::Ne:
+      return "!=";
+    case BinOp::Lt:
+      return "<";
+    case BinOp::Le:
+      return "<=";
+    case BinOp::Gt:
+      return ">";
+    case BinOp::Ge:
+      return ">=";
+    case BinOp::And:
+      return "&&";
+    case BinOp::Or:
+      return "||";
+
+    default:
+      util::msg::fatal("unhandled binary operator [", static_cast<uint32_t>(op), "]");
+      break;
+  }
+  return "";
+}
+
 class BinOpExpression : public Expression {
-  util::memory::Ref<expr::Expression> lhs_;
-  util::memory::Ref<expr::Expression> rhs_;
-  BinOp                               op_;
+  Expression* lhs_;
+  Expression* rhs_;
+  BinOp       op_;
 
 public:
-  BinOpExpression(util::memory::Ref<expr::Expression> lhs, util::memory::Ref<expr::Expression> rhs,
-                  BinOp op)
-      : lhs_(lhs), rhs_(rhs), op_(op) {}
+  BinOpExpression(Expression* lhs, Expression* rhs, BinOp op) : lhs_(lhs), rhs_(rhs), op_(op) {}
 
   virtual ~BinOpExpression() = default;
 
-  virtual output::PrintLambda to_glsl(const output::glsl::Options opts) const override {
-    switch (op_) {
-      case BinOp::Add:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_glsl(opts) << (opts.pretty ? " + " : "+") << rhs_->to_glsl(opts);
-        }};
-
-      case BinOp::Sub:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_glsl(opts) << (opts.pretty ? " - " : "-") << rhs_->to_glsl(opts);
-        }};
-
-      case BinOp::Mul:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_glsl(opts) << (opts.pretty ? " * " : "*") << rhs_->to_glsl(opts);
-        }};
-
-      case BinOp::Div:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_glsl(opts) << (opts.pretty ? " / " : "/") << rhs_->to_glsl(opts);
-        }};
-
-      case BinOp::Eq:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_glsl(opts) << (opts.pretty ? " == " : "==") << rhs_->to_glsl(opts);
-        }};
-
-      case BinOp::Ne:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_glsl(opts) << (opts.pretty ? " != " : "!=") << rhs_->to_glsl(opts);
-        }};
-
-      case BinOp::Lt:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_glsl(opts) << (opts.pretty ? " < " : "<") << rhs_->to_glsl(opts);
-        }};
-
-      case BinOp::Le:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_glsl(opts) << (opts.pretty ? " <= " : "<=") << rhs_->to_glsl(opts);
-        }};
-
-      case BinOp::Gt:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_glsl(opts) << (opts.pretty ? " > " : ">") << rhs_->to_glsl(opts);
-        }};
-
-      case BinOp::Ge:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_glsl(opts) << (opts.pretty ? " >= " : ">=") << rhs_->to_glsl(opts);
-        }};
-
-      case BinOp::And:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_glsl(opts) << (opts.pretty ? " && " : "&&") << rhs_->to_glsl(opts);
-        }};
-
-      case BinOp::Or:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_glsl(opts) << (opts.pretty ? " || " : "||") << rhs_->to_glsl(opts);
-        }};
-
-      default:
-        util::msg::fatal("unhandled binary operator [", static_cast<uint32_t>(op_), "]");
-        break;
-    }
+  [[nodiscard]] virtual Expression* clone(Arena& arena) const override {
+    return arena.make<BinOpExpression>(lhs_->clone(arena), rhs_->clone(arena), op_);
+  }
+
+  virtual Expression* optimize(opt::Context& ctx) override {
+    lhs_ = lhs_->optimize(ctx);
+    rhs_ = rhs_->optimize(ctx);
+    return opt::binary(ctx, this, op_, lhs_, rhs_);
+  }
+
+  virtual void for_each_operand(const std::function<void(Expression*&)>& fn) override {
+    fn(lhs_);
+    fn(rhs_);
+  }
+
+  virtual void key(opt::Key& key) const override { key.add('b').add(op_); }
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override {
+    const std::string_view space = opts.pretty ? " " : "";
+    out << output::glsl::emit{lhs_, opts} << space << to_string(op_) << space
+        << output::glsl::emit{rhs_, opts};
+  }
+
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override {
+    out << output::metal::emit{lhs_, opts} << " " << to_string(op_) << " "
+        << output::metal::emit{rhs_, opts};
+  }
+
+  virtual output::spirv::Value to_spirv(const output::spirv::Options opts) const override {
+    return output::spirv::binary(opts, op_, lhs_->to_spirv(opts), rhs_->to_spirv(opts));
   }
 
-  virtual output::PrintLambda to_metal(const output::metal::Options opts) const override {
-    switch (op_) {
-      case BinOp::Add:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_metal(opts) << " + " << rhs_->to_metal(opts);
-        }};
-
-      case BinOp::Sub:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_metal(opts) << " - " << rhs_->to_metal(opts);
-        }};
-
-      case BinOp::Mul:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_metal(opts) << " * " << rhs_->to_metal(opts);
-        }};
-
-      case BinOp::Div:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_metal(opts) << " / " << rhs_->to_metal(opts);
-        }};
-
-      case BinOp::Eq:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_metal(opts) << " == " << rhs_->to_metal(opts);
-        }};
-
-      case BinOp::Ne:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_metal(opts) << " != " << rhs_->to_metal(opts);
-        }};
-
-      case BinOp::Lt:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_metal(opts) << " < " << rhs_->to_metal(opts);
-        }};
-
-      case BinOp::Le:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_metal(opts) << " <= " << rhs_->to_metal(opts);
-        }};
-
-      case BinOp::Gt:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_metal(opts) << " > " << rhs_->to_metal(opts);
-        }};
-
-      case BinOp::Ge:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_metal(opts) << " >= " << rhs_->to_metal(opts);
-        }};
-
-      case BinOp::And:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_metal(opts) << " && " << rhs_->to_metal(opts);
-        }};
-
-      case BinOp::Or:
-        return output::PrintLambda{[=](std::ostream& out) {
-          out << lhs_->to_metal(opts) << " || " << rhs_->to_metal(opts);
-        }};
-
-      default:
-        util::msg::fatal("unhandled binary operator [", static_cast<uint32_t>(op_), "]");
-        break;
-    }
+protected:
+  virtual util::memory::Ref<type::Type> resolve_type_(check::Context& ctx) override {
+    const util::memory::Ref<type::Type> lhs = lhs_->typecheck(ctx);
+    return check::binary(ctx, op_, lhs, rhs_->typecheck(ctx));
   }
 };
 
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <optional>
+
+#include "crystal/compiler/ast/expr/expression.hpp"
+
+namespace crystal::compiler::ast::expr {
+
+class BoolExpression : public Expression {
+  bool value_;
+
+public:
+  BoolExpression(bool value) : value_(value) {}
+
+  virtual ~BoolExpression() = default;
+
+  [[nodiscard]] virtual Expression* clone(Arena& arena) const override {
+    return arena.make<BoolExpression>(value_);
+  }
+
+  [[nodiscard]] virtual std::optional<double> constant() const override {
+    return value_ ? 1.0 : 0.0;
+  }
+
+  virtual void key(opt::Key& key) const override { key.add('t').add(value_); }
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override {
+    out << (value_ ? "true" : "false");
+  }
+
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override {
+    out << (value_ ? "true" : "false");
+  }
+
+  virtual output::spirv::Value to_spirv(const output::spirv::Options opts) const override {
+    return output::spirv::Value{opts.builder.constant_bool(value_),
+                                output::spirv::ValueType::scalar(output::spirv::Kind::Bool)};
+  }
+
+protected:
+  virtual util::memory::Ref<type::Type> resolve_type_(check::Context& ctx) override {
+    return ctx.bool_type();
+  }
+};
+
+}  // namespace crystal::compiler::ast::expr
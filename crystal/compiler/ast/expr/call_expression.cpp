@@ -2,149 +2,470 @@
 
 #include "crystal/compiler/ast/expr/identifier_expression.hpp"
 #include "crystal/compiler/ast/module.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
+#include "crystal/compiler/ast/type/struct_type.hpp"
+#include "util/msg/msg.hpp"
 
 namespace crystal::compiler::ast::expr {
 
-output::PrintLambda CallExpression::to_glsl(const output::glsl::Options opts) const {
-  // TODO: Typecheck to determine that the callee is a texture.
-  if (expr_ != nullptr && name_ == "sample") {
-    return output::PrintLambda{[=](std::ostream& out) {
-      out << "texture(" << expr_->to_glsl(opts);
+namespace {
+
+using output::spirv::Kind;
+using output::spirv::Value;
+using output::spirv::ValueType;
+
+struct Builtin {
+  std::string_view name;
+  GLSLstd450       inst;
+};
+
+constexpr Builtin BUILTINS[] = {
+    {"abs", GLSLstd450FAbs},
+    {"acos", GLSLstd450Acos},
+    {"asin", GLSLstd450Asin},
+    {"atan", GLSLstd450Atan},
+    {"ceil", GLSLstd450Ceil},
+    {"clamp", GLSLstd450FClamp},
+    {"cos", GLSLstd450Cos},
+    {"cross", GLSLstd450Cross},
+    {"degrees", GLSLstd450Degrees},
+    {"determinant", GLSLstd450Determinant},
+    {"distance", GLSLstd450Distance},
+    {"exp", GLSLstd450Exp},
+    {"exp2", GLSLstd450Exp2},
+    {"floor", GLSLstd450Floor},
+    {"fract", GLSLstd450Fract},
+    {"inverse", GLSLstd450MatrixInverse},
+    {"inversesqrt", GLSLstd450InverseSqrt},
+    {"length", GLSLstd450Length},
+    {"log", GLSLstd450Log},
+    {"log2", GLSLstd450Log2},
+    {"max", GLSLstd450FMax},
+    {"min", GLSLstd450FMin},
+    {"mix", GLSLstd450FMix},
+    {"normalize", GLSLstd450Normalize},
+    {"pow", GLSLstd450Pow},
+    {"radians", GLSLstd450Radians},
+    {"reflect", GLSLstd450Reflect},
+    {"refract", GLSLstd450Refract},
+    {"round", GLSLstd450Round},
+    {"sign", GLSLstd450FSign},
+    {"sin", GLSLstd450Sin},
+    {"smoothstep", GLSLstd450SmoothStep},
+    {"sqrt", GLSLstd450Sqrt},
+    {"step", GLSLstd450Step},
+    {"tan", GLSLstd450Tan},
+    {"trunc", GLSLstd450Trunc},
+};
+
+// The overloads for integer arguments, whose result is an integer too.
+constexpr Builtin INT_BUILTINS[] = {
+    {"abs", GLSLstd450SAbs},
+    {"clamp", GLSLstd450SClamp},
+    {"max", GLSLstd450SMax},
+    {"min", GLSLstd450SMin},
+};
+
+// Converts integer and boolean values to their floating point equivalent.
+Value to_float(const output::spirv::Options& opts, const Value& value) {
+  if (value.type.kind == Kind::Int || value.type.kind == Kind::Bool) {
+    return output::spirv::convert(opts, value, ValueType::vector(Kind::Float, value.type.count));
+  }
+  return value;
+}
+
+}  // namespace
+
+void CallExpression::to_glsl(output::Writer& out, const output::glsl::Options& opts) const {
+  switch (callee_) {
+    case Callee::Sample:
+    case Callee::SampleOffset:
+      out << (callee_ == Callee::Sample ? "texture(" : "textureOffset(")
+          << output::glsl::emit{expr_, opts};
       for (const auto& arg : arguments_) {
-        out << ", " << arg->to_glsl(opts);
+        out << ", " << output::glsl::emit{arg, opts};
       }
       out << ")";
-    }};
-  }
+      return;
 
-  // TODO: Typecheck to determine that the callee is a texture.
-  if (expr_ != nullptr && name_ == "sampleOffset") {
-    return output::PrintLambda{[=](std::ostream& out) {
-      out << "textureOffset(" << expr_->to_glsl(opts);
+    case Callee::SampleDepth:
+      out << (opts.vulkan ? "texture(" : "(texture(") << output::glsl::emit{expr_, opts};
       for (const auto& arg : arguments_) {
-        out << ", " << arg->to_glsl(opts);
+        out << ", " << output::glsl::emit{arg, opts};
       }
-      out << ")";
-    }};
+      out << (opts.vulkan ? ").x" : ").x * 2.0 - 1.0)");
+      return;
+
+    case Callee::Constructor:
+      out << output::glsl::type_name{type(), opts.names} << "(";
+      break;
+
+    default:
+      out << name_ << "(";
+      break;
   }
 
-  // TODO: Typecheck to determine that the callee is a texture.
-  if (expr_ != nullptr && name_ == "sampleDepth") {
-    if (opts.vulkan) {
-      return output::PrintLambda{[=](std::ostream& out) {
-        out << "texture(" << expr_->to_glsl(opts);
-        for (const auto& arg : arguments_) {
-          out << ", " << arg->to_glsl(opts);
-        }
-        out << ").x";
-      }};
+  bool first = true;
+  for (const auto& arg : arguments_) {
+    if (first) {
+      first = false;
     } else {
-      return output::PrintLambda{[=](std::ostream& out) {
-        out << "(texture(" << expr_->to_glsl(opts);
-        for (const auto& arg : arguments_) {
-          out << ", " << arg->to_glsl(opts);
-        }
-        out << ").x * 2.0 - 1.0)";
-      }};
+      out << ", ";
     }
+    out << output::glsl::emit{arg, opts};
   }
+  out << ")";
+}
 
-  const auto type = opts.mod.find_type(name_);
-  if (type.has_value()) {
-    return output::PrintLambda{[=](std::ostream& out) {
-      out << type.value()->glsl_name() << "(";
+void CallExpression::to_metal(output::Writer& out, const output::metal::Options& opts) const {
+  switch (callee_) {
+    case Callee::Sample:
+    case Callee::SampleDepth: {
+      out << output::metal::emit{expr_, opts} << ".sample(" << output::metal::emit{expr_, opts}
+          << "_sampler";
       bool first = true;
       for (const auto& arg : arguments_) {
         if (first) {
           first = false;
+          out << ", float2(" << output::metal::emit{arg, opts} << ".x, 1.0 - "
+              << output::metal::emit{arg, opts} << ".y)";
         } else {
-          out << ", ";
+          out << ", " << output::metal::emit{arg, opts};
         }
-        out << arg->to_glsl(opts);
       }
-      out << ")";
-    }};
+      out << (callee_ == Callee::SampleDepth ? ").x" : ")");
+      return;
+    }
+
+    case Callee::SampleOffset:
+      util::msg::fatal("method [", name_, "] is not supported by the metal output");
+      return;
+
+    case Callee::Constructor:
+      out << type()->metal_name() << "(";
+      break;
+
+    default:
+      out << name_ << "(";
+      break;
   }
 
-  return output::PrintLambda{[=](std::ostream& out) {
-    out << name_ << "(";
-    bool first = true;
-    for (const auto& arg : arguments_) {
-      if (first) {
-        first = false;
-      } else {
-        out << ", ";
-      }
-      out << arg->to_glsl(opts);
+  bool first = true;
+  for (const auto& arg : arguments_) {
+    if (first) {
+      first = false;
+    } else {
+      out << ", ";
     }
-    out << ")";
-  }};
+    out << output::metal::emit{arg, opts};
+  }
+  out << ")";
 }
 
-output::PrintLambda CallExpression::to_metal(const output::metal::Options opts) const {
-  // TODO: Typecheck to determine that the callee is a texture.
-  if (expr_ != nullptr && name_ == "sample") {
-    return output::PrintLambda{[=](std::ostream& out) {
-      out << expr_->to_metal(opts) << ".sample(" << expr_->to_metal(opts) << "_sampler";
-      bool first = true;
-      for (const auto& arg : arguments_) {
-        if (first) {
-          first = false;
-          out << ", float2(" << arg->to_metal(opts) << ".x, 1.0 - " << arg->to_metal(opts) << ".y)";
-        } else {
-          out << ", " << arg->to_metal(opts);
-        }
-      }
-      out << ")";
-    }};
+output::spirv::Value CallExpression::to_spirv(const output::spirv::Options opts) const {
+  switch (callee_) {
+    case Callee::Sample:
+    case Callee::SampleDepth:
+      return to_spirv_sample_(opts);
+
+    case Callee::Constructor:
+      return to_spirv_construct_(opts, ValueType::from(type()));
+
+    case Callee::Function:
+      return to_spirv_builtin_(opts);
+
+    default:
+      util::msg::fatal("method [", name_, "] is not supported by the spir-v output");
+      break;
   }
+  return Value{};
+}
 
-  if (expr_ != nullptr && name_ == "sampleDepth") {
-    return output::PrintLambda{[=](std::ostream& out) {
-      out << expr_->to_metal(opts) << ".sample(" << expr_->to_metal(opts) << "_sampler";
-      bool first = true;
-      for (const auto& arg : arguments_) {
-        if (first) {
-          first = false;
-          out << ", float2(" << arg->to_metal(opts) << ".x, 1.0 - " << arg->to_metal(opts) << ".y)";
-        } else {
-          out << ", " << arg->to_metal(opts);
+output::spirv::Value CallExpression::to_spirv_sample_(const output::spirv::Options opts) const {
+  if (arguments_.size() != 1) {
+    util::msg::fatal("method [", name_, "] takes exactly one argument");
+  }
+
+  const Value texture = expr_->to_spirv(opts);
+  const Value coord = output::spirv::convert(opts, arguments_[0]->to_spirv(opts),
+                                             ValueType::vector(Kind::Float, 2));
+
+  // Implicit level of detail selection relies on derivatives, which only fragment shaders have.
+  const ValueType color = ValueType::vector(Kind::Float, 4);
+  uint32_t        id    = 0;
+  if (opts.fragment != nullptr) {
+    id = opts.emit(spv::Op::OpImageSampleImplicitLod, color, {texture.id, coord.id});
+  } else {
+    id = opts.emit(spv::Op::OpImageSampleExplicitLod, color,
+                   {texture.id, coord.id, static_cast<uint32_t>(spv::ImageOperandsMask::Lod),
+                    opts.builder.constant_float(0.0f)});
+  }
+
+  if (callee_ == Callee::SampleDepth) {
+    const ValueType depth = ValueType::scalar(Kind::Float);
+    return Value{opts.emit(spv::Op::OpCompositeExtract, depth, {id, 0}), depth};
+  }
+  return Value{id, color};
+}
+
+output::spirv::Value CallExpression::to_spirv_construct_(
+    const output::spirv::Options opts, const output::spirv::ValueType& type) const {
+  std::vector<Value> args;
+  for (const auto& arg : arguments_) {
+    args.push_back(arg->to_spirv(opts));
+  }
+
+  if (type.kind == Kind::Struct) {
+    const auto& properties = type.type->properties();
+    if (args.size() != properties.size()) {
+      util::msg::fatal("constructor [", name_, "] takes ", properties.size(), " arguments");
+    }
+    std::vector<uint32_t> members;
+    for (uint32_t i = 0; i < args.size(); ++i) {
+      members.push_back(
+          output::spirv::convert(opts, args[i], ValueType::from(properties[i].type)).id);
+    }
+    return Value{opts.emit(spv::Op::OpCompositeConstruct, type, members), type};
+  }
+
+  if (type.kind == Kind::Matrix) {
+    const ValueType column = ValueType::vector(Kind::Float, 4);
+    if (args.size() == 1 && args[0].type == type) {
+      return args[0];
+    }
+
+    if (args.size() == 1 && args[0].type.is_scalar()) {
+      // A scalar sets the diagonal.
+      const Value           diagonal = to_float(opts, args[0]);
+      const uint32_t        zero     = opts.builder.constant_float(0.0f);
+      std::vector<uint32_t> columns;
+      for (uint32_t i = 0; i < type.count; ++i) {
+        std::vector<uint32_t> components(4, zero);
+        components[i] = diagonal.id;
+        columns.push_back(opts.emit(spv::Op::OpCompositeConstruct, column, components));
+      }
+      return Value{opts.emit(spv::Op::OpCompositeConstruct, type, columns), type};
+    }
+
+    std::vector<uint32_t> columns;
+    if (args.size() == type.count) {
+      for (const auto& arg : args) {
+        columns.push_back(output::spirv::convert(opts, arg, column).id);
+      }
+    } else if (args.size() == type.count * 4) {
+      for (uint32_t i = 0; i < type.count; ++i) {
+        std::vector<uint32_t> components;
+        for (uint32_t j = 0; j < 4; ++j) {
+          components.push_back(
+              output::spirv::convert(opts, args[i * 4 + j], ValueType::scalar(Kind::Float)).id);
         }
+        columns.push_back(opts.emit(spv::Op::OpCompositeConstruct, column, components));
       }
-      out << ").x";
-    }};
+    } else {
+      util::msg::fatal("unsupported arguments to constructor [", name_, "]");
+    }
+    return Value{opts.emit(spv::Op::OpCompositeConstruct, type, columns), type};
   }
 
-  const auto type = opts.mod.find_type(name_);
-  if (type.has_value()) {
-    return output::PrintLambda{[=](std::ostream& out) {
-      out << type.value()->metal_name() << "(";
-      bool first = true;
-      for (const auto& arg : arguments_) {
-        if (first) {
-          first = false;
-        } else {
-          out << ", ";
-        }
-        out << arg->to_metal(opts);
+  if (type.kind != Kind::Float || args.empty()) {
+    util::msg::fatal("unsupported arguments to constructor [", name_, "]");
+  }
+
+  if (args.size() == 1) {
+    const Value arg = to_float(opts, args[0]);
+    if (arg.type.kind != Kind::Float) {
+      util::msg::fatal("unsupported arguments to constructor [", name_, "]");
+    }
+
+    if (arg.type.count == type.count) {
+      return arg;
+    }
+
+    if (arg.type.is_scalar()) {
+      return output::spirv::splat(opts, arg, type.count);
+    }
+
+    if (arg.type.count > type.count) {
+      // Truncate to the leading components.
+      if (type.is_scalar()) {
+        return Value{opts.emit(spv::Op::OpCompositeExtract, type, {arg.id, 0}), type};
       }
-      out << ")";
-    }};
+      std::vector<uint32_t> operands{arg.id, arg.id};
+      for (uint32_t i = 0; i < type.count; ++i) {
+        operands.push_back(i);
+      }
+      return Value{opts.emit(spv::Op::OpVectorShuffle, type, operands), type};
+    }
   }
 
-  return output::PrintLambda{[=](std::ostream& out) {
-    out << name_ << "(";
-    bool first = true;
-    for (const auto& arg : arguments_) {
-      if (first) {
-        first = false;
-      } else {
-        out << ", ";
+  // Vectors may be built from any mix of scalars and vectors.
+  std::vector<uint32_t> constituents;
+  uint32_t              count = 0;
+  for (const auto& arg : args) {
+    const Value value = to_float(opts, arg);
+    if (value.type.kind != Kind::Float) {
+      util::msg::fatal("unsupported arguments to constructor [", name_, "]");
+    }
+    constituents.push_back(value.id);
+    count += value.type.count;
+  }
+  if (count != type.count) {
+    util::msg::fatal("constructor [", name_, "] given ", count, " components, expected ",
+                     type.count);
+  }
+  return Value{opts.emit(spv::Op::OpCompositeConstruct, type, constituents), type};
+}
+
+output::spirv::Value CallExpression::to_spirv_builtin_(const output::spirv::Options opts) const {
+  // The type checker only gives an int result to the integer overloads, which keep their
+  // arguments as they are.
+  const bool         integral = type()->kind() == type::Kind::Int;
+  std::vector<Value> args;
+  for (const auto& arg : arguments_) {
+    const Value value = arg->to_spirv(opts);
+    args.push_back(integral ? value : to_float(opts, value));
+  }
+  if (args.empty()) {
+    util::msg::fatal("unknown function [", name_, "]");
+  }
+
+  const ValueType scalar = ValueType::scalar(Kind::Float);
+  if (name_.str() == "dot") {
+    if (args.size() != 2 || args[0].type != args[1].type || args[0].type.kind != Kind::Float) {
+      util::msg::fatal("[dot] takes two vectors of the same type");
+    }
+    if (args[0].type.is_scalar()) {
+      return Value{opts.emit(spv::Op::OpFMul, scalar, {args[0].id, args[1].id}), scalar};
+    }
+    return Value{opts.emit(spv::Op::OpDot, scalar, {args[0].id, args[1].id}), scalar};
+  }
+
+  // Scalar arguments are widened to match the vector ones. Refract's ratio always stays scalar.
+  ValueType type = args[0].type;
+  for (const auto& arg : args) {
+    if (arg.type.kind == Kind::Matrix || arg.type.count > type.count) {
+      type = arg.type;
+    }
+  }
+  for (uint32_t i = 0; i < args.size(); ++i) {
+    if (args[i].type != type && !(name_.str() == "refract" && i == 2)) {
+      args[i] = output::spirv::convert(opts, args[i], type);
+    }
+  }
+
+  std::vector<uint32_t> operands;
+  for (const auto& arg : args) {
+    operands.push_back(arg.id);
+  }
+
+  if (integral) {
+    for (const auto& builtin : INT_BUILTINS) {
+      if (builtin.name == name_.str()) {
+        return Value{opts.ext(builtin.inst, type, operands), type};
       }
-      out << arg->to_metal(opts);
     }
-    out << ")";
-  }};
+    util::msg::fatal("unknown function [", name_, "]");
+  }
+
+  if (name_.str() == "mod") {
+    return Value{opts.emit(spv::Op::OpFMod, type, operands), type};
+  }
+
+  if (name_.str() == "atan" && args.size() == 2) {
+    return Value{opts.ext(GLSLstd450Atan2, type, operands), type};
+  }
+
+  for (const auto& builtin : BUILTINS) {
+    if (builtin.name != name_.str()) {
+      continue;
+    }
+
+    const std::string_view name   = name_.str();
+    const ValueType        result =
+        (name == "length" || name == "distance" || name == "determinant") ? scalar : type;
+    return Value{opts.ext(builtin.inst, result, operands), result};
+  }
+
+  util::msg::fatal("unknown function [", name_, "]");
+  return args[0];
+}
+
+util::memory::Ref<type::Type> CallExpression::resolve_type_(check::Context& ctx) {
+  std::vector<util::memory::Ref<type::Type>> args;
+  args.reserve(arguments_.size());
+  for (const auto& arg : arguments_) {
+    args.push_back(arg->typecheck(ctx));
+  }
+
+  // Methods are only defined on textures.
+  if (expr_ != nullptr) {
+    const util::memory::Ref<type::Type> texture = expr_->typecheck(ctx);
+    if (texture->kind() != type::Kind::Texture) {
+      util::msg::fatal("type [", texture->name(), "] has no method [", name_, "]");
+    }
+
+    const std::string_view name = name_.str();
+    if (name == "sample") {
+      callee_ = Callee::Sample;
+    } else if (name == "sampleOffset") {
+      callee_ = Callee::SampleOffset;
+      ctx.mod().require_vulkan_glsl();
+    } else if (name == "sampleDepth") {
+      callee_ = Callee::SampleDepth;
+    } else {
+      util::msg::fatal("type [", texture->name(), "] has no method [", name_, "]");
+    }
+
+    if (args.empty() || args[0] != ctx.float_type(2)) {
+      util::msg::fatal("method [", name_, "] takes vec2 texture coordinates");
+    }
+    return callee_ == Callee::SampleDepth ? ctx.float_type() : ctx.float_type(4);
+  }
+
+  const auto type = ctx.mod().find_type(name_);
+  if (type.has_value()) {
+    callee_ = Callee::Constructor;
+    return check::construct(ctx, type.value(), args);
+  }
+
+  callee_ = Callee::Function;
+  return check::builtin(ctx, name_, args);
+}
+
+Expression* CallExpression::optimize(opt::Context& ctx) {
+  for (auto& arg : arguments_) {
+    arg = arg->optimize(ctx);
+  }
+
+  switch (callee_) {
+    case Callee::Constructor:
+      return opt::construct(ctx, this, arguments_);
+
+    case Callee::Function:
+      return opt::builtin(ctx, this, name_, arguments_);
+
+    default:
+      return this;
+  }
+}
+
+Expression* CallExpression::clone(Arena& arena) const {
+  std::vector<Expression*> arguments;
+  arguments.reserve(arguments_.size());
+  for (const auto& arg : arguments_) {
+    arguments.push_back(arg->clone(arena));
+  }
+  return arena.make<CallExpression>(expr_ != nullptr ? expr_->clone(arena) : nullptr, name_,
+                                    std::move(arguments));
+}
+
+void CallExpression::for_each_operand(const std::function<void(Expression*&)>& fn) {
+  if (expr_ != nullptr) {
+    fn(expr_);
+  }
+  for (auto& arg : arguments_) {
+    fn(arg);
+  }
 }
 
 }  // namespace crystal::compiler::ast::expr
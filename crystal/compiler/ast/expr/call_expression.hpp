@@ -1,38 +1,64 @@
 #pragma once
 
-#include <string>
-#include <string_view>
 #include <vector>
 
 #include "crystal/compiler/ast/expr/expression.hpp"
-#include "crystal/compiler/ast/output/print.hpp"
-#include "util/memory/ref_count.hpp"
+#include "crystal/compiler/ast/symbol.hpp"
 #include "util/msg/msg.hpp"
 
 namespace crystal::compiler::ast::expr {
 
+// What a call expression invokes, as resolved by `typecheck`.
+enum class Callee {
+  Undefined = 0,
+  Function,
+  Constructor,
+  Sample,
+  SampleOffset,
+  SampleDepth,
+};
+
 class CallExpression : public Expression {
-  util::memory::Ref<expr::Expression>              expr_;
-  std::string                                      name_;
-  std::vector<util::memory::Ref<expr::Expression>> arguments_;
+  Expression*              expr_ = nullptr;
+  Symbol                   name_;
+  std::vector<Expression*> arguments_;
+  Callee                   callee_ = Callee::Undefined;
 
 public:
-  CallExpression(const std::string_view name) : name_(name) {}
-  CallExpression(const std::string_view                           name,
-                 std::vector<util::memory::Ref<expr::Expression>> arguments)
-      : name_(name), arguments_(arguments) {}
+  CallExpression(const Symbol name) : name_(name) {}
+  CallExpression(const Symbol name, std::vector<Expression*>&& arguments)
+      : name_(name), arguments_(std::move(arguments)) {}
 
-  CallExpression(util::memory::Ref<expr::Expression> expr, const std::string_view name)
-      : expr_(expr), name_(name) {}
-  CallExpression(util::memory::Ref<expr::Expression> expr, const std::string_view name,
-                 std::vector<util::memory::Ref<expr::Expression>> arguments)
-      : expr_(expr), name_(name), arguments_(arguments) {}
+  CallExpression(Expression* expr, const Symbol name) : expr_(expr), name_(name) {}
+  CallExpression(Expression* expr, const Symbol name, std::vector<Expression*>&& arguments)
+      : expr_(expr), name_(name), arguments_(std::move(arguments)) {}
 
   virtual ~CallExpression() = default;
 
-  virtual output::PrintLambda to_glsl(const output::glsl::Options opts) const override;
+  [[nodiscard]] Callee callee() const { return callee_; }
+
+  [[nodiscard]] virtual Expression* clone(Arena& arena) const override;
+
+  virtual Expression* optimize(opt::Context& ctx) override;
+
+  virtual void for_each_operand(const std::function<void(Expression*&)>& fn) override;
+
+  virtual void key(opt::Key& key) const override { key.add('c').add(callee_).add(name_.str()); }
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override;
+
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override;
+
+  virtual output::spirv::Value to_spirv(const output::spirv::Options opts) const override;
+
+protected:
+  virtual util::memory::Ref<type::Type> resolve_type_(check::Context& ctx) override;
 
-  virtual output::PrintLambda to_metal(const output::metal::Options opts) const override;
+private:
+  output::spirv::Value to_spirv_sample_(const output::spirv::Options opts) const;
+  output::spirv::Value to_spirv_construct_(const output::spirv::Options    opts,
+                                           const output::spirv::ValueType& type) const;
+  output::spirv::Value to_spirv_builtin_(const output::spirv::Options opts) const;
 };
 
 }  // namespace crystal::compiler::ast::expr
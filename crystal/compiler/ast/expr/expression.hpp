@@ -1,19 +1,81 @@
 #pragma once
 
+#include <functional>
+#include <optional>
+
+#include "crystal/compiler/ast/arena.hpp"
+#include "crystal/compiler/ast/check/check.hpp"
+#include "crystal/compiler/ast/opt/opt.hpp"
 #include "crystal/compiler/ast/output/glsl.hpp"
 #include "crystal/compiler/ast/output/metal.hpp"
-#include "crystal/compiler/ast/output/print.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
+#include "crystal/compiler/ast/output/writer.hpp"
+#include "crystal/compiler/ast/symbol.hpp"
+#include "crystal/compiler/ast/type/type.hpp"
+#include "util/memory/ref_count.hpp"
+#include "util/msg/msg.hpp"
 
 namespace crystal::compiler::ast::expr {
 
+class IdentifierExpression;
+
 class Expression {
+  util::memory::Ref<type::Type> type_;
+
 public:
   virtual ~Expression() = default;
 
+  // The type of the value, as resolved by `typecheck`.
+  [[nodiscard]] const util::memory::Ref<type::Type>& type() const { return type_; }
+
+  // Resolves the types of the expression and everything it contains, and every identifier to its
+  // declaration. Fails with an error if the expression is not well typed.
+  const util::memory::Ref<type::Type>& typecheck(check::Context& ctx) {
+    type_ = resolve_type_(ctx);
+    return type_;
+  }
+
+  // Copies the expression, and everything it contains, into `arena`. The copy is yet to be type
+  // checked.
+  [[nodiscard]] virtual Expression* clone(Arena& arena) const = 0;
+
+  // Simplifies the expression and everything it contains. Returns the expression that should
+  // replace it, which is itself when there is nothing to simplify. Requires `typecheck`.
+  [[nodiscard]] virtual Expression* optimize(opt::Context& ctx) { return this; }
+
+  // Calls `fn` with each operand, which it may replace with an expression of the same value.
+  virtual void for_each_operand(const std::function<void(Expression*&)>& fn) {}
+
+  // Describes the operation, such that two expressions with equal keys and operands compute the
+  // same value. Expressions that leave it empty pass the value of their operand through.
+  virtual void key(opt::Key& key) const = 0;
+
   [[nodiscard]] virtual bool is_identifier() const { return false; }
 
-  virtual output::PrintLambda to_glsl(const output::glsl::Options opts) const   = 0;
-  virtual output::PrintLambda to_metal(const output::metal::Options opts) const = 0;
+  // The property that the expression selects from its operand, eg: `b` in `a.b`.
+  [[nodiscard]] virtual std::optional<Symbol> property() const { return std::nullopt; }
+
+  // The value of a scalar bool, int or float literal, where a bool is either 0 or 1.
+  [[nodiscard]] virtual std::optional<double> constant() const { return std::nullopt; }
+
+  // Whether the expression refers to a location, such as a variable or one of its properties.
+  [[nodiscard]] virtual bool addressable() const { return false; }
+
+  // The variable that an addressable expression refers to, or to a property of.
+  [[nodiscard]] virtual const IdentifierExpression* root() const { return nullptr; }
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const   = 0;
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const = 0;
+  virtual output::spirv::Value to_spirv(const output::spirv::Options opts) const       = 0;
+
+  // Returns the location the expression refers to. Only valid for addressable expressions.
+  virtual output::spirv::Pointer to_spirv_pointer(const output::spirv::Options opts) const {
+    util::msg::fatal("expression can not be assigned to");
+    return output::spirv::Pointer{};
+  }
+
+protected:
+  virtual util::memory::Ref<type::Type> resolve_type_(check::Context& ctx) = 0;
 };
 
 }  // namespace crystal::compiler::ast::expr
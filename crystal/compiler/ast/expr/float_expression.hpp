@@ -1,9 +1,11 @@
 #pragma once
 
 #include <cstdio>
+#include <cstring>
+#include <optional>
+#include <string_view>
 
 #include "crystal/compiler/ast/expr/expression.hpp"
-#include "crystal/compiler/ast/output/print.hpp"
 
 namespace crystal::compiler::ast::expr {
 
@@ -15,38 +17,45 @@ public:
 
   virtual ~FloatExpression() = default;
 
-  virtual output::PrintLambda to_glsl(const output::glsl::Options opts) const override {
-    return output::PrintLambda{[=](std::ostream& out) {
-      char f_buffer[20] = {0};
-      char g_buffer[20] = {0};
-      sprintf(f_buffer, "%.1f", value_);
-      sprintf(g_buffer, "%g", value_);
-
-      // Always print at least one decimal place. This is required as not all clients' glsl parsers
-      // will correctly treat it as a floating point otherwise.
-      if (strlen(g_buffer) < strlen(f_buffer)) {
-        out << f_buffer;
-      } else {
-        out << g_buffer;
-      }
-    }};
+  [[nodiscard]] virtual Expression* clone(Arena& arena) const override {
+    return arena.make<FloatExpression>(value_);
   }
 
-  virtual output::PrintLambda to_metal(const output::metal::Options opts) const override {
-    return output::PrintLambda{[=](std::ostream& out) {
-      char f_buffer[20] = {0};
-      char g_buffer[20] = {0};
-      sprintf(f_buffer, "%.1f", value_);
-      sprintf(g_buffer, "%g", value_);
-
-      // Always print at least one decimal place. This is to prevent a possible edge case where
-      // integer division could cause a different result than expected.
-      if (strlen(g_buffer) < strlen(f_buffer)) {
-        out << f_buffer;
-      } else {
-        out << g_buffer;
-      }
-    }};
+  // Writes the value into `buffer`, always with at least one decimal place. This is required as not
+  // all clients' glsl parsers will correctly treat it as a floating point otherwise, and in metal
+  // integer division could cause a different result than expected.
+  static std::string_view format(const double value, char (&buffer)[32]) {
+    char g_buffer[32] = {0};
+    snprintf(buffer, sizeof(buffer), "%.1f", value);
+    snprintf(g_buffer, sizeof(g_buffer), "%g", value);
+    if (strlen(g_buffer) >= strlen(buffer)) {
+      memcpy(buffer, g_buffer, sizeof(buffer));
+    }
+    return buffer;
+  }
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override {
+    char buffer[32];
+    out << format(value_, buffer);
+  }
+
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override {
+    char buffer[32];
+    out << format(value_, buffer);
+  }
+
+  [[nodiscard]] virtual std::optional<double> constant() const override { return value_; }
+
+  virtual void key(opt::Key& key) const override { key.add('f').add(value_); }
+
+  virtual output::spirv::Value to_spirv(const output::spirv::Options opts) const override {
+    return output::spirv::Value{opts.builder.constant_float(static_cast<float>(value_)),
+                                output::spirv::ValueType::scalar(output::spirv::Kind::Float)};
+  }
+
+protected:
+  virtual util::memory::Ref<type::Type> resolve_type_(check::Context& ctx) override {
+    return ctx.float_type();
   }
 };
 
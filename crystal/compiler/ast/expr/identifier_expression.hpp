@@ -3,29 +3,84 @@
 #include "crystal/compiler/ast/expr/expression.hpp"
 #include "crystal/compiler/ast/output/glsl.hpp"
 #include "crystal/compiler/ast/output/metal.hpp"
-#include "crystal/compiler/ast/output/print.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
+#include "crystal/compiler/ast/symbol.hpp"
+#include "util/msg/msg.hpp"
 
 namespace crystal::compiler::ast::expr {
 
 class IdentifierExpression : public Expression {
-  std::string name_;
+  Symbol         name_;
+  check::Binding binding_;
 
 public:
-  IdentifierExpression(std::string_view name) : name_(name) {}
+  IdentifierExpression(Symbol name) : name_(name) {}
 
   virtual ~IdentifierExpression() = default;
 
+  [[nodiscard]] virtual Expression* clone(Arena& arena) const override {
+    return arena.make<IdentifierExpression>(name_);
+  }
+
   [[nodiscard]] virtual bool is_identifier() const override { return true; }
+  [[nodiscard]] virtual bool addressable() const override { return true; }
+
+  [[nodiscard]] virtual const IdentifierExpression* root() const override { return this; }
+
+  constexpr Symbol name() const { return name_; }
+
+  // The declaration that the identifier refers to, as resolved by `typecheck`.
+  [[nodiscard]] const check::Binding& binding() const { return binding_; }
+
+  // Replaces locals that hold a constant with their value.
+  virtual Expression* optimize(opt::Context& ctx) override {
+    if (binding_.kind != check::BindingKind::Local) {
+      return this;
+    }
+
+    const std::optional<double> value = ctx.constant(binding_.local);
+    if (!value) {
+      return this;
+    }
+    Expression* const literal = ctx.literal(type(), *value);
+    return literal != nullptr ? literal : this;
+  }
+
+  virtual void key(opt::Key& key) const override { key.add('v').add(name_.str()); }
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override {
+    out << output::glsl::mangle_name{name_, opts.names};
+  }
 
-  constexpr const std::string& name() const { return name_; }
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override {
+    out << output::metal::mangle_name{name_};
+  }
+
+  virtual output::spirv::Value to_spirv(const output::spirv::Options opts) const override {
+    if (binding_.kind == check::BindingKind::Constant) {
+      // A specialization constant, which is a value rather than a variable.
+      const auto it = opts.function.constants.find(name_.str());
+      if (it == opts.function.constants.end()) {
+        util::msg::fatal("unknown identifier [", name_, "]");
+      }
+      return it->second;
+    }
+    return output::spirv::load(opts, to_spirv_pointer(opts));
+  }
 
-  virtual output::PrintLambda to_glsl(const output::glsl::Options opts) const override {
-    return output::PrintLambda{[=](std::ostream& out) { out << output::glsl::mangle_name{name_}; }};
+  virtual output::spirv::Pointer to_spirv_pointer(
+      const output::spirv::Options opts) const override {
+    const auto it = opts.function.scope.find(name_.str());
+    if (it == opts.function.scope.end()) {
+      util::msg::fatal("unknown identifier [", name_, "]");
+    }
+    return it->second;
   }
 
-  virtual output::PrintLambda to_metal(const output::metal::Options opts) const override {
-    return output::PrintLambda{
-        [=](std::ostream& out) { out << output::metal::mangle_name{name_}; }};
+protected:
+  virtual util::memory::Ref<type::Type> resolve_type_(check::Context& ctx) override {
+    binding_ = ctx.lookup(name_);
+    return binding_.type;
   }
 };
 
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "crystal/compiler/ast/expr/expression.hpp"
+#include "crystal/compiler/ast/symbol.hpp"
+
+namespace crystal::compiler::ast::expr {
+
+// An element of a runtime sized array, eg: `a.b[i]`. The array is always a property, as a storage
+// buffer is the only place that one can be.
+class IndexExpression : public Expression {
+  Expression* expr_;
+  Symbol      name_;
+  Expression* index_;
+
+public:
+  IndexExpression(Expression* expr, Symbol name, Expression* index)
+      : expr_(expr), name_(name), index_(index) {}
+
+  virtual ~IndexExpression() = default;
+
+  [[nodiscard]] virtual Expression* clone(Arena& arena) const override {
+    return arena.make<IndexExpression>(expr_->clone(arena), name_, index_->clone(arena));
+  }
+
+  // The struct is the last operand, which is the one that the optimizer follows down to the root
+  // of a location.
+  virtual void for_each_operand(const std::function<void(Expression*&)>& fn) override {
+    fn(index_);
+    fn(expr_);
+  }
+
+  virtual void key(opt::Key& key) const override { key.add('i').add(name_.str()); }
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override {
+    out << output::glsl::emit{expr_, opts} << "." << output::glsl::member_name{name_, opts.names}
+        << "[" << output::glsl::emit{index_, opts} << "]";
+  }
+
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override {
+    out << output::metal::emit{expr_, opts} << "." << name_ << "["
+        << output::metal::emit{index_, opts} << "]";
+  }
+
+  virtual output::spirv::Value to_spirv(const output::spirv::Options opts) const override {
+    return output::spirv::load(opts, to_spirv_pointer(opts));
+  }
+
+  virtual output::spirv::Pointer to_spirv_pointer(
+      const output::spirv::Options opts) const override {
+    const output::spirv::Pointer array = expr_->to_spirv_pointer(opts);
+    return output::spirv::index(opts, array, name_, index_->to_spirv(opts));
+  }
+
+  virtual Expression* optimize(opt::Context& ctx) override {
+    expr_  = expr_->optimize(ctx);
+    index_ = index_->optimize(ctx);
+    return this;
+  }
+
+  [[nodiscard]] virtual bool addressable() const override { return expr_->addressable(); }
+
+  [[nodiscard]] virtual const IdentifierExpression* root() const override {
+    return expr_->root();
+  }
+
+protected:
+  virtual util::memory::Ref<type::Type> resolve_type_(check::Context& ctx) override {
+    const util::memory::Ref<type::Type> type = expr_->typecheck(ctx);
+    return check::element(ctx, type, name_, index_->typecheck(ctx));
+  }
+};
+
+}  // namespace crystal::compiler::ast::expr
@@ -1,7 +1,8 @@
 #pragma once
 
+#include <optional>
+
 #include "crystal/compiler/ast/expr/expression.hpp"
-#include "crystal/compiler/ast/output/print.hpp"
 
 namespace crystal::compiler::ast::expr {
 
@@ -13,12 +14,32 @@ public:
 
   virtual ~IntegerExpression() = default;
 
-  virtual output::PrintLambda to_glsl(const output::glsl::Options opts) const override {
-    return output::PrintLambda{[=](std::ostream& out) { out << value_; }};
+  [[nodiscard]] virtual Expression* clone(Arena& arena) const override {
+    return arena.make<IntegerExpression>(value_);
+  }
+
+  [[nodiscard]] virtual std::optional<double> constant() const override {
+    return static_cast<double>(value_);
+  }
+
+  virtual void key(opt::Key& key) const override { key.add('i').add(value_); }
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override {
+    out << value_;
+  }
+
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override {
+    out << value_;
+  }
+
+  virtual output::spirv::Value to_spirv(const output::spirv::Options opts) const override {
+    return output::spirv::Value{opts.builder.constant_int(static_cast<int32_t>(value_)),
+                                output::spirv::ValueType::scalar(output::spirv::Kind::Int)};
   }
 
-  virtual output::PrintLambda to_metal(const output::metal::Options opts) const override {
-    return output::PrintLambda{[=](std::ostream& out) { out << value_; }};
+protected:
+  virtual util::memory::Ref<type::Type> resolve_type_(check::Context& ctx) override {
+    return ctx.int_type();
   }
 };
 
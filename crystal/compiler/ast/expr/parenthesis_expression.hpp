@@ -1,27 +1,68 @@
 #pragma once
 
 #include "crystal/compiler/ast/expr/expression.hpp"
-#include "crystal/compiler/ast/output/print.hpp"
-#include "util/memory/ref_count.hpp"
 
 namespace crystal::compiler::ast::expr {
 
 class ParenthesisExpression : public Expression {
-  util::memory::Ref<expr::Expression> expr_;
+  Expression* expr_;
 
 public:
-  ParenthesisExpression(util::memory::Ref<expr::Expression> expr) : expr_(expr) {}
+  ParenthesisExpression(Expression* expr) : expr_(expr) {}
 
   virtual ~ParenthesisExpression() = default;
 
-  virtual output::PrintLambda to_glsl(const output::glsl::Options opts) const override {
-    return output::PrintLambda{
-        [=](std::ostream& out) { out << "(" << expr_->to_glsl(opts) << ")"; }};
+  [[nodiscard]] virtual Expression* clone(Arena& arena) const override {
+    return arena.make<ParenthesisExpression>(expr_->clone(arena));
   }
 
-  virtual output::PrintLambda to_metal(const output::metal::Options opts) const override {
-    return output::PrintLambda{
-        [=](std::ostream& out) { out << "(" << expr_->to_metal(opts) << ")"; }};
+  virtual void for_each_operand(const std::function<void(Expression*&)>& fn) override {
+    fn(expr_);
+  }
+
+  virtual void key(opt::Key& key) const override {}
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override {
+    out << "(" << output::glsl::emit{expr_, opts} << ")";
+  }
+
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override {
+    out << "(" << output::metal::emit{expr_, opts} << ")";
+  }
+
+  virtual output::spirv::Value to_spirv(const output::spirv::Options opts) const override {
+    return expr_->to_spirv(opts);
+  }
+
+  virtual output::spirv::Pointer to_spirv_pointer(
+      const output::spirv::Options opts) const override {
+    return expr_->to_spirv_pointer(opts);
+  }
+
+  virtual Expression* optimize(opt::Context& ctx) override {
+    expr_ = expr_->optimize(ctx);
+
+    // Binary operators never take a negative literal on their right hand side once they have
+    // been optimized, so dropping the parentheses around one can't merge two minus signs.
+    if (expr_->is_identifier() || expr_->constant()) {
+      return expr_;
+    }
+    return this;
+  }
+
+  [[nodiscard]] virtual std::optional<double> constant() const override {
+    return expr_->constant();
+  }
+
+  [[nodiscard]] virtual bool addressable() const override { return expr_->addressable(); }
+
+  [[nodiscard]] virtual const IdentifierExpression* root() const override {
+    return expr_->root();
+  }
+
+protected:
+  virtual util::memory::Ref<type::Type> resolve_type_(check::Context& ctx) override {
+    return expr_->typecheck(ctx);
   }
 };
 
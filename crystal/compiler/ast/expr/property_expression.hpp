@@ -1,29 +1,70 @@
 #pragma once
 
 #include "crystal/compiler/ast/expr/expression.hpp"
-#include "crystal/compiler/ast/output/print.hpp"
-#include "util/memory/ref_count.hpp"
+#include "crystal/compiler/ast/symbol.hpp"
 
 namespace crystal::compiler::ast::expr {
 
 class PropertyExpression : public Expression {
-  util::memory::Ref<expr::Expression> expr_;
-  std::string                         name_;
+  Expression* expr_;
+  Symbol      name_;
 
 public:
-  PropertyExpression(util::memory::Ref<expr::Expression> expr, std::string_view name)
-      : expr_(expr), name_(name) {}
+  PropertyExpression(Expression* expr, Symbol name) : expr_(expr), name_(name) {}
 
   virtual ~PropertyExpression() = default;
 
-  virtual output::PrintLambda to_glsl(const output::glsl::Options opts) const override {
-    return output::PrintLambda{
-        [=](std::ostream& out) { out << expr_->to_glsl(opts) << "." << name_; }};
+  [[nodiscard]] virtual Expression* clone(Arena& arena) const override {
+    return arena.make<PropertyExpression>(expr_->clone(arena), name_);
   }
 
-  virtual output::PrintLambda to_metal(const output::metal::Options opts) const override {
-    return output::PrintLambda{
-        [=](std::ostream& out) { out << expr_->to_metal(opts) << "." << name_; }};
+  virtual void for_each_operand(const std::function<void(Expression*&)>& fn) override {
+    fn(expr_);
+  }
+
+  [[nodiscard]] virtual std::optional<Symbol> property() const override { return name_; }
+
+  virtual void key(opt::Key& key) const override { key.add('p').add(name_.str()); }
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override {
+    out << output::glsl::emit{expr_, opts} << ".";
+    if (expr_->type()->kind() == type::Kind::Struct) {
+      out << output::glsl::member_name{name_, opts.names};
+    } else {
+      out << name_;  // A swizzle.
+    }
+  }
+
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override {
+    out << output::metal::emit{expr_, opts} << "." << name_;
+  }
+
+  virtual output::spirv::Value to_spirv(const output::spirv::Options opts) const override {
+    if (addressable()) {
+      return output::spirv::load(opts, to_spirv_pointer(opts));
+    }
+    return output::spirv::extract(opts, expr_->to_spirv(opts), name_);
+  }
+
+  virtual output::spirv::Pointer to_spirv_pointer(
+      const output::spirv::Options opts) const override {
+    return output::spirv::access(opts, expr_->to_spirv_pointer(opts), name_);
+  }
+
+  virtual Expression* optimize(opt::Context& ctx) override {
+    expr_ = expr_->optimize(ctx);
+    return this;
+  }
+
+  [[nodiscard]] virtual bool addressable() const override { return expr_->addressable(); }
+
+  [[nodiscard]] virtual const IdentifierExpression* root() const override {
+    return expr_->root();
+  }
+
+protected:
+  virtual util::memory::Ref<type::Type> resolve_type_(check::Context& ctx) override {
+    return check::property(ctx, expr_->typecheck(ctx), name_);
   }
 };
 
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <optional>
+#include <string_view>
+
 #include "crystal/compiler/ast/expr/expression.hpp"
-#include "crystal/compiler/ast/output/print.hpp"
-#include "util/memory/ref_count.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
+#include "util/msg/msg.hpp"
 
 namespace crystal::compiler::ast::expr {
 
@@ -12,41 +15,96 @@ enum class UnOp {
   Neg,
 };
 
+inline std::string_view to_string(const UnOp op) {
+  switch (op) {
+    case UnOp::Pos:
+      return "+";
+
+    case UnOp::Neg:
+      return "-";
+
+    default:
+      util::msg::fatal("unhandled unary operator [", static_cast<uint32_t>(op), "]");
+      break;
+  }
+  return "";
+}
+
 class UnOpExpression : public Expression {
-  util::memory::Ref<expr::Expression> rhs_;
-  UnOp                                op_;
+  Expression* rhs_;
+  UnOp        op_;
 
 public:
-  UnOpExpression(util::memory::Ref<expr::Expression> rhs, UnOp op) : rhs_(rhs), op_(op) {}
+  UnOpExpression(Expression* rhs, UnOp op) : rhs_(rhs), op_(op) {}
 
   virtual ~UnOpExpression() = default;
 
-  virtual output::PrintLambda to_glsl(const output::glsl::Options opts) const override {
-    switch (op_) {
-      case UnOp::Pos:
-        return output::PrintLambda{[=](std::ostream& out) { out << "+" << rhs_->to_glsl(opts); }};
+  [[nodiscard]] virtual Expression* clone(Arena& arena) const override {
+    return arena.make<UnOpExpression>(rhs_->clone(arena), op_);
+  }
 
-      case UnOp::Neg:
-        return output::PrintLambda{[=](std::ostream& out) { out << "-" << rhs_->to_glsl(opts); }};
+  virtual Expression* optimize(opt::Context& ctx) override {
+    rhs_ = rhs_->optimize(ctx);
+    return opt::unary(ctx, this, op_, rhs_);
+  }
 
-      default:
-        util::msg::fatal("unhandled unary operator [", static_cast<uint32_t>(op_), "]");
-        break;
+  [[nodiscard]] virtual std::optional<double> constant() const override {
+    const std::optional<double> value = rhs_->constant();
+    if (value && op_ == UnOp::Neg) {
+      return -*value;
     }
+    return value;
+  }
+
+  virtual void for_each_operand(const std::function<void(Expression*&)>& fn) override {
+    fn(rhs_);
+  }
+
+  virtual void key(opt::Key& key) const override { key.add('u').add(op_); }
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override {
+    out << to_string(op_) << output::glsl::emit{rhs_, opts};
   }
 
-  virtual output::PrintLambda to_metal(const output::metal::Options opts) const override {
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override {
+    out << to_string(op_) << output::metal::emit{rhs_, opts};
+  }
+
+  virtual output::spirv::Value to_spirv(const output::spirv::Options opts) const override {
+    const output::spirv::Value rhs = rhs_->to_spirv(opts);
     switch (op_) {
       case UnOp::Pos:
-        return output::PrintLambda{[=](std::ostream& out) { out << "+" << rhs_->to_metal(opts); }};
+        return rhs;
 
       case UnOp::Neg:
-        return output::PrintLambda{[=](std::ostream& out) { out << "-" << rhs_->to_metal(opts); }};
+        switch (rhs.type.kind) {
+          case output::spirv::Kind::Float:
+            return output::spirv::Value{opts.emit(spv::Op::OpFNegate, rhs.type, {rhs.id}),
+                                        rhs.type};
+          case output::spirv::Kind::Int:
+            return output::spirv::Value{opts.emit(spv::Op::OpSNegate, rhs.type, {rhs.id}),
+                                        rhs.type};
+          case output::spirv::Kind::Matrix:
+            return output::spirv::Value{
+                opts.emit(spv::Op::OpMatrixTimesScalar, rhs.type,
+                          {rhs.id, opts.builder.constant_float(-1.0f)}),
+                rhs.type};
+          default:
+            util::msg::fatal("unary operator [-] is not defined for this type");
+            break;
+        }
+        break;
 
       default:
         util::msg::fatal("unhandled unary operator [", static_cast<uint32_t>(op_), "]");
         break;
     }
+    return rhs;
+  }
+
+protected:
+  virtual util::memory::Ref<type::Type> resolve_type_(check::Context& ctx) override {
+    return check::unary(ctx, op_, rhs_->typecheck(ctx));
   }
 };
 
@@ -1,12 +1,19 @@
 #include "crystal/compiler/ast/module.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 
 #include "crystal/common/proto/proto.hpp"
 #include "crystal/compiler/ast/output/metal.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
+#include "crystal/compiler/ast/parallel.hpp"
 #include "crystal/compiler/ast/type/all.hpp"
+#include "crystal/compiler/spirv/spirv.hpp"
 #include "util/fs/file.hpp"
 #include "util/fs/tmp.hpp"
 #include "util/msg/msg.hpp"
@@ -14,51 +21,235 @@
 
 namespace crystal::compiler::ast {
 
+namespace {
+
+template <typename Container>
+std::vector<uint32_t> to_spv(const Container& contents) {
+  std::vector<uint32_t> spv(contents.size() / sizeof(uint32_t));
+  std::memcpy(spv.data(), contents.data(), spv.size() * sizeof(uint32_t));
+  return spv;
+}
+
+std::vector<uint32_t> read_spv_file(const std::filesystem::path& path) {
+  return to_spv(util::fs::read_file_binary(path.string()));
+}
+
+// Returns the command followed by what it prints for `--version`, used to tell apart output cached
+// by different versions of an external tool.
+std::string tool_version(const std::string& cmd) {
+  std::string version = cmd;
+
+#if _WIN32
+  FILE* pipe = _popen((cmd + " --version").c_str(), "r");
+#else   // ^^^ _WIN32 / !_WIN32 vvv
+  FILE* pipe = popen((cmd + " --version").c_str(), "r");
+#endif  // ^^^ !_WIN32
+  if (pipe != nullptr) {
+    std::array<char, 256> buffer;
+    size_t                size = 0;
+    while ((size = fread(buffer.data(), 1, buffer.size(), pipe)) > 0) {
+      version.append(buffer.data(), size);
+    }
+#if _WIN32
+    _pclose(pipe);
+#else   // ^^^ _WIN32 / !_WIN32 vvv
+    pclose(pipe);
+#endif  // ^^^ !_WIN32
+  }
+
+  return version;
+}
+
+// Returns the version string reported by the metal compiler, used to tell apart output cached by
+// different versions of Xcode.
+std::string metal_tool_version() {
+#if __APPLE__
+  return tool_version("xcrun -sdk macosx metal");
+#else   // ^^^ __APPLE__ / !__APPLE__ vvv
+  return "xcrun -sdk macosx metal";
+#endif  // ^^^ !__APPLE__
+}
+
+// Fallback used when an external glslangValidator executable is explicitly requested, instead of
+// compiling in-process.
+std::vector<uint32_t> compile_glsl_external(const std::string_view glslang_validator_exe,
+                                            const std::string& src, const spirv::Stage stage,
+                                            const std::string& entry_point) {
+  const auto tmp_dir    = util::fs::TemporaryDirectory();
+  const auto stage_name = std::string(spirv::stage_name(stage));
+  const auto src_path   = tmp_dir.path() / (entry_point + "." + stage_name + ".glsl");
+  const auto spv_path   = tmp_dir.path() / (entry_point + "." + stage_name + ".spv");
+
+  {  // Wrap output file in additional scope to close file before running command on it.
+    std::ofstream out(src_path);
+    out << src;
+  }
+
+  std::stringstream cmd;
+  cmd << std::filesystem::path{glslang_validator_exe} << " -Os -V -S " << stage_name << " -e "
+      << entry_point << " --source-entrypoint main -o " << spv_path << " " << src_path;
+  util::proc::run_command(cmd.str().c_str());
+
+  return read_spv_file(spv_path);
+}
+
+// Fallback used when an external spirv-link executable is explicitly requested, instead of linking
+// in-process.
+std::vector<uint32_t> link_external(const std::string_view                    spirv_link_exe,
+                                    const std::vector<std::vector<uint32_t>>& spv_partials) {
+  const auto tmp_dir  = util::fs::TemporaryDirectory();
+  const auto out_path = tmp_dir.path() / "_.spv";
+
+  std::stringstream cmd;
+  cmd << std::filesystem::path{spirv_link_exe} << " -o " << out_path;
+  for (size_t i = 0; i < spv_partials.size(); ++i) {
+    const auto spv_path = tmp_dir.path() / (std::to_string(i) + ".spv");
+
+    {  // Wrap output file in additional scope to close file before running command on it.
+      std::ofstream out(spv_path, std::ios_base::out | std::ios_base::binary);
+      out.write(reinterpret_cast<const char*>(spv_partials[i].data()),
+                spv_partials[i].size() * sizeof(uint32_t));
+    }
+
+    cmd << " " << spv_path;
+  }
+  util::proc::run_command(cmd.str().c_str());
+
+  return read_spv_file(out_path);
+}
+
+// Writes a declaration between include guards, named after it and a hash of its text.
+void write_guarded(std::ostream& out, const std::string& name, const std::string& decl) {
+  char hash[17] = {0};
+  snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(cache::hash(decl)));
+  const std::string guard = name + "_" + hash;
+  out << "#ifndef " << guard << "\n#define " << guard << "\n" << decl << "#endif  // " << guard
+      << "\n\n";
+}
+
+}  // namespace
+
+const std::vector<util::memory::Ref<type::Type>>& Module::base_types() {
+  // Built once, and shared by every module compiled by the process, as they're never modified.
+  static const std::vector<util::memory::Ref<type::Type>> types = []() {
+    auto bool_t = util::memory::Ref<type::StructType>::make("bool", true);
+    bool_t->set_shape(type::Kind::Bool, 1);
+    auto int_t = util::memory::Ref<type::StructType>::make("int", true);
+    int_t->set_shape(type::Kind::Int, 1);
+    auto float_t = util::memory::Ref<type::StructType>::make("float", true);
+    float_t->set_glsl_name("float");
+    float_t->set_metal_name("float");
+    float_t->set_shape(type::Kind::Float, 1);
+    auto vec2_t = util::memory::Ref<type::StructType>::make("vec2", true,
+                                                            std::vector{
+                                                                type::StructProperty{"x", float_t},
+                                                                type::StructProperty{"y", float_t},
+                                                            });
+    vec2_t->set_glsl_name("vec2");
+    vec2_t->set_metal_name("float2");
+    vec2_t->set_shape(type::Kind::Float, 2);
+    auto vec3_t = util::memory::Ref<type::StructType>::make("vec3", true,
+                                                            std::vector{
+                                                                type::StructProperty{"x", float_t},
+                                                                type::StructProperty{"y", float_t},
+                                                                type::StructProperty{"z", float_t},
+                                                            });
+    vec3_t->set_glsl_name("vec3");
+    vec3_t->set_metal_name("float3");
+    vec3_t->set_shape(type::Kind::Float, 3);
+    auto vec4_t = util::memory::Ref<type::StructType>::make("vec4", true,
+                                                            std::vector{
+                                                                type::StructProperty{"x", float_t},
+                                                                type::StructProperty{"y", float_t},
+                                                                type::StructProperty{"z", float_t},
+                                                                type::StructProperty{"w", float_t},
+                                                            });
+    vec4_t->set_glsl_name("vec4");
+    vec4_t->set_metal_name("float4");
+    vec4_t->set_shape(type::Kind::Float, 4);
+    auto mat4_t = util::memory::Ref<type::StructType>::make("mat4", true);
+    mat4_t->set_glsl_name("mat4");
+    mat4_t->set_metal_name("float4x4");
+    mat4_t->set_shape(type::Kind::Matrix, 4);
+
+    auto texture2D_t = util::memory::Ref<type::StructType>::make("Texture2D", true);
+    texture2D_t->set_glsl_name("sampler2D");
+    texture2D_t->set_metal_name("texture2d<float>");
+    texture2D_t->set_shape(type::Kind::Texture, 1);
+
+    return std::vector<util::memory::Ref<type::Type>>{
+        bool_t, int_t, float_t, vec2_t, vec3_t, vec4_t, mat4_t, texture2D_t,
+    };
+  }();
+  return types;
+}
+
+void Module::add_type(util::memory::Ref<type::Type> type) {
+  if (!type_dict_.emplace(std::make_pair(intern(type->name()), type)).second) {
+    util::msg::fatal("redeclaration of type [", type->name(), "]");
+  }
+  type_list_.emplace_back(type);
+}
+
 void Module::add_base_types() {
-  auto float_t = util::memory::Ref<type::StructType>::make("float", true);
-  float_t->set_glsl_name("float");
-  float_t->set_metal_name("float");
-  auto vec2_t = util::memory::Ref<type::StructType>::make("vec2", true,
-                                                          std::vector{
-                                                              type::StructProperty{"x", float_t},
-                                                              type::StructProperty{"y", float_t},
-                                                          });
-  vec2_t->set_glsl_name("vec2");
-  vec2_t->set_metal_name("float2");
-  auto vec3_t = util::memory::Ref<type::StructType>::make("vec3", true,
-                                                          std::vector{
-                                                              type::StructProperty{"x", float_t},
-                                                              type::StructProperty{"y", float_t},
-                                                              type::StructProperty{"z", float_t},
-                                                          });
-  vec3_t->set_glsl_name("vec3");
-  vec3_t->set_metal_name("float3");
-  auto vec4_t = util::memory::Ref<type::StructType>::make("vec4", true,
-                                                          std::vector{
-                                                              type::StructProperty{"x", float_t},
-                                                              type::StructProperty{"y", float_t},
-                                                              type::StructProperty{"z", float_t},
-                                                              type::StructProperty{"w", float_t},
-                                                          });
-  vec4_t->set_glsl_name("vec4");
-  vec4_t->set_metal_name("float4");
-  auto mat4_t = util::memory::Ref<type::StructType>::make("mat4", true);
-  mat4_t->set_glsl_name("mat4");
-  mat4_t->set_metal_name("float4x4");
-
-  auto texture2D_t = util::memory::Ref<type::StructType>::make("Texture2D", true);
-  texture2D_t->set_glsl_name("sampler2D");
-  texture2D_t->set_metal_name("texture2d<float>");
-
-  add_type(float_t);
-  add_type(vec2_t);
-  add_type(vec3_t);
-  add_type(vec4_t);
-  add_type(mat4_t);
-  add_type(texture2D_t);
+  for (const auto& type : base_types()) {
+    add_type(type);
+  }
 }
 
-const std::optional<util::memory::Ref<type::Type>> Module::find_type(std::string_view name) const {
+void Module::typecheck() {
+  for (const auto& pipeline : pipeline_list_) {
+    pipeline->typecheck(*this);
+    for (const auto& variant : pipeline->variants()) {
+      if (variant->name() != pipeline->name() && pipeline_dict_.contains(intern(variant->name()))) {
+        util::msg::fatal("variant [", variant->name(), "] of pipeline [", pipeline->name(),
+                         "] has the same name as another pipeline");
+      }
+    }
+  }
+
+  // A struct only has a single layout in the C++ header.
+  const type::TypeSet uniforms = uniform_types_();
+  for (const auto& pipeline : pipeline_list_) {
+    for (const auto& storage : pipeline->storage_buffers()) {
+      if (uniforms.contains(storage.type)) {
+        util::msg::fatal("type [", storage.type->name(),
+                         "] can not be used by both uniform and storage buffers");
+      }
+    }
+  }
+}
+
+void Module::optimize() {
+  for (const auto& pipeline : pipeline_list_) {
+    if (pipeline->variants().empty()) {
+      pipeline->optimize(*this);
+      continue;
+    }
+
+    // Variants that only differed in code that has now been folded away are merged.
+    for (const auto& variant : pipeline->distinct_variants()) {
+      variant->optimize(*this);
+    }
+    pipeline->merge_variants(*this);
+  }
+}
+
+std::vector<util::memory::Ref<decl::PipelineDeclaration>> Module::emitted_pipelines_() const {
+  std::vector<util::memory::Ref<decl::PipelineDeclaration>> pipelines;
+  for (const auto& pipeline : pipeline_list_) {
+    if (pipeline->variants().empty()) {
+      pipelines.push_back(pipeline);
+      continue;
+    }
+    for (const auto& variant : pipeline->distinct_variants()) {
+      pipelines.push_back(variant);
+    }
+  }
+  return pipelines;
+}
+
+const std::optional<util::memory::Ref<type::Type>> Module::find_type(const Symbol name) const {
   const auto it = type_dict_.find(name);
   if (it != type_dict_.cend()) {
     return it->second;
@@ -68,7 +259,7 @@ const std::optional<util::memory::Ref<type::Type>> Module::find_type(std::string
 }
 
 const std::optional<util::memory::Ref<decl::VertexDeclaration>> Module::find_vertex_function(
-    std::string_view name) const {
+    const Symbol name) const {
   const auto it = vertex_function_dict_.find(name);
   if (it != vertex_function_dict_.cend()) {
     return it->second;
@@ -78,7 +269,7 @@ const std::optional<util::memory::Ref<decl::VertexDeclaration>> Module::find_ver
 }
 
 const std::optional<util::memory::Ref<decl::FragmentDeclaration>> Module::find_fragment_function(
-    std::string_view name) const {
+    const Symbol name) const {
   const auto it = fragment_function_dict_.find(name);
   if (it != fragment_function_dict_.cend()) {
     return it->second;
@@ -87,8 +278,39 @@ const std::optional<util::memory::Ref<decl::FragmentDeclaration>> Module::find_f
   return std::nullopt;
 }
 
+const std::optional<util::memory::Ref<type::Type>> Module::find_type(std::string_view name) const {
+  const auto symbol = interner_.find(name);
+  if (symbol) {
+    return find_type(*symbol);
+  }
+
+  return std::nullopt;
+}
+
+const std::optional<util::memory::Ref<decl::VertexDeclaration>> Module::find_vertex_function(
+    std::string_view name) const {
+  const auto symbol = interner_.find(name);
+  if (symbol) {
+    return find_vertex_function(*symbol);
+  }
+
+  return std::nullopt;
+}
+
+const std::optional<util::memory::Ref<decl::FragmentDeclaration>> Module::find_fragment_function(
+    std::string_view name) const {
+  const auto symbol = interner_.find(name);
+  if (symbol) {
+    return find_fragment_function(*symbol);
+  }
+
+  return std::nullopt;
+}
+
 void Module::to_cpphdr(std::ostream& out, const CppOutputOptions& opts) const {
   out << "#pragma once\n\n"
+      << "#include <cstddef>\n"
+      << "#include <cstdint>\n\n"
       << "#include \"crystal/common/pipeline_desc.hpp\"\n"
       << "#include \"glm/glm.hpp\"\n\n";
 
@@ -113,19 +335,91 @@ void Module::to_cpphdr(std::ostream& out, const CppOutputOptions& opts) const {
 
   out << "using namespace glm;\n\n";
 
-  // TODO: Output only the used types.
-  // Output the struct types.
+  // Output the struct types that any of the pipelines use. A struct from an imported module is
+  // also declared by the header of every other module that imports it, so each one is guarded to
+  // let those headers be included together. The guard includes a hash of the whole declaration, so
+  // that two differing declarations of the same name still fail to compile.
+  std::string guard_prefix = "CRYSTAL_STRUCT_";
+  for (const auto& name : namespace_) {
+    guard_prefix += name + "_";
+  }
+
+  type::TypeSet types;
+  for (const auto& pipeline : pipeline_list_) {
+    pipeline->add_types(types);
+  }
+  const type::TypeSet uniforms = uniform_types_();
+  const type::TypeSet storage  = storage_types_();
   for (const auto& type : type_list_) {
-    if (type->builtin()) {
+    if (!types.contains(type)) {
       continue;
     }
 
-    out << "struct " << type->name() << " {\n";
     const util::memory::Ref<type::StructType> struct_type = type;
+    std::ostringstream                        decl;
+    if (!uniforms.contains(type) && !storage.contains(type)) {
+      decl << "struct " << type->name() << " {\n";
+      for (auto& prop : struct_type->properties()) {
+        decl << "  " << prop.type->name() << " " << prop.name << ";\n";
+      }
+      decl << "};\n";
+      write_guarded(out, guard_prefix + type->name(), decl.str());
+      continue;
+    }
+
+    // The glm types are only aligned to their components, so the std140 or std430 alignment of
+    // each member is spelled out. Bools are 4 bytes in a buffer block. A runtime sized array is
+    // left out, and its elements are found with the offset and stride constants instead, which
+    // needs the struct to be aligned as a whole.
+    const type::Layout layout =
+        uniforms.contains(type) ? type::Layout::Std140 : type::Layout::Std430;
+    const std::string_view layout_name = layout == type::Layout::Std140 ? "std140" : "std430";
+    const uint32_t         struct_alignment = type::alignment(struct_type, layout);
+    decl << "struct ";
+    if (layout == type::Layout::Std140) {
+      decl << "alignas(16) ";
+    } else if (struct_type->runtime_sized() && struct_alignment > 4) {
+      decl << "alignas(" << struct_alignment << ") ";
+    }
+    decl << type->name() << " {\n";
     for (auto& prop : struct_type->properties()) {
-      out << "  " << prop.type->name() << " " << prop.name << ";\n";
+      if (prop.array) {
+        continue;
+      }
+      const uint32_t alignment = type::alignment(prop.type, layout);
+      decl << "  ";
+      if (alignment > 4) {
+        decl << "alignas(" << alignment << ") ";
+      }
+      decl << (prop.type->kind() == type::Kind::Bool ? "uint32_t" : prop.type->name()) << " "
+           << prop.name << ";\n";
     }
-    out << "};\n\n";
+
+    const std::vector<uint32_t> offsets = type::offsets(struct_type, layout);
+    for (size_t i = 0; i < offsets.size(); ++i) {
+      const type::StructProperty& prop = struct_type->properties()[i];
+      if (prop.array) {
+        decl << "  static constexpr uint32_t " << prop.name << "_offset = " << offsets[i]
+             << ";\n";
+        decl << "  static constexpr uint32_t " << prop.name
+             << "_stride = " << type::stride(prop.type, layout) << ";\n";
+      }
+    }
+    decl << "};\n\n";
+
+    for (size_t i = 0; i < offsets.size(); ++i) {
+      const type::StructProperty& prop = struct_type->properties()[i];
+      if (prop.array) {
+        continue;
+      }
+      decl << "static_assert(offsetof(" << type->name() << ", " << prop.name
+           << ") == " << offsets[i] << ", \"" << layout_name << "\");\n";
+    }
+    if (offsets.size() > 1 || !struct_type->runtime_sized()) {
+      decl << "static_assert(sizeof(" << type->name()
+           << ") == " << type::size(struct_type, layout) << ", \"" << layout_name << "\");\n";
+    }
+    write_guarded(out, guard_prefix + type->name(), decl.str());
   }
 
   for (const auto& pipeline : pipeline_list_) {
@@ -152,18 +446,54 @@ void Module::to_cpphdr(std::ostream& out, const CppOutputOptions& opts) const {
 }
 
 void Module::to_metal(std::ostream& out, const MetalOutputOptions& opts) const {
-  out << output::metal::HDR;
+  type::TypeSet types;
+  for (const auto& pipeline : pipeline_list_) {
+    pipeline->add_types(types);
+  }
+
+  output::Writer src;
+  src << output::metal::HDR;
+  to_metal_types_(src, types);
+
+  for (const auto& pipeline : pipeline_list_) {
+    output::metal::declare_function_constants(src, *pipeline);
+  }
+  for (const auto& pipeline : emitted_pipelines_()) {
+    pipeline->to_metal(src, *this);
+  }
+
+  out << src;
+}
 
-  // Output the struct types.
+void Module::to_metal_types_(output::Writer& out, const type::TypeSet& types) const {
+  const type::TypeSet uniforms = uniform_types_();
+  const type::TypeSet storage  = storage_types_();
   for (const auto& type : type_list_) {
-    if (type->builtin()) {
+    if (!types.contains(type)) {
       continue;
     }
 
-    out << "struct " << type->name() << " {\n";
+    const bool uniform = uniforms.contains(type);
+    const bool buffer  = uniform || storage.contains(type);
+    out << (uniform ? "struct alignas(16) " : "struct ") << type->name() << " {\n";
     const util::memory::Ref<type::StructType> struct_type = type;
     for (auto& prop : struct_type->properties()) {
-      out << output::metal::indent{1} << prop.type->metal_name() << " " << prop.name;
+      out << output::metal::indent{1};
+
+      // Uniforms match the std140 layout of the C++ header, and storage buffers std430. Only a
+      // float3, which is padded out to 16 bytes, and a bool, which is a single byte, need anything
+      // spelled out.
+      if (prop.array) {
+        // Indexed past its end, the same as the runtime sized array of the other languages. The
+        // stride of a float3 is already 16 bytes.
+        out << prop.type->metal_name() << " " << prop.name << "[1]";
+      } else if (buffer && prop.type->kind() == type::Kind::Float && prop.type->count() == 3) {
+        out << "alignas(16) packed_float3 " << prop.name;
+      } else if (buffer && prop.type->kind() == type::Kind::Bool) {
+        out << "alignas(4) " << prop.type->metal_name() << " " << prop.name;
+      } else {
+        out << prop.type->metal_name() << " " << prop.name;
+      }
       if (prop.index >= 0) {
         out << " [[ color(" << prop.index << ") ]]";
       }
@@ -171,103 +501,219 @@ void Module::to_metal(std::ostream& out, const MetalOutputOptions& opts) const {
     }
     out << "};\n\n";
   }
+}
+
+type::TypeSet Module::uniform_types_() const {
+  type::TypeSet types;
+  for (const auto& pipeline : pipeline_list_) {
+    for (const auto& [type, name, binding] : pipeline->uniforms()) {
+      types.add(type);
+    }
+  }
+  return types;
+}
 
+type::TypeSet Module::storage_types_() const {
+  type::TypeSet types;
   for (const auto& pipeline : pipeline_list_) {
-    pipeline->to_metal(out, *this);
+    for (const auto& storage : pipeline->storage_buffers()) {
+      types.add(storage.type);
+    }
   }
+  return types;
 }
 
 void Module::to_crystallib(std::ostream& out, const CrystallibOutputOptions& opts) const {
   crystal::common::proto::Library lib_pb;
 
-  if (opts.opengl) {
+  // Every backend lists the pipelines in this order, which the variant tables index into.
+  const std::vector<util::memory::Ref<decl::PipelineDeclaration>> pipelines = emitted_pipelines_();
+  {
+    uint32_t index = 0;
     for (const auto& pipeline : pipeline_list_) {
-      pipeline->make_opengl_crystallib(*lib_pb.mutable_opengl()->add_pipelines(), *this);
+      if (pipeline->variants().empty()) {
+        ++index;
+        continue;
+      }
+
+      common::proto::Variants* variants_pb = lib_pb.add_variants();
+      variants_pb->set_name(pipeline->name());
+      for (const auto& feature : pipeline->features()) {
+        variants_pb->add_features(feature);
+      }
+
+      const auto distinct = pipeline->distinct_variants();
+      for (const auto& variant : pipeline->variants()) {
+        const auto it = std::find(distinct.begin(), distinct.end(), variant);
+        variants_pb->add_pipelines(index + static_cast<uint32_t>(it - distinct.begin()));
+      }
+      index += static_cast<uint32_t>(distinct.size());
+    }
+  }
+
+  if (opts.opengl) {
+    const trace::Span span(opts.trace, "opengl");
+
+    // Add every pipeline up front, so that each one can then be filled in independently.
+    auto& opengl_pb = *lib_pb.mutable_opengl();
+    for (size_t i = 0; i < pipelines.size(); ++i) {
+      opengl_pb.add_pipelines();
+    }
+
+    parallel_for(pipelines.size(), opts.jobs, [&](const size_t i) {
+      const trace::Span span(opts.trace, "emit opengl glsl", pipelines[i]->name());
+      pipelines[i]->make_opengl_crystallib(*opengl_pb.mutable_pipelines(i), *this, opts.minify);
+    });
+
+    for (const auto& pipeline_pb : opengl_pb.pipelines()) {
+      trace::add_stat(opts.trace, "opengl glsl bytes",
+                      pipeline_pb.vertex_source().size() + pipeline_pb.fragment_source().size() +
+                          pipeline_pb.compute_source().size());
     }
   }
 
   if (opts.vulkan) {
-    make_vulkan_crystallib_(*lib_pb.mutable_vulkan(), opts.glslang_validator_exe,
-                            opts.spirv_link_exe);
+    const trace::Span span(opts.trace, "vulkan");
+    make_vulkan_crystallib_(*lib_pb.mutable_vulkan(), pipelines, opts);
+    trace::add_stat(opts.trace, "vulkan spir-v bytes", lib_pb.vulkan().library().size());
   }
 
   if (opts.metal) {
-    make_metal_crystallib_(*lib_pb.mutable_metal());
+    const trace::Span span(opts.trace, "metal");
+    make_metal_crystallib_(*lib_pb.mutable_metal(), pipelines, opts);
+    trace::add_stat(opts.trace, "metal library bytes", lib_pb.metal().library().size());
   }
 
-  if (!lib_pb.SerializeToOstream(&out)) {
-    util::msg::fatal("serializing library to file");
+  {
+    const trace::Span span(opts.trace, "serialize crystallib");
+    if (!lib_pb.SerializeToOstream(&out)) {
+      util::msg::fatal("serializing library to file");
+    }
   }
+  trace::add_stat(opts.trace, "crystallib bytes", lib_pb.ByteSizeLong());
 }
 
-void Module::make_vulkan_crystallib_(crystal::common::proto::Vulkan& vulkan_pb,
-                                     const std::string_view          glslang_validator_exe,
-                                     const std::string_view          spirv_link_exe) const {
-  const auto tmp_dir                    = util::fs::TemporaryDirectory();
-  const auto glslang_validator_exe_path = std::filesystem::path{glslang_validator_exe};
-  const auto spirv_link_exe_path        = std::filesystem::path{spirv_link_exe};
+void Module::to_interface(std::ostream& out) const {
+  // One line per struct, followed by one line per property. Every name is an identifier, so none
+  // of them can contain the spaces that separate the fields.
+  out << INTERFACE_VERSION << "\n";
+  for (const auto& type : type_list_) {
+    if (type->builtin()) {
+      continue;
+    }
 
-  std::vector<std::filesystem::path> spv_partials;
-  for (const auto& pipeline : pipeline_list_) {
-    {  // Vertex shader.
-      const auto src_path = tmp_dir.path() / (pipeline->name() + ".vert.glsl");
-      const auto spv_path = tmp_dir.path() / (pipeline->name() + ".vert.spv");
+    const util::memory::Ref<type::StructType> struct_type = type;
+    out << "struct " << type->name() << " " << struct_type->packed() << " "
+        << struct_type->properties().size() << "\n";
+    for (const auto& prop : struct_type->properties()) {
+      out << prop.type->name() << " " << prop.name << " " << prop.index << " " << prop.array
+          << "\n";
+    }
+  }
+}
 
-      {  // Wrap output file in additional scope to close file before running command on it.
-        std::ofstream out(src_path);
-        pipeline->vertex_function()->to_glsl(out, *this, true, true);
-      }
+void Module::add_interface(const std::string_view interface) {
+  std::istringstream in{std::string(interface)};
 
-      std::stringstream cmd;
-      cmd << glslang_validator_exe_path << " -Os -V -S vert -e " << pipeline->name()
-          << " --source-entrypoint main -o " << spv_path << " " << src_path;
-      // std::cout << "VERT_CMD=" << cmd.str() << std::endl;
-      util::proc::run_command(cmd.str().c_str());
+  std::string version;
+  if (!std::getline(in, version) || version != INTERFACE_VERSION) {
+    util::msg::fatal("invalid module interface");
+  }
 
-      spv_partials.push_back(spv_path.string());
+  std::string keyword;
+  while (in >> keyword) {
+    std::string name;
+    bool        packed = false;
+    size_t      count  = 0;
+    if (keyword != "struct" || !(in >> name >> packed >> count)) {
+      util::msg::fatal("invalid module interface");
     }
 
-    if (pipeline->fragment_function() != nullptr) {  // Fragment shader.
-      const auto src_path = tmp_dir.path() / (pipeline->name() + ".frag.glsl");
-      const auto spv_path = tmp_dir.path() / (pipeline->name() + ".frag.spv");
+    std::vector<type::StructProperty> props;
+    for (size_t i = 0; i < count; ++i) {
+      std::string type_name;
+      std::string prop_name;
+      int32_t     index = -1;
+      bool        array = false;
+      if (!(in >> type_name >> prop_name >> index >> array)) {
+        util::msg::fatal("invalid module interface");
+      }
 
-      {  // Wrap output file in additional scope to close file before running command on it.
-        std::ofstream out(src_path);
-        pipeline->fragment_function()->to_glsl(out, *this, true, true);
+      const auto type = find_type(type_name);
+      if (type == std::nullopt) {
+        util::msg::fatal("type [", type_name, "] does not exist");
       }
+      props.emplace_back(prop_name, type.value(), index);
+      props.back().array = array;
+    }
 
-      std::stringstream cmd;
-      cmd << glslang_validator_exe_path << " -Os -V -S frag -e " << pipeline->name()
-          << " --source-entrypoint main -o " << spv_path << " " << src_path;
-      // std::cout << "FRAG_CMD=" << cmd.str() << std::endl;
-      util::proc::run_command(cmd.str().c_str());
+    const auto existing = find_type(name);
+    if (existing != std::nullopt) {
+      // The same struct, reached through more than one import.
+      const util::memory::Ref<type::StructType> struct_type = existing.value();
+      bool same = !struct_type->builtin() && struct_type->packed() == packed &&
+                  struct_type->properties().size() == props.size();
+      for (size_t i = 0; same && i < props.size(); ++i) {
+        const auto& prop = struct_type->properties()[i];
+        same = prop.name == props[i].name && prop.type == props[i].type &&
+               prop.index == props[i].index && prop.array == props[i].array;
+      }
+      if (!same) {
+        util::msg::fatal("conflicting declarations of type [", name, "]");
+      }
+      continue;
+    }
 
-      spv_partials.push_back(spv_path);
+    const auto type = util::memory::Ref<type::StructType>::make(name, false, std::move(props));
+    if (packed) {
+      type->set_packed();
     }
+    add_type(type);
   }
+}
 
-  {  // Link partial spv files together.
-    const auto out_path = tmp_dir.path() / "_.spv";
-
-    std::stringstream cmd;
-    cmd << spirv_link_exe_path << " -o " << out_path;
-    for (const auto& spv : spv_partials) {
-      cmd << " " << spv;
+std::vector<uint32_t> Module::to_spirv() const {
+  output::spirv::Builder builder;
+  for (const auto& pipeline : emitted_pipelines_()) {
+    if (pipeline->compute_function() != nullptr) {
+      pipeline->compute_function()->to_spirv(builder, *this);
+      continue;
+    }
+    pipeline->vertex_function()->to_spirv(builder, *this);
+    if (pipeline->fragment_function() != nullptr) {
+      pipeline->fragment_function()->to_spirv(builder, *this);
     }
-    // std::cout << "LINK_CMD=" << cmd.str() << std::endl;
-    util::proc::run_command(cmd.str().c_str());
+  }
+  return builder.finish();
+}
 
-    const auto spv_contents = util::fs::read_file_binary(out_path.string());
-    vulkan_pb.set_library(spv_contents.data(), spv_contents.size());
+void Module::make_vulkan_crystallib_(
+    crystal::common::proto::Vulkan&                                  vulkan_pb,
+    const std::vector<util::memory::Ref<decl::PipelineDeclaration>>& pipelines,
+    const CrystallibOutputOptions&                                   opts) const {
+  {  // Shader library.
+    const bool glsl = opts.vulkan_glsl || vulkan_glsl_ || opts.glslang_validator_exe.size() > 0 ||
+                      opts.spirv_link_exe.size() > 0;
+    std::vector<uint32_t> spv_library;
+    if (glsl) {
+      spv_library = compile_vulkan_glsl_(pipelines, opts);
+    } else {
+      const trace::Span span(opts.trace, "emit spir-v");
+      spv_library = to_spirv();
+    }
+    vulkan_pb.set_library(spv_library.data(), spv_library.size() * sizeof(uint32_t));
   }
 
-  for (const auto& pipeline : pipeline_list_) {
+  for (const auto& pipeline : pipelines) {
     common::proto::VKPipeline* pipeline_pb = vulkan_pb.add_pipelines();
 
     pipeline_pb->set_name(pipeline->name());
     if (pipeline->fragment_function() != nullptr) {
       pipeline_pb->set_fragment(true);
     }
+    if (pipeline->compute_function() != nullptr) {
+      pipeline_pb->set_compute(true);
+    }
 
     for (const auto& [type, name, binding] : pipeline->uniforms()) {
       common::proto::VKUniform* uniform_pb = pipeline_pb->add_uniforms();
@@ -278,40 +724,197 @@ void Module::make_vulkan_crystallib_(crystal::common::proto::Vulkan& vulkan_pb,
       common::proto::VKTexture* texture_pb = pipeline_pb->add_textures();
       texture_pb->set_binding(binding);
     }
+
+    for (const auto& storage : pipeline->storage_buffers()) {
+      common::proto::VKStorage* storage_pb = pipeline_pb->add_storage();
+      storage_pb->set_binding(storage.binding);
+    }
+
+    for (const auto& constant : pipeline->constants()) {
+      common::proto::VKConstant* constant_pb = pipeline_pb->add_constants();
+      constant_pb->set_id(constant.id);
+      constant_pb->set_actual(constant.actual);
+      constant_pb->set_type(constant.proto_type());
+    }
+  }
+}
+
+std::vector<uint32_t> Module::compile_vulkan_glsl_(
+    const std::vector<util::memory::Ref<decl::PipelineDeclaration>>& pipelines,
+    const CrystallibOutputOptions&                                   opts) const {
+  const std::string_view glslang_validator_exe = opts.glslang_validator_exe;
+  const std::string_view spirv_link_exe        = opts.spirv_link_exe;
+  cache::Cache* const    cache                 = opts.cache;
+
+  // The external glslangValidator is identified by the version it reports, not by its path, so
+  // that upgrading it in place does not reuse output it cached before.
+  std::string tool(spirv::TOOL_VERSION);
+  if (cache != nullptr && glslang_validator_exe.size() > 0) {
+    tool = tool_version(std::string(glslang_validator_exe));
+  }
+
+  const auto compile = [&](const std::string& src, const spirv::Stage stage,
+                           const std::string& entry_point) {
+    const cache::Key key{"vulkan", spirv::stage_name(stage), entry_point, tool, src};
+    if (cache != nullptr) {
+      const auto cached = cache->load(key);
+      if (cached.has_value()) {
+        return to_spv(cached.value());
+      }
+    }
+
+    std::vector<uint32_t> spv;
+    if (glslang_validator_exe.size() == 0) {
+      const trace::Span span(opts.trace, "glslang", entry_point);
+      spv = spirv::compile_glsl(src, stage, entry_point);
+    } else {
+      const trace::Span span(opts.trace, "glslangValidator", entry_point);
+      spv = compile_glsl_external(glslang_validator_exe, src, stage, entry_point);
+    }
+    if (cache != nullptr) {
+      cache->store(key, std::string_view(reinterpret_cast<const char*>(spv.data()),
+                                         spv.size() * sizeof(uint32_t)));
+    }
+    return spv;
+  };
+
+  std::vector<std::vector<uint32_t>> vertex_spvs(pipelines.size());
+  std::vector<std::vector<uint32_t>> fragment_spvs(pipelines.size());
+  parallel_for(pipelines.size(), opts.jobs, [&](const size_t i) {
+    const auto& pipeline = pipelines[i];
+
+    if (pipeline->compute_function() != nullptr) {  // Compute shader, in place of the vertex one.
+      output::Writer src;
+      {
+        const trace::Span span(opts.trace, "emit vulkan glsl", pipeline->name());
+        pipeline->compute_function()->to_glsl(src, *this, true, true);
+      }
+      vertex_spvs[i] = compile(src.str(), spirv::Stage::Compute, pipeline->name());
+      return;
+    }
+
+    {  // Vertex shader.
+      output::Writer src;
+      {
+        const trace::Span span(opts.trace, "emit vulkan glsl", pipeline->name());
+        pipeline->vertex_function()->to_glsl(src, *this, true, true);
+      }
+      vertex_spvs[i] = compile(src.str(), spirv::Stage::Vertex, pipeline->name());
+    }
+
+    if (pipeline->fragment_function() != nullptr) {  // Fragment shader.
+      output::Writer src;
+      {
+        const trace::Span span(opts.trace, "emit vulkan glsl", pipeline->name());
+        pipeline->fragment_function()->to_glsl(src, *this, true, true);
+      }
+      fragment_spvs[i] = compile(src.str(), spirv::Stage::Fragment, pipeline->name());
+    }
+  });
+
+  // Merge the results back in declaration order, so that the linked library is the same regardless
+  // of how many jobs were used to compile it.
+  std::vector<std::vector<uint32_t>> spv_partials;
+  for (size_t i = 0; i < pipelines.size(); ++i) {
+    spv_partials.emplace_back(std::move(vertex_spvs[i]));
+    if (pipelines[i]->fragment_function() != nullptr) {
+      spv_partials.emplace_back(std::move(fragment_spvs[i]));
+    }
+  }
+
+  // Link partial spv modules together.
+  if (spirv_link_exe.size() == 0) {
+    const trace::Span span(opts.trace, "spirv link");
+    return spirv::link(spv_partials);
   }
+  const trace::Span span(opts.trace, "spirv-link");
+  return link_external(spirv_link_exe, spv_partials);
 }
 
-void Module::make_metal_crystallib_(crystal::common::proto::Metal& metal_pb) const {
+void Module::make_metal_crystallib_(
+    crystal::common::proto::Metal&                                   metal_pb,
+    const std::vector<util::memory::Ref<decl::PipelineDeclaration>>& pipelines,
+    const CrystallibOutputOptions&                                   opts) const {
+  cache::Cache* const cache = opts.cache;
+
   const auto tmp_dir            = util::fs::TemporaryDirectory();
-  auto       metal_file_name    = tmp_dir.path() / "tmp.metal";
-  auto       air_file_name      = tmp_dir.path() / "tmp.air";
   auto       metallib_file_name = tmp_dir.path() / "tmp.metallib";
+  const auto tool               = cache != nullptr ? metal_tool_version() : std::string{};
+
+  // Each pipeline is compiled into its own *.air file, which are then all linked together.
+  std::vector<std::filesystem::path> air_file_names(pipelines.size());
+  parallel_for(pipelines.size(), opts.jobs, [&](const size_t i) {
+    const auto& pipeline        = pipelines[i];
+    const auto  metal_file_name = tmp_dir.path() / (pipeline->name() + ".metal");
+    air_file_names[i]           = tmp_dir.path() / (pipeline->name() + ".air");
+
+    type::TypeSet types;
+    pipeline->add_types(types);
+
+    output::Writer src;
+    {
+      const trace::Span span(opts.trace, "emit metal", pipeline->name());
+      src << output::metal::HDR;
+      to_metal_types_(src, types);
+      output::metal::declare_function_constants(src, *pipeline);
+      pipeline->to_metal(src, *this);
+    }
 
-  {
-    std::ofstream output_file(metal_file_name, std::ios::out);
-    to_metal(output_file, MetalOutputOptions{});
-  }
+    const cache::Key key{"metal", "air", pipeline->name(), tool, src.str()};
+    if (cache != nullptr) {
+      const auto cached = cache->load(key);
+      if (cached.has_value()) {
+        std::ofstream output_file(air_file_names[i], std::ios::out | std::ios::binary);
+        output_file << cached.value();
+        return;
+      }
+    }
+
+    {
+      std::ofstream output_file(metal_file_name, std::ios::out);
+      output_file << src.str();
+    }
 
-  {
     std::stringstream cmd;
-    cmd << "xcrun -sdk macosx metal -c " << metal_file_name << " -o " << air_file_name;
-    std::system(cmd.str().c_str());
-  }
+    cmd << "xcrun -sdk macosx metal -c " << metal_file_name << " -o " << air_file_names[i];
+    {
+      const trace::Span span(opts.trace, "xcrun metal", pipeline->name());
+      std::system(cmd.str().c_str());
+    }
+
+    if (cache != nullptr) {
+      const auto air_contents = util::fs::read_file_binary(air_file_names[i].string());
+      cache->store(key, std::string_view(reinterpret_cast<const char*>(air_contents.data()),
+                                         air_contents.size()));
+    }
+  });
 
   {
     std::stringstream cmd;
-    cmd << "xcrun -sdk macosx metallib " << air_file_name << " -o " << metallib_file_name;
+    cmd << "xcrun -sdk macosx metallib";
+    for (const auto& air_file_name : air_file_names) {
+      cmd << " " << air_file_name;
+    }
+    cmd << " -o " << metallib_file_name;
+    const trace::Span span(opts.trace, "xcrun metallib");
     std::system(cmd.str().c_str());
   }
 
   const auto matallib_contents = util::fs::read_file_binary(metallib_file_name.string());
   metal_pb.set_library(matallib_contents.data(), matallib_contents.size());
 
-  for (const auto& pipeline : pipeline_list_) {
+  for (const auto& pipeline : pipelines) {
     common::proto::MTLPipeline* pipeline_pb = metal_pb.add_pipelines();
 
     pipeline_pb->set_name(pipeline->name());
-    pipeline_pb->set_vertex_name(pipeline->vertex_function()->name());
+    if (pipeline->compute_function() != nullptr) {
+      pipeline_pb->set_compute_name(pipeline->compute_function()->name());
+      for (const uint32_t size : pipeline->compute_function()->workgroup_size()) {
+        pipeline_pb->add_workgroup_size(size);
+      }
+    } else {
+      pipeline_pb->set_vertex_name(pipeline->vertex_function()->name());
+    }
     if (pipeline->fragment_function() != nullptr) {
       pipeline_pb->set_fragment_name(pipeline->fragment_function()->name());
     }
@@ -321,6 +924,19 @@ void Module::make_metal_crystallib_(crystal::common::proto::Metal& metal_pb) con
       uniform_pb->set_binding(binding);
       uniform_pb->set_actual(output::metal::uniform_binding(pipeline, binding));
     }
+
+    for (const auto& storage : pipeline->storage_buffers()) {
+      common::proto::MTLStorage* storage_pb = pipeline_pb->add_storage();
+      storage_pb->set_binding(storage.binding);
+      storage_pb->set_actual(output::metal::storage_binding(pipeline, storage.binding));
+    }
+
+    for (const auto& constant : pipeline->constants()) {
+      common::proto::MTLConstant* constant_pb = pipeline_pb->add_constants();
+      constant_pb->set_id(constant.id);
+      constant_pb->set_actual(constant.actual);
+      constant_pb->set_type(constant.proto_type());
+    }
   }
 }
 
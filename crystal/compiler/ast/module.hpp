@@ -2,17 +2,30 @@
 
 #include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "crystal/compiler/ast/arena.hpp"
+#include "crystal/compiler/ast/decl/compute_declaration.hpp"
 #include "crystal/compiler/ast/decl/fragment_declaration.hpp"
 #include "crystal/compiler/ast/decl/pipeline_declaration.hpp"
 #include "crystal/compiler/ast/decl/vertex_declaration.hpp"
+#include "crystal/compiler/ast/output/writer.hpp"
+#include "crystal/compiler/ast/symbol.hpp"
 #include "crystal/compiler/ast/type/type.hpp"
+#include "crystal/compiler/ast/type/type_set.hpp"
+#include "crystal/compiler/cache/cache.hpp"
+#include "crystal/compiler/trace/trace.hpp"
 #include "util/memory/ref_count.hpp"
 
 namespace crystal::compiler::ast {
 
+// Identifies the format written by `Module::to_interface`, and the cached interfaces the parser
+// keeps. Bump this whenever the interface format changes.
+inline constexpr std::string_view INTERFACE_VERSION = "crystal-interface-2";
+
 struct CppOutputOptions {
   bool cpp17;
 };
@@ -24,33 +37,71 @@ struct CrystallibOutputOptions {
   bool vulkan;
   bool metal;
 
-  // Path to the glslangValidator executable that will be used to convert glsl to spv.
+  // Compile the vulkan stages from their glsl, rather than emitting spir-v directly from the ast.
+  // Implied by either of the external tools below.
+  bool vulkan_glsl = false;
+
+  // Shorten the identifiers in the opengl glsl. The names of the textures are recorded in the
+  // library, and those of the uniform blocks are kept.
+  bool minify = false;
+
+  // Optional path to a glslangValidator executable that will be used to convert glsl to spv. When
+  // empty, the glsl is compiled in-process instead.
   std::string_view glslang_validator_exe;
-  // Path to the spirv-link executable that will be used to merge the individual spv files into a
-  // single monolithic library.
+  // Optional path to a spirv-link executable that will be used to merge the individual spv files
+  // into a single monolithic library. When empty, the spv is linked in-process instead.
   std::string_view spirv_link_exe;
+
+  // The maximum number of pipelines to compile concurrently. The output is identical regardless of
+  // the value used.
+  uint32_t jobs = 1;
+
+  // Optional cache of previously compiled shader stages. When set, only the stages whose emitted
+  // source (or compiler) changed since they were cached are recompiled.
+  cache::Cache* cache = nullptr;
+
+  // Optional trace that records how long each phase takes, and how large each output is.
+  trace::Trace* trace = nullptr;
 };
 
 class Module {
+  // Owns every expression and statement in the module, along with the text of every symbol.
+  // Declared first so that it outlives everything that points into it.
+  Arena    arena_;
+  Interner interner_;
+
   std::vector<std::string> namespace_;
 
-  std::vector<util::memory::Ref<type::Type>>                      type_list_;
-  absl::flat_hash_map<std::string, util::memory::Ref<type::Type>> type_dict_;
+  std::vector<util::memory::Ref<type::Type>>                 type_list_;
+  absl::flat_hash_map<Symbol, util::memory::Ref<type::Type>> type_dict_;
 
-  std::vector<util::memory::Ref<decl::VertexDeclaration>> vertex_function_list_;
-  absl::flat_hash_map<std::string, util::memory::Ref<decl::VertexDeclaration>>
-      vertex_function_dict_;
+  std::vector<util::memory::Ref<decl::VertexDeclaration>>                 vertex_function_list_;
+  absl::flat_hash_map<Symbol, util::memory::Ref<decl::VertexDeclaration>> vertex_function_dict_;
 
   std::vector<util::memory::Ref<decl::FragmentDeclaration>> fragment_function_list_;
-  absl::flat_hash_map<std::string, util::memory::Ref<decl::FragmentDeclaration>>
+  absl::flat_hash_map<Symbol, util::memory::Ref<decl::FragmentDeclaration>>
       fragment_function_dict_;
 
-  std::vector<util::memory::Ref<decl::PipelineDeclaration>>                      pipeline_list_;
-  absl::flat_hash_map<std::string, util::memory::Ref<decl::PipelineDeclaration>> pipeline_dict_;
+  std::vector<util::memory::Ref<decl::PipelineDeclaration>>                 pipeline_list_;
+  absl::flat_hash_map<Symbol, util::memory::Ref<decl::PipelineDeclaration>> pipeline_dict_;
+
+  uint32_t constant_count_ = 0;
+
+  // Whether the module uses anything that the spir-v output can't emit.
+  bool vulkan_glsl_ = false;
 
 public:
   Module() = default;
 
+  Module(Module&&) = default;
+  Module& operator=(Module&&) = default;
+
+  // Everything the module has allocated, for reporting the size of the ast.
+  [[nodiscard]] const Arena& arena() const { return arena_; }
+
+  // For copying nodes with their `clone`.
+  [[nodiscard]] Arena& arena() { return arena_; }
+
   [[nodiscard]] const std::vector<util::memory::Ref<type::Type>>& types() const {
     return type_list_;
   }
@@ -62,31 +113,59 @@ public:
   fragment_functions() const {
     return fragment_function_list_;
   }
+  [[nodiscard]] const std::vector<util::memory::Ref<decl::PipelineDeclaration>>& pipelines()
+      const {
+    return pipeline_list_;
+  }
+
+  // The builtin types, eg: `vec4`.
+  [[nodiscard]] static const std::vector<util::memory::Ref<type::Type>>& base_types();
 
   void add_base_types();
 
+  // Constructs an ast node that is owned by, and freed along with, the module.
+  template <typename T, typename... Args>
+  [[nodiscard]] T* make(Args&&... args) {
+    return arena_.make<T>(std::forward<Args>(args)...);
+  }
+
+  [[nodiscard]] Symbol intern(const std::string_view str) { return interner_.intern(arena_, str); }
+
   void set_namespace(std::vector<std::string>& ns) { namespace_ = ns; }
 
-  void add_type(util::memory::Ref<type::Type> type) {
-    type_list_.emplace_back(type);
-    type_dict_.emplace(std::make_pair(type->name(), type));
-  }
+  void add_type(util::memory::Ref<type::Type> type);
 
   void add_vertex_function(util::memory::Ref<decl::VertexDeclaration> decl) {
     vertex_function_list_.emplace_back(decl);
-    vertex_function_dict_.emplace(std::make_pair(decl->name(), decl));
+    vertex_function_dict_.emplace(std::make_pair(intern(decl->name()), decl));
   }
 
   void add_fragment_function(util::memory::Ref<decl::FragmentDeclaration> decl) {
     fragment_function_list_.emplace_back(decl);
-    fragment_function_dict_.emplace(std::make_pair(decl->name(), decl));
+    fragment_function_dict_.emplace(std::make_pair(intern(decl->name()), decl));
   }
 
+  // Every `const` pipeline parameter gets an id that is unique within the module, as the shaders of
+  // all of the pipelines end up in one spir-v module.
+  [[nodiscard]] uint32_t make_constant_id() { return constant_count_++; }
+
+  // Marks the module as using something that the spir-v output can't emit, such as
+  // `sampleOffset`, so that its vulkan shaders are compiled from glsl instead.
+  void require_vulkan_glsl() { vulkan_glsl_ = true; }
+  [[nodiscard]] bool requires_vulkan_glsl() const { return vulkan_glsl_; }
+
   void add_pipeline(util::memory::Ref<decl::PipelineDeclaration> decl) {
     pipeline_list_.emplace_back(decl);
-    pipeline_dict_.emplace(std::make_pair(decl->name(), decl));
+    pipeline_dict_.emplace(std::make_pair(intern(decl->name()), decl));
   }
 
+  [[nodiscard]] const std::optional<util::memory::Ref<type::Type>> find_type(Symbol name) const;
+  [[nodiscard]] const std::optional<util::memory::Ref<decl::VertexDeclaration>>
+  find_vertex_function(Symbol name) const;
+  [[nodiscard]] const std::optional<util::memory::Ref<decl::FragmentDeclaration>>
+  find_fragment_function(Symbol name) const;
+
+  // Lookups by name, for names that may never have been interned.
   [[nodiscard]] const std::optional<util::memory::Ref<type::Type>> find_type(
       std::string_view name) const;
   [[nodiscard]] const std::optional<util::memory::Ref<decl::VertexDeclaration>>
@@ -94,15 +173,56 @@ public:
   [[nodiscard]] const std::optional<util::memory::Ref<decl::FragmentDeclaration>>
   find_fragment_function(std::string_view name) const;
 
+  // Resolves the type of every expression in every pipeline. This must run before any of the
+  // outputs are generated.
+  void typecheck();
+
+  // Folds constant expressions, removes redundant arithmetic, computes repeated subexpressions once
+  // and packs the varyings that are used in every pipeline. Requires `typecheck`.
+  void optimize();
+
   void to_cpphdr(std::ostream& out, const CppOutputOptions& opts) const;
   void to_metal(std::ostream& out, const MetalOutputOptions& opts) const;
   void to_crystallib(std::ostream& out, const CrystallibOutputOptions& opts) const;
 
+  // Writes the interface of the module, which is every struct type it declares or imports, for
+  // other modules to import with `add_interface`.
+  void to_interface(std::ostream& out) const;
+
+  // Declares the struct types of an imported module's interface. A type that is already declared
+  // identically, such as one that two imports share, is skipped.
+  void add_interface(std::string_view interface);
+
+  // Emits every pipeline into a single spir-v module, with one entry point per stage. Fails for a
+  // module that `requires_vulkan_glsl`.
+  [[nodiscard]] std::vector<uint32_t> to_spirv() const;
+
 private:
-  void make_vulkan_crystallib_(crystal::common::proto::Vulkan& vulkan_pb,
-                               const std::string_view          glslang_validator_exe,
-                               const std::string_view          spirv_link_exe) const;
-  void make_metal_crystallib_(crystal::common::proto::Metal& metal_pb) const;
+  // The struct types that are used by a uniform block, whose layout has to match std140.
+  [[nodiscard]] type::TypeSet uniform_types_() const;
+
+  // The struct types that are used by a storage block, whose layout has to match std430.
+  [[nodiscard]] type::TypeSet storage_types_() const;
+
+  // The pipelines that are output: those without features, and the distinct variants of those with
+  // them, in declaration order.
+  [[nodiscard]] std::vector<util::memory::Ref<decl::PipelineDeclaration>> emitted_pipelines_()
+      const;
+
+  // Outputs the struct types in `types`, in the order that they're declared in.
+  void to_metal_types_(output::Writer& out, const type::TypeSet& types) const;
+
+  void make_vulkan_crystallib_(
+      crystal::common::proto::Vulkan&                                  vulkan_pb,
+      const std::vector<util::memory::Ref<decl::PipelineDeclaration>>& pipelines,
+      const CrystallibOutputOptions&                                   opts) const;
+  [[nodiscard]] std::vector<uint32_t> compile_vulkan_glsl_(
+      const std::vector<util::memory::Ref<decl::PipelineDeclaration>>& pipelines,
+      const CrystallibOutputOptions&                                   opts) const;
+  void make_metal_crystallib_(
+      crystal::common::proto::Metal&                                   metal_pb,
+      const std::vector<util::memory::Ref<decl::PipelineDeclaration>>& pipelines,
+      const CrystallibOutputOptions&                                   opts) const;
 };
 
 }  // namespace crystal::compiler::ast
@@ -0,0 +1,130 @@
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "crystal/compiler/ast/expr/expression.hpp"
+#include "crystal/compiler/ast/expr/identifier_expression.hpp"
+#include "crystal/compiler/ast/opt/opt.hpp"
+#include "crystal/compiler/ast/stmt/statement.hpp"
+#include "crystal/compiler/ast/stmt/variable_statement.hpp"
+
+namespace crystal::compiler::ast::opt {
+
+namespace {
+
+struct Value {
+  uint32_t number = 0;
+
+  // Whether the expression is worth storing in a temporary. Variables, literals and the properties
+  // of variables are just as cheap to repeat.
+  bool candidate = false;
+
+  // Whether the expression passes the value of its operand through, such as parentheses.
+  bool transparent = false;
+};
+
+// Numbers the expressions of a function body, such that two expressions get the same number
+// exactly when they compute the same value.
+class Numbering {
+  absl::flat_hash_map<std::string, uint32_t>              numbers_;
+  absl::flat_hash_map<Symbol, uint32_t>                   versions_;
+  absl::flat_hash_map<const expr::Expression*, Value>     values_;
+  absl::flat_hash_map<uint32_t, uint32_t>                 counts_;
+  absl::flat_hash_map<uint32_t, stmt::VariableStatement*> temporaries_;
+
+public:
+  // Must be called in the order that the expressions are evaluated in, as a variable is a
+  // different value after every assignment to it.
+  uint32_t number(expr::Expression* expr) {
+    Key key;
+    expr->key(key);
+    if (key.bytes().empty()) {
+      uint32_t number = 0;
+      expr->for_each_operand([&](expr::Expression*& operand) { number = this->number(operand); });
+      values_[expr] = Value{number, false, true};
+      return number;
+    }
+
+    if (expr->is_identifier()) {
+      key.add(versions_[static_cast<const expr::IdentifierExpression*>(expr)->name()]);
+    }
+    expr->for_each_operand([&](expr::Expression*& operand) { key.add(number(operand)); });
+
+    const uint32_t number    = numbers_.try_emplace(key.bytes(), numbers_.size()).first->second;
+    const bool     candidate = !expr->is_identifier() && !expr->addressable() && !expr->constant();
+    values_[expr]            = Value{number, candidate};
+    return number;
+  }
+
+  void assign(const expr::Expression& location) { ++versions_[location.root()->name()]; }
+
+  // Counts the candidates that remain once their repetitions are replaced, which excludes those
+  // nested inside of a repetition.
+  void count(expr::Expression* expr) {
+    const Value& value = values_.at(expr);
+    if (value.candidate && ++counts_[value.number] > 1) {
+      return;
+    }
+    expr->for_each_operand([&](expr::Expression*& operand) { count(operand); });
+  }
+
+  // Replaces every repeated candidate with a reference to a temporary. The temporaries are added
+  // to `declarations` in the order that they need to be declared in.
+  void replace(Context& ctx, expr::Expression*& expr,
+               std::vector<stmt::Statement*>& declarations) {
+    const Value value = values_.at(expr);
+    if (!value.candidate || counts_[value.number] < 2) {
+      expr->for_each_operand([&](expr::Expression*& operand) {
+        replace(ctx, operand, declarations);
+
+        // There is no need to keep the parentheses around a temporary.
+        if (value.transparent && operand->is_identifier()) {
+          expr = operand;
+        }
+      });
+      return;
+    }
+
+    const auto it = temporaries_.find(value.number);
+    if (it != temporaries_.end()) {
+      expr = ctx.reference(it->second);
+      return;
+    }
+
+    // Anything repeated within the first occurrence is declared before it.
+    expr->for_each_operand(
+        [&](expr::Expression*& operand) { replace(ctx, operand, declarations); });
+
+    stmt::VariableStatement* const local = ctx.temporary(expr);
+    declarations.push_back(local);
+    temporaries_.emplace(value.number, local);
+    expr = ctx.reference(local);
+  }
+};
+
+}  // namespace
+
+void eliminate_common_subexpressions(Context& ctx, std::vector<stmt::Statement*>& body) {
+  Numbering numbering;
+  for (const auto& stmt : body) {
+    stmt->for_each_expression([&](expr::Expression*& expr) { numbering.number(expr); });
+    stmt->for_each_assigned([&](expr::Expression* location) { numbering.assign(*location); });
+  }
+
+  for (const auto& stmt : body) {
+    stmt->for_each_expression([&](expr::Expression*& expr) { numbering.count(expr); });
+  }
+
+  std::vector<stmt::Statement*> result;
+  result.reserve(body.size());
+  for (const auto& stmt : body) {
+    stmt->for_each_expression(
+        [&](expr::Expression*& expr) { numbering.replace(ctx, expr, result); });
+    result.push_back(stmt);
+  }
+  body = std::move(result);
+}
+
+}  // namespace crystal::compiler::ast::opt
@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "crystal/compiler/ast/expr/expression.hpp"
+#include "crystal/compiler/ast/expr/identifier_expression.hpp"
+#include "crystal/compiler/ast/opt/opt.hpp"
+#include "crystal/compiler/ast/stmt/statement.hpp"
+
+namespace crystal::compiler::ast::opt {
+
+namespace {
+
+// The only operand of a property expression.
+expr::Expression* operand(expr::Expression* expr) {
+  expr::Expression* result = nullptr;
+  expr->for_each_operand([&](expr::Expression*& operand) { result = operand; });
+  return result;
+}
+
+// Whether the expression selects a property of a struct variable, which is tracked on its own.
+bool selects_property(expr::Expression* expr) {
+  if (!expr->property()) {
+    return false;
+  }
+  const expr::Expression* const var = operand(expr);
+  return var->is_identifier() && var->type()->kind() == type::Kind::Struct;
+}
+
+}  // namespace
+
+void Liveness::use(expr::Expression* expr) {
+  if (expr->is_identifier()) {
+    variables_.insert(static_cast<const expr::IdentifierExpression*>(expr)->name());
+    return;
+  }
+
+  if (selects_property(expr)) {
+    const auto* const var = static_cast<const expr::IdentifierExpression*>(operand(expr));
+    properties_[var->name()].insert(*expr->property());
+    return;
+  }
+
+  expr->for_each_operand([&](expr::Expression*& operand) { use(operand); });
+}
+
+void Liveness::use_result(expr::Expression* expr) {
+  if (!result_ || !expr->is_identifier()) {
+    use(expr);
+    return;
+  }
+
+  auto& properties = properties_[static_cast<const expr::IdentifierExpression*>(expr)->name()];
+  properties.insert(result_->begin(), result_->end());
+}
+
+bool Liveness::needed(expr::Expression* location) const {
+  const expr::IdentifierExpression* const root = location->root();
+  if (root == nullptr) {
+    return true;
+  }
+
+  // Find the part of the location that is directly on the variable, eg: `a.b` in `a.b.c`.
+  while (location != root && operand(location) != root) {
+    location = operand(location);
+  }
+  if (location != root && selects_property(location)) {
+    return needed(root->name(), *location->property());
+  }
+  return needed(root->name());
+}
+
+bool Liveness::needed(const Symbol variable) const {
+  return variables_.contains(variable) || properties_.contains(variable);
+}
+
+bool Liveness::needed(const Symbol variable, const Symbol property) const {
+  if (variables_.contains(variable)) {
+    return true;
+  }
+  const auto it = properties_.find(variable);
+  return it != properties_.end() && it->second.contains(property);
+}
+
+void eliminate_dead_code(Liveness& live, std::vector<stmt::Statement*>& body) {
+  std::vector<stmt::Statement*> result;
+  result.reserve(body.size());
+  for (auto it = body.rbegin(); it != body.rend(); ++it) {
+    if ((*it)->live(live)) {
+      result.push_back(*it);
+    }
+  }
+  std::reverse(result.begin(), result.end());
+  body = std::move(result);
+}
+
+}  // namespace crystal::compiler::ast::opt
@@ -0,0 +1,374 @@
+#include "crystal/compiler/ast/opt/opt.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <utility>
+
+#include "crystal/compiler/ast/expr/bin_op_expression.hpp"
+#include "crystal/compiler/ast/expr/bool_expression.hpp"
+#include "crystal/compiler/ast/expr/float_expression.hpp"
+#include "crystal/compiler/ast/expr/identifier_expression.hpp"
+#include "crystal/compiler/ast/expr/integer_expression.hpp"
+#include "crystal/compiler/ast/expr/un_op_expression.hpp"
+#include "crystal/compiler/ast/module.hpp"
+#include "crystal/compiler/ast/stmt/variable_statement.hpp"
+
+namespace crystal::compiler::ast::opt {
+
+namespace {
+
+using util::memory::Ref;
+
+bool is_bool(const type::Type& type) {
+  return type.kind() == type::Kind::Bool && type.count() == 1;
+}
+
+bool is_int(const type::Type& type) { return type.kind() == type::Kind::Int && type.count() == 1; }
+
+bool is_float(const type::Type& type) {
+  return type.kind() == type::Kind::Float && type.count() == 1;
+}
+
+// Whether the expression is a literal with the given value.
+bool is_constant(const expr::Expression* expr, const double value) {
+  const std::optional<double> constant = expr->constant();
+  return constant && *constant == value;
+}
+
+// The following evaluate with the precision that shaders use: 32 bit integers and single
+// precision floats.
+
+std::optional<double> evaluate(const expr::BinOp op, const int64_t lhs, const int64_t rhs) {
+  switch (op) {
+    case expr::BinOp::Add:
+      return static_cast<double>(lhs + rhs);
+    case expr::BinOp::Sub:
+      return static_cast<double>(lhs - rhs);
+    case expr::BinOp::Mul:
+      return static_cast<double>(lhs * rhs);
+    case expr::BinOp::Div:
+      if (rhs == 0) {
+        return std::nullopt;
+      }
+      return static_cast<double>(lhs / rhs);
+    default:
+      return std::nullopt;
+  }
+}
+
+std::optional<double> evaluate(const expr::BinOp op, const float lhs, const float rhs) {
+  switch (op) {
+    case expr::BinOp::Add:
+      return lhs + rhs;
+    case expr::BinOp::Sub:
+      return lhs - rhs;
+    case expr::BinOp::Mul:
+      return lhs * rhs;
+    case expr::BinOp::Div:
+      return lhs / rhs;
+    default:
+      return std::nullopt;
+  }
+}
+
+// Comparisons and logical operators, which are exact for any of the scalar types.
+std::optional<double> evaluate_bool(const expr::BinOp op, const double lhs, const double rhs) {
+  switch (op) {
+    case expr::BinOp::Eq:
+      return lhs == rhs;
+    case expr::BinOp::Ne:
+      return lhs != rhs;
+    case expr::BinOp::Lt:
+      return lhs < rhs;
+    case expr::BinOp::Le:
+      return lhs <= rhs;
+    case expr::BinOp::Gt:
+      return lhs > rhs;
+    case expr::BinOp::Ge:
+      return lhs >= rhs;
+    case expr::BinOp::And:
+      return lhs != 0.0 && rhs != 0.0;
+    case expr::BinOp::Or:
+      return lhs != 0.0 || rhs != 0.0;
+    default:
+      return std::nullopt;
+  }
+}
+
+// Only the builtins whose results are exact, so that folding them can't change the output of the
+// shader.
+std::optional<double> evaluate(const std::string_view name, const float* args, const size_t size) {
+  if (size == 1) {
+    const float x = args[0];
+    if (name == "abs") {
+      return std::fabs(x);
+    } else if (name == "ceil") {
+      return std::ceil(x);
+    } else if (name == "floor") {
+      return std::floor(x);
+    } else if (name == "fract") {
+      return x - std::floor(x);
+    } else if (name == "sign") {
+      return x > 0.0f ? 1.0f : (x < 0.0f ? -1.0f : 0.0f);
+    } else if (name == "sqrt" && x >= 0.0f) {
+      return std::sqrt(x);
+    } else if (name == "trunc") {
+      return std::trunc(x);
+    }
+  } else if (size == 2) {
+    if (name == "max") {
+      return std::fmax(args[0], args[1]);
+    } else if (name == "min") {
+      return std::fmin(args[0], args[1]);
+    } else if (name == "step") {
+      return args[1] < args[0] ? 0.0f : 1.0f;
+    }
+  } else if (size == 3) {
+    if (name == "clamp" && args[1] <= args[2]) {
+      return std::fmin(std::fmax(args[0], args[1]), args[2]);
+    }
+  }
+  return std::nullopt;
+}
+
+}  // namespace
+
+Context::Context(Module& mod, Ref<type::Type> return_type)
+    : mod_(mod), check_(mod, std::move(return_type)) {}
+
+expr::Expression* Context::literal(const Ref<type::Type>& type, const double value) {
+  expr::Expression* literal = nullptr;
+  if (is_bool(type)) {
+    literal = mod_.make<expr::BoolExpression>(value != 0.0);
+    literal->typecheck(check_);
+    return literal;
+  }
+  if (is_int(type)) {
+    if (value != std::trunc(value) || std::fabs(value) > INT32_MAX) {
+      return nullptr;
+    }
+    literal = mod_.make<expr::IntegerExpression>(static_cast<long long>(std::fabs(value)));
+  } else if (is_float(type)) {
+    const float single = static_cast<float>(value);
+    if (!std::isfinite(single)) {
+      return nullptr;
+    }
+
+    // Floats are written out with limited precision, so the value may not survive the trip.
+    char buffer[32];
+    if (std::strtof(expr::FloatExpression::format(single, buffer).data(), nullptr) != single) {
+      return nullptr;
+    }
+    literal = mod_.make<expr::FloatExpression>(std::fabs(single));
+  } else {
+    return nullptr;
+  }
+
+  // Negative values are written the same way as they are in the source.
+  if (std::signbit(value)) {
+    literal = mod_.make<expr::UnOpExpression>(literal, expr::UnOp::Neg);
+  }
+  literal->typecheck(check_);
+  return literal;
+}
+
+stmt::VariableStatement* Context::temporary(expr::Expression* value) {
+  // Not a valid identifier in the source, so it can't clash with one.
+  const Symbol name = mod_.intern(std::to_string(temporaries_++));
+
+  stmt::VariableStatement* const local =
+      mod_.make<stmt::VariableStatement>(name, value->type(), value);
+  check_.declare(name, check::Binding{check::BindingKind::Local, value->type(), -1, local});
+  return local;
+}
+
+expr::Expression* Context::reference(const stmt::VariableStatement* local) {
+  expr::Expression* const identifier = mod_.make<expr::IdentifierExpression>(local->name());
+  identifier->typecheck(check_);
+  return identifier;
+}
+
+void Context::set_constant(const stmt::VariableStatement* local, const double value) {
+  constants_.insert_or_assign(local, value);
+}
+
+void Context::clear_constant(const stmt::VariableStatement* local) { constants_.erase(local); }
+
+std::optional<double> Context::constant(const stmt::VariableStatement* local) const {
+  const auto it = constants_.find(local);
+  if (it == constants_.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+expr::Expression* unary(Context& ctx, expr::Expression* expr, const expr::UnOp op,
+                        expr::Expression* rhs) {
+  switch (op) {
+    case expr::UnOp::Pos:
+      return rhs;
+
+    case expr::UnOp::Neg: {
+      const std::optional<double> value = rhs->constant();
+      if (value) {
+        expr::Expression* const literal = ctx.literal(expr->type(), -*value);
+        if (literal != nullptr) {
+          return literal;
+        }
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+  return expr;
+}
+
+expr::Expression* binary(Context& ctx, expr::Expression* expr, expr::BinOp& op,
+                         expr::Expression* lhs, expr::Expression*& rhs) {
+  const Ref<type::Type>& type = expr->type();
+
+  const std::optional<double> lhs_value = lhs->constant();
+  const std::optional<double> rhs_value = rhs->constant();
+  if (lhs_value && rhs_value) {
+    std::optional<double> value;
+    if (is_int(type)) {
+      value = evaluate(op, static_cast<int64_t>(*lhs_value), static_cast<int64_t>(*rhs_value));
+    } else if (is_float(type)) {
+      value = evaluate(op, static_cast<float>(*lhs_value), static_cast<float>(*rhs_value));
+    } else if (is_bool(type) && (is_float(lhs->type()) || is_float(rhs->type()))) {
+      // An integer compared to a float is converted to one first.
+      value = evaluate_bool(op, static_cast<float>(*lhs_value), static_cast<float>(*rhs_value));
+    } else if (is_bool(type)) {
+      value = evaluate_bool(op, *lhs_value, *rhs_value);
+    }
+
+    expr::Expression* const literal = value ? ctx.literal(type, *value) : nullptr;
+    if (literal != nullptr) {
+      return literal;
+    }
+  }
+
+  // Identities, which only apply when they don't change the type of the result. Multiplying by
+  // zero is left alone, as it doesn't hold for infinities and NaNs.
+  switch (op) {
+    case expr::BinOp::Add:
+      if (is_constant(rhs, 0.0) && lhs->type() == type) {
+        return lhs;
+      }
+      if (is_constant(lhs, 0.0) && rhs->type() == type) {
+        return rhs;
+      }
+      break;
+
+    case expr::BinOp::Sub:
+      if (is_constant(rhs, 0.0) && lhs->type() == type) {
+        return lhs;
+      }
+      break;
+
+    case expr::BinOp::Mul:
+      if (is_constant(rhs, 1.0) && lhs->type() == type) {
+        return lhs;
+      }
+      if (is_constant(lhs, 1.0) && rhs->type() == type) {
+        return rhs;
+      }
+      break;
+
+    case expr::BinOp::Div:
+      if (is_constant(rhs, 1.0) && lhs->type() == type) {
+        return lhs;
+      }
+      break;
+
+    // Expressions have no side effects, so either operand may be dropped.
+    case expr::BinOp::And:
+      if (lhs_value) {
+        return *lhs_value != 0.0 ? rhs : lhs;
+      }
+      if (rhs_value) {
+        return *rhs_value != 0.0 ? lhs : rhs;
+      }
+      break;
+
+    case expr::BinOp::Or:
+      if (lhs_value) {
+        return *lhs_value != 0.0 ? lhs : rhs;
+      }
+      if (rhs_value) {
+        return *rhs_value != 0.0 ? rhs : lhs;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  // Adding a negative constant is written as a subtraction, and vice versa, so that two minus
+  // signs never end up next to each other, eg: `a--1.0` in compact glsl.
+  if ((op == expr::BinOp::Add || op == expr::BinOp::Sub) && rhs_value &&
+      std::signbit(*rhs_value)) {
+    expr::Expression* const negated = ctx.literal(rhs->type(), -*rhs_value);
+    if (negated != nullptr) {
+      op  = op == expr::BinOp::Add ? expr::BinOp::Sub : expr::BinOp::Add;
+      rhs = negated;
+    }
+  }
+  return expr;
+}
+
+expr::Expression* construct(Context& ctx, expr::Expression* expr,
+                            const std::vector<expr::Expression*>& args) {
+  // Conversions between scalars, eg: `float(1)`.
+  const Ref<type::Type>& type = expr->type();
+  if (args.size() != 1) {
+    return expr;
+  }
+
+  const std::optional<double> value = args[0]->constant();
+  if (value) {
+    expr::Expression* const literal = ctx.literal(type, is_int(type) ? std::trunc(*value) : *value);
+    if (literal != nullptr) {
+      return literal;
+    }
+  }
+  return expr;
+}
+
+expr::Expression* builtin(Context& ctx, expr::Expression* expr, const std::string_view name,
+                          const std::vector<expr::Expression*>& args) {
+  const Ref<type::Type>& type = expr->type();
+
+  // Mixing with a constant factor of 0 or 1 selects one of the arguments.
+  if (name == "mix" && args.size() == 3) {
+    if (is_constant(args[2], 0.0) && args[0]->type() == type) {
+      return args[0];
+    }
+    if (is_constant(args[2], 1.0) && args[1]->type() == type) {
+      return args[1];
+    }
+  }
+
+  if (!is_float(type) || args.size() > 3) {
+    return expr;
+  }
+
+  float values[3];
+  for (size_t i = 0; i < args.size(); ++i) {
+    const std::optional<double> value = args[i]->constant();
+    if (!value) {
+      return expr;
+    }
+    values[i] = static_cast<float>(*value);
+  }
+
+  const std::optional<double> value = evaluate(name, values, args.size());
+  expr::Expression* const literal   = value ? ctx.literal(type, *value) : nullptr;
+  return literal != nullptr ? literal : expr;
+}
+
+}  // namespace crystal::compiler::ast::opt
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "crystal/compiler/ast/check/check.hpp"
+#include "crystal/compiler/ast/symbol.hpp"
+#include "crystal/compiler/ast/type/type.hpp"
+#include "util/memory/ref_count.hpp"
+
+namespace crystal::compiler::ast {
+
+class Module;
+
+}  // namespace crystal::compiler::ast
+
+namespace crystal::compiler::ast::expr {
+
+class Expression;
+enum class BinOp;
+enum class UnOp;
+
+}  // namespace crystal::compiler::ast::expr
+
+namespace crystal::compiler::ast::stmt {
+
+class Statement;
+class VariableStatement;
+
+}  // namespace crystal::compiler::ast::stmt
+
+namespace crystal::compiler::ast::opt {
+
+// Identifies an operation, but not its operands, for common subexpression elimination.
+class Key {
+  std::string bytes_;
+
+public:
+  template <typename T>
+  Key& add(const T value) {
+    static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+    bytes_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    return *this;
+  }
+
+  Key& add(const std::string_view str) {
+    add(static_cast<uint32_t>(str.size()));
+    bytes_.append(str);
+    return *this;
+  }
+
+  [[nodiscard]] const std::string& bytes() const { return bytes_; }
+};
+
+// Optimization state for a single function body. The body must already have been type checked.
+class Context {
+  Module&        mod_;
+  check::Context check_;
+
+  // The value of every local that was initialized with a constant, and hasn't been assigned to
+  // since.
+  absl::flat_hash_map<const stmt::VariableStatement*, double> constants_;
+
+  uint32_t temporaries_ = 0;
+
+public:
+  Context(Module& mod, util::memory::Ref<type::Type> return_type);
+
+  [[nodiscard]] Module& mod() const { return mod_; }
+
+  // Constructs a type checked literal of a scalar bool, int or float `type`. Returns nullptr if the
+  // value can't be written out exactly, in which case the expression it would replace should be
+  // kept.
+  [[nodiscard]] expr::Expression* literal(const util::memory::Ref<type::Type>& type, double value);
+
+  // Declares a new local that is initialized with `value`. The statement must be inserted into the
+  // body before the first reference to it.
+  [[nodiscard]] stmt::VariableStatement* temporary(expr::Expression* value);
+
+  // Constructs a type checked reference to a local declared by `temporary`.
+  [[nodiscard]] expr::Expression* reference(const stmt::VariableStatement* local);
+
+  void set_constant(const stmt::VariableStatement* local, double value);
+  void clear_constant(const stmt::VariableStatement* local);
+  [[nodiscard]] std::optional<double> constant(const stmt::VariableStatement* local) const;
+
+  // The constant locals at the current point of the body. A block that may not run saves them
+  // beforehand, and restores them afterwards.
+  [[nodiscard]] absl::flat_hash_map<const stmt::VariableStatement*, double> save_constants() const {
+    return constants_;
+  }
+  void restore_constants(absl::flat_hash_map<const stmt::VariableStatement*, double> constants) {
+    constants_ = std::move(constants);
+  }
+};
+
+// The variables, and properties of struct variables, whose values are still needed at some point
+// in a function body. Filled in by walking the body backwards from its end.
+class Liveness {
+  // Which properties of the returned struct are needed, if not all of them.
+  std::optional<absl::flat_hash_set<Symbol>> result_;
+
+  absl::flat_hash_set<Symbol>                              variables_;
+  absl::flat_hash_map<Symbol, absl::flat_hash_set<Symbol>> properties_;
+
+public:
+  Liveness() = default;
+  explicit Liveness(absl::flat_hash_set<Symbol> result) : result_(std::move(result)) {}
+
+  // Marks everything that the expression reads as needed.
+  void use(expr::Expression* expr);
+
+  // Marks the value that the function returns as needed.
+  void use_result(expr::Expression* expr);
+
+  // Marks the whole variable as needed, such as a storage buffer, which is read after the function
+  // returns.
+  void keep(Symbol variable) { variables_.insert(variable); }
+
+  // Whether the location that an addressable expression refers to is needed.
+  [[nodiscard]] bool needed(expr::Expression* location) const;
+
+  // Whether any part of the variable is needed.
+  [[nodiscard]] bool needed(Symbol variable) const;
+  [[nodiscard]] bool needed(Symbol variable, Symbol property) const;
+};
+
+// The following return the expression that should replace `expr`, which is `expr` itself when
+// nothing could be simplified. The operands must already have been optimized, and those passed by
+// reference may be rewritten in place.
+
+[[nodiscard]] expr::Expression* unary(Context& ctx, expr::Expression* expr, expr::UnOp op,
+                                      expr::Expression* rhs);
+
+[[nodiscard]] expr::Expression* binary(Context& ctx, expr::Expression* expr, expr::BinOp& op,
+                                       expr::Expression* lhs, expr::Expression*& rhs);
+
+// Calls the constructor of `expr`'s type.
+[[nodiscard]] expr::Expression* construct(Context& ctx, expr::Expression* expr,
+                                          const std::vector<expr::Expression*>& args);
+
+// Calls one of the builtin functions.
+[[nodiscard]] expr::Expression* builtin(Context& ctx, expr::Expression* expr,
+                                        std::string_view name,
+                                        const std::vector<expr::Expression*>& args);
+
+// Computes each subexpression that is repeated in the body just once, into a temporary declared
+// before the statement that first uses it.
+void eliminate_common_subexpressions(Context& ctx, std::vector<stmt::Statement*>& body);
+
+// Removes the statements whose results are never needed. Afterwards `live` holds what the body
+// reads from the inputs of the function.
+void eliminate_dead_code(Liveness& live, std::vector<stmt::Statement*>& body);
+
+}  // namespace crystal::compiler::ast::opt
@@ -0,0 +1,118 @@
+#include "crystal/compiler/ast/output/glsl.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+#include "crystal/compiler/ast/type/struct_type.hpp"
+
+namespace crystal::compiler::ast::output::glsl {
+
+namespace {
+
+// Keywords, types and builtin functions of up to four characters, which a short name must not
+// clash with. Sorted, for the binary search.
+constexpr std::string_view RESERVED[] = {
+    "abs", "acos", "all", "any", "asin", "asm", "atan", "bool", "case", "cast", "ceil", "cos",
+    "cosh", "dFdx", "dFdy", "do", "dot", "else", "enum", "exp", "exp2", "flat", "fma", "for",
+    "goto", "half", "if", "in", "int", "log", "log2", "long", "lowp", "main", "mat2", "mat3",
+    "mat4", "max", "min", "mix", "mod", "modf", "not", "out", "pow", "sign", "sin", "sinh", "sqrt",
+    "step", "tan", "tanh", "this", "true", "uint", "vec2", "vec3", "vec4", "void",
+};
+
+bool reserved(const std::string_view name) {
+  // The uniform and storage blocks are looked up by these names, and the constants are overridden
+  // through them, so they are left as they are.
+  if (name.size() >= 2 && (name[0] == 'U' || name[0] == 'S' || name[0] == 'C') && name[1] >= '0' &&
+      name[1] <= '9') {
+    return true;
+  }
+  return std::binary_search(std::begin(RESERVED), std::end(RESERVED), name);
+}
+
+// The `index`th identifier made of letters and digits, in order of length.
+std::string make_name(uint32_t index) {
+  constexpr std::string_view CHARS =
+      "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+  constexpr uint32_t FIRST = 52;  // Identifiers can't start with a digit.
+
+  std::string name(1, CHARS[index % FIRST]);
+  index /= FIRST;
+  while (index > 0) {
+    --index;
+    name.push_back(CHARS[index % CHARS.size()]);
+    index /= CHARS.size();
+  }
+  return name;
+}
+
+}  // namespace
+
+std::string_view Names::shorten(const std::string_view name) {
+  const auto it = names_.find(name);
+  if (it != names_.end()) {
+    return it->second;
+  }
+
+  std::string short_name;
+  do {
+    short_name = make_name(next_++);
+  } while (reserved(short_name));
+  return names_.emplace(name, std::move(short_name)).first->second;
+}
+
+std::string constant_value(const type::Type& type, const double value) {
+  switch (type.kind()) {
+    case type::Kind::Bool:
+      return value != 0.0 ? "true" : "false";
+    case type::Kind::Int:
+      return std::to_string(static_cast<int64_t>(value));
+    default: {
+      // Always with a decimal point or an exponent, so that it isn't read as an integer.
+      char buffer[32];
+      std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+      std::string str(buffer);
+      if (str.find_first_of(".e") == std::string::npos) {
+        str += ".0";
+      }
+      return str;
+    }
+  }
+}
+
+void declare_constant(Writer& out, const Options& opts, const type::Type& type,
+                      const std::string_view name, const uint32_t actual, const double value) {
+  if (opts.vulkan) {
+    out << "layout(constant_id=" << actual << (opts.pretty ? ") const " : ")const ")
+        << type.glsl_name() << " " << mangle_name{name, opts.names}
+        << (opts.pretty ? " = " : "=") << constant_value(type, value)
+        << (opts.pretty ? ";\n" : ";");
+    return;
+  }
+
+  // Preprocessor directives have to be on lines of their own, even when minified.
+  out << "#ifndef " << constant_name{actual} << "\n#define " << constant_name{actual} << " "
+      << constant_value(type, value) << "\n#endif\n";
+  out << "const " << type.glsl_name() << " " << mangle_name{name, opts.names}
+      << (opts.pretty ? " = " : "=") << constant_name{actual} << ";\n";
+}
+
+void declare_storage(Writer& out, const Options& opts, const type::StructType& type,
+                     const std::string_view name, const uint32_t binding, const bool readonly) {
+  out << indent{opts.indent} << "layout(std430";
+  if (opts.vulkan) {
+    out << ", set=2";
+  }
+  out << ", binding=" << binding << (opts.pretty ? ") " : ")") << (readonly ? "readonly " : "")
+      << "buffer S" << binding << (opts.pretty ? " {\n" : "{");
+  const Options struct_opts = opts.incr_indent();
+  for (const auto& prop : type.properties()) {
+    out << indent{struct_opts.indent} << type_name{prop.type, opts.names} << " "
+        << member_name{prop.name, opts.names} << (prop.array ? "[]" : "")
+        << (struct_opts.pretty ? ";\n" : ";");
+  }
+  out << indent{opts.indent} << (opts.pretty ? "} " : "}") << mangle_name{name, opts.names}
+      << (opts.pretty ? ";\n" : ";");
+}
+
+}  // namespace crystal::compiler::ast::output::glsl
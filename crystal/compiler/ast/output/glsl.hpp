@@ -1,14 +1,25 @@
 #pragma once
 
-#include <iostream>
+#include <cstdint>
+#include <string>
 #include <string_view>
 
+#include "absl/container/flat_hash_map.h"
+#include "crystal/compiler/ast/output/writer.hpp"
+#include "crystal/compiler/ast/type/type.hpp"
+
 namespace crystal::compiler::ast {
 
 class Module;
 
 }  // namespace crystal::compiler::ast
 
+namespace crystal::compiler::ast::type {
+
+class StructType;
+
+}  // namespace crystal::compiler::ast::type
+
 namespace crystal::compiler::ast::decl {
 
 class VertexDeclaration;
@@ -21,6 +32,21 @@ namespace crystal::compiler::ast::output::glsl {
 constexpr std::string_view GL_HDR = "#version 410 core\n";
 constexpr std::string_view VK_HDR = "#version 420 core\n";
 
+// Compute shaders and storage blocks need glsl 4.3, for both OpenGL and Vulkan.
+constexpr std::string_view CS_HDR = "#version 430 core\n";
+
+// The shortened identifiers of minified output. Each distinct identifier is given the next unused
+// short name the first time that it's written, so sharing one between the stages of a pipeline
+// gives their interfaces the same names.
+class Names {
+  absl::flat_hash_map<std::string, std::string> names_;
+  uint32_t                                      next_ = 0;
+
+public:
+  // The returned view is only valid until the next call.
+  [[nodiscard]] std::string_view shorten(std::string_view name);
+};
+
 struct Options {
   const Module&                    mod;
   const decl::VertexDeclaration*   vertex;
@@ -28,64 +54,145 @@ struct Options {
   const uint32_t                   indent;
   const bool                       pretty;
   const bool                       vulkan;
+  Names* const                     names;  // Renames every identifier, when not null.
 
   constexpr Options(const Module& mod, const decl::VertexDeclaration* vertex,
                     const decl::FragmentDeclaration* fragment, const uint32_t indent,
-                    const bool pretty, const bool vulkan)
+                    const bool pretty, const bool vulkan, Names* const names = nullptr)
       : mod(mod),
         vertex(vertex),
         fragment(fragment),
         indent(indent),
         pretty(pretty),
-        vulkan(vulkan) {}
+        vulkan(vulkan),
+        names(names) {}
 
   constexpr Options incr_indent() const {
-    return Options{mod, vertex, fragment, indent + (pretty ? 1 : 0), pretty, vulkan};
+    return Options{mod, vertex, fragment, indent + (pretty ? 1 : 0), pretty, vulkan, names};
   }
 };
 
+// Emits a nested expression or statement in the middle of a chain of writes.
+template <typename Node>
+struct emit {
+  const Node*    node;
+  const Options& opts;
+};
+
+template <typename Node>
+emit(const Node*, const Options&) -> emit<Node>;
+
+template <typename Node>
+inline Writer& operator<<(Writer& out, const emit<Node> op) {
+  op.node->to_glsl(out, op.opts);
+  return out;
+}
+
 struct indent {
   uint32_t indent;
 };
 
-inline std::ostream& operator<<(std::ostream& out, indent op) {
+inline Writer& operator<<(Writer& out, indent op) {
   for (int i = 0; i < op.indent; ++i) {
     out << "    ";
   }
   return out;
 }
 
+// The following write an identifier, or its short name when `names` is set.
+
 struct mangle_name {
   std::string_view name;
+  Names*           names = nullptr;
+};
+
+inline Writer& operator<<(Writer& out, mangle_name op) {
+  if (op.names != nullptr) {
+    return out << op.names->shorten("_" + std::string(op.name));
+  }
+  return out << "_" << op.name;
+}
+
+// A struct property, which unlike a local isn't mangled.
+struct member_name {
+  std::string_view name;
+  Names*           names = nullptr;
 };
 
-inline std::ostream& operator<<(std::ostream& out, mangle_name op) { return out << "_" << op.name; }
+inline Writer& operator<<(Writer& out, member_name op) {
+  return out << (op.names != nullptr ? op.names->shorten(op.name) : op.name);
+}
+
+// Builtin types always keep their glsl names.
+struct type_name {
+  const type::Type& type;
+  Names*            names = nullptr;
+};
+
+inline Writer& operator<<(Writer& out, type_name op) {
+  if (op.names != nullptr && !op.type.builtin()) {
+    return out << op.names->shorten(op.type.glsl_name());
+  }
+  return out << op.type.glsl_name();
+}
 
 struct vertex_input_name {
   uint32_t         index;
   std::string_view name;
+  Names*           names = nullptr;
 };
 
-inline std::ostream& operator<<(std::ostream& out, vertex_input_name op) {
+inline Writer& operator<<(Writer& out, vertex_input_name op) {
+  if (op.names != nullptr) {
+    return out << op.names->shorten("i" + std::to_string(op.index) + "_" + std::string(op.name));
+  }
   return out << "i" << op.index << "_" << op.name;
 }
 
 struct varying_name {
   uint32_t         index;
   std::string_view name;
+  Names*           names = nullptr;
 };
 
-inline std::ostream& operator<<(std::ostream& out, varying_name op) {
+inline Writer& operator<<(Writer& out, varying_name op) {
+  if (op.names != nullptr) {
+    return out << op.names->shorten("v" + std::to_string(op.index) + "_" + std::string(op.name));
+  }
   return out << "v" << op.index << "_" << op.name;
 }
 
+// The macro that an OpenGL shader reads a `const` pipeline parameter from.
+struct constant_name {
+  uint32_t actual;
+};
+
+inline Writer& operator<<(Writer& out, constant_name op) { return out << "C" << op.actual; }
+
 struct fragment_output_name {
   uint32_t         index;
   std::string_view name;
+  Names*           names = nullptr;
 };
 
-inline std::ostream& operator<<(std::ostream& out, fragment_output_name op) {
+inline Writer& operator<<(Writer& out, fragment_output_name op) {
+  if (op.names != nullptr) {
+    return out << op.names->shorten("o" + std::to_string(op.index) + "_" + std::string(op.name));
+  }
   return out << "o" << op.index << "_" << op.name;
 }
 
+// Declares a storage block, in a set of its own after the textures. The layout is spelled out to
+// match the structs in the generated C++ header.
+void declare_storage(Writer& out, const Options& opts, const type::StructType& type,
+                     std::string_view name, uint32_t binding, bool readonly);
+
+// Writes the default value of a `const` pipeline parameter as a literal of its type.
+[[nodiscard]] std::string constant_value(const type::Type& type, double value);
+
+// Declares a `const` pipeline parameter. In vulkan it's a specialization constant, and otherwise
+// its value comes from a macro, which the runtime defines ahead of the default to override it.
+void declare_constant(Writer& out, const Options& opts, const type::Type& type,
+                      std::string_view name, uint32_t actual, double value);
+
 }  // namespace crystal::compiler::ast::output::glsl
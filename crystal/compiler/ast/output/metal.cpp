@@ -1,11 +1,28 @@
 #include "crystal/compiler/ast/output/metal.hpp"
 
+#include "crystal/compiler/ast/decl/compute_declaration.hpp"
 #include "crystal/compiler/ast/decl/pipeline_declaration.hpp"
 #include "crystal/compiler/ast/decl/vertex_declaration.hpp"
+#include "crystal/compiler/ast/output/glsl.hpp"
 
 namespace crystal::compiler::ast::output::metal {
 
 uint32_t uniform_binding(const decl::PipelineDeclaration& pipeline, uint32_t binding) {
+  if (pipeline.compute_function() != nullptr) {
+    // A kernel has no vertex buffers, so its uniforms come first.
+    uint32_t uniform_index          = 0;
+    uint32_t matching_uniform_index = 0;
+    for (const auto& input : pipeline.compute_function()->inputs()) {
+      if (input.input_type == decl::ComputeInputType::Uniform) {
+        if (input.index == binding) {
+          matching_uniform_index = uniform_index;
+        }
+        ++uniform_index;
+      }
+    }
+    return matching_uniform_index;
+  }
+
   uint32_t max_buffer_index       = 0;
   uint32_t uniform_index          = 0;
   uint32_t matching_uniform_index = 0;
@@ -28,4 +45,46 @@ uint32_t uniform_binding(const decl::PipelineDeclaration& pipeline, uint32_t bin
   return max_buffer_index + matching_uniform_index;
 }
 
+uint32_t storage_binding(const decl::PipelineDeclaration& pipeline, uint32_t binding) {
+  // The vertex buffers of a graphics pipeline come first.
+  uint32_t max_buffer_index = 0;
+  if (pipeline.vertex_function() != nullptr) {
+    for (const auto& input : pipeline.vertex_function()->inputs()) {
+      if (input.input_type == decl::VertexInputType::Vertex ||
+          input.input_type == decl::VertexInputType::Instanced) {
+        if (input.index >= max_buffer_index) {
+          max_buffer_index = input.index + 1;
+        }
+      }
+    }
+  }
+
+  uint32_t storage_index          = 0;
+  uint32_t matching_storage_index = 0;
+  for (const auto& storage : pipeline.storage_buffers()) {
+    if (storage.binding == binding) {
+      matching_storage_index = storage_index;
+    }
+    ++storage_index;
+  }
+
+  return max_buffer_index + static_cast<uint32_t>(pipeline.uniforms().size()) +
+         matching_storage_index;
+}
+
+void declare_function_constants(Writer& out, const decl::PipelineDeclaration& pipeline) {
+  for (const auto& constant : pipeline.constants()) {
+    out << "constant " << constant.type->metal_name() << " " << constant_name{constant.actual}
+        << " [[ function_constant(" << constant.actual << ") ]];\n";
+  }
+}
+
+void declare_constant(Writer& out, const type::Type& type, const std::string_view name,
+                      const uint32_t actual, const double value) {
+  // The literals are spelled the same way as they are in glsl.
+  out << indent{1} << "const " << type.metal_name() << " " << mangle_name{name}
+      << " = is_function_constant_defined(" << constant_name{actual} << ") ? "
+      << constant_name{actual} << " : " << glsl::constant_value(type, value) << ";\n";
+}
+
 }  // namespace crystal::compiler::ast::output::metal
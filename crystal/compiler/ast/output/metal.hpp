@@ -1,8 +1,10 @@
 #pragma once
 
-#include <iostream>
+#include <cstdint>
 #include <string_view>
 
+#include "crystal/compiler/ast/output/writer.hpp"
+
 namespace crystal::compiler::ast {
 
 class Module;
@@ -17,6 +19,12 @@ class FragmentDeclaration;
 
 }  // namespace crystal::compiler::ast::decl
 
+namespace crystal::compiler::ast::type {
+
+class Type;
+
+}  // namespace crystal::compiler::ast::type
+
 namespace crystal::compiler::ast::output::metal {
 
 constexpr std::string_view HDR = R"(#include <metal_stdlib>
@@ -35,14 +43,30 @@ struct Options {
                     const decl::FragmentDeclaration* fragment, const uint32_t indent)
       : mod(mod), vertex(vertex), fragment(fragment), indent(indent) {}
 
-  constexpr Options incr_indent() const { return Options{mod, vertex, fragment, indent}; }
+  constexpr Options incr_indent() const { return Options{mod, vertex, fragment, indent + 1}; }
 };
 
+// Emits a nested expression or statement in the middle of a chain of writes.
+template <typename Node>
+struct emit {
+  const Node*    node;
+  const Options& opts;
+};
+
+template <typename Node>
+emit(const Node*, const Options&) -> emit<Node>;
+
+template <typename Node>
+inline Writer& operator<<(Writer& out, const emit<Node> op) {
+  op.node->to_metal(out, op.opts);
+  return out;
+}
+
 struct indent {
   uint32_t indent;
 };
 
-inline std::ostream& operator<<(std::ostream& out, indent op) {
+inline Writer& operator<<(Writer& out, indent op) {
   for (int i = 0; i < op.indent; ++i) {
     out << "    ";
   }
@@ -53,17 +77,35 @@ struct mangle_name {
   std::string_view name;
 };
 
-inline std::ostream& operator<<(std::ostream& out, mangle_name op) { return out << "_" << op.name; }
+inline Writer& operator<<(Writer& out, mangle_name op) { return out << "_" << op.name; }
 
 struct vertex_input_name {
   uint32_t         index;
   std::string_view name;
 };
 
-inline std::ostream& operator<<(std::ostream& out, vertex_input_name op) {
+inline Writer& operator<<(Writer& out, vertex_input_name op) {
   return out << "in." << op.name;
 }
 
+// The function constant behind a `const` pipeline parameter.
+struct constant_name {
+  uint32_t actual;
+};
+
+inline Writer& operator<<(Writer& out, constant_name op) { return out << "C" << op.actual; }
+
 uint32_t uniform_binding(const decl::PipelineDeclaration& vertex, uint32_t binding);
 
+// The buffer index of a storage buffer, which follows the vertex buffers and the uniforms.
+uint32_t storage_binding(const decl::PipelineDeclaration& pipeline, uint32_t binding);
+
+// Declares the function constants of the pipeline's `const` parameters, at the top level.
+void declare_function_constants(Writer& out, const decl::PipelineDeclaration& pipeline);
+
+// Declares a `const` pipeline parameter as a local of a function, which falls back to the default
+// when the runtime leaves the function constant undefined.
+void declare_constant(Writer& out, const type::Type& type, std::string_view name, uint32_t actual,
+                      double value);
+
 }  // namespace crystal::compiler::ast::output::metal
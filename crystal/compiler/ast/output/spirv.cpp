@@ -0,0 +1,933 @@
+#include "crystal/compiler/ast/output/spirv.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "crystal/compiler/ast/expr/bin_op_expression.hpp"
+#include "crystal/compiler/ast/type/layout.hpp"
+#include "crystal/compiler/ast/type/struct_type.hpp"
+#include "crystal/compiler/ast/type/type.hpp"
+#include "util/msg/msg.hpp"
+
+namespace crystal::compiler::ast::output::spirv {
+
+namespace {
+
+constexpr uint32_t SPIRV_VERSION = 0x00010000;  // Spir-v 1.0, for Vulkan 1.0.
+
+std::string type_name(const ValueType& type) {
+  switch (type.kind) {
+    case Kind::Void:
+      return "void";
+    case Kind::Bool:
+      return type.count == 1 ? "bool" : "bvec" + std::to_string(type.count);
+    case Kind::Int:
+      return type.count == 1 ? "int" : "ivec" + std::to_string(type.count);
+    case Kind::Float:
+      return type.count == 1 ? "float" : "vec" + std::to_string(type.count);
+    case Kind::Matrix:
+      return "mat" + std::to_string(type.count);
+    case Kind::Texture:
+      return "Texture2D";
+    case Kind::Struct:
+      return type.type->name();
+  }
+  return "?";
+}
+
+uint32_t member_index(const type::StructType& type, const std::string_view name) {
+  const auto& properties = type.properties();
+  for (uint32_t i = 0; i < properties.size(); ++i) {
+    if (properties[i].name == name) {
+      return i;
+    }
+  }
+  util::msg::fatal("no property [", name, "] on type [", type.name(), "]");
+  return 0;
+}
+
+Value matrix_columns(const Options& opts, const spv::Op op, const Value& lhs,
+                     const Value& rhs) {
+  const ValueType       column = ValueType::vector(Kind::Float, 4);
+  std::vector<uint32_t> columns;
+  for (uint32_t i = 0; i < lhs.type.count; ++i) {
+    const uint32_t l = opts.emit(spv::Op::OpCompositeExtract, column, {lhs.id, i});
+    const uint32_t r = opts.emit(spv::Op::OpCompositeExtract, column, {rhs.id, i});
+    columns.push_back(opts.emit(op, column, {l, r}));
+  }
+  return Value{opts.emit(spv::Op::OpCompositeConstruct, lhs.type, columns), lhs.type};
+}
+
+Value arithmetic(const Options& opts, const expr::BinOp op, Value lhs, Value rhs) {
+  if (lhs.type.kind == Kind::Matrix || rhs.type.kind == Kind::Matrix) {
+    if (lhs.type.kind == Kind::Matrix && rhs.type.kind == Kind::Matrix) {
+      switch (op) {
+        case expr::BinOp::Add:
+          return matrix_columns(opts, spv::Op::OpFAdd, lhs, rhs);
+        case expr::BinOp::Sub:
+          return matrix_columns(opts, spv::Op::OpFSub, lhs, rhs);
+        case expr::BinOp::Mul:
+          return Value{opts.emit(spv::Op::OpMatrixTimesMatrix, lhs.type, {lhs.id, rhs.id}),
+                       lhs.type};
+        default:
+          break;
+      }
+    } else if (op == expr::BinOp::Mul && lhs.type.kind == Kind::Matrix && rhs.type.is_vector()) {
+      return Value{opts.emit(spv::Op::OpMatrixTimesVector, rhs.type, {lhs.id, rhs.id}), rhs.type};
+    } else if (op == expr::BinOp::Mul && lhs.type.is_vector() && rhs.type.kind == Kind::Matrix) {
+      return Value{opts.emit(spv::Op::OpVectorTimesMatrix, lhs.type, {lhs.id, rhs.id}), lhs.type};
+    } else if (op == expr::BinOp::Mul && rhs.type.is_scalar()) {
+      return Value{opts.emit(spv::Op::OpMatrixTimesScalar, lhs.type, {lhs.id, rhs.id}), lhs.type};
+    } else if (op == expr::BinOp::Mul && lhs.type.is_scalar()) {
+      return Value{opts.emit(spv::Op::OpMatrixTimesScalar, rhs.type, {rhs.id, lhs.id}), rhs.type};
+    }
+    util::msg::fatal("unsupported matrix operation [", static_cast<uint32_t>(op), "]");
+  }
+
+  if (lhs.type.kind != rhs.type.kind ||
+      (lhs.type.kind != Kind::Float && lhs.type.kind != Kind::Int)) {
+    util::msg::fatal("arithmetic operator [", static_cast<uint32_t>(op),
+                     "] is not defined for these types");
+  }
+  const bool is_float = lhs.type.kind == Kind::Float;
+
+  if (lhs.type.count != rhs.type.count) {
+    // Vector and scalar. Multiplication has a dedicated instruction, the rest work per component.
+    if (op == expr::BinOp::Mul && is_float) {
+      const Value& vector = lhs.type.is_vector() ? lhs : rhs;
+      const Value& scalar = lhs.type.is_vector() ? rhs : lhs;
+      if (!scalar.type.is_scalar()) {
+        util::msg::fatal("mismatched vector sizes in arithmetic");
+      }
+      return Value{opts.emit(spv::Op::OpVectorTimesScalar, vector.type, {vector.id, scalar.id}),
+                   vector.type};
+    }
+
+    if (lhs.type.is_scalar()) {
+      lhs = splat(opts, lhs, rhs.type.count);
+    } else if (rhs.type.is_scalar()) {
+      rhs = splat(opts, rhs, lhs.type.count);
+    } else {
+      util::msg::fatal("mismatched vector sizes in arithmetic");
+    }
+  }
+
+  spv::Op instruction = spv::Op::OpNop;
+  switch (op) {
+    case expr::BinOp::Add:
+      instruction = is_float ? spv::Op::OpFAdd : spv::Op::OpIAdd;
+      break;
+    case expr::BinOp::Sub:
+      instruction = is_float ? spv::Op::OpFSub : spv::Op::OpISub;
+      break;
+    case expr::BinOp::Mul:
+      instruction = is_float ? spv::Op::OpFMul : spv::Op::OpIMul;
+      break;
+    case expr::BinOp::Div:
+      instruction = is_float ? spv::Op::OpFDiv : spv::Op::OpSDiv;
+      break;
+    default:
+      util::msg::fatal("unhandled binary operator [", static_cast<uint32_t>(op), "]");
+      break;
+  }
+  return Value{opts.emit(instruction, lhs.type, {lhs.id, rhs.id}), lhs.type};
+}
+
+Value comparison(const Options& opts, const expr::BinOp op, const Value& lhs,
+                 const Value& rhs) {
+  if (lhs.type != rhs.type) {
+    util::msg::fatal("comparison operator [", static_cast<uint32_t>(op),
+                     "] requires operands of the same type");
+  }
+
+  spv::Op instruction = spv::Op::OpNop;
+  switch (lhs.type.kind) {
+    case Kind::Float:
+      switch (op) {
+        case expr::BinOp::Eq:
+          instruction = spv::Op::OpFOrdEqual;
+          break;
+        case expr::BinOp::Ne:
+          instruction = spv::Op::OpFOrdNotEqual;
+          break;
+        case expr::BinOp::Lt:
+          instruction = spv::Op::OpFOrdLessThan;
+          break;
+        case expr::BinOp::Le:
+          instruction = spv::Op::OpFOrdLessThanEqual;
+          break;
+        case expr::BinOp::Gt:
+          instruction = spv::Op::OpFOrdGreaterThan;
+          break;
+        case expr::BinOp::Ge:
+          instruction = spv::Op::OpFOrdGreaterThanEqual;
+          break;
+        default:
+          break;
+      }
+      break;
+
+    case Kind::Int:
+      switch (op) {
+        case expr::BinOp::Eq:
+          instruction = spv::Op::OpIEqual;
+          break;
+        case expr::BinOp::Ne:
+          instruction = spv::Op::OpINotEqual;
+          break;
+        case expr::BinOp::Lt:
+          instruction = spv::Op::OpSLessThan;
+          break;
+        case expr::BinOp::Le:
+          instruction = spv::Op::OpSLessThanEqual;
+          break;
+        case expr::BinOp::Gt:
+          instruction = spv::Op::OpSGreaterThan;
+          break;
+        case expr::BinOp::Ge:
+          instruction = spv::Op::OpSGreaterThanEqual;
+          break;
+        default:
+          break;
+      }
+      break;
+
+    case Kind::Bool:
+      if (op == expr::BinOp::Eq) {
+        instruction = spv::Op::OpLogicalEqual;
+      } else if (op == expr::BinOp::Ne) {
+        instruction = spv::Op::OpLogicalNotEqual;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  if (instruction == spv::Op::OpNop ||
+      (lhs.type.is_vector() && op != expr::BinOp::Eq && op != expr::BinOp::Ne)) {
+    util::msg::fatal("comparison operator [", static_cast<uint32_t>(op),
+                     "] is not defined for this type");
+  }
+
+  const ValueType result = ValueType::vector(Kind::Bool, lhs.type.count);
+  const uint32_t  id     = opts.emit(instruction, result, {lhs.id, rhs.id});
+  if (!lhs.type.is_vector()) {
+    return Value{id, result};
+  }
+
+  // Vectors compare equal when all of their components do.
+  const ValueType scalar = ValueType::scalar(Kind::Bool);
+  const spv::Op   all    = op == expr::BinOp::Eq ? spv::Op::OpAll : spv::Op::OpAny;
+  return Value{opts.emit(all, scalar, {id}), scalar};
+}
+
+}  // namespace
+
+ValueType ValueType::from(const type::Type& type) {
+  switch (type.kind()) {
+    case type::Kind::Bool:
+      return ValueType::vector(Kind::Bool, type.count());
+    case type::Kind::Int:
+      return ValueType::vector(Kind::Int, type.count());
+    case type::Kind::Float:
+      return ValueType::vector(Kind::Float, type.count());
+    case type::Kind::Matrix:
+      return ValueType{Kind::Matrix, type.count()};
+    case type::Kind::Texture:
+      return ValueType{Kind::Texture, 1};
+    case type::Kind::Struct:
+      break;
+  }
+
+  if (type.builtin()) {
+    util::msg::fatal("unsupported type [", type.name(), "] for spir-v output");
+  }
+
+  // All user declared types are structs.
+  return ValueType{Kind::Struct, 1, static_cast<const type::StructType*>(&type)};
+}
+
+Builder::Builder() { glsl_std_450_ = make_id(); }
+
+uint32_t Builder::type_(spv::Op op, std::initializer_list<uint32_t> operands) {
+  std::vector<uint32_t> key{static_cast<uint32_t>(op)};
+  key.insert(key.end(), operands.begin(), operands.end());
+
+  const auto it = types_.find(key);
+  if (it != types_.end()) {
+    return it->second;
+  }
+
+  const uint32_t        id = make_id();
+  std::vector<uint32_t> words{id};
+  words.insert(words.end(), operands.begin(), operands.end());
+  emit(globals_, op, words);
+  types_.emplace(std::move(key), id);
+  return id;
+}
+
+uint32_t Builder::type_void() { return type_(spv::Op::OpTypeVoid, {}); }
+
+uint32_t Builder::type_bool() { return type_(spv::Op::OpTypeBool, {}); }
+
+uint32_t Builder::type_int() { return type_(spv::Op::OpTypeInt, {32, 1}); }
+
+uint32_t Builder::type_float() { return type_(spv::Op::OpTypeFloat, {32}); }
+
+uint32_t Builder::type_vector(const uint32_t component, const uint32_t count) {
+  return type_(spv::Op::OpTypeVector, {component, count});
+}
+
+uint32_t Builder::type_matrix(const uint32_t columns) {
+  return type_(spv::Op::OpTypeMatrix, {type_vector(type_float(), 4), columns});
+}
+
+uint32_t Builder::type_sampled_image() {
+  const uint32_t image = type_(spv::Op::OpTypeImage,
+                               {
+                                   type_float(),
+                                   static_cast<uint32_t>(spv::Dim::Dim2D),
+                                   0,  // Depth.
+                                   0,  // Arrayed.
+                                   0,  // Multisampled.
+                                   1,  // Sampled.
+                                   static_cast<uint32_t>(spv::ImageFormat::Unknown),
+                               });
+  return type_(spv::Op::OpTypeSampledImage, {image});
+}
+
+uint32_t Builder::type_pointer(const spv::StorageClass storage, const uint32_t type) {
+  return type_(spv::Op::OpTypePointer, {static_cast<uint32_t>(storage), type});
+}
+
+uint32_t Builder::type_function(const uint32_t return_type) {
+  return type_(spv::Op::OpTypeFunction, {return_type});
+}
+
+uint32_t Builder::struct_(const type::StructType& type, const Layout layout) {
+  // Member types must be declared before the struct itself.
+  std::vector<uint32_t> words{0};
+  for (const auto& prop : type.properties()) {
+    const ValueType member = ValueType::from(prop.type);
+    if (member.kind == Kind::Texture) {
+      util::msg::fatal("textures can not be struct members [", type.name(), ".", prop.name, "]");
+    }
+    if (!prop.array) {
+      words.push_back(type_id(member, layout));
+    } else if (layout == Layout::Std430) {
+      words.push_back(type_runtime_array(type_id(member, layout),
+                                         type::stride(prop.type, type::Layout::Std430)));
+    } else {
+      util::msg::fatal("runtime sized array [", type.name(), ".", prop.name,
+                       "] can only be in a storage block");
+    }
+  }
+
+  const uint32_t id = make_id();
+  words[0]          = id;
+  emit(globals_, spv::Op::OpTypeStruct, words);
+
+  name(id, type.name());
+  std::vector<uint32_t> offsets;
+  if (layout != Layout::None) {
+    offsets = type::offsets(type, layout == Layout::Std140 ? type::Layout::Std140
+                                                           : type::Layout::Std430);
+  }
+  for (uint32_t i = 0; i < type.properties().size(); ++i) {
+    const auto&     prop   = type.properties()[i];
+    const ValueType member = ValueType::from(prop.type);
+    member_name(id, i, prop.name);
+
+    if (layout != Layout::None) {
+      member_decorate(id, i, spv::Decoration::Offset, {offsets[i]});
+      if (member.kind == Kind::Matrix) {
+        member_decorate(id, i, spv::Decoration::ColMajor);
+        member_decorate(id, i, spv::Decoration::MatrixStride, {16});
+      }
+    }
+  }
+
+  return id;
+}
+
+uint32_t Builder::type_struct(const type::StructType& type, const Layout layout) {
+  const auto it = structs_.find(std::make_tuple(&type, layout));
+  if (it != structs_.end()) {
+    return it->second;
+  }
+
+  const uint32_t id = struct_(type, layout);
+  structs_.emplace(std::make_tuple(&type, layout), id);
+  return id;
+}
+
+uint32_t Builder::type_id(const ValueType& type, const Layout layout) {
+  uint32_t component = 0;
+  switch (type.kind) {
+    case Kind::Void:
+      return type_void();
+    case Kind::Bool:
+      component = type_bool();
+      break;
+    case Kind::Int:
+      component = type_int();
+      break;
+    case Kind::Float:
+      component = type_float();
+      break;
+    case Kind::Matrix:
+      return type_matrix(type.count);
+    case Kind::Texture:
+      return type_sampled_image();
+    case Kind::Struct:
+      return type_struct(*type.type, layout);
+  }
+
+  return type.count == 1 ? component : type_vector(component, type.count);
+}
+
+uint32_t Builder::type_runtime_array(const uint32_t element, const uint32_t stride) {
+  const auto it = runtime_arrays_.find(std::make_tuple(element, stride));
+  if (it != runtime_arrays_.end()) {
+    return it->second;
+  }
+
+  // Not shared through `type_`, as the stride is a decoration of the type.
+  const uint32_t id = make_id();
+  emit(globals_, spv::Op::OpTypeRuntimeArray, {id, element});
+  decorate(id, spv::Decoration::ArrayStride, {stride});
+  runtime_arrays_.emplace(std::make_tuple(element, stride), id);
+  return id;
+}
+
+uint32_t Builder::type_block(const type::StructType& type) {
+  const auto it = blocks_.find(std::make_tuple(&type, Layout::Std140));
+  if (it != blocks_.end()) {
+    return it->second;
+  }
+
+  const uint32_t id = struct_(type, Layout::Std140);
+  decorate(id, spv::Decoration::Block);
+  blocks_.emplace(std::make_tuple(&type, Layout::Std140), id);
+  return id;
+}
+
+uint32_t Builder::type_storage_block(const type::StructType& type) {
+  const auto it = blocks_.find(std::make_tuple(&type, Layout::Std430));
+  if (it != blocks_.end()) {
+    return it->second;
+  }
+
+  const uint32_t id = struct_(type, Layout::Std430);
+  decorate(id, spv::Decoration::BufferBlock);
+  blocks_.emplace(std::make_tuple(&type, Layout::Std430), id);
+  return id;
+}
+
+uint32_t Builder::constant_bool(const bool value) {
+  const uint32_t type = type_bool();
+  const auto     key  = std::make_tuple(type, static_cast<uint32_t>(value));
+  const auto     it   = constants_.find(key);
+  if (it != constants_.end()) {
+    return it->second;
+  }
+
+  const uint32_t id = make_id();
+  emit(globals_, value ? spv::Op::OpConstantTrue : spv::Op::OpConstantFalse, {type, id});
+  constants_.emplace(key, id);
+  return id;
+}
+
+uint32_t Builder::constant_int(const int32_t value) {
+  const uint32_t type = type_int();
+  const auto     key  = std::make_tuple(type, static_cast<uint32_t>(value));
+  const auto     it   = constants_.find(key);
+  if (it != constants_.end()) {
+    return it->second;
+  }
+
+  const uint32_t id = make_id();
+  emit(globals_, spv::Op::OpConstant, {type, id, static_cast<uint32_t>(value)});
+  constants_.emplace(key, id);
+  return id;
+}
+
+uint32_t Builder::constant_float(const float value) {
+  uint32_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  const uint32_t type = type_float();
+  const auto     key  = std::make_tuple(type, bits);
+  const auto     it   = constants_.find(key);
+  if (it != constants_.end()) {
+    return it->second;
+  }
+
+  const uint32_t id = make_id();
+  emit(globals_, spv::Op::OpConstant, {type, id, bits});
+  constants_.emplace(key, id);
+  return id;
+}
+
+void Builder::name(const uint32_t id, const std::string_view name) {
+  std::vector<uint32_t> words{id};
+  append_string(words, name);
+  emit(debug_, spv::Op::OpName, words);
+}
+
+void Builder::member_name(const uint32_t id, const uint32_t member, const std::string_view name) {
+  std::vector<uint32_t> words{id, member};
+  append_string(words, name);
+  emit(debug_, spv::Op::OpMemberName, words);
+}
+
+void Builder::decorate(const uint32_t id, const spv::Decoration decoration,
+                       std::initializer_list<uint32_t> operands) {
+  std::vector<uint32_t> words{id, static_cast<uint32_t>(decoration)};
+  words.insert(words.end(), operands.begin(), operands.end());
+  emit(annotations_, spv::Op::OpDecorate, words);
+}
+
+void Builder::member_decorate(const uint32_t id, const uint32_t member,
+                              const spv::Decoration           decoration,
+                              std::initializer_list<uint32_t> operands) {
+  std::vector<uint32_t> words{id, member, static_cast<uint32_t>(decoration)};
+  words.insert(words.end(), operands.begin(), operands.end());
+  emit(annotations_, spv::Op::OpMemberDecorate, words);
+}
+
+uint32_t Builder::spec_constant(const ValueType& type, const uint32_t spec_id, const double value,
+                                const std::string_view name) {
+  const auto it = spec_constants_.find(spec_id);
+  if (it != spec_constants_.end()) {
+    return it->second;
+  }
+
+  const uint32_t type_id = this->type_id(type);
+  const uint32_t id      = make_id();
+  switch (type.kind) {
+    case Kind::Bool:
+      emit(globals_, value != 0.0 ? spv::Op::OpSpecConstantTrue : spv::Op::OpSpecConstantFalse,
+           {type_id, id});
+      break;
+    case Kind::Int:
+      emit(globals_, spv::Op::OpSpecConstant,
+           {type_id, id, static_cast<uint32_t>(static_cast<int32_t>(value))});
+      break;
+    case Kind::Float: {
+      const float single = static_cast<float>(value);
+      uint32_t    bits   = 0;
+      std::memcpy(&bits, &single, sizeof(bits));
+      emit(globals_, spv::Op::OpSpecConstant, {type_id, id, bits});
+      break;
+    }
+    default:
+      util::msg::fatal("unsupported specialization constant type [", type_name(type), "]");
+      break;
+  }
+  decorate(id, spv::Decoration::SpecId, {spec_id});
+  this->name(id, name);
+  spec_constants_.emplace(spec_id, id);
+  return id;
+}
+
+uint32_t Builder::variable(const spv::StorageClass storage, const uint32_t type,
+                           const std::string_view name) {
+  const uint32_t pointer = type_pointer(storage, type);
+  const uint32_t id      = make_id();
+  emit(globals_, spv::Op::OpVariable, {pointer, id, static_cast<uint32_t>(storage)});
+  this->name(id, name);
+  return id;
+}
+
+void Builder::entry_point(const spv::ExecutionModel model, const uint32_t function,
+                          const std::string_view name, const std::vector<uint32_t>& interface) {
+  std::vector<uint32_t> words{static_cast<uint32_t>(model), function};
+  append_string(words, name);
+  words.insert(words.end(), interface.begin(), interface.end());
+  emit(entry_points_, spv::Op::OpEntryPoint, words);
+}
+
+void Builder::execution_mode(const uint32_t function, const spv::ExecutionMode mode,
+                             std::initializer_list<uint32_t> operands) {
+  std::vector<uint32_t> words{function, static_cast<uint32_t>(mode)};
+  words.insert(words.end(), operands.begin(), operands.end());
+  emit(execution_modes_, spv::Op::OpExecutionMode, words);
+}
+
+uint32_t Builder::add_function(const Function& function, const std::string_view name) {
+  const uint32_t id = make_id();
+  emit(functions_, spv::Op::OpFunction,
+       {type_void(), id, static_cast<uint32_t>(spv::FunctionControlMask::MaskNone),
+        type_function(type_void())});
+  emit(functions_, spv::Op::OpLabel, {make_id()});
+  functions_.insert(functions_.end(), function.variables.begin(), function.variables.end());
+  functions_.insert(functions_.end(), function.body.begin(), function.body.end());
+  if (!function.terminated) {
+    emit(functions_, spv::Op::OpReturn, {});
+  }
+  emit(functions_, spv::Op::OpFunctionEnd, {});
+
+  this->name(id, name);
+  return id;
+}
+
+std::vector<uint32_t> Builder::finish() const {
+  std::vector<uint32_t> out{
+      spv::MagicNumber,
+      SPIRV_VERSION,
+      0,         // Generator.
+      next_id_,  // Bound.
+      0,         // Schema.
+  };
+
+  emit(out, spv::Op::OpCapability, {static_cast<uint32_t>(spv::Capability::Shader)});
+  {
+    std::vector<uint32_t> words{glsl_std_450_};
+    append_string(words, "GLSL.std.450");
+    emit(out, spv::Op::OpExtInstImport, words);
+  }
+  emit(out, spv::Op::OpMemoryModel,
+       {static_cast<uint32_t>(spv::AddressingModel::Logical),
+        static_cast<uint32_t>(spv::MemoryModel::GLSL450)});
+
+  for (const auto* section :
+       {&entry_points_, &execution_modes_, &debug_, &annotations_, &globals_, &functions_}) {
+    out.insert(out.end(), section->begin(), section->end());
+  }
+  return out;
+}
+
+uint32_t Options::emit(const spv::Op op, const ValueType& type,
+                       std::initializer_list<uint32_t> operands) const {
+  return emit(op, type, std::vector<uint32_t>(operands));
+}
+
+uint32_t Options::emit(const spv::Op op, const ValueType& type,
+                       const std::vector<uint32_t>& operands) const {
+  const uint32_t        id = builder.make_id();
+  std::vector<uint32_t> words{builder.type_id(type), id};
+  words.insert(words.end(), operands.begin(), operands.end());
+  spirv::emit(function.body, op, words);
+  return id;
+}
+
+void Options::emit_void(const spv::Op op, std::initializer_list<uint32_t> operands) const {
+  spirv::emit(function.body, op, operands);
+}
+
+uint32_t Options::ext(const GLSLstd450 inst, const ValueType& type,
+                      const std::vector<uint32_t>& operands) const {
+  std::vector<uint32_t> words{builder.glsl_std_450(), static_cast<uint32_t>(inst)};
+  words.insert(words.end(), operands.begin(), operands.end());
+  return emit(spv::Op::OpExtInst, type, words);
+}
+
+void emit(std::vector<uint32_t>& out, const spv::Op op, std::initializer_list<uint32_t> operands) {
+  out.push_back(static_cast<uint32_t>(operands.size() + 1) << spv::WordCountShift |
+                static_cast<uint32_t>(op));
+  out.insert(out.end(), operands.begin(), operands.end());
+}
+
+void emit(std::vector<uint32_t>& out, const spv::Op op, const std::vector<uint32_t>& operands) {
+  out.push_back(static_cast<uint32_t>(operands.size() + 1) << spv::WordCountShift |
+                static_cast<uint32_t>(op));
+  out.insert(out.end(), operands.begin(), operands.end());
+}
+
+void append_string(std::vector<uint32_t>& out, const std::string_view str) {
+  // The string is always followed by at least one nul byte.
+  const size_t start = out.size();
+  out.resize(start + str.size() / 4 + 1, 0);
+  std::memcpy(&out[start], str.data(), str.size());
+}
+
+std::vector<uint32_t> parse_swizzle(const std::string_view name) {
+  constexpr std::string_view SETS[] = {"xyzw", "rgba", "stpq"};
+  if (name.empty() || name.size() > 4) {
+    return {};
+  }
+
+  for (const auto set : SETS) {
+    std::vector<uint32_t> components;
+    for (const char c : name) {
+      const auto pos = set.find(c);
+      if (pos == std::string_view::npos) {
+        break;
+      }
+      components.push_back(static_cast<uint32_t>(pos));
+    }
+    if (components.size() == name.size()) {
+      return components;
+    }
+  }
+  return {};
+}
+
+Pointer local(const Options& opts, const ValueType& type, const std::string_view name) {
+  const uint32_t pointer =
+      opts.builder.type_pointer(spv::StorageClass::Function, opts.builder.type_id(type));
+  const uint32_t id = opts.builder.make_id();
+  emit(opts.function.variables, spv::Op::OpVariable,
+       {pointer, id, static_cast<uint32_t>(spv::StorageClass::Function)});
+  opts.builder.name(id, name);
+  return Pointer{id, type, spv::StorageClass::Function, {}};
+}
+
+Pointer storage(Builder& builder, const type::StructType& type, const std::string_view name,
+                const uint32_t binding, const bool readonly) {
+  const uint32_t var = builder.variable(spv::StorageClass::Uniform,
+                                        builder.type_storage_block(type), mangle_name(name));
+  builder.decorate(var, spv::Decoration::DescriptorSet, {2});
+  builder.decorate(var, spv::Decoration::Binding, {binding});
+  if (readonly) {
+    builder.decorate(var, spv::Decoration::NonWritable);
+  }
+  return Pointer{var, ValueType::from(type), spv::StorageClass::Uniform, {}, Layout::Std430};
+}
+
+void ensure_block(const Options& opts) {
+  if (opts.function.terminated) {
+    emit(opts.function.body, spv::Op::OpLabel, {opts.builder.make_id()});
+    opts.function.terminated = false;
+  }
+}
+
+void begin_block(const Options& opts, const uint32_t label) {
+  emit(opts.function.body, spv::Op::OpLabel, {label});
+  opts.function.terminated = false;
+}
+
+void branch(const Options& opts, const uint32_t label) {
+  if (!opts.function.terminated) {
+    opts.emit_void(spv::Op::OpBranch, {label});
+    opts.function.terminated = true;
+  }
+}
+
+Value load(const Options& opts, const Pointer& ptr) {
+  if (ptr.type.kind == Kind::Struct && ptr.layout != Layout::None) {
+    util::msg::fatal("loading struct [", type_name(ptr.type),
+                     "] from a buffer block is not supported by the spir-v output");
+  }
+
+  const Value value{opts.emit(spv::Op::OpLoad, ptr.type, {ptr.id}), ptr.type};
+  if (ptr.swizzle.empty()) {
+    return value;
+  }
+
+  const ValueType       type = ValueType::vector(ptr.type.kind, ptr.swizzle.size());
+  std::vector<uint32_t> operands{value.id, value.id};
+  operands.insert(operands.end(), ptr.swizzle.begin(), ptr.swizzle.end());
+  return Value{opts.emit(spv::Op::OpVectorShuffle, type, operands), type};
+}
+
+void store(const Options& opts, const Pointer& ptr, const Value& value) {
+  // Storage blocks are the only writable locations outside of the function.
+  if (ptr.storage != spv::StorageClass::Function && ptr.storage != spv::StorageClass::Output &&
+      ptr.layout != Layout::Std430) {
+    util::msg::fatal("can not assign to a value of type [", type_name(ptr.type),
+                     "] that is not local");
+  }
+  if (ptr.type.kind == Kind::Struct && ptr.layout != Layout::None) {
+    util::msg::fatal("storing struct [", type_name(ptr.type),
+                     "] to a buffer block is not supported by the spir-v output");
+  }
+
+  if (ptr.swizzle.empty()) {
+    const Value converted = convert(opts, value, ptr.type);
+    opts.emit_void(spv::Op::OpStore, {ptr.id, converted.id});
+    return;
+  }
+
+  // Write the swizzled components by shuffling them into the current value.
+  const Value converted =
+      convert(opts, value, ValueType::vector(ptr.type.kind, ptr.swizzle.size()));
+  const uint32_t        current = opts.emit(spv::Op::OpLoad, ptr.type, {ptr.id});
+  std::vector<uint32_t> operands{current, converted.id};
+  for (uint32_t i = 0; i < ptr.type.count; ++i) {
+    const auto it = std::find(ptr.swizzle.begin(), ptr.swizzle.end(), i);
+    operands.push_back(it == ptr.swizzle.end()
+                           ? i
+                           : ptr.type.count + static_cast<uint32_t>(it - ptr.swizzle.begin()));
+  }
+  const uint32_t result = opts.emit(spv::Op::OpVectorShuffle, ptr.type, operands);
+  opts.emit_void(spv::Op::OpStore, {ptr.id, result});
+}
+
+Pointer access(const Options& opts, const Pointer& ptr, const std::string_view name) {
+  const Layout layout = ptr.layout;
+
+  if (ptr.type.kind == Kind::Struct) {
+    const uint32_t index = member_index(*ptr.type.type, name);
+    if (ptr.type.type->properties()[index].array) {
+      util::msg::fatal("runtime sized array [", name, "] can only be indexed");
+    }
+    const ValueType member = ValueType::from(ptr.type.type->properties()[index].type);
+    const uint32_t  type =
+        opts.builder.type_pointer(ptr.storage, opts.builder.type_id(member, layout));
+    const uint32_t  id   = opts.builder.make_id();
+    emit(opts.function.body, spv::Op::OpAccessChain,
+         {type, id, ptr.id, opts.builder.constant_int(index)});
+    return Pointer{id, member, ptr.storage, {}, layout};
+  }
+
+  if (ptr.type.is_vector()) {
+    std::vector<uint32_t> components = parse_swizzle(name);
+    for (auto& component : components) {
+      if (!ptr.swizzle.empty()) {
+        component = component < ptr.swizzle.size() ? ptr.swizzle[component] : ptr.type.count;
+      }
+      if (component >= ptr.type.count) {
+        util::msg::fatal("invalid swizzle [", name, "] on type [", type_name(ptr.type), "]");
+      }
+    }
+    if (components.empty()) {
+      util::msg::fatal("invalid swizzle [", name, "] on type [", type_name(ptr.type), "]");
+    }
+
+    if (components.size() == 1) {
+      const ValueType component = ValueType::scalar(ptr.type.kind);
+      const uint32_t  type =
+          opts.builder.type_pointer(ptr.storage, opts.builder.type_id(component));
+      const uint32_t  id   = opts.builder.make_id();
+      emit(opts.function.body, spv::Op::OpAccessChain,
+           {type, id, ptr.id, opts.builder.constant_int(components[0])});
+      return Pointer{id, component, ptr.storage, {}, layout};
+    }
+
+    return Pointer{ptr.id, ptr.type, ptr.storage, std::move(components), layout};
+  }
+
+  util::msg::fatal("no property [", name, "] on type [", type_name(ptr.type), "]");
+  return ptr;
+}
+
+Pointer index(const Options& opts, const Pointer& ptr, const std::string_view name,
+              const Value& index) {
+  const uint32_t member =
+      ptr.type.kind == Kind::Struct ? member_index(*ptr.type.type, name) : UINT32_MAX;
+  if (member == UINT32_MAX || !ptr.type.type->properties()[member].array ||
+      ptr.layout != Layout::Std430) {
+    util::msg::fatal("no runtime sized array [", name, "] on type [", type_name(ptr.type), "]");
+  }
+
+  const ValueType element = ValueType::from(ptr.type.type->properties()[member].type);
+  const uint32_t  type =
+      opts.builder.type_pointer(ptr.storage, opts.builder.type_id(element, ptr.layout));
+  const uint32_t  id   = opts.builder.make_id();
+  emit(opts.function.body, spv::Op::OpAccessChain,
+       {type, id, ptr.id, opts.builder.constant_int(member), index.id});
+  return Pointer{id, element, ptr.storage, {}, ptr.layout};
+}
+
+Value extract(const Options& opts, const Value& value, const std::string_view name) {
+  if (value.type.kind == Kind::Struct) {
+    const uint32_t  index  = member_index(*value.type.type, name);
+    const ValueType member = ValueType::from(value.type.type->properties()[index].type);
+    return Value{opts.emit(spv::Op::OpCompositeExtract, member, {value.id, index}), member};
+  }
+
+  if (value.type.is_vector()) {
+    const std::vector<uint32_t> components = parse_swizzle(name);
+    if (components.empty() || *std::max_element(components.begin(), components.end()) >=
+                                   value.type.count) {
+      util::msg::fatal("invalid swizzle [", name, "] on type [", type_name(value.type), "]");
+    }
+
+    if (components.size() == 1) {
+      const ValueType type = ValueType::scalar(value.type.kind);
+      return Value{opts.emit(spv::Op::OpCompositeExtract, type, {value.id, components[0]}), type};
+    }
+
+    const ValueType       type = ValueType::vector(value.type.kind, components.size());
+    std::vector<uint32_t> operands{value.id, value.id};
+    operands.insert(operands.end(), components.begin(), components.end());
+    return Value{opts.emit(spv::Op::OpVectorShuffle, type, operands), type};
+  }
+
+  util::msg::fatal("no property [", name, "] on type [", type_name(value.type), "]");
+  return value;
+}
+
+Value convert(const Options& opts, const Value& value, const ValueType& to) {
+  if (value.type == to) {
+    return value;
+  }
+
+  if (to.kind == Kind::Float && value.type.count == to.count) {
+    if (value.type.kind == Kind::Int) {
+      return Value{opts.emit(spv::Op::OpConvertSToF, to, {value.id}), to};
+    }
+
+    if (value.type.kind == Kind::Bool) {
+      const uint32_t one  = opts.builder.constant_float(1.0f);
+      const uint32_t zero = opts.builder.constant_float(0.0f);
+      if (to.count == 1) {
+        return Value{opts.emit(spv::Op::OpSelect, to, {value.id, one, zero}), to};
+      }
+      const Value ones  = splat(opts, Value{one, ValueType::scalar(Kind::Float)}, to.count);
+      const Value zeros = splat(opts, Value{zero, ValueType::scalar(Kind::Float)}, to.count);
+      return Value{opts.emit(spv::Op::OpSelect, to, {value.id, ones.id, zeros.id}), to};
+    }
+  }
+
+  if (to.is_vector() && value.type.is_scalar()) {
+    return splat(opts, convert(opts, value, ValueType::scalar(to.kind)), to.count);
+  }
+
+  util::msg::fatal("can not convert [", type_name(value.type), "] to [", type_name(to), "]");
+  return value;
+}
+
+Value splat(const Options& opts, const Value& value, const uint32_t count) {
+  const ValueType type = ValueType::vector(value.type.kind, count);
+  const std::vector<uint32_t> components(count, value.id);
+  return Value{opts.emit(spv::Op::OpCompositeConstruct, type, components), type};
+}
+
+Value binary(const Options& opts, const expr::BinOp op, Value lhs, Value rhs) {
+  // Integers are promoted when mixed with floating point values, as in glsl.
+  if (lhs.type.kind == Kind::Int &&
+      (rhs.type.kind == Kind::Float || rhs.type.kind == Kind::Matrix)) {
+    lhs = convert(opts, lhs, ValueType::vector(Kind::Float, lhs.type.count));
+  }
+  if (rhs.type.kind == Kind::Int &&
+      (lhs.type.kind == Kind::Float || lhs.type.kind == Kind::Matrix)) {
+    rhs = convert(opts, rhs, ValueType::vector(Kind::Float, rhs.type.count));
+  }
+
+  switch (op) {
+    case expr::BinOp::Add:
+    case expr::BinOp::Sub:
+    case expr::BinOp::Mul:
+    case expr::BinOp::Div:
+      return arithmetic(opts, op, lhs, rhs);
+
+    case expr::BinOp::Eq:
+    case expr::BinOp::Ne:
+    case expr::BinOp::Lt:
+    case expr::BinOp::Le:
+    case expr::BinOp::Gt:
+    case expr::BinOp::Ge:
+      return comparison(opts, op, lhs, rhs);
+
+    case expr::BinOp::And:
+    case expr::BinOp::Or:
+      if (lhs.type != ValueType::scalar(Kind::Bool) || rhs.type != ValueType::scalar(Kind::Bool)) {
+        util::msg::fatal("logical operator [", static_cast<uint32_t>(op),
+                         "] requires boolean operands");
+      }
+      return Value{opts.emit(op == expr::BinOp::And ? spv::Op::OpLogicalAnd : spv::Op::OpLogicalOr,
+                             lhs.type, {lhs.id, rhs.id}),
+                   lhs.type};
+
+    default:
+      util::msg::fatal("unhandled binary operator [", static_cast<uint32_t>(op), "]");
+      break;
+  }
+  return lhs;
+}
+
+}  // namespace crystal::compiler::ast::output::spirv
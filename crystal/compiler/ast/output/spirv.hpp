@@ -0,0 +1,285 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "spirv/unified1/GLSL.std.450.h"
+#include "spirv/unified1/spirv.hpp11"
+
+namespace crystal::compiler::ast {
+
+class Module;
+
+}  // namespace crystal::compiler::ast
+
+namespace crystal::compiler::ast::type {
+
+class Type;
+class StructType;
+
+}  // namespace crystal::compiler::ast::type
+
+namespace crystal::compiler::ast::expr {
+
+enum class BinOp;
+
+}  // namespace crystal::compiler::ast::expr
+
+namespace crystal::compiler::ast::decl {
+
+class VertexDeclaration;
+class FragmentDeclaration;
+
+}  // namespace crystal::compiler::ast::decl
+
+namespace crystal::compiler::ast::output::spirv {
+
+// The shape of a value produced while emitting spir-v. Scalars and vectors share a kind and are
+// distinguished by their component count.
+enum class Kind {
+  Void = 0,
+  Bool,
+  Int,
+  Float,
+  Matrix,
+  Texture,
+  Struct,
+};
+
+struct ValueType {
+  Kind                    kind  = Kind::Void;
+  uint32_t                count = 1;  // Vector components, or matrix columns.
+  const type::StructType* type  = nullptr;
+
+  [[nodiscard]] static ValueType from(const type::Type& type);
+
+  [[nodiscard]] static constexpr ValueType scalar(const Kind kind) { return ValueType{kind, 1}; }
+  [[nodiscard]] static constexpr ValueType vector(const Kind kind, const uint32_t count) {
+    return ValueType{kind, count};
+  }
+
+  [[nodiscard]] constexpr bool is_scalar() const {
+    return (kind == Kind::Bool || kind == Kind::Int || kind == Kind::Float) && count == 1;
+  }
+  [[nodiscard]] constexpr bool is_vector() const {
+    return (kind == Kind::Bool || kind == Kind::Int || kind == Kind::Float) && count > 1;
+  }
+
+  [[nodiscard]] constexpr bool operator==(const ValueType& other) const {
+    return kind == other.kind && count == other.count && type == other.type;
+  }
+  [[nodiscard]] constexpr bool operator!=(const ValueType& other) const {
+    return !(*this == other);
+  }
+};
+
+struct Value {
+  uint32_t  id;
+  ValueType type;
+};
+
+// Whether aggregate types carry explicit offsets, as is required inside uniform (std140) and
+// storage (std430) blocks.
+enum class Layout {
+  None = 0,
+  Std140,
+  Std430,
+};
+
+// An addressable location. A non-empty swizzle selects components of the pointed-to vector. The
+// layout is that of the block the location is in, if any.
+struct Pointer {
+  uint32_t              id;
+  ValueType             type;
+  spv::StorageClass     storage;
+  std::vector<uint32_t> swizzle;
+  Layout                layout = Layout::None;
+};
+
+struct Function;
+
+class Builder {
+  uint32_t next_id_ = 1;
+  uint32_t glsl_std_450_;
+
+  std::vector<uint32_t> entry_points_;
+  std::vector<uint32_t> execution_modes_;
+  std::vector<uint32_t> debug_;
+  std::vector<uint32_t> annotations_;
+  std::vector<uint32_t> globals_;
+  std::vector<uint32_t> functions_;
+
+  absl::flat_hash_map<std::vector<uint32_t>, uint32_t>                       types_;
+  absl::flat_hash_map<std::tuple<uint32_t, uint32_t>, uint32_t>              constants_;
+  absl::flat_hash_map<std::tuple<const type::StructType*, Layout>, uint32_t> structs_;
+  absl::flat_hash_map<std::tuple<const type::StructType*, Layout>, uint32_t> blocks_;
+  absl::flat_hash_map<uint32_t, uint32_t>                                    spec_constants_;
+  absl::flat_hash_map<std::tuple<uint32_t, uint32_t>, uint32_t>              runtime_arrays_;
+
+  uint32_t type_(spv::Op op, std::initializer_list<uint32_t> operands);
+  uint32_t struct_(const type::StructType& type, Layout layout);
+
+public:
+  Builder();
+
+  [[nodiscard]] uint32_t make_id() { return next_id_++; }
+  [[nodiscard]] uint32_t glsl_std_450() const { return glsl_std_450_; }
+
+  [[nodiscard]] uint32_t type_void();
+  [[nodiscard]] uint32_t type_bool();
+  [[nodiscard]] uint32_t type_int();
+  [[nodiscard]] uint32_t type_float();
+  [[nodiscard]] uint32_t type_vector(uint32_t component, uint32_t count);
+  [[nodiscard]] uint32_t type_matrix(uint32_t columns);
+  [[nodiscard]] uint32_t type_sampled_image();
+  [[nodiscard]] uint32_t type_pointer(spv::StorageClass storage, uint32_t type);
+  [[nodiscard]] uint32_t type_function(uint32_t return_type);
+  [[nodiscard]] uint32_t type_struct(const type::StructType& type, Layout layout);
+  [[nodiscard]] uint32_t type_id(const ValueType& type, Layout layout = Layout::None);
+
+  // A runtime sized array of `element`, whose elements are `stride` bytes apart.
+  [[nodiscard]] uint32_t type_runtime_array(uint32_t element, uint32_t stride);
+
+  // Uniform blocks get a struct type of their own, so that the Block decoration never leaks onto
+  // struct types that are also used for plain values.
+  [[nodiscard]] uint32_t type_block(const type::StructType& type);
+
+  // Storage blocks are std430, and decorated with BufferBlock, as spir-v 1.0 has no StorageBuffer
+  // storage class.
+  [[nodiscard]] uint32_t type_storage_block(const type::StructType& type);
+
+  [[nodiscard]] uint32_t constant_bool(bool value);
+  [[nodiscard]] uint32_t constant_int(int32_t value);
+  [[nodiscard]] uint32_t constant_float(float value);
+
+  // A scalar specialization constant with the given SpecId. Each one is only declared once, so that
+  // the stages of a pipeline share it.
+  [[nodiscard]] uint32_t spec_constant(const ValueType& type, uint32_t spec_id, double value,
+                                       std::string_view name);
+
+  void name(uint32_t id, std::string_view name);
+  void member_name(uint32_t id, uint32_t member, std::string_view name);
+  void decorate(uint32_t id, spv::Decoration decoration,
+                std::initializer_list<uint32_t> operands = {});
+  void member_decorate(uint32_t id, uint32_t member, spv::Decoration decoration,
+                       std::initializer_list<uint32_t> operands = {});
+
+  [[nodiscard]] uint32_t variable(spv::StorageClass storage, uint32_t type, std::string_view name);
+
+  void entry_point(spv::ExecutionModel model, uint32_t function, std::string_view name,
+                   const std::vector<uint32_t>& interface);
+  void execution_mode(uint32_t function, spv::ExecutionMode mode,
+                      std::initializer_list<uint32_t> operands = {});
+
+  // Adds a `void()` function with the given body and returns its id.
+  [[nodiscard]] uint32_t add_function(const Function& function, std::string_view name);
+
+  [[nodiscard]] std::vector<uint32_t> finish() const;
+};
+
+// Per-function emission state.
+struct Function {
+  std::vector<uint32_t>                     variables;  // Must lead the first block.
+  std::vector<uint32_t>                     body;
+  absl::flat_hash_map<std::string, Pointer> scope;
+  absl::flat_hash_map<std::string, Value>   constants;  // The `const` pipeline parameters.
+  absl::flat_hash_map<int32_t, uint32_t>    outputs;  // Output index to variable.
+  uint32_t                                  position   = 0;
+  bool                                      terminated = false;
+};
+
+struct Options {
+  const Module&                    mod;
+  const decl::VertexDeclaration*   vertex;
+  const decl::FragmentDeclaration* fragment;
+  Builder&                         builder;
+  Function&                        function;
+
+  constexpr Options(const Module& mod, const decl::VertexDeclaration* vertex,
+                    const decl::FragmentDeclaration* fragment, Builder& builder,
+                    Function& function)
+      : mod(mod), vertex(vertex), fragment(fragment), builder(builder), function(function) {}
+
+  // Appends an instruction producing a value of `type` to the function body.
+  uint32_t emit(spv::Op op, const ValueType& type, std::initializer_list<uint32_t> operands) const;
+  uint32_t emit(spv::Op op, const ValueType& type, const std::vector<uint32_t>& operands) const;
+
+  // Appends an instruction without a result to the function body.
+  void emit_void(spv::Op op, std::initializer_list<uint32_t> operands) const;
+
+  // Appends a GLSL.std.450 extended instruction to the function body.
+  uint32_t ext(GLSLstd450 inst, const ValueType& type, const std::vector<uint32_t>& operands) const;
+};
+
+inline std::string mangle_name(const std::string_view name) { return "_" + std::string(name); }
+
+inline std::string vertex_input_name(const uint32_t index, const std::string_view name) {
+  return "i" + std::to_string(index) + "_" + std::string(name);
+}
+
+inline std::string varying_name(const uint32_t index, const std::string_view name) {
+  return "v" + std::to_string(index) + "_" + std::string(name);
+}
+
+inline std::string fragment_output_name(const uint32_t index, const std::string_view name) {
+  return "o" + std::to_string(index) + "_" + std::string(name);
+}
+
+// Appends a single instruction to `out`.
+void emit(std::vector<uint32_t>& out, spv::Op op, std::initializer_list<uint32_t> operands);
+void emit(std::vector<uint32_t>& out, spv::Op op, const std::vector<uint32_t>& operands);
+
+// Appends a nul terminated, word padded literal string to `out`.
+void append_string(std::vector<uint32_t>& out, std::string_view str);
+
+// Returns the component indices of a vector swizzle, or an empty vector if `name` isn't one.
+[[nodiscard]] std::vector<uint32_t> parse_swizzle(std::string_view name);
+
+// Declares a function local variable.
+[[nodiscard]] Pointer local(const Options& opts, const ValueType& type, std::string_view name);
+
+// Declares a storage block in a descriptor set of its own, after the textures, and returns its
+// location. The function may only read from a readonly one.
+[[nodiscard]] Pointer storage(Builder& builder, const type::StructType& type,
+                              std::string_view name, uint32_t binding, bool readonly);
+
+// Starts a new block if the current one has been terminated, as any following statements are
+// unreachable but must still belong to a block.
+void ensure_block(const Options& opts);
+
+// Starts the block with the given label, which the current block must already have branched to.
+void begin_block(const Options& opts, uint32_t label);
+
+// Ends the current block with a branch to `label`, unless it has already been terminated, such as
+// by a return.
+void branch(const Options& opts, uint32_t label);
+
+[[nodiscard]] Value load(const Options& opts, const Pointer& ptr);
+void                store(const Options& opts, const Pointer& ptr, const Value& value);
+
+// Returns a pointer to a member of the struct, or component of the vector, behind `ptr`.
+[[nodiscard]] Pointer access(const Options& opts, const Pointer& ptr, std::string_view name);
+
+// Returns a pointer to an element of the runtime sized array member of the struct behind `ptr`.
+[[nodiscard]] Pointer index(const Options& opts, const Pointer& ptr, std::string_view name,
+                            const Value& index);
+
+// Returns the member of a struct value, or the components of a vector value.
+[[nodiscard]] Value extract(const Options& opts, const Value& value, std::string_view name);
+
+// Applies the implicit conversions glsl allows (int and bool to float, scalar to vector).
+[[nodiscard]] Value convert(const Options& opts, const Value& value, const ValueType& to);
+
+// Applies a binary operator to two values, following glsl's rules for mixing scalars, vectors and
+// matrices.
+[[nodiscard]] Value binary(const Options& opts, expr::BinOp op, Value lhs, Value rhs);
+
+// Replicates a scalar into a vector of `count` components.
+[[nodiscard]] Value splat(const Options& opts, const Value& value, uint32_t count);
+
+}  // namespace crystal::compiler::ast::output::spirv
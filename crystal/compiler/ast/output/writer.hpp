@@ -0,0 +1,57 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace crystal::compiler::ast::output {
+
+// A growable text buffer that the glsl and metal emitters write straight into.
+//
+// Nodes append their output directly rather than returning anything to be printed later, so
+// emitting a tree doesn't allocate beyond the occasional growth of the buffer itself. Reusing a
+// cleared writer avoids even that.
+class Writer {
+  std::string buffer_;
+
+public:
+  Writer() = default;
+  explicit Writer(const size_t capacity) { buffer_.reserve(capacity); }
+
+  [[nodiscard]] const std::string& str() const { return buffer_; }
+  [[nodiscard]] std::string        take() { return std::move(buffer_); }
+  [[nodiscard]] size_t             size() const { return buffer_.size(); }
+
+  // Empties the buffer while keeping its capacity.
+  void clear() { buffer_.clear(); }
+
+  Writer& operator<<(const std::string_view str) {
+    buffer_.append(str);
+    return *this;
+  }
+
+  Writer& operator<<(const char c) {
+    buffer_.push_back(c);
+    return *this;
+  }
+
+  template <typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, char> &&
+                                             !std::is_same_v<T, bool>,
+                                         int> = 0>
+  Writer& operator<<(const T value) {
+    char       buffer[24];
+    const auto result = std::to_chars(std::begin(buffer), std::end(buffer), value);
+    buffer_.append(buffer, result.ptr - buffer);
+    return *this;
+  }
+};
+
+inline std::ostream& operator<<(std::ostream& out, const Writer& writer) {
+  return out << writer.str();
+}
+
+}  // namespace crystal::compiler::ast::output
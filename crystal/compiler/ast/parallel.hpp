@@ -0,0 +1,42 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace crystal::compiler::ast {
+
+// Calls `fn(i)` for every `i` in `[0, count)`, spread across up to `jobs` threads.
+//
+// Every index is handed to exactly one call, so writing the results into a presized container by
+// index keeps the output identical to running the loop serially, no matter how the work ends up
+// being scheduled.
+template <typename Fn>
+void parallel_for(const size_t count, const uint32_t jobs, Fn&& fn) {
+  const size_t thread_count = std::min<size_t>(jobs, count);
+  if (thread_count <= 1) {
+    for (size_t i = 0; i < count; ++i) {
+      fn(i);
+    }
+    return;
+  }
+
+  std::atomic<size_t>      next = 0;
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count);
+  for (size_t t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&]() {
+      for (size_t i = next++; i < count; i = next++) {
+        fn(i);
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace crystal::compiler::ast
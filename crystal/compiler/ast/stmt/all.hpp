@@ -1,7 +1,10 @@
 #pragma once
 
 #include "crystal/compiler/ast/stmt/assignment_statement.hpp"
+#include "crystal/compiler/ast/stmt/block_statement.hpp"
 #include "crystal/compiler/ast/stmt/expression_statement.hpp"
+#include "crystal/compiler/ast/stmt/for_statement.hpp"
+#include "crystal/compiler/ast/stmt/if_statement.hpp"
 #include "crystal/compiler/ast/stmt/return_statement.hpp"
 #include "crystal/compiler/ast/stmt/statement.hpp"
 #include "crystal/compiler/ast/stmt/variable_statement.hpp"
@@ -1,37 +1,173 @@
 #include "crystal/compiler/ast/stmt/assignment_statement.hpp"
 
+#include <functional>
+#include <string_view>
+
+#include "crystal/compiler/ast/expr/bin_op_expression.hpp"
+#include "crystal/compiler/ast/expr/identifier_expression.hpp"
 #include "crystal/compiler/ast/output/glsl.hpp"
-#include "crystal/compiler/ast/output/print.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
 #include "util/msg/msg.hpp"
 
 namespace crystal::compiler::ast::stmt {
 
-output::PrintLambda AssignmentStatement::to_glsl(const output::glsl::Options opts) const {
-  switch (op_) {
+namespace {
+
+// The operator, which is spelled the same in glsl and metal.
+std::string_view to_string(const AssignmentOp op) {
+  switch (op) {
     case AssignmentOp::Set:
-      return output::PrintLambda{[=](std::ostream& out) {
-        out << output::glsl::indent{opts.indent} << var_->to_glsl(opts)
-            << (opts.pretty ? " = " : "=") << value_->to_glsl(opts) << (opts.pretty ? ";\n" : ";");
-      }};
+      return "=";
+    case AssignmentOp::Add:
+      return "+=";
+    case AssignmentOp::Sub:
+      return "-=";
+    case AssignmentOp::Mul:
+      return "*=";
+    case AssignmentOp::Div:
+      return "/=";
 
     default:
-      util::msg::fatal("unhandled assignment operator [", static_cast<uint32_t>(op_), "]");
+      util::msg::fatal("unhandled assignment operator [", static_cast<uint32_t>(op), "]");
       break;
   }
+  return "";
+}
+
+// Calls `fn` with each operand of the location that isn't on the way down to its root, which are
+// the indices into runtime sized arrays, eg: `i` in `a.b[i].c`. The location is always the last
+// operand.
+void for_each_index(expr::Expression* location, const std::function<void(expr::Expression*&)>& fn) {
+  while (location != nullptr && !location->is_identifier()) {
+    expr::Expression** next = nullptr;
+    location->for_each_operand([&](expr::Expression*& operand) {
+      if (next != nullptr) {
+        fn(*next);
+      }
+      next = &operand;
+    });
+    location = next != nullptr ? *next : nullptr;
+  }
 }
 
-output::PrintLambda AssignmentStatement::to_metal(const output::metal::Options opts) const {
+}  // namespace
+
+void AssignmentStatement::typecheck(check::Context& ctx) {
+  const util::memory::Ref<type::Type> var = var_->typecheck(ctx);
+  if (!var_->addressable()) {
+    util::msg::fatal("expression can not be assigned to");
+  }
+  if (var_->root()->binding().kind == check::BindingKind::Uniform) {
+    util::msg::fatal("uniform [", var_->root()->name(), "] can not be assigned to");
+  }
+  if (var_->root()->binding().kind == check::BindingKind::ReadOnlyStorage) {
+    util::msg::fatal("readonly storage buffer [", var_->root()->name(), "] can not be assigned to");
+  }
+  if (var_->root()->binding().kind == check::BindingKind::Constant) {
+    util::msg::fatal("constant [", var_->root()->name(), "] can not be assigned to");
+  }
+  if (var_->root()->binding().kind == check::BindingKind::Feature) {
+    util::msg::fatal("feature [", var_->root()->name(), "] can not be assigned to");
+  }
+  if (var_->root()->binding().kind == check::BindingKind::Counter) {
+    util::msg::fatal("loop counter [", var_->root()->name(), "] can not be assigned to");
+  }
+
+  util::memory::Ref<type::Type> value = value_->typecheck(ctx);
   switch (op_) {
     case AssignmentOp::Set:
-      return output::PrintLambda{[=](std::ostream& out) {
-        out << output::metal::indent{opts.indent} << var_->to_metal(opts) << " = "
-            << value_->to_metal(opts) << ";\n";
-      }};
+      break;
+    case AssignmentOp::Add:
+      value = check::binary(ctx, expr::BinOp::Add, var, value);
+      break;
+    case AssignmentOp::Sub:
+      value = check::binary(ctx, expr::BinOp::Sub, var, value);
+      break;
+    case AssignmentOp::Mul:
+      value = check::binary(ctx, expr::BinOp::Mul, var, value);
+      break;
+    case AssignmentOp::Div:
+      value = check::binary(ctx, expr::BinOp::Div, var, value);
+      break;
+    default:
+      util::msg::fatal("unhandled assignment operator [", static_cast<uint32_t>(op_), "]");
+      break;
+  }
+
+  if (!check::assignable(var, value)) {
+    util::msg::fatal("cannot assign a value of type [", value->name(), "] to [", var->name(),
+                     "]");
+  }
+}
+
+void AssignmentStatement::for_each_expression(const std::function<void(expr::Expression*&)>& fn) {
+  for_each_index(var_, fn);
+  fn(value_);
+}
+
+void AssignmentStatement::optimize(opt::Context& ctx) {
+  // Only the indices into the target are simplified, as the rest of it must remain a location.
+  for_each_index(var_, [&](expr::Expression*& index) { index = index->optimize(ctx); });
+  value_ = value_->optimize(ctx);
+  ctx.clear_constant(var_->root()->binding().local);
+}
+
+bool AssignmentStatement::live(opt::Liveness& live) {
+  if (!live.needed(var_)) {
+    return false;
+  }
+
+  // Compound assignments read the target as well, and any assignment reads the indices into it.
+  if (op_ != AssignmentOp::Set) {
+    live.use(var_);
+  } else {
+    for_each_index(var_, [&](expr::Expression*& index) { live.use(index); });
+  }
+  live.use(value_);
+  return true;
+}
+
+void AssignmentStatement::to_glsl(output::Writer& out, const output::glsl::Options& opts) const {
+  const std::string_view op = to_string(op_);
+  out << output::glsl::indent{opts.indent} << output::glsl::emit{var_, opts}
+      << (opts.pretty ? " " : "") << op << (opts.pretty ? " " : "")
+      << output::glsl::emit{value_, opts} << (opts.pretty ? ";\n" : ";");
+}
 
+void AssignmentStatement::to_metal(output::Writer& out, const output::metal::Options& opts) const {
+  out << output::metal::indent{opts.indent} << output::metal::emit{var_, opts} << " "
+      << to_string(op_) << " " << output::metal::emit{value_, opts} << ";\n";
+}
+
+void AssignmentStatement::to_spirv(const output::spirv::Options opts) const {
+  const output::spirv::Pointer var   = var_->to_spirv_pointer(opts);
+  output::spirv::Value         value = value_->to_spirv(opts);
+
+  expr::BinOp op = expr::BinOp::Undefined;
+  switch (op_) {
+    case AssignmentOp::Set:
+      break;
+    case AssignmentOp::Add:
+      op = expr::BinOp::Add;
+      break;
+    case AssignmentOp::Sub:
+      op = expr::BinOp::Sub;
+      break;
+    case AssignmentOp::Mul:
+      op = expr::BinOp::Mul;
+      break;
+    case AssignmentOp::Div:
+      op = expr::BinOp::Div;
+      break;
     default:
       util::msg::fatal("unhandled assignment operator [", static_cast<uint32_t>(op_), "]");
       break;
   }
+
+  if (op != expr::BinOp::Undefined) {
+    value = output::spirv::binary(opts, op, output::spirv::load(opts, var), value);
+  }
+  output::spirv::store(opts, var, value);
 }
 
 }  // namespace crystal::compiler::ast::stmt
@@ -2,7 +2,6 @@
 
 #include "crystal/compiler/ast/expr/expression.hpp"
 #include "crystal/compiler/ast/stmt/statement.hpp"
-#include "util/memory/ref_count.hpp"
 
 namespace crystal::compiler::ast::stmt {
 
@@ -16,18 +15,34 @@ enum class AssignmentOp {
 };
 
 class AssignmentStatement : public Statement {
-  util::memory::Ref<expr::Expression> var_;
-  util::memory::Ref<expr::Expression> value_;
-  AssignmentOp                        op_;
+  expr::Expression* var_;
+  expr::Expression* value_;
+  AssignmentOp      op_;
 
 public:
-  AssignmentStatement(util::memory::Ref<expr::Expression> var,
-                      util::memory::Ref<expr::Expression> value, AssignmentOp op)
+  AssignmentStatement(expr::Expression* var, expr::Expression* value, AssignmentOp op)
       : var_(var), value_(value), op_(op) {}
 
-  virtual output::PrintLambda to_glsl(const output::glsl::Options opts) const override;
+  [[nodiscard]] virtual Statement* clone(Arena& arena) const override {
+    return arena.make<AssignmentStatement>(var_->clone(arena), value_->clone(arena), op_);
+  }
 
-  virtual output::PrintLambda to_metal(const output::metal::Options opts) const override;
+  virtual void typecheck(check::Context& ctx) override;
+
+  virtual void optimize(opt::Context& ctx) override;
+
+  // The indices into the target, eg: `i` in `a.b[i] = c`, followed by the value.
+  virtual void for_each_expression(const std::function<void(expr::Expression*&)>& fn) override;
+
+  [[nodiscard]] virtual expr::Expression* assigned() const override { return var_; }
+
+  [[nodiscard]] virtual bool live(opt::Liveness& live) override;
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override;
+
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override;
+
+  virtual void to_spirv(const output::spirv::Options opts) const override;
 };
 
 }  // namespace crystal::compiler::ast::stmt
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "crystal/compiler/ast/stmt/statement.hpp"
+
+namespace crystal::compiler::ast::stmt {
+
+// A nested block, whose locals are only visible inside of it. The compiler creates these for the
+// iterations of a loop that it unrolls, so that each may declare the same locals.
+class BlockStatement : public Statement {
+  std::vector<Statement*> body_;
+
+public:
+  BlockStatement(std::vector<Statement*>&& body) : body_(std::move(body)) {}
+
+  [[nodiscard]] virtual Statement* clone(Arena& arena) const override {
+    return arena.make<BlockStatement>(stmt::clone(arena, body_));
+  }
+
+  virtual void typecheck(check::Context& ctx) override { stmt::typecheck(ctx, body_); }
+
+  virtual void optimize(opt::Context& ctx) override { stmt::optimize(ctx, body_); }
+
+  virtual void for_each_expression(const std::function<void(expr::Expression*&)>& fn) override {}
+
+  virtual void for_each_body(const std::function<void(std::vector<Statement*>&)>& fn) override {
+    fn(body_);
+  }
+
+  [[nodiscard]] virtual bool live(opt::Liveness& live) override {
+    opt::eliminate_dead_code(live, body_);
+    return !body_.empty();
+  }
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override {
+    out << output::glsl::indent{opts.indent};
+    stmt::to_glsl(out, opts, body_);
+    out << (opts.pretty ? "\n" : "");
+  }
+
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override {
+    out << output::metal::indent{opts.indent};
+    stmt::to_metal(out, opts, body_);
+    out << "\n";
+  }
+
+  virtual void to_spirv(const output::spirv::Options opts) const override {
+    stmt::to_spirv(opts, body_);
+  }
+};
+
+}  // namespace crystal::compiler::ast::stmt
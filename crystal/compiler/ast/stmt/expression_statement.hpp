@@ -2,29 +2,45 @@
 
 #include "crystal/compiler/ast/expr/expression.hpp"
 #include "crystal/compiler/ast/output/glsl.hpp"
-#include "crystal/compiler/ast/output/print.hpp"
 #include "crystal/compiler/ast/stmt/statement.hpp"
-#include "util/memory/ref_count.hpp"
 
 namespace crystal::compiler::ast::stmt {
 
 class ExpressionStatement : public Statement {
-  util::memory::Ref<expr::Expression> expr_;
+  expr::Expression* expr_;
 
 public:
-  ExpressionStatement(util::memory::Ref<expr::Expression> expr) : expr_(expr) {}
+  ExpressionStatement(expr::Expression* expr) : expr_(expr) {}
 
-  virtual output::PrintLambda to_glsl(const output::glsl::Options opts) const override {
-    return output::PrintLambda{[=](std::ostream& out) {
-      out << output::glsl::indent{opts.indent} << expr_->to_glsl(opts)
-          << (opts.pretty ? ";\n" : ";");
-    }};
+  [[nodiscard]] virtual Statement* clone(Arena& arena) const override {
+    return arena.make<ExpressionStatement>(expr_->clone(arena));
   }
 
-  virtual output::PrintLambda to_metal(const output::metal::Options opts) const override {
-    return output::PrintLambda{[=](std::ostream& out) {
-      out << output::metal::indent{opts.indent} << expr_->to_metal(opts) << ";\n";
-    }};
+  virtual void typecheck(check::Context& ctx) override { expr_->typecheck(ctx); }
+
+  virtual void optimize(opt::Context& ctx) override { expr_ = expr_->optimize(ctx); }
+
+  virtual void for_each_expression(const std::function<void(expr::Expression*&)>& fn) override {
+    fn(expr_);
+  }
+
+  [[nodiscard]] virtual bool live(opt::Liveness& live) override {
+    live.use(expr_);
+    return true;
+  }
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override {
+    out << output::glsl::indent{opts.indent} << output::glsl::emit{expr_, opts}
+        << (opts.pretty ? ";\n" : ";");
+  }
+
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override {
+    out << output::metal::indent{opts.indent} << output::metal::emit{expr_, opts} << ";\n";
+  }
+
+  virtual void to_spirv(const output::spirv::Options opts) const override {
+    // The result is unused.
+    (void)expr_->to_spirv(opts);
   }
 };
 
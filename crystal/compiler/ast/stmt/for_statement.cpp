@@ -0,0 +1,227 @@
+#include "crystal/compiler/ast/stmt/for_statement.hpp"
+
+#include <optional>
+
+#include "crystal/compiler/ast/expr/bin_op_expression.hpp"
+#include "crystal/compiler/ast/expr/identifier_expression.hpp"
+#include "crystal/compiler/ast/expr/integer_expression.hpp"
+#include "crystal/compiler/ast/expr/parenthesis_expression.hpp"
+#include "crystal/compiler/ast/expr/un_op_expression.hpp"
+#include "crystal/compiler/ast/module.hpp"
+#include "crystal/compiler/ast/output/glsl.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
+#include "crystal/compiler/ast/stmt/block_statement.hpp"
+#include "util/msg/msg.hpp"
+
+namespace crystal::compiler::ast::stmt {
+
+namespace {
+
+int64_t evaluate(check::Context& ctx, expr::Expression*& expr) {
+  const util::memory::Ref<type::Type> type = expr->typecheck(ctx);
+  if (type != ctx.int_type()) {
+    util::msg::fatal("the bounds and step of a for loop must be [int], not [", type->name(), "]");
+  }
+
+  opt::Context                opt_ctx(ctx.mod(), ctx.return_type());
+  const std::optional<double> value = (expr = expr->optimize(opt_ctx))->constant();
+  if (!value) {
+    util::msg::fatal("the bounds and step of a for loop must be constant");
+  }
+  return static_cast<int64_t>(*value);
+}
+
+// An expression that may replace the counter anywhere, such as on the right of a subtraction.
+expr::Expression* counter_value(Module& mod, const int64_t value) {
+  if (value >= 0) {
+    return mod.make<expr::IntegerExpression>(value);
+  }
+  return mod.make<expr::ParenthesisExpression>(
+      mod.make<expr::UnOpExpression>(mod.make<expr::IntegerExpression>(-value), expr::UnOp::Neg));
+}
+
+}  // namespace
+
+void ForStatement::typecheck(check::Context& ctx) {
+  if (header_.type != ctx.int_type()) {
+    util::msg::fatal("the counter of a for loop must be an [int], not [", header_.type->name(),
+                     "]");
+  }
+
+  start_             = evaluate(ctx, header_.start);
+  const int64_t end  = evaluate(ctx, header_.end) + (header_.inclusive ? 1 : 0);
+  const int64_t step = evaluate(ctx, step_);
+  if (step <= 0) {
+    util::msg::fatal("the step of a for loop must be positive, not [", step, "]");
+  }
+  const int64_t iterations = end > start_ ? (end - start_ + step - 1) / step : 0;
+
+  Module& mod   = ctx.mod();
+  checked_      = true;
+  loop_end_     = start_;
+  int64_t first = 0;  // The first of the iterations that are unrolled after the loop.
+
+  if (unroll_ == UNROLL_NONE) {
+    loop_      = body_;
+    loop_end_  = end;
+    loop_step_ = step;
+    first      = iterations;
+  } else if (unroll_ == UNROLL_ALL || iterations <= unroll_) {
+    if (iterations > MAX_UNROLLED) {
+      util::msg::fatal("can not unroll a loop of [", iterations, "] iterations, the most is [",
+                       MAX_UNROLLED, "]");
+    }
+  } else {
+    if (unroll_ > MAX_UNROLLED) {
+      util::msg::fatal("can not unroll a loop by [", unroll_, "], the most is [", MAX_UNROLLED,
+                       "]");
+    }
+
+    // Each iteration of the loop runs `unroll_` iterations of the source, the nth of which sees
+    // the counter advanced by n steps.
+    loop_step_ = step * unroll_;
+    loop_end_  = start_ + iterations / unroll_ * loop_step_;
+    first      = iterations / unroll_ * unroll_;
+
+    expr::Expression* const counter = mod.make<expr::IdentifierExpression>(header_.counter);
+    loop_.push_back(mod.make<BlockStatement>(stmt::clone(mod.arena(), body_)));
+    for (uint32_t n = 1; n < unroll_; ++n) {
+      const auto value = mod.make<expr::ParenthesisExpression>(mod.make<expr::BinOpExpression>(
+          counter, mod.make<expr::IntegerExpression>(n * step), expr::BinOp::Add));
+      loop_.push_back(mod.make<BlockStatement>(
+          stmt::substitute(mod.arena(), body_, header_.counter, *value)));
+    }
+  }
+
+  for (int64_t i = first; i < iterations; ++i) {
+    const expr::Expression* const value = counter_value(mod, start_ + i * step);
+    unrolled_.push_back(
+        mod.make<BlockStatement>(stmt::substitute(mod.arena(), body_, header_.counter, *value)));
+  }
+
+  // The counter is declared even when the whole loop is unrolled, so that it still can't clash
+  // with another local.
+  ctx.open_block();
+  ctx.declare(header_.counter, check::Binding{check::BindingKind::Counter, ctx.int_type()});
+  for (const auto& stmt : loop_) {
+    stmt->typecheck(ctx);
+  }
+  ctx.close_block();
+  for (const auto& stmt : unrolled_) {
+    stmt->typecheck(ctx);
+  }
+
+  if (loop_end_ <= start_) {
+    loop_.clear();
+  }
+}
+
+void ForStatement::optimize(opt::Context& ctx) {
+  if (!loop_.empty()) {
+    // Each iteration sees what the ones before it assigned, so nothing that the loop assigns to is
+    // known inside of it, or after it.
+    for (const auto& stmt : loop_) {
+      stmt->for_each_assigned([&](expr::Expression* location) {
+        ctx.clear_constant(location->root()->binding().local);
+      });
+    }
+    const auto constants = ctx.save_constants();
+    stmt::optimize(ctx, loop_);
+    ctx.restore_constants(constants);
+  }
+
+  // The unrolled iterations simply run one after the other.
+  for (const auto& stmt : unrolled_) {
+    stmt->optimize(ctx);
+  }
+}
+
+bool ForStatement::live(opt::Liveness& live) {
+  opt::eliminate_dead_code(live, unrolled_);
+  if (!loop_.empty()) {
+    // What an iteration assigns to may be read by the next one, before it is assigned again.
+    for (const auto& stmt : loop_) {
+      stmt->for_each_assigned([&](expr::Expression* location) { live.use(location); });
+    }
+    opt::eliminate_dead_code(live, loop_);
+  }
+  return !loop_.empty() || !unrolled_.empty();
+}
+
+void ForStatement::to_glsl(output::Writer& out, const output::glsl::Options& opts) const {
+  if (!loop_.empty()) {
+    const output::glsl::mangle_name counter{header_.counter, opts.names};
+    out << output::glsl::indent{opts.indent} << (opts.pretty ? "for (int " : "for(int ") << counter
+        << (opts.pretty ? " = " : "=") << start_ << (opts.pretty ? "; " : ";") << counter
+        << (opts.pretty ? " < " : "<") << loop_end_ << (opts.pretty ? "; " : ";") << counter
+        << (opts.pretty ? " += " : "+=") << loop_step_ << (opts.pretty ? ") " : ")");
+    stmt::to_glsl(out, opts, loop_);
+    out << (opts.pretty ? "\n" : "");
+  }
+  for (const auto& stmt : unrolled_) {
+    stmt->to_glsl(out, opts);
+  }
+}
+
+void ForStatement::to_metal(output::Writer& out, const output::metal::Options& opts) const {
+  if (!loop_.empty()) {
+    const output::metal::mangle_name counter{header_.counter};
+    out << output::metal::indent{opts.indent} << "for (int " << counter << " = " << start_ << "; "
+        << counter << " < " << loop_end_ << "; " << counter << " += " << loop_step_ << ") ";
+    stmt::to_metal(out, opts, loop_);
+    out << "\n";
+  }
+  for (const auto& stmt : unrolled_) {
+    stmt->to_metal(out, opts);
+  }
+}
+
+void ForStatement::to_spirv(const output::spirv::Options opts) const {
+  if (!loop_.empty()) {
+    const auto int_type = output::spirv::ValueType::scalar(output::spirv::Kind::Int);
+    const output::spirv::Pointer counter =
+        output::spirv::local(opts, int_type, output::spirv::mangle_name(header_.counter));
+    output::spirv::store(
+        opts, counter,
+        output::spirv::Value{opts.builder.constant_int(static_cast<int32_t>(start_)), int_type});
+    opts.function.scope.insert_or_assign(std::string(header_.counter.str()), counter);
+
+    const uint32_t header_label   = opts.builder.make_id();
+    const uint32_t check_label    = opts.builder.make_id();
+    const uint32_t body_label     = opts.builder.make_id();
+    const uint32_t continue_label = opts.builder.make_id();
+    const uint32_t merge_label    = opts.builder.make_id();
+
+    output::spirv::branch(opts, header_label);
+    output::spirv::begin_block(opts, header_label);
+    opts.emit_void(spv::Op::OpLoopMerge,
+                   {merge_label, continue_label,
+                    static_cast<uint32_t>(spv::LoopControlMask::MaskNone)});
+    output::spirv::branch(opts, check_label);
+
+    output::spirv::begin_block(opts, check_label);
+    const uint32_t in_range =
+        opts.emit(spv::Op::OpSLessThan, output::spirv::ValueType::scalar(output::spirv::Kind::Bool),
+                  {output::spirv::load(opts, counter).id,
+                   opts.builder.constant_int(static_cast<int32_t>(loop_end_))});
+    opts.emit_void(spv::Op::OpBranchConditional, {in_range, body_label, merge_label});
+    opts.function.terminated = true;
+
+    output::spirv::begin_block(opts, body_label);
+    stmt::to_spirv(opts, loop_);
+    output::spirv::branch(opts, continue_label);
+
+    output::spirv::begin_block(opts, continue_label);
+    const uint32_t next =
+        opts.emit(spv::Op::OpIAdd, int_type,
+                  {output::spirv::load(opts, counter).id,
+                   opts.builder.constant_int(static_cast<int32_t>(loop_step_))});
+    output::spirv::store(opts, counter, output::spirv::Value{next, int_type});
+    output::spirv::branch(opts, header_label);
+
+    output::spirv::begin_block(opts, merge_label);
+  }
+  stmt::to_spirv(opts, unrolled_);
+}
+
+}  // namespace crystal::compiler::ast::stmt
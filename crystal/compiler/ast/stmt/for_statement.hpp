@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "crystal/compiler/ast/expr/expression.hpp"
+#include "crystal/compiler/ast/stmt/statement.hpp"
+#include "crystal/compiler/ast/symbol.hpp"
+#include "crystal/compiler/ast/type/type.hpp"
+#include "util/memory/ref_count.hpp"
+
+namespace crystal::compiler::ast::stmt {
+
+// How many copies of the body `[[unroll(N)]]` puts in each iteration of a loop. The compiler
+// expands these itself, rather than leaving it to the heuristics of each driver.
+constexpr uint32_t UNROLL_NONE = 1;
+constexpr uint32_t UNROLL_ALL  = 0;  // `[[unroll]]`, which leaves no loop at all.
+
+// The most copies of the body that unrolling a loop may create.
+constexpr int64_t MAX_UNROLLED = 256;
+
+// The part of a `for` loop that declares its counter and its bound.
+struct LoopHeader {
+  Symbol                        counter;
+  util::memory::Ref<type::Type> type;
+  expr::Expression*             start;
+  expr::Expression*             end;
+  bool                          inclusive = false;  // Whether the bound is compared with `<=`.
+};
+
+// `for (int i = start; i < end; i += step)`, where the start, end and step are constant, and only
+// the loop itself advances the counter.
+class ForStatement : public Statement {
+  LoopHeader              header_;
+  expr::Expression*       step_;
+  uint32_t                unroll_;
+  std::vector<Statement*> body_;
+
+  // Filled in by `typecheck`. The loop that is output runs `loop_` from `start_` up to `loop_end_`
+  // in steps of `loop_step_`, and the iterations that are left over follow it in `unrolled_`.
+  bool                    checked_   = false;
+  int64_t                 start_     = 0;
+  int64_t                 loop_end_  = 0;
+  int64_t                 loop_step_ = 1;
+  std::vector<Statement*> loop_;
+  std::vector<Statement*> unrolled_;
+
+public:
+  ForStatement(LoopHeader header, expr::Expression* step, uint32_t unroll,
+               std::vector<Statement*>&& body)
+      : header_(std::move(header)), step_(step), unroll_(unroll), body_(std::move(body)) {}
+
+  [[nodiscard]] virtual Statement* clone(Arena& arena) const override {
+    LoopHeader header = header_;
+    header.start      = header_.start->clone(arena);
+    header.end        = header_.end->clone(arena);
+    return arena.make<ForStatement>(std::move(header), step_->clone(arena), unroll_,
+                                    stmt::clone(arena, body_));
+  }
+
+  // Also unrolls the loop, so that the copies of the body are checked, and optimized, on their
+  // own.
+  virtual void typecheck(check::Context& ctx) override;
+
+  virtual void optimize(opt::Context& ctx) override;
+
+  virtual void for_each_expression(const std::function<void(expr::Expression*&)>& fn) override {
+    fn(header_.start);
+    fn(header_.end);
+    fn(step_);
+  }
+
+  virtual void for_each_body(const std::function<void(std::vector<Statement*>&)>& fn) override {
+    if (!checked_) {
+      fn(body_);
+      return;
+    }
+    fn(loop_);
+    fn(unrolled_);
+  }
+
+  [[nodiscard]] virtual bool live(opt::Liveness& live) override;
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override;
+
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override;
+
+  virtual void to_spirv(const output::spirv::Options opts) const override;
+};
+
+}  // namespace crystal::compiler::ast::stmt
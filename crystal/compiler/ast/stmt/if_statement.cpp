@@ -0,0 +1,129 @@
+#include "crystal/compiler/ast/stmt/if_statement.hpp"
+
+#include <optional>
+
+#include "crystal/compiler/ast/expr/identifier_expression.hpp"
+#include "crystal/compiler/ast/output/glsl.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
+#include "util/msg/msg.hpp"
+
+namespace crystal::compiler::ast::stmt {
+
+void IfStatement::typecheck(check::Context& ctx) {
+  const util::memory::Ref<type::Type> cond = cond_->typecheck(ctx);
+  if (!check::assignable(ctx.bool_type(), cond)) {
+    util::msg::fatal("the condition of an if statement must be a [bool], not [", cond->name(),
+                     "]");
+  }
+
+  stmt::typecheck(ctx, then_);
+  stmt::typecheck(ctx, else_);
+}
+
+void IfStatement::optimize(opt::Context& ctx) {
+  cond_ = cond_->optimize(ctx);
+
+  const std::optional<double> value = cond_->constant();
+  if (value) {
+    // The remaining branch always runs, just like the statements around it.
+    (*value != 0.0 ? else_ : then_).clear();
+    stmt::optimize(ctx, *value != 0.0 ? then_ : else_);
+    return;
+  }
+
+  // Either branch may run, so each starts from what is known before the statement, and what either
+  // assigns to is unknown after it.
+  const auto constants = ctx.save_constants();
+  stmt::optimize(ctx, then_);
+  ctx.restore_constants(constants);
+  stmt::optimize(ctx, else_);
+  ctx.restore_constants(constants);
+  for_each_assigned([&](expr::Expression* location) {
+    ctx.clear_constant(location->root()->binding().local);
+  });
+}
+
+bool IfStatement::live(opt::Liveness& live) {
+  opt::eliminate_dead_code(live, then_);
+  opt::eliminate_dead_code(live, else_);
+  if (then_.empty() && else_.empty()) {
+    return false;
+  }
+
+  live.use(cond_);
+  return true;
+}
+
+void IfStatement::to_glsl(output::Writer& out, const output::glsl::Options& opts) const {
+  out << output::glsl::indent{opts.indent};
+  if (const auto* const taken = taken_(); taken != nullptr) {
+    stmt::to_glsl(out, opts, *taken);
+    out << (opts.pretty ? "\n" : "");
+    return;
+  }
+
+  out << (opts.pretty ? "if (" : "if(") << output::glsl::emit{cond_, opts}
+      << (opts.pretty ? ") " : ")");
+  stmt::to_glsl(out, opts, then_);
+  if (!else_.empty()) {
+    out << (opts.pretty ? " else " : "else");
+    stmt::to_glsl(out, opts, else_);
+  }
+  out << (opts.pretty ? "\n" : "");
+}
+
+void IfStatement::to_metal(output::Writer& out, const output::metal::Options& opts) const {
+  out << output::metal::indent{opts.indent};
+  if (const auto* const taken = taken_(); taken != nullptr) {
+    stmt::to_metal(out, opts, *taken);
+    out << "\n";
+    return;
+  }
+
+  out << "if (" << output::metal::emit{cond_, opts} << ") ";
+  stmt::to_metal(out, opts, then_);
+  if (!else_.empty()) {
+    out << " else ";
+    stmt::to_metal(out, opts, else_);
+  }
+  out << "\n";
+}
+
+void IfStatement::to_spirv(const output::spirv::Options opts) const {
+  if (const auto* const taken = taken_(); taken != nullptr) {
+    stmt::to_spirv(opts, *taken);
+    return;
+  }
+
+  const output::spirv::Value cond        = cond_->to_spirv(opts);
+  const uint32_t             then_label  = opts.builder.make_id();
+  const uint32_t             merge_label = opts.builder.make_id();
+  const uint32_t             else_label  = else_.empty() ? merge_label : opts.builder.make_id();
+
+  opts.emit_void(spv::Op::OpSelectionMerge,
+                 {merge_label, static_cast<uint32_t>(spv::SelectionControlMask::MaskNone)});
+  opts.emit_void(spv::Op::OpBranchConditional, {cond.id, then_label, else_label});
+  opts.function.terminated = true;
+
+  output::spirv::begin_block(opts, then_label);
+  stmt::to_spirv(opts, then_);
+  output::spirv::branch(opts, merge_label);
+
+  if (!else_.empty()) {
+    output::spirv::begin_block(opts, else_label);
+    stmt::to_spirv(opts, else_);
+    output::spirv::branch(opts, merge_label);
+  }
+
+  output::spirv::begin_block(opts, merge_label);
+}
+
+const std::vector<Statement*>* IfStatement::taken_() const {
+  const std::optional<double> value = cond_->constant();
+  if (!value) {
+    return nullptr;
+  }
+  return *value != 0.0 ? &then_ : &else_;
+}
+
+}  // namespace crystal::compiler::ast::stmt
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "crystal/compiler/ast/expr/expression.hpp"
+#include "crystal/compiler/ast/stmt/statement.hpp"
+
+namespace crystal::compiler::ast::stmt {
+
+class IfStatement : public Statement {
+  expr::Expression*       cond_;
+  std::vector<Statement*> then_;
+  std::vector<Statement*> else_;  // Empty without an `else`.
+
+public:
+  IfStatement(expr::Expression* cond, std::vector<Statement*>&& then_body,
+              std::vector<Statement*>&& else_body = {})
+      : cond_(cond), then_(std::move(then_body)), else_(std::move(else_body)) {}
+
+  [[nodiscard]] virtual Statement* clone(Arena& arena) const override {
+    return arena.make<IfStatement>(cond_->clone(arena), stmt::clone(arena, then_),
+                                   stmt::clone(arena, else_));
+  }
+
+  virtual void typecheck(check::Context& ctx) override;
+
+  // Drops the branch that is never taken when the condition is a constant.
+  virtual void optimize(opt::Context& ctx) override;
+
+  virtual void for_each_expression(const std::function<void(expr::Expression*&)>& fn) override {
+    fn(cond_);
+  }
+
+  virtual void for_each_body(const std::function<void(std::vector<Statement*>&)>& fn) override {
+    fn(then_);
+    fn(else_);
+  }
+
+  [[nodiscard]] virtual bool live(opt::Liveness& live) override;
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override;
+
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override;
+
+  virtual void to_spirv(const output::spirv::Options opts) const override;
+
+private:
+  // The branch that is always taken, if the condition is a constant.
+  [[nodiscard]] const std::vector<Statement*>* taken_() const;
+};
+
+}  // namespace crystal::compiler::ast::stmt
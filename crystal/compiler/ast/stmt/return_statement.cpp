@@ -1,72 +1,202 @@
 #include "crystal/compiler/ast/stmt/return_statement.hpp"
 
+#include <string_view>
+#include <vector>
+
 #include "crystal/compiler/ast/decl/fragment_declaration.hpp"
 #include "crystal/compiler/ast/decl/vertex_declaration.hpp"
 #include "crystal/compiler/ast/expr/expression.hpp"
 #include "crystal/compiler/ast/output/glsl.hpp"
-#include "crystal/compiler/ast/output/print.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
 #include "crystal/compiler/ast/stmt/statement.hpp"
 #include "crystal/compiler/ast/type/struct_type.hpp"
 #include "util/memory/ref_count.hpp"
 
 namespace crystal::compiler::ast::stmt {
 
-output::PrintLambda ReturnStatement::to_glsl(const output::glsl::Options opts) const {
-  if (opts.vertex != nullptr) {
-    return output::PrintLambda{[=](std::ostream& out) {
-      out << output::glsl::indent{opts.indent} << opts.vertex->return_type()->name() << " _"
-          << (opts.pretty ? " = " : "=") << expr_->to_glsl(opts) << (opts.pretty ? ";\n" : ";");
-
-      const util::memory::Ref<type::StructType> return_struct_type = opts.vertex->return_type();
-      for (auto& prop : return_struct_type->properties()) {
-        if (prop.index < 0) {
-          // Skip properties that don't have an output index.
-          continue;
-        }
+void ReturnStatement::typecheck(check::Context& ctx) {
+  if (expr_ == nullptr || ctx.return_type() == nullptr) {
+    if (expr_ != nullptr) {
+      util::msg::fatal("cannot return a value from a compute function");
+    }
+    if (ctx.return_type() != nullptr) {
+      util::msg::fatal("a function returning [", ctx.return_type()->name(),
+                       "] must return a value");
+    }
+    return;
+  }
 
-        out << output::glsl::indent{opts.indent}
-            << output::glsl::varying_name{static_cast<uint32_t>(prop.index), prop.name}
-            << (opts.pretty ? " = " : "=") << "_." << prop.name << (opts.pretty ? ";\n" : ";");
+  if (!check::assignable(ctx.return_type(), expr_->typecheck(ctx))) {
+    util::msg::fatal("cannot return a value of type [", expr_->type()->name(),
+                     "] from a function returning [", ctx.return_type()->name(), "]");
+  }
+}
 
-        if (prop.index == 0) {
-          // The zero output for the vertex function must be the vertex position.
-          out << output::glsl::indent{opts.indent} << "gl_Position" << (opts.pretty ? " = " : "=")
-              << "_." << prop.name << (opts.pretty ? ";\n" : ";");
+void ReturnStatement::optimize(opt::Context& ctx) {
+  if (expr_ != nullptr) {
+    expr_ = expr_->optimize(ctx);
+  }
+}
+
+bool ReturnStatement::live(opt::Liveness& live) {
+  if (expr_ != nullptr) {
+    live.use_result(expr_);
+  }
+  return true;
+}
+
+void ReturnStatement::to_glsl(output::Writer& out, const output::glsl::Options& opts) const {
+  if (expr_ == nullptr) {
+    out << output::glsl::indent{opts.indent} << (opts.pretty ? "return;\n" : "return;");
+    return;
+  }
+
+  if (opts.vertex != nullptr) {
+    out << output::glsl::indent{opts.indent}
+        << output::glsl::type_name{opts.vertex->return_type(), opts.names} << " _"
+        << (opts.pretty ? " = " : "=") << output::glsl::emit{expr_, opts}
+        << (opts.pretty ? ";\n" : ";");
+
+    for (const auto& interpolator : opts.vertex->varyings().interpolators) {
+      out << output::glsl::indent{opts.indent}
+          << output::glsl::varying_name{interpolator.location, interpolator.name(), opts.names}
+          << (opts.pretty ? " = " : "=");
+      if (interpolator.packed()) {
+        out << interpolator.type->name() << "(";
+        for (size_t i = 0; i < interpolator.varyings.size(); ++i) {
+          out << (i == 0 ? "" : (opts.pretty ? ", " : ",")) << "_."
+              << output::glsl::member_name{interpolator.varyings[i].name, opts.names};
         }
+        out << ")";
+      } else {
+        out << "_." << output::glsl::member_name{interpolator.varyings[0].name, opts.names};
       }
+      out << (opts.pretty ? ";\n" : ";");
 
-      out << output::glsl::indent{opts.indent} << (opts.pretty ? "return;\n" : "return;");
-    }};
+      if (interpolator.location == 0) {
+        // The zero output for the vertex function must be the vertex position.
+        out << output::glsl::indent{opts.indent} << "gl_Position" << (opts.pretty ? " = " : "=")
+            << "_." << output::glsl::member_name{interpolator.varyings[0].name, opts.names}
+            << (opts.pretty ? ";\n" : ";");
+      }
+    }
+
+    out << output::glsl::indent{opts.indent} << (opts.pretty ? "return;\n" : "return;");
+    return;
   }
 
   if (opts.fragment != nullptr) {
-    return output::PrintLambda{[=](std::ostream& out) {
-      out << output::glsl::indent{opts.indent} << opts.fragment->return_type()->name()
-          << (opts.pretty ? " _ = " : " _=") << expr_->to_glsl(opts) << (opts.pretty ? ";\n" : ";");
-
-      const util::memory::Ref<type::StructType> return_struct_type = opts.fragment->return_type();
-      for (auto& prop : return_struct_type->properties()) {
-        if (prop.index < 0) {
-          // Skip properties that don't have an output index.
-          continue;
-        }
+    out << output::glsl::indent{opts.indent}
+        << output::glsl::type_name{opts.fragment->return_type(), opts.names}
+        << (opts.pretty ? " _ = " : " _=") << output::glsl::emit{expr_, opts}
+        << (opts.pretty ? ";\n" : ";");
 
-        out << output::glsl::indent{opts.indent}
-            << output::glsl::fragment_output_name{static_cast<uint32_t>(prop.index), prop.name}
-            << (opts.pretty ? " = " : "=") << "_." << prop.name << (opts.pretty ? ";\n" : ";");
+    const util::memory::Ref<type::StructType> return_struct_type = opts.fragment->return_type();
+    for (auto& prop : return_struct_type->properties()) {
+      if (prop.index < 0) {
+        // Skip properties that don't have an output index.
+        continue;
       }
 
-      out << output::glsl::indent{opts.indent} << (opts.pretty ? "return;\n" : "return;");
-    }};
+      out << output::glsl::indent{opts.indent}
+          << output::glsl::fragment_output_name{static_cast<uint32_t>(prop.index), prop.name,
+                                                opts.names}
+          << (opts.pretty ? " = " : "=") << "_." << output::glsl::member_name{prop.name, opts.names}
+          << (opts.pretty ? ";\n" : ";");
+    }
+
+    out << output::glsl::indent{opts.indent} << (opts.pretty ? "return;\n" : "return;");
   }
+}
 
-  return output::PrintLambda{[=](std::ostream& out) {}};
+void ReturnStatement::to_metal(output::Writer& out, const output::metal::Options& opts) const {
+  if (expr_ == nullptr) {
+    out << output::metal::indent{opts.indent} << "return;\n";
+    return;
+  }
+
+  if (opts.vertex == nullptr || opts.vertex->varyings().direct) {
+    out << output::metal::indent{opts.indent} << "return " << output::metal::emit{expr_, opts}
+        << ";\n";
+    return;
+  }
+
+  // The return struct is converted into the interpolators that are passed to the fragment
+  // function.
+  const std::string_view name = opts.vertex->name();
+  out << output::metal::indent{opts.indent} << opts.vertex->return_type()->metal_name() << " _ = "
+      << output::metal::emit{expr_, opts} << ";\n";
+  out << output::metal::indent{opts.indent} << "return " << name.substr(0, name.size() - 5)
+      << "_v{";
+  for (size_t i = 0; i < opts.vertex->varyings().interpolators.size(); ++i) {
+    const auto& interpolator = opts.vertex->varyings().interpolators[i];
+    out << (i == 0 ? "" : ", ");
+    if (interpolator.packed()) {
+      out << interpolator.type->metal_name() << "(";
+      for (size_t j = 0; j < interpolator.varyings.size(); ++j) {
+        out << (j == 0 ? "_." : ", _.") << interpolator.varyings[j].name;
+      }
+      out << ")";
+    } else {
+      out << "_." << interpolator.varyings[0].name;
+    }
+  }
+  out << "};\n";
 }
 
-output::PrintLambda ReturnStatement::to_metal(const output::metal::Options opts) const {
-  return output::PrintLambda{[=](std::ostream& out) {
-    out << output::metal::indent{opts.indent} << "return " << expr_->to_metal(opts) << ";\n";
-  }};
+void ReturnStatement::to_spirv(const output::spirv::Options opts) const {
+  if (expr_ == nullptr) {
+    opts.emit_void(spv::Op::OpReturn, {});
+    opts.function.terminated = true;
+    return;
+  }
+
+  const util::memory::Ref<type::StructType> return_struct_type =
+      opts.vertex != nullptr ? opts.vertex->return_type() : opts.fragment->return_type();
+  const output::spirv::Value value = output::spirv::convert(
+      opts, expr_->to_spirv(opts), output::spirv::ValueType::from(return_struct_type));
+
+  if (opts.vertex != nullptr) {
+    for (const auto& interpolator : opts.vertex->varyings().interpolators) {
+      std::vector<uint32_t> members;
+      for (const auto& varying : interpolator.varyings) {
+        members.push_back(output::spirv::extract(opts, value, varying.name).id);
+      }
+
+      const uint32_t result =
+          interpolator.packed()
+              ? opts.emit(spv::Op::OpCompositeConstruct,
+                          output::spirv::ValueType::from(interpolator.type), members)
+              : members[0];
+      opts.emit_void(spv::Op::OpStore,
+                     {opts.function.outputs.find(interpolator.location)->second, result});
+
+      if (interpolator.location == 0) {
+        // The zero output for the vertex function must be the vertex position.
+        opts.emit_void(spv::Op::OpStore, {opts.function.position, members[0]});
+      }
+    }
+
+    opts.emit_void(spv::Op::OpReturn, {});
+    opts.function.terminated = true;
+    return;
+  }
+
+  const auto& properties = return_struct_type->properties();
+  for (uint32_t i = 0; i < properties.size(); ++i) {
+    const auto& prop = properties[i];
+    if (prop.index < 0) {
+      // Skip properties that don't have an output index.
+      continue;
+    }
+
+    const output::spirv::ValueType type = output::spirv::ValueType::from(prop.type);
+    const uint32_t member = opts.emit(spv::Op::OpCompositeExtract, type, {value.id, i});
+    opts.emit_void(spv::Op::OpStore, {opts.function.outputs.find(prop.index)->second, member});
+  }
+
+  opts.emit_void(spv::Op::OpReturn, {});
+  opts.function.terminated = true;
 }
 
 }  // namespace crystal::compiler::ast::stmt
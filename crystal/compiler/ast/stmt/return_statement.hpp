@@ -2,19 +2,38 @@
 
 #include "crystal/compiler/ast/expr/expression.hpp"
 #include "crystal/compiler/ast/stmt/statement.hpp"
-#include "util/memory/ref_count.hpp"
 
 namespace crystal::compiler::ast::stmt {
 
+// Returns from the function. Only a `compute` function, which has no result, returns without a
+// value, in which case `expr_` is null.
 class ReturnStatement : public Statement {
-  util::memory::Ref<expr::Expression> expr_;
+  expr::Expression* expr_;
 
 public:
-  ReturnStatement(util::memory::Ref<expr::Expression> expr) : expr_(expr) {}
+  ReturnStatement(expr::Expression* expr) : expr_(expr) {}
 
-  virtual output::PrintLambda to_glsl(const output::glsl::Options opts) const override;
+  [[nodiscard]] virtual Statement* clone(Arena& arena) const override {
+    return arena.make<ReturnStatement>(expr_ != nullptr ? expr_->clone(arena) : nullptr);
+  }
 
-  virtual output::PrintLambda to_metal(const output::metal::Options opts) const override;
+  virtual void typecheck(check::Context& ctx) override;
+
+  virtual void optimize(opt::Context& ctx) override;
+
+  virtual void for_each_expression(const std::function<void(expr::Expression*&)>& fn) override {
+    if (expr_ != nullptr) {
+      fn(expr_);
+    }
+  }
+
+  [[nodiscard]] virtual bool live(opt::Liveness& live) override;
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override;
+
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override;
+
+  virtual void to_spirv(const output::spirv::Options opts) const override;
 };
 
 }  // namespace crystal::compiler::ast::stmt
@@ -0,0 +1,138 @@
+#include "crystal/compiler/ast/stmt/statement.hpp"
+
+#include <functional>
+
+#include "crystal/compiler/ast/expr/bool_expression.hpp"
+#include "crystal/compiler/ast/expr/expression.hpp"
+#include "crystal/compiler/ast/expr/identifier_expression.hpp"
+#include "crystal/compiler/ast/stmt/variable_statement.hpp"
+#include "crystal/compiler/ast/type/type_set.hpp"
+
+namespace crystal::compiler::ast::stmt {
+
+namespace {
+
+void add_types(type::TypeSet& types, expr::Expression* expr) {
+  // Locations have the type of a local or an input, which is added where it's declared.
+  if (!expr->addressable()) {
+    types.add(expr->type());
+  }
+  expr->for_each_operand([&](expr::Expression*& operand) { add_types(types, operand); });
+}
+
+// Returns the expression that replaces a reference to `name`, or nullptr to keep it.
+using Replacement = std::function<expr::Expression*(Symbol name)>;
+
+void replace(expr::Expression*& expr, const Replacement& replacement) {
+  if (expr->is_identifier()) {
+    expr::Expression* const value =
+        replacement(static_cast<expr::IdentifierExpression*>(expr)->name());
+    if (value != nullptr) {
+      expr = value;
+    }
+    return;
+  }
+  expr->for_each_operand([&](expr::Expression*& operand) { replace(operand, replacement); });
+}
+
+void replace(std::vector<Statement*>& body, const Replacement& replacement) {
+  for (const auto& stmt : body) {
+    stmt->for_each_expression([&](expr::Expression*& expr) { replace(expr, replacement); });
+    stmt->for_each_body([&](std::vector<Statement*>& block) { replace(block, replacement); });
+  }
+}
+
+}  // namespace
+
+void Statement::for_each_assigned(const std::function<void(expr::Expression*)>& fn) {
+  if (assigned() != nullptr) {
+    fn(assigned());
+  }
+  for_each_body([&](std::vector<Statement*>& body) {
+    for (const auto& stmt : body) {
+      stmt->for_each_assigned(fn);
+    }
+  });
+}
+
+void add_types(type::TypeSet& types, const std::vector<Statement*>& body) {
+  for (const auto& stmt : body) {
+    if (stmt->declared() != nullptr) {
+      types.add(stmt->declared()->type());
+    }
+    stmt->for_each_expression([&](expr::Expression*& expr) { add_types(types, expr); });
+    stmt->for_each_body([&](std::vector<Statement*>& block) { add_types(types, block); });
+  }
+}
+
+std::vector<Statement*> clone(Arena& arena, const std::vector<Statement*>& body) {
+  std::vector<Statement*> copy;
+  copy.reserve(body.size());
+  for (const auto& stmt : body) {
+    copy.push_back(stmt->clone(arena));
+  }
+  return copy;
+}
+
+std::vector<Statement*> specialize(Arena& arena, const std::vector<Statement*>& body,
+                                   const absl::flat_hash_map<Symbol, bool>& values) {
+  std::vector<Statement*> copy = clone(arena, body);
+  replace(copy, [&](const Symbol name) -> expr::Expression* {
+    const auto it = values.find(name);
+    return it != values.end() ? arena.make<expr::BoolExpression>(it->second) : nullptr;
+  });
+  return copy;
+}
+
+std::vector<Statement*> substitute(Arena& arena, const std::vector<Statement*>& body,
+                                   const Symbol name, const expr::Expression& value) {
+  std::vector<Statement*> copy = clone(arena, body);
+  replace(copy, [&](const Symbol other) -> expr::Expression* {
+    return other == name ? value.clone(arena) : nullptr;
+  });
+  return copy;
+}
+
+void typecheck(check::Context& ctx, const std::vector<Statement*>& body) {
+  ctx.open_block();
+  for (const auto& stmt : body) {
+    stmt->typecheck(ctx);
+  }
+  ctx.close_block();
+}
+
+void optimize(opt::Context& ctx, std::vector<Statement*>& body) {
+  for (const auto& stmt : body) {
+    stmt->optimize(ctx);
+  }
+  opt::eliminate_common_subexpressions(ctx, body);
+}
+
+void to_glsl(output::Writer& out, const output::glsl::Options& opts,
+             const std::vector<Statement*>& body) {
+  out << (opts.pretty ? "{\n" : "{");
+  const auto block_opts = opts.incr_indent();
+  for (const auto& stmt : body) {
+    stmt->to_glsl(out, block_opts);
+  }
+  out << output::glsl::indent{opts.indent} << "}";
+}
+
+void to_metal(output::Writer& out, const output::metal::Options& opts,
+              const std::vector<Statement*>& body) {
+  out << "{\n";
+  const auto block_opts = opts.incr_indent();
+  for (const auto& stmt : body) {
+    stmt->to_metal(out, block_opts);
+  }
+  out << output::metal::indent{opts.indent} << "}";
+}
+
+void to_spirv(const output::spirv::Options opts, const std::vector<Statement*>& body) {
+  for (const auto& stmt : body) {
+    output::spirv::ensure_block(opts);
+    stmt->to_spirv(opts);
+  }
+}
+
+}  // namespace crystal::compiler::ast::stmt
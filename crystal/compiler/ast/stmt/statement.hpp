@@ -1,8 +1,16 @@
 #pragma once
 
+#include <functional>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "crystal/compiler/ast/arena.hpp"
+#include "crystal/compiler/ast/check/check.hpp"
+#include "crystal/compiler/ast/opt/opt.hpp"
 #include "crystal/compiler/ast/output/glsl.hpp"
 #include "crystal/compiler/ast/output/metal.hpp"
-#include "crystal/compiler/ast/output/print.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
+#include "crystal/compiler/ast/symbol.hpp"
 
 namespace crystal::compiler::ast::decl {
 
@@ -11,15 +19,96 @@ class FragmentDeclaration;
 
 }  // namespace crystal::compiler::ast::decl
 
+namespace crystal::compiler::ast::expr {
+
+class Expression;
+class IdentifierExpression;
+
+}  // namespace crystal::compiler::ast::expr
+
+namespace crystal::compiler::ast::type {
+
+class TypeSet;
+
+}  // namespace crystal::compiler::ast::type
+
 namespace crystal::compiler::ast::stmt {
 
+class VariableStatement;
+
 class Statement {
 public:
   virtual ~Statement() = default;
 
-  virtual output::PrintLambda to_glsl(const output::glsl::Options opts) const = 0;
+  // Copies the statement, and every expression in it, into `arena`. The copy is yet to be type
+  // checked.
+  [[nodiscard]] virtual Statement* clone(Arena& arena) const = 0;
+
+  // Resolves the types of every expression in the statement, and checks that they agree.
+  virtual void typecheck(check::Context& ctx) = 0;
+
+  // Simplifies every expression in the statement. Requires `typecheck`.
+  virtual void optimize(opt::Context& ctx) = 0;
+
+  // Calls `fn` with each expression that the statement evaluates, in order. It may replace them
+  // with expressions of the same value.
+  virtual void for_each_expression(const std::function<void(expr::Expression*&)>& fn) = 0;
+
+  // Whether the statement is still needed, given what is read after it. If it is, marks what it
+  // reads as needed too.
+  [[nodiscard]] virtual bool live(opt::Liveness& live) = 0;
+
+  // The location that the statement stores to, if any.
+  [[nodiscard]] virtual expr::Expression* assigned() const { return nullptr; }
+
+  // Calls `fn` with each block of statements that the statement contains, such as the branches of
+  // an `if`.
+  virtual void for_each_body(const std::function<void(std::vector<Statement*>&)>& fn) {}
 
-  virtual output::PrintLambda to_metal(const output::metal::Options opts) const = 0;
+  // Calls `fn` with every location that the statement stores to, including from inside of its
+  // blocks.
+  void for_each_assigned(const std::function<void(expr::Expression*)>& fn);
+
+  // The local that the statement declares, if any.
+  [[nodiscard]] virtual const VariableStatement* declared() const { return nullptr; }
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const = 0;
+
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const = 0;
+
+  virtual void to_spirv(const output::spirv::Options opts) const = 0;
 };
 
+// Adds the types of the locals that the body declares, and of the values that it constructs.
+void add_types(type::TypeSet& types, const std::vector<Statement*>& body);
+
+// Copies the body into `arena`. The copy is yet to be type checked.
+[[nodiscard]] std::vector<Statement*> clone(Arena& arena, const std::vector<Statement*>& body);
+
+// Copies the body into `arena`, replacing every reference to one of the names in `values` with a
+// bool literal. The copy is yet to be type checked.
+[[nodiscard]] std::vector<Statement*> specialize(Arena& arena, const std::vector<Statement*>& body,
+                                                 const absl::flat_hash_map<Symbol, bool>& values);
+
+// Copies the body into `arena`, replacing every reference to `name` with a copy of `value`. The
+// copy is yet to be type checked.
+[[nodiscard]] std::vector<Statement*> substitute(Arena& arena, const std::vector<Statement*>& body,
+                                                 Symbol name, const expr::Expression& value);
+
+// The following handle a block nested in a function body, whose locals are only visible inside of
+// it.
+
+void typecheck(check::Context& ctx, const std::vector<Statement*>& body);
+
+// Also computes the repeated subexpressions of the block once.
+void optimize(opt::Context& ctx, std::vector<Statement*>& body);
+
+// Emit the block between braces, with its statements indented one level deeper than `opts`.
+void to_glsl(output::Writer& out, const output::glsl::Options& opts,
+             const std::vector<Statement*>& body);
+void to_metal(output::Writer& out, const output::metal::Options& opts,
+              const std::vector<Statement*>& body);
+
+void to_spirv(const output::spirv::Options opts, const std::vector<Statement*>& body);
+
 }  // namespace crystal::compiler::ast::stmt
@@ -1,51 +1,86 @@
 #include "crystal/compiler/ast/stmt/variable_statement.hpp"
 
+#include <optional>
+
 #include "crystal/compiler/ast/decl/vertex_declaration.hpp"
+#include "crystal/compiler/ast/output/spirv.hpp"
+#include "crystal/compiler/ast/type/struct_type.hpp"
+#include "util/msg/msg.hpp"
 
 namespace crystal::compiler::ast::stmt {
 
-output::PrintLambda VariableStatement::to_glsl(const output::glsl::Options opts) const {
-  if (expr_ != nullptr) {
-    return output::PrintLambda{[=](std::ostream& out) {
-      out << output::glsl::indent{opts.indent} << type_->glsl_name() << " "
-          << output::glsl::mangle_name{name_} << (opts.pretty ? " = " : "=") << expr_->to_glsl(opts)
-          << (opts.pretty ? ";\n" : ";");
-    }};
-  } else {
-    return output::PrintLambda{[=](std::ostream& out) {
-      out << output::glsl::indent{opts.indent} << type_->glsl_name() << " "
-          << output::glsl::mangle_name{name_} << (opts.pretty ? ";\n" : ";");
-    }};
+void VariableStatement::typecheck(check::Context& ctx) {
+  if (type::runtime_sized(type_)) {
+    util::msg::fatal("local [", name_, "] can not be of type [", type_->name(),
+                     "], as it ends in a runtime sized array");
+  }
+  if (expr_ != nullptr && !check::assignable(type_, expr_->typecheck(ctx))) {
+    util::msg::fatal("cannot initialize [", name_, "] of type [", type_->name(),
+                     "] with a value of type [", expr_->type()->name(), "]");
   }
+
+  // Declared after the initializer is checked, so that it can't refer to itself.
+  ctx.declare(name_, check::Binding{check::BindingKind::Local, type_, -1, this});
 }
 
-output::PrintLambda VariableStatement::to_metal(const output::metal::Options opts) const {
-  if (opts.vertex != nullptr && type_ == opts.vertex->return_type()) {
-    std::string short_name = opts.vertex->name().substr(0, opts.vertex->name().size() - 5);
-    if (expr_ != nullptr) {
-      return output::PrintLambda{[=](std::ostream& out) {
-        out << output::metal::indent{opts.indent} << short_name << "_v "
-            << output::metal::mangle_name{name_} << " = " << expr_->to_metal(opts) << ";\n";
-      }};
-    } else {
-      return output::PrintLambda{[=](std::ostream& out) {
-        out << output::metal::indent{opts.indent} << short_name << "_v "
-            << output::metal::mangle_name{name_} << ";\n";
-      }};
-    }
+void VariableStatement::optimize(opt::Context& ctx) {
+  if (expr_ == nullptr) {
+    return;
+  }
+
+  expr_ = expr_->optimize(ctx);
+
+  // Uses of the local are replaced with its value, for as long as it isn't assigned to.
+  const std::optional<double> value = expr_->constant();
+  if (value) {
+    ctx.set_constant(this, *value);
+  }
+}
+
+bool VariableStatement::live(opt::Liveness& live) {
+  if (!live.needed(name_)) {
+    return false;
   }
 
   if (expr_ != nullptr) {
-    return output::PrintLambda{[=](std::ostream& out) {
-      out << output::metal::indent{opts.indent} << type_->metal_name() << " "
-          << output::metal::mangle_name{name_} << " = " << expr_->to_metal(opts) << ";\n";
-    }};
+    live.use(expr_);
+  }
+  return true;
+}
+
+void VariableStatement::to_glsl(output::Writer& out, const output::glsl::Options& opts) const {
+  out << output::glsl::indent{opts.indent} << output::glsl::type_name{type_, opts.names} << " "
+      << output::glsl::mangle_name{name_, opts.names};
+  if (expr_ != nullptr) {
+    out << (opts.pretty ? " = " : "=") << output::glsl::emit{expr_, opts};
+  }
+  out << (opts.pretty ? ";\n" : ";");
+}
+
+void VariableStatement::to_metal(output::Writer& out, const output::metal::Options& opts) const {
+  out << output::metal::indent{opts.indent};
+  if (opts.vertex != nullptr && opts.vertex->varyings().direct &&
+      type_ == opts.vertex->return_type()) {
+    const std::string_view name = opts.vertex->name();
+    out << name.substr(0, name.size() - 5) << "_v ";
   } else {
-    return output::PrintLambda{[=](std::ostream& out) {
-      out << output::metal::indent{opts.indent} << type_->metal_name() << " "
-          << output::metal::mangle_name{name_} << ";\n";
-    }};
+    out << type_->metal_name() << " ";
+  }
+
+  out << output::metal::mangle_name{name_};
+  if (expr_ != nullptr) {
+    out << " = " << output::metal::emit{expr_, opts};
+  }
+  out << ";\n";
+}
+
+void VariableStatement::to_spirv(const output::spirv::Options opts) const {
+  const output::spirv::Pointer var = output::spirv::local(
+      opts, output::spirv::ValueType::from(type_), output::spirv::mangle_name(name_));
+  if (expr_ != nullptr) {
+    output::spirv::store(opts, var, expr_->to_spirv(opts));
   }
+  opts.function.scope.insert_or_assign(std::string(name_.str()), var);
 }
 
 }  // namespace crystal::compiler::ast::stmt
@@ -1,32 +1,51 @@
 #pragma once
 
-#include <string>
-#include <string_view>
-
 #include "crystal/compiler/ast/expr/expression.hpp"
 #include "crystal/compiler/ast/output/glsl.hpp"
-#include "crystal/compiler/ast/output/print.hpp"
 #include "crystal/compiler/ast/stmt/statement.hpp"
+#include "crystal/compiler/ast/symbol.hpp"
 #include "crystal/compiler/ast/type/type.hpp"
 #include "util/memory/ref_count.hpp"
 
 namespace crystal::compiler::ast::stmt {
 
 class VariableStatement : public Statement {
-  std::string                         name_;
-  util::memory::Ref<type::Type>       type_;
-  util::memory::Ref<expr::Expression> expr_;
+  Symbol                        name_;
+  util::memory::Ref<type::Type> type_;
+  expr::Expression*             expr_ = nullptr;
 
 public:
-  VariableStatement(std::string_view name, util::memory::Ref<type::Type> type)
-      : name_(name), type_(type) {}
-  VariableStatement(std::string_view name, util::memory::Ref<type::Type> type,
-                    util::memory::Ref<expr::Expression> expr)
+  VariableStatement(Symbol name, util::memory::Ref<type::Type> type) : name_(name), type_(type) {}
+  VariableStatement(Symbol name, util::memory::Ref<type::Type> type, expr::Expression* expr)
       : name_(name), type_(type), expr_(expr) {}
 
-  virtual output::PrintLambda to_glsl(const output::glsl::Options opts) const override;
+  [[nodiscard]] virtual Statement* clone(Arena& arena) const override {
+    return arena.make<VariableStatement>(name_, type_,
+                                         expr_ != nullptr ? expr_->clone(arena) : nullptr);
+  }
+
+  [[nodiscard]] Symbol                               name() const { return name_; }
+  [[nodiscard]] const util::memory::Ref<type::Type>& type() const { return type_; }
+
+  virtual void typecheck(check::Context& ctx) override;
+
+  virtual void optimize(opt::Context& ctx) override;
+
+  virtual void for_each_expression(const std::function<void(expr::Expression*&)>& fn) override {
+    if (expr_ != nullptr) {
+      fn(expr_);
+    }
+  }
+
+  [[nodiscard]] virtual bool live(opt::Liveness& live) override;
+
+  [[nodiscard]] virtual const VariableStatement* declared() const override { return this; }
+
+  virtual void to_glsl(output::Writer& out, const output::glsl::Options& opts) const override;
+
+  virtual void to_metal(output::Writer& out, const output::metal::Options& opts) const override;
 
-  virtual output::PrintLambda to_metal(const output::metal::Options opts) const override;
+  virtual void to_spirv(const output::spirv::Options opts) const override;
 };
 
 }  // namespace crystal::compiler::ast::stmt
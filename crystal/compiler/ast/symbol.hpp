@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "crystal/compiler/ast/arena.hpp"
+
+namespace crystal::compiler::ast {
+
+// An interned identifier. Symbols from the same interner compare and hash by id alone, while still
+// carrying their text so that they can be output without going back to the interner.
+class Symbol {
+  uint32_t         id_ = 0;
+  std::string_view str_;
+
+public:
+  constexpr Symbol() = default;
+  constexpr Symbol(const uint32_t id, const std::string_view str) : id_(id), str_(str) {}
+
+  [[nodiscard]] constexpr uint32_t         id() const { return id_; }
+  [[nodiscard]] constexpr std::string_view str() const { return str_; }
+  [[nodiscard]] constexpr size_t           size() const { return str_.size(); }
+
+  [[nodiscard]] constexpr operator std::string_view() const { return str_; }
+
+  [[nodiscard]] constexpr bool operator==(const Symbol& other) const { return id_ == other.id_; }
+  [[nodiscard]] constexpr bool operator!=(const Symbol& other) const { return id_ != other.id_; }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const Symbol& symbol) {
+    return H::combine(std::move(h), symbol.id_);
+  }
+};
+
+inline std::ostream& operator<<(std::ostream& out, const Symbol& symbol) {
+  return out << symbol.str();
+}
+
+// Maps identifier text to symbols. The text of each symbol is copied into the arena once, so symbols
+// stay valid for as long as the arena does.
+class Interner {
+  absl::flat_hash_map<std::string_view, uint32_t> ids_;  // Keys point into the arena.
+
+public:
+  // Returns the symbol for `str`, creating it if it hasn't been seen before.
+  [[nodiscard]] Symbol intern(Arena& arena, const std::string_view str) {
+    const auto it = ids_.find(str);
+    if (it != ids_.end()) {
+      return Symbol(it->second, it->first);
+    }
+
+    // Ids start at one, so that a default constructed symbol never matches an interned one.
+    const uint32_t         id   = static_cast<uint32_t>(ids_.size()) + 1;
+    const std::string_view copy = arena.copy(str);
+    ids_.emplace(copy, id);
+    return Symbol(id, copy);
+  }
+
+  // Returns the symbol for `str`, if it has already been interned.
+  [[nodiscard]] std::optional<Symbol> find(const std::string_view str) const {
+    const auto it = ids_.find(str);
+    if (it != ids_.end()) {
+      return Symbol(it->second, it->first);
+    }
+    return std::nullopt;
+  }
+};
+
+}  // namespace crystal::compiler::ast
@@ -1,4 +1,6 @@
 #pragma once
 
+#include "crystal/compiler/ast/type/layout.hpp"
 #include "crystal/compiler/ast/type/struct_type.hpp"
 #include "crystal/compiler/ast/type/type.hpp"
+#include "crystal/compiler/ast/type/type_set.hpp"
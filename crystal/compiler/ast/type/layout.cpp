@@ -0,0 +1,127 @@
+#include "crystal/compiler/ast/type/layout.hpp"
+
+#include <algorithm>
+
+#include "util/msg/msg.hpp"
+
+namespace crystal::compiler::ast::type {
+
+namespace {
+
+constexpr uint32_t round_up(const uint32_t value, const uint32_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// The offset of each property, when they're laid out in the order that they're given in.
+std::vector<uint32_t> offsets(const std::vector<StructProperty>& properties, const Layout layout) {
+  std::vector<uint32_t> offsets;
+  uint32_t              offset = 0;
+  for (const auto& prop : properties) {
+    offset = round_up(offset, alignment(prop.type, layout));
+    offsets.push_back(offset);
+    if (!prop.array) {
+      offset += size(prop.type, layout);
+    }
+  }
+  return offsets;
+}
+
+}  // namespace
+
+uint32_t alignment(const Type& type, const Layout layout) {
+  switch (type.kind()) {
+    case Kind::Bool:
+    case Kind::Int:
+    case Kind::Float:
+      // A vec3 is aligned like a vec4.
+      return type.count() == 1 ? 4 : (type.count() == 2 ? 8 : 16);
+    case Kind::Matrix:
+      return 16;
+    case Kind::Struct: {
+      uint32_t alignment = layout == Layout::Std140 ? 16 : 4;
+      for (const auto& prop : static_cast<const StructType&>(type).properties()) {
+        alignment = std::max(alignment, type::alignment(prop.type, layout));
+      }
+      return alignment;
+    }
+    default:
+      util::msg::fatal("type [", type.name(), "] can not be stored in a buffer");
+      return 0;
+  }
+}
+
+uint32_t size(const Type& type, const Layout layout) {
+  switch (type.kind()) {
+    case Kind::Bool:
+    case Kind::Int:
+    case Kind::Float:
+      return 4 * type.count();
+    case Kind::Matrix:
+      return 16 * type.count();
+    case Kind::Struct:
+      return size(static_cast<const StructType&>(type).properties(), layout);
+    default:
+      util::msg::fatal("type [", type.name(), "] can not be stored in a buffer");
+      return 0;
+  }
+}
+
+std::vector<uint32_t> offsets(const StructType& type, const Layout layout) {
+  return offsets(type.properties(), layout);
+}
+
+uint32_t size(const std::vector<StructProperty>& properties, const Layout layout) {
+  uint32_t alignment = layout == Layout::Std140 ? 16 : 4;
+  uint32_t end       = 0;
+  for (const auto& prop : properties) {
+    alignment = std::max(alignment, type::alignment(prop.type, layout));
+    if (!prop.array) {
+      end = round_up(end, type::alignment(prop.type, layout)) + size(prop.type, layout);
+    }
+  }
+  return round_up(end, alignment);
+}
+
+uint32_t stride(const Type& type, const Layout layout) {
+  return round_up(size(type, layout), alignment(type, layout));
+}
+
+std::vector<StructProperty> pack(std::vector<StructProperty> properties, const Layout layout) {
+  std::vector<StructProperty> vec3s;
+  std::vector<StructProperty> vec2s;
+  std::vector<StructProperty> scalars;
+  std::vector<StructProperty> packed;
+  std::vector<StructProperty> arrays;
+  for (const auto& prop : properties) {
+    if (prop.array) {
+      arrays.push_back(prop);
+    } else if (prop.type->is_vector() && prop.type->count() == 3) {
+      vec3s.push_back(prop);
+    } else if (prop.type->is_vector() && prop.type->count() == 2) {
+      vec2s.push_back(prop);
+    } else if (prop.type->is_scalar()) {
+      scalars.push_back(prop);
+    } else {
+      packed.push_back(prop);
+    }
+  }
+
+  // Under std140, everything in `packed` so far is a multiple of 16 bytes in size.
+  auto scalar = scalars.begin();
+  for (const auto& prop : vec3s) {
+    packed.push_back(prop);
+    if (scalar != scalars.end()) {
+      packed.push_back(*scalar++);
+    }
+  }
+  packed.insert(packed.end(), vec2s.begin(), vec2s.end());
+  packed.insert(packed.end(), scalar, scalars.end());
+  packed.insert(packed.end(), arrays.begin(), arrays.end());
+
+  if (size(packed, layout) < size(properties, layout)) {
+    return packed;
+  }
+  return properties;
+}
+
+}  // namespace crystal::compiler::ast::type
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "crystal/compiler/ast/type/struct_type.hpp"
+#include "crystal/compiler/ast/type/type.hpp"
+
+namespace crystal::compiler::ast::type {
+
+// The rules by which values are laid out in buffer memory, which the generated C++ structs have to
+// match byte for byte.
+enum class Layout {
+  Std140 = 0,  // Uniform blocks.
+  Std430,      // Storage blocks, which don't round structs up to the alignment of a vec4.
+};
+
+[[nodiscard]] uint32_t alignment(const Type& type, Layout layout);
+[[nodiscard]] uint32_t size(const Type& type, Layout layout);
+
+// The offset of each property of the struct, in order.
+[[nodiscard]] std::vector<uint32_t> offsets(const StructType& type, Layout layout);
+
+// The size of a struct with the given properties, in the order that they're given in. A runtime
+// sized array adds nothing but its alignment, so this is the size of the struct without elements.
+[[nodiscard]] uint32_t size(const std::vector<StructProperty>& properties, Layout layout);
+
+// The distance between the elements of a runtime sized array of the type.
+[[nodiscard]] uint32_t stride(const Type& type, Layout layout);
+
+// Reorders the properties to minimize the padding between them. Each vec3 is followed by a scalar
+// to fill its last 4 bytes, and the vec2s and the rest of the scalars are moved to the end, ahead
+// of a runtime sized array. Keeps the declared order if that is already as small.
+[[nodiscard]] std::vector<StructProperty> pack(std::vector<StructProperty> properties,
+                                               Layout                      layout);
+
+}  // namespace crystal::compiler::ast::type
@@ -0,0 +1,26 @@
+#include "crystal/compiler/ast/type/struct_type.hpp"
+
+#include <utility>
+
+#include "util/msg/msg.hpp"
+
+namespace crystal::compiler::ast::type {
+
+void add_property(std::vector<StructProperty>& properties, StructProperty prop) {
+  if (!properties.empty() && properties.back().array) {
+    util::msg::fatal("runtime sized array [", properties.back().name,
+                     "] must be the last property");
+  }
+  if (runtime_sized(prop.type)) {
+    util::msg::fatal("type [", prop.type->name(), "] of property [", prop.name,
+                     "] ends in a runtime sized array, which only a storage buffer can hold");
+  }
+  if (prop.array && prop.type->kind() != Kind::Struct && prop.type->kind() != Kind::Int &&
+      prop.type->kind() != Kind::Float && prop.type->kind() != Kind::Matrix) {
+    util::msg::fatal("runtime sized array [", prop.name, "] can not hold [", prop.type->name(),
+                     "]");
+  }
+  properties.push_back(std::move(prop));
+}
+
+}  // namespace crystal::compiler::ast::type
@@ -14,16 +14,26 @@ struct StructProperty {
   std::string             name;
   util::memory::Ref<Type> type;
   int32_t                 index;
+  bool                    array = false;  // A runtime sized array of `type`, eg: `T name[];`.
 
   StructProperty(std::string_view name, util::memory::Ref<Type> type)
       : name(name), type(type), index(-1) {}
 
   StructProperty(std::string_view name, util::memory::Ref<Type> type, int32_t index)
       : name(name), type(type), index(index) {}
+
+  // An array whose length is only known from the size of the buffer that holds it.
+  [[nodiscard]] static StructProperty runtime_array(std::string_view name,
+                                                    util::memory::Ref<Type> type) {
+    StructProperty prop(name, type);
+    prop.array = true;
+    return prop;
+  }
 };
 
 class StructType : public Type {
   std::vector<StructProperty> properties_;
+  bool                        packed_ = false;  // Whether the properties were reordered.
 
 public:
   StructType(std::string_view name, bool builtin) : Type(name, builtin) {}
@@ -33,7 +43,25 @@ public:
 
   virtual ~StructType() = default;
 
+  void set_packed() { packed_ = true; }
+
   [[nodiscard]] const std::vector<StructProperty>& properties() const { return properties_; }
+  [[nodiscard]] bool                               packed() const { return packed_; }
+
+  // Whether the last property is a runtime sized array, which only a storage buffer can hold.
+  [[nodiscard]] bool runtime_sized() const {
+    return !properties_.empty() && properties_.back().array;
+  }
 };
 
+// Whether values of the type can only live in a storage buffer.
+[[nodiscard]] inline bool runtime_sized(const Type& type) {
+  return type.kind() == Kind::Struct && !type.builtin() &&
+         static_cast<const StructType&>(type).runtime_sized();
+}
+
+// Appends `prop` to the properties of a struct that is being declared. Only the last property may
+// be a runtime sized array, and no property may hold one.
+void add_property(std::vector<StructProperty>& properties, StructProperty prop);
+
 }  // namespace crystal::compiler::ast::type
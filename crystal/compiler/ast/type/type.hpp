@@ -1,14 +1,29 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace crystal::compiler::ast::type {
 
+// The shape of a value of a type. Scalars and vectors share a kind, and are told apart by their
+// component count. Every user declared type is a struct.
+enum class Kind {
+  Struct = 0,
+  Bool,
+  Int,
+  Float,
+  Matrix,
+  Texture,
+};
+
 class Type {
   std::string name_;
   std::string glsl_name_;
   std::string metal_name_;
   bool        builtin_;
+  Kind        kind_  = Kind::Struct;
+  uint32_t    count_ = 1;  // Vector components, or matrix columns.
 
 public:
   Type(std::string_view name, bool builtin) : name_(name), builtin_(builtin) {}
@@ -17,8 +32,16 @@ public:
 
   void set_glsl_name(const std::string_view name) { glsl_name_ = name; }
   void set_metal_name(const std::string_view name) { metal_name_ = name; }
+  void set_shape(const Kind kind, const uint32_t count) {
+    kind_  = kind;
+    count_ = count;
+  }
 
   [[nodiscard]] bool               builtin() const { return builtin_; }
+  [[nodiscard]] Kind               kind() const { return kind_; }
+  [[nodiscard]] uint32_t           count() const { return count_; }
+  [[nodiscard]] bool               is_scalar() const { return is_numeric_() && count_ == 1; }
+  [[nodiscard]] bool               is_vector() const { return is_numeric_() && count_ > 1; }
   [[nodiscard]] const std::string& name() const { return name_; }
   [[nodiscard]] const std::string& glsl_name() const {
     return glsl_name_.size() > 0 ? glsl_name_ : name_;
@@ -26,6 +49,11 @@ public:
   [[nodiscard]] const std::string& metal_name() const {
     return metal_name_.size() > 0 ? metal_name_ : name_;
   }
+
+private:
+  [[nodiscard]] bool is_numeric_() const {
+    return kind_ == Kind::Bool || kind_ == Kind::Int || kind_ == Kind::Float;
+  }
 };
 
 }  // namespace crystal::compiler::ast::type
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "absl/container/flat_hash_set.h"
+#include "crystal/compiler/ast/type/struct_type.hpp"
+#include "crystal/compiler/ast/type/type.hpp"
+
+namespace crystal::compiler::ast::type {
+
+// The user declared types that some output refers to, so that only those need to be output.
+class TypeSet {
+  absl::flat_hash_set<const Type*> types_;
+
+public:
+  // Adds the type, along with the types of its properties.
+  void add(const Type& type) {
+    if (type.builtin() || !types_.insert(&type).second) {
+      return;
+    }
+
+    for (const auto& prop : static_cast<const StructType&>(type).properties()) {
+      add(prop.type);
+    }
+  }
+
+  [[nodiscard]] bool contains(const Type& type) const { return types_.contains(&type); }
+};
+
+}  // namespace crystal::compiler::ast::type
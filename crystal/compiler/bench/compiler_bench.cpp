@@ -0,0 +1,145 @@
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "crystal/compiler/ast/module.hpp"
+#include "crystal/compiler/ast/output/writer.hpp"
+#include "crystal/compiler/bench/generator.hpp"
+#include "crystal/compiler/parser/lexer.hpp"
+#include "crystal/compiler/parser/parse.hpp"
+
+namespace {
+
+using namespace crystal::compiler;
+
+// Times each phase of the compiler separately, on generated modules of increasing size. Every
+// benchmark reports the same counters, as rates per second, so that the phases can be compared
+// with each other and across commits:
+//   tokens - lexed from the source.
+//   nodes  - expressions and statements in the source.
+//   bytes  - of the source for the lexer and the parser, and of the output for everything else.
+
+bench::GeneratorOptions options(const benchmark::State& state) {
+  return bench::GeneratorOptions{
+      static_cast<uint32_t>(state.range(0)),
+      static_cast<uint32_t>(state.range(1)),
+      static_cast<uint32_t>(state.range(2)),
+      static_cast<uint32_t>(state.range(3)),
+  };
+}
+
+int64_t count_tokens(const std::string& src) {
+  parser::Lexer lex(src);
+  int64_t       tokens = 0;
+  while (lex.next().type != 0) {
+    ++tokens;
+  }
+  return tokens;
+}
+
+void set_counters(benchmark::State& state, const bench::GeneratedModule& gen) {
+  constexpr auto RATE = benchmark::Counter::kIsIterationInvariantRate;
+  state.counters["tokens"] =
+      benchmark::Counter(static_cast<double>(count_tokens(gen.source)), RATE);
+  state.counters["nodes"] = benchmark::Counter(static_cast<double>(gen.nodes), RATE);
+}
+
+void BM_Lex(benchmark::State& state) {
+  const bench::GeneratedModule gen = bench::generate(options(state));
+  for (auto _ : state) {
+    parser::Lexer lex(gen.source);
+    int64_t       tokens = 0;
+    while (lex.next().type != 0) {
+      ++tokens;
+    }
+    benchmark::DoNotOptimize(tokens);
+  }
+  set_counters(state, gen);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * gen.source.size()));
+}
+
+// Includes type checking, which the parser runs once the whole module has been read.
+void BM_Parse(benchmark::State& state) {
+  const bench::GeneratedModule gen = bench::generate(options(state));
+  for (auto _ : state) {
+    parser::Lexer     lex(gen.source);
+    const ast::Module mod = parser::parse(lex);
+    benchmark::DoNotOptimize(&mod);
+  }
+  set_counters(state, gen);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * gen.source.size()));
+}
+
+void BM_EmitGlsl(benchmark::State& state) {
+  const bench::GeneratedModule gen = bench::generate(options(state));
+  parser::Lexer                lex(gen.source);
+  const ast::Module            mod = parser::parse(lex);
+
+  ast::output::Writer out;
+  int64_t             bytes = 0;
+  for (auto _ : state) {
+    out.clear();
+    for (const auto& pipeline : mod.pipelines()) {
+      pipeline->vertex_function()->to_glsl(out, mod, false, false);
+      pipeline->fragment_function()->to_glsl(out, mod, false, false);
+    }
+    bytes += static_cast<int64_t>(out.size());
+    benchmark::DoNotOptimize(out.str().data());
+  }
+  set_counters(state, gen);
+  state.SetBytesProcessed(bytes);
+}
+
+void BM_EmitMetal(benchmark::State& state) {
+  const bench::GeneratedModule gen = bench::generate(options(state));
+  parser::Lexer                lex(gen.source);
+  const ast::Module            mod = parser::parse(lex);
+
+  int64_t bytes = 0;
+  for (auto _ : state) {
+    std::stringstream out;
+    mod.to_metal(out, ast::MetalOutputOptions{});
+    bytes += static_cast<int64_t>(out.tellp());
+    benchmark::DoNotOptimize(out);
+  }
+  set_counters(state, gen);
+  state.SetBytesProcessed(bytes);
+}
+
+// Serializes the opengl and vulkan stages, with the spir-v emitted directly from the ast. Metal is
+// left out, as it needs the external tools.
+void BM_Crystallib(benchmark::State& state) {
+  const bench::GeneratedModule gen = bench::generate(options(state));
+  parser::Lexer                lex(gen.source);
+  const ast::Module            mod = parser::parse(lex);
+
+  int64_t bytes = 0;
+  for (auto _ : state) {
+    std::stringstream out;
+    mod.to_crystallib(out, ast::CrystallibOutputOptions{true, true, false});
+    bytes += static_cast<int64_t>(out.tellp());
+    benchmark::DoNotOptimize(out);
+  }
+  set_counters(state, gen);
+  state.SetBytesProcessed(bytes);
+}
+
+// Grows each knob on its own from a small module, and then all of them at once.
+void sizes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"structs", "pipelines", "statements", "depth"});
+  b->Args({4, 4, 8, 2});
+  b->Args({256, 4, 8, 2});
+  b->Args({4, 64, 8, 2});
+  b->Args({4, 4, 256, 2});
+  b->Args({4, 4, 8, 16});
+  b->Args({64, 64, 64, 8});
+}
+
+}  // namespace
+
+BENCHMARK(BM_Lex)->Apply(sizes);
+BENCHMARK(BM_Parse)->Apply(sizes);
+BENCHMARK(BM_EmitGlsl)->Apply(sizes);
+BENCHMARK(BM_EmitMetal)->Apply(sizes);
+BENCHMARK(BM_Crystallib)->Apply(sizes);
@@ -0,0 +1,138 @@
+#include "crystal/compiler/bench/generator.hpp"
+
+namespace crystal::compiler::bench {
+
+namespace {
+
+class Generator {
+  std::string& src_;
+  int64_t&     nodes_;
+
+public:
+  Generator(GeneratedModule& mod) : src_(mod.source), nodes_(mod.nodes) {}
+
+  void append(const std::string_view str) { src_.append(str); }
+  void append(const uint32_t value) { src_.append(std::to_string(value)); }
+
+  // A vec4 expression of the given depth, which cycles through binary operators, properties,
+  // literals, constructors and builtin calls. `local` names a vec4 that's in scope.
+  void expression(const uint32_t depth, const uint32_t seed, const std::string_view local) {
+    if (depth == 0) {
+      append(local);
+      nodes_ += 1;
+      return;
+    }
+
+    switch ((depth + seed) % 3) {
+      case 0:  // Parentheses, two binary operators, a literal and a property.
+        append("(");
+        expression(depth - 1, seed, local);
+        append(" * 1.5 + u.tint)");
+        nodes_ += 6;
+        break;
+      case 1:  // A call, with a property and a literal.
+        append("mix(");
+        expression(depth - 1, seed, local);
+        append(", in.color, 0.25)");
+        nodes_ += 5;
+        break;
+      case 2:  // Parentheses, a binary operator and a constructor with four literals.
+        append("(");
+        expression(depth - 1, seed, local);
+        append(" - vec4(0.5, 0.5, 0.5, 0.0))");
+        nodes_ += 7;
+        break;
+    }
+  }
+
+  // Declares a chain of locals `v0`..`vN`, each computed from the one before.
+  void body(const GeneratorOptions& opts, const std::string_view first) {
+    append("        vec4 v0 = ");
+    append(first);
+    append(";\n");
+    nodes_ += 3;
+    for (uint32_t i = 1; i <= opts.statements; ++i) {
+      const std::string local = "v" + std::to_string(i - 1);
+      append("        vec4 v");
+      append(i);
+      append(" = ");
+      expression(opts.depth, i, local);
+      append(";\n");
+      nodes_ += 1;
+    }
+  }
+};
+
+}  // namespace
+
+GeneratedModule generate(const GeneratorOptions& opts) {
+  GeneratedModule mod;
+  Generator       gen(mod);
+
+  gen.append("namespace bench::generated;\n\n");
+  gen.append(
+      "struct Uniform {\n"
+      "    mat4 matrix;\n"
+      "    vec4 tint;\n"
+      "}\n\n"
+      "struct Vertex {\n"
+      "    vec4 position : 0;\n"
+      "    vec4 color    : 1;\n"
+      "}\n\n"
+      "struct Varyings {\n"
+      "    vec4 position : 0;\n"
+      "    vec4 color    : 1;\n"
+      "}\n\n"
+      "struct Out {\n"
+      "    vec4 color : 0;\n"
+      "}\n\n");
+
+  for (uint32_t i = 0; i < opts.structs; ++i) {
+    gen.append("struct Struct");
+    gen.append(i);
+    gen.append(
+        " {\n"
+        "    mat4  matrix;\n"
+        "    vec4  color;\n"
+        "    vec3  normal;\n"
+        "    float scale;\n"
+        "}\n\n");
+  }
+
+  for (uint32_t i = 0; i < opts.pipelines; ++i) {
+    gen.append("pipeline pipeline");
+    gen.append(i);
+    gen.append(
+        " {\n"
+        "    cull = \"back\";\n"
+        "    depth_test = \"less\";\n"
+        "    depth_write = true;\n\n"
+        "    uniform Uniform u : 0;\n\n"
+        "    vertex (\n"
+        "        Vertex in : 0,\n"
+        "    ) -> Varyings {\n");
+    gen.body(opts, "u.matrix * in.position");
+    gen.append(
+        "        Varyings out;\n"
+        "        out.position = v0;\n");
+    gen.append("        out.color = v");
+    gen.append(opts.statements);
+    gen.append(
+        ";\n"
+        "        return out;\n"
+        "    }\n\n"
+        "    fragment (Varyings in) -> Out {\n");
+    gen.body(opts, "in.color");
+    gen.append("        Out out;\n        out.color = v");
+    gen.append(opts.statements);
+    gen.append(
+        ";\n"
+        "        return out;\n"
+        "    }\n"
+        "}\n\n");
+  }
+
+  return mod;
+}
+
+}  // namespace crystal::compiler::bench
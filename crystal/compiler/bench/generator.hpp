@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace crystal::compiler::bench {
+
+// The size of a generated module. The same options always generate the same source, so that
+// results can be compared across commits.
+struct GeneratorOptions {
+  uint32_t structs    = 16;  // Struct types, on top of the ones that every pipeline uses.
+  uint32_t pipelines  = 16;
+  uint32_t statements = 16;  // Per function.
+  uint32_t depth      = 4;   // Of the expression in each statement.
+};
+
+struct GeneratedModule {
+  std::string source;
+
+  // The expressions and statements in the source, for reporting throughput in nodes.
+  int64_t nodes = 0;
+};
+
+[[nodiscard]] GeneratedModule generate(const GeneratorOptions& opts);
+
+}  // namespace crystal::compiler::bench
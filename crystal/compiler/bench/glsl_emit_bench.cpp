@@ -0,0 +1,107 @@
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "crystal/compiler/ast/module.hpp"
+#include "crystal/compiler/ast/output/writer.hpp"
+#include "crystal/compiler/parser/lexer.hpp"
+#include "crystal/compiler/parser/parse.hpp"
+
+namespace {
+
+using namespace crystal::compiler;
+
+// Each generated statement contributes ten expression nodes:
+//   vN = vM * 1.5 + (u.matrix * in.position)
+constexpr int EXPRESSIONS_PER_STATEMENT = 10;
+
+std::string synthetic_shader(const int expression_count) {
+  std::string src =
+      "namespace bench::synthetic;\n"
+      "struct Uniform { mat4 matrix; }\n"
+      "struct Vertex { vec4 position : 0; }\n"
+      "struct Varyings { vec4 position : 0; }\n"
+      "struct Out { vec4 color : 0; }\n"
+      "pipeline synthetic {\n"
+      "  uniform Uniform u : 0;\n"
+      "  vertex (Vertex in : 0) -> Varyings {\n"
+      "    Varyings out;\n"
+      "    vec4 v0 = in.position;\n";
+
+  const int statement_count = expression_count / EXPRESSIONS_PER_STATEMENT;
+  for (int i = 1; i <= statement_count; ++i) {
+    src += "    vec4 v" + std::to_string(i) + " = v" + std::to_string(i - 1) +
+           " * 1.5 + (u.matrix * in.position);\n";
+  }
+
+  src += "    out.position = v" + std::to_string(statement_count) +
+         ";\n"
+         "    return out;\n"
+         "  }\n"
+         "  fragment (Varyings in) -> Out {\n"
+         "    Out out;\n"
+         "    out.color = in.position;\n"
+         "    return out;\n"
+         "  }\n"
+         "}\n";
+  return src;
+}
+
+void emit_glsl(ast::output::Writer& out, const ast::Module& mod, const bool pretty) {
+  for (const auto& pipeline : mod.pipelines()) {
+    pipeline->vertex_function()->to_glsl(out, mod, pretty, false);
+    if (pipeline->fragment_function() != nullptr) {
+      pipeline->fragment_function()->to_glsl(out, mod, pretty, false);
+    }
+  }
+}
+
+void run(benchmark::State& state, const ast::Module& mod, const bool pretty) {
+  ast::output::Writer out;
+  size_t              bytes = 0;
+  for (auto _ : state) {
+    out.clear();
+    emit_glsl(out, mod, pretty);
+    bytes += out.size();
+    benchmark::DoNotOptimize(out.str().data());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+
+void BM_EmitExampleGlsl(benchmark::State& state, const char* file_name) {
+  parser::Lexer     lex = parser::Lexer::from_file(file_name);
+  const ast::Module mod = parser::parse(lex);
+  run(state, mod, state.range(0) != 0);
+}
+
+void BM_EmitSyntheticGlsl(benchmark::State& state) {
+  const std::string src = synthetic_shader(static_cast<int>(state.range(0)));
+  parser::Lexer     lex(src);
+  const ast::Module mod = parser::parse(lex);
+  run(state, mod, state.range(1) != 0);
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(BM_EmitExampleGlsl, triangle, "examples/01_triangle/shader.crystal")
+    ->ArgName("pretty")
+    ->Arg(0)
+    ->Arg(1);
+BENCHMARK_CAPTURE(BM_EmitExampleGlsl, instances, "examples/02_instances/shader.crystal")
+    ->ArgName("pretty")
+    ->Arg(0)
+    ->Arg(1);
+BENCHMARK_CAPTURE(BM_EmitExampleGlsl, depth_test, "examples/03_depth_test/shader.crystal")
+    ->ArgName("pretty")
+    ->Arg(0)
+    ->Arg(1);
+BENCHMARK_CAPTURE(BM_EmitExampleGlsl, render_to_texture,
+                  "examples/04_render_to_texture/shader.crystal")
+    ->ArgName("pretty")
+    ->Arg(0)
+    ->Arg(1);
+BENCHMARK_CAPTURE(BM_EmitExampleGlsl, shadow_map, "examples/05_shadow_map/shader.crystal")
+    ->ArgName("pretty")
+    ->Arg(0)
+    ->Arg(1);
+
+BENCHMARK(BM_EmitSyntheticGlsl)->ArgNames({"exprs", "pretty"})->Args({10000, 0})->Args({10000, 1});
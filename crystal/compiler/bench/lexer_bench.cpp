@@ -0,0 +1,104 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include "benchmark/benchmark.h"
+#include "crystal/compiler/parser/lexer.hpp"
+
+namespace {
+
+using namespace crystal::compiler;
+
+// A pipeline that touches every kind of token: keywords, identifiers, numbers, strings, comments
+// and operators. Each `$` is replaced with a counter to keep the names unique.
+constexpr std::string_view PIPELINE = R"(
+struct Uniform$ {
+    mat4 matrix;
+    vec4 tint;
+}
+
+struct Vertex$ {
+    vec4 position : 0;
+    vec4 color    : 1;
+}
+
+struct Varyings$ {
+    vec4 position : 0;
+    vec4 color    : 1;
+}
+
+pipeline pipeline$ {
+    cull = "back";
+    depth_write = true;
+    depth_bias = 1.25;
+
+    uniform Uniform$ u : 0;
+
+    vertex (
+        Vertex$ in : 0,
+    ) -> Varyings$ {
+        // Transform into clip space.
+        Varyings$ out;
+        out.position = u.matrix * in.position;
+        out.color    = mix(in.color, u.tint, 0.5) * 2.0 - vec4(1.0, 1.0, 1.0, 0.0);
+        return out;
+    }
+}
+)";
+
+// Repeats `PIPELINE` until the source is at least `size` bytes long.
+std::string generated_source(const size_t size) {
+  std::string src = "namespace bench::lexer;\n";
+  src.reserve(size + PIPELINE.size() * 2);
+  for (int i = 0; src.size() < size; ++i) {
+    const std::string n = std::to_string(i);
+    for (const char c : PIPELINE) {
+      if (c == '$') {
+        src += n;
+      } else {
+        src += c;
+      }
+    }
+  }
+  return src;
+}
+
+void lex_all(parser::Lexer& lex) {
+  int64_t tokens = 0;
+  while (lex.next().type != 0) {
+    ++tokens;
+  }
+  benchmark::DoNotOptimize(tokens);
+}
+
+void BM_LexBuffer(benchmark::State& state) {
+  const std::string src = generated_source(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    parser::Lexer lex(src);
+    lex_all(lex);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * src.size()));
+}
+
+// Includes the cost of mapping the file, which is what the command line tool actually pays.
+void BM_LexFile(benchmark::State& state) {
+  const std::string src = generated_source(static_cast<size_t>(state.range(0)));
+  const std::filesystem::path file_name =
+      std::filesystem::temp_directory_path() / "crystal_lexer_bench.crystal";
+  std::ofstream(file_name, std::ios_base::out | std::ios_base::binary) << src;
+
+  for (auto _ : state) {
+    parser::Lexer lex = parser::Lexer::from_file(file_name.string());
+    lex_all(lex);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * src.size()));
+
+  std::filesystem::remove(file_name);
+}
+
+}  // namespace
+
+BENCHMARK(BM_LexBuffer)->ArgName("bytes")->Arg(1 << 20)->Arg(16 << 20);
+BENCHMARK(BM_LexFile)->ArgName("bytes")->Arg(1 << 20)->Arg(16 << 20);
@@ -0,0 +1,137 @@
+#include "crystal/compiler/cache/cache.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <thread>
+
+#include "util/msg/msg.hpp"
+
+#if _WIN32
+#include <process.h>
+#else  // ^^^ _WIN32 / !_WIN32 vvv
+#include <unistd.h>
+#endif  // ^^^ !_WIN32
+
+namespace crystal::compiler::cache {
+
+namespace {
+
+// Bump this whenever the entry format changes, to invalidate every existing entry.
+constexpr std::string_view FORMAT_VERSION = "crystal-cache-2";
+
+void append_field(std::string& out, std::string_view field) {
+  // Prefix each field with its length, so that moving bytes between fields changes the key.
+  out += std::to_string(field.size());
+  out += ':';
+  out += field;
+}
+
+std::string serialize_key(const Key& key) {
+  std::string out;
+  append_field(out, FORMAT_VERSION);
+  append_field(out, key.target);
+  append_field(out, key.stage);
+  append_field(out, key.name);
+  append_field(out, key.tool);
+  append_field(out, key.source);
+  return out;
+}
+
+// Unique to the process, as the cache directory may be shared by several compiles at once.
+long process_id() {
+#if _WIN32
+  return _getpid();
+#else   // ^^^ _WIN32 / !_WIN32 vvv
+  return getpid();
+#endif  // ^^^ !_WIN32
+}
+
+}  // namespace
+
+uint64_t hash(const std::string_view data) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  for (const char c : data) {
+    h ^= static_cast<uint8_t>(c);
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+Cache::Cache(std::filesystem::path dir) : dir_(std::move(dir)) {
+  std::error_code error;
+  std::filesystem::create_directories(dir_, error);
+  if (error) {
+    util::msg::fatal("creating cache directory [", dir_.string(), "]: ", error.message());
+  }
+}
+
+std::optional<std::string> Cache::load(const Key& key) {
+  const auto key_data = serialize_key(key);
+
+  std::ifstream in(entry_path_(key_data), std::ios_base::in | std::ios_base::binary);
+  if (in) {
+    std::stringstream contents;
+    contents << in.rdbuf();
+    const auto entry = contents.str();
+
+    // The entry is the full key, followed by the output as a field of its own. An entry that was
+    // cut short, or otherwise doesn't match its length, is treated as missing.
+    std::string_view rest(entry);
+    if (rest.substr(0, key_data.size()) == key_data) {
+      rest.remove_prefix(key_data.size());
+
+      const size_t separator = rest.find(':');
+      size_t       size      = 0;
+      bool         valid     = separator != std::string_view::npos && separator > 0;
+      for (size_t i = 0; valid && i < separator; ++i) {
+        valid = rest[i] >= '0' && rest[i] <= '9';
+        size  = size * 10 + (rest[i] - '0');
+      }
+      if (valid && rest.size() - separator - 1 == size) {
+        ++hits_;
+        return std::string(rest.substr(separator + 1));
+      }
+    }
+  }
+
+  ++misses_;
+  return std::nullopt;
+}
+
+void Cache::store(const Key& key, std::string_view output) {
+  const auto key_data   = serialize_key(key);
+  const auto entry_path = entry_path_(key_data);
+
+  // Write to a temporary file first and then move it into place, so that concurrent compiles never
+  // observe a partially written entry. The name is unique to both the process and the thread.
+  std::stringstream tmp_name;
+  tmp_name << entry_path.filename().string() << "." << process_id() << "."
+           << std::hash<std::thread::id>{}(std::this_thread::get_id()) << ".tmp";
+  const auto tmp_path = dir_ / tmp_name.str();
+
+  {  // Wrap output file in additional scope to close file before moving it.
+    std::ofstream out(tmp_path, std::ios_base::out | std::ios_base::binary);
+    std::string entry = key_data;
+    append_field(entry, output);
+    out.write(entry.data(), entry.size());
+    if (!out) {
+      util::msg::fatal("writing cache entry [", tmp_path.string(), "]");
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tmp_path, entry_path, error);
+  if (error) {
+    util::msg::fatal("writing cache entry [", entry_path.string(), "]: ", error.message());
+  }
+}
+
+std::filesystem::path Cache::entry_path_(const std::string& key_data) const {
+  char name[17] = {0};
+  snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash(key_data)));
+  return dir_ / name;
+}
+
+}  // namespace crystal::compiler::cache
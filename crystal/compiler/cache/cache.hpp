@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace crystal::compiler::cache {
+
+// Everything that affects the output of compiling a single shader stage. Two stages with an equal
+// key are guaranteed to compile to the same output.
+struct Key {
+  // The backend being compiled for, eg: "vulkan".
+  std::string_view target;
+  // The shader stage being compiled, eg: "vert".
+  std::string_view stage;
+  // The name of the entry point that the compiled output exports.
+  std::string_view name;
+  // Identifies the tool, and its version, used to compile the source.
+  std::string_view tool;
+  // The emitted shader source being compiled.
+  std::string_view source;
+};
+
+// 64-bit FNV-1a. This is used instead of `std::hash` or `absl::Hash`, as the result must be stable
+// across processes and platforms, such as for the names of cache entries.
+[[nodiscard]] uint64_t hash(std::string_view data);
+
+// An on-disk, content-addressed store of compiled shader stages.
+//
+// Entries are keyed by a hash of the full `Key`, and store the key alongside the output so that a
+// hash collision can never return the wrong output. The length of the output is stored too, so
+// that a truncated entry is never returned. It is safe to use from multiple threads, and from
+// multiple processes sharing the same directory.
+class Cache {
+  std::filesystem::path dir_;
+  std::atomic<uint32_t> hits_   = 0;
+  std::atomic<uint32_t> misses_ = 0;
+
+public:
+  explicit Cache(std::filesystem::path dir);
+
+  [[nodiscard]] uint32_t hits() const { return hits_; }
+  [[nodiscard]] uint32_t misses() const { return misses_; }
+
+  // Returns the output previously stored for the key, if any, and counts it as a hit or a miss.
+  [[nodiscard]] std::optional<std::string> load(const Key& key);
+
+  // Stores the compiled output for the key, replacing any existing entry.
+  void store(const Key& key, std::string_view output);
+
+private:
+  [[nodiscard]] std::filesystem::path entry_path_(const std::string& key_data) const;
+};
+
+}  // namespace crystal::compiler::cache
@@ -0,0 +1,71 @@
+#include "crystal/compiler/cli/instrument.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+#include "crystal/compiler/parser/lexer.hpp"
+#include "util/msg/msg.hpp"
+
+namespace crystal::compiler::instrument {
+
+void add_options(cli::App* const cmd, Options& opts) {
+  cmd->add_flag("--time-passes", opts.time_passes, "Print the time spent in each compiler phase");
+  cmd->add_flag("--stats", opts.stats,
+                "Print the size of the ast and of each output, and the peak memory usage");
+  cmd->add_option("--trace-out", opts.trace_out,
+                  "Write a chrome trace event file (json) of the compile");
+}
+
+ast::Module parse(const std::string& file_name, const uint32_t opt_level,
+                  parser::ParseOptions parse_opts, trace::Trace* const trace) {
+  parser::Lexer lex;
+  {
+    const trace::Span span(trace, "read", file_name);
+    lex = parser::Lexer::from_file(file_name);
+  }
+  trace::add_stat(trace, "source bytes", lex.remaining().size());
+
+  if (trace != nullptr) {
+    const trace::Span span(trace, "lex");
+    parser::Lexer     tokens(lex.remaining());
+    int64_t           count = 0;
+    while (tokens.next().type != 0) {
+      ++count;
+    }
+    trace::add_stat(trace, "tokens", count);
+  }
+
+  ast::Module mod;
+  {
+    const trace::Span span(trace, "parse");
+    parse_opts.import_dir = std::filesystem::path(file_name).parent_path();
+    mod                   = parser::parse(lex, parse_opts);
+  }
+  trace::add_stat(trace, "pipelines", mod.pipelines().size());
+  trace::add_stat(trace, "ast nodes", mod.arena().objects());
+  trace::add_stat(trace, "ast bytes", mod.arena().bytes());
+
+  if (opt_level > 0) {
+    const trace::Span span(trace, "optimize");
+    mod.optimize();
+  }
+  return mod;
+}
+
+void report(const Options& opts, trace::Trace& trace) {
+  if (opts.time_passes) {
+    trace.report_times();
+  }
+  if (opts.stats) {
+    trace.report_stats();
+  }
+  if (opts.trace_out.size() > 0) {
+    std::ofstream out(opts.trace_out);
+    trace.write_chrome_trace(out);
+    if (!out) {
+      util::msg::fatal("writing file [", opts.trace_out, "]");
+    }
+  }
+}
+
+}  // namespace crystal::compiler::instrument
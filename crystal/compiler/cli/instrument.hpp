@@ -0,0 +1,35 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include "cli11/cli11.hpp"
+#include "crystal/compiler/ast/module.hpp"
+#include "crystal/compiler/parser/parse.hpp"
+#include "crystal/compiler/trace/trace.hpp"
+
+namespace crystal::compiler::instrument {
+
+// What to report about a compile, shared by every subcommand.
+struct Options {
+  bool        time_passes = false;
+  bool        stats       = false;
+  std::string trace_out;  // No trace file is written when empty.
+
+  [[nodiscard]] bool enabled() const {
+    return time_passes || stats || trace_out.size() > 0;
+  }
+};
+
+void add_options(cli::App* cmd, Options& opts);
+
+// Lexes, parses and optionally optimizes the file, with its imports relative to its directory.
+// Lexing is timed in a separate pass over the source, as the parser pulls its tokens one at a time,
+// so the parse time includes lexing again.
+[[nodiscard]] ast::Module parse(const std::string& file_name, uint32_t opt_level,
+                                parser::ParseOptions parse_opts, trace::Trace* trace);
+
+// Prints the times and stats, and writes the trace file, that `opts` ask for.
+void report(const Options& opts, trace::Trace& trace);
+
+}  // namespace crystal::compiler::instrument
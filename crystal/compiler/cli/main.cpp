@@ -1,7 +1,16 @@
+#include <algorithm>
+#include <fstream>
+#include <optional>
+#include <thread>
+#include <vector>
+
 #include "cli11/cli11.hpp"
 #include "crystal/common/proto/proto.hpp"
-#include "crystal/compiler/parser/lexer.hpp"
-#include "crystal/compiler/parser/parse.hpp"
+#include "crystal/compiler/ast/parallel.hpp"
+#include "crystal/compiler/cache/cache.hpp"
+#include "crystal/compiler/cli/instrument.hpp"
+#include "crystal/compiler/cli/watch.hpp"
+#include "crystal/compiler/trace/trace.hpp"
 #include "util/fs/path.hpp"
 
 int main(const int argc, const char* const argv[]) {
@@ -22,10 +31,27 @@ int main(const int argc, const char* const argv[]) {
   glsl_cmd->add_flag("--pretty", glsl_pretty, "Output the shaders in a human readable form");
   bool glsl_vulkan = false;
   glsl_cmd->add_flag("--vulkan", glsl_vulkan, "Output the slightly modified vulkan shaders");
+  bool glsl_minify = false;
+  glsl_cmd->add_flag("--minify", glsl_minify, "Shorten the identifiers in the shaders");
+  uint32_t glsl_opt_level = 0;
+  glsl_cmd->add_option("-O", glsl_opt_level,
+                       "Optimization level (1 folds constants and shares repeated expressions)");
+  instrument::Options glsl_instrument;
+  instrument::add_options(glsl_cmd, glsl_instrument);
 
   glsl_cmd->final_callback([&]() {
-    parser::Lexer lex = parser::Lexer::from_file(glsl_input_file_name);
-    ast::Module   mod = parser::parse(lex);
+    std::optional<trace::Trace> trace;
+    if (glsl_instrument.enabled()) {
+      trace.emplace();
+    }
+    trace::Trace* const tracer = trace ? &trace.value() : nullptr;
+
+    const ast::Module mod =
+        instrument::parse(glsl_input_file_name, glsl_opt_level, parser::ParseOptions{}, tracer);
+
+    // Shared by every stage, so that the varyings of each pair still match up by name.
+    ast::output::glsl::Names  minified_names;
+    ast::output::glsl::Names* names = glsl_minify ? &minified_names : nullptr;
 
     for (auto& vertex_function : mod.vertex_functions()) {
       const std::string output_file_name =
@@ -33,7 +59,13 @@ int main(const int argc, const char* const argv[]) {
       std::ofstream output_file(output_file_name);
       util::msg::debug("outputting vertex file [", output_file_name, "]");
 
-      vertex_function->to_glsl(output_file, mod, glsl_pretty, glsl_vulkan);
+      ast::output::Writer out;
+      {
+        const trace::Span span(tracer, "emit glsl", vertex_function->name());
+        vertex_function->to_glsl(out, mod, glsl_pretty, glsl_vulkan, names);
+      }
+      trace::add_stat(tracer, "glsl bytes", out.size());
+      output_file << out;
     }
 
     for (auto& fragment_function : mod.fragment_functions()) {
@@ -42,7 +74,17 @@ int main(const int argc, const char* const argv[]) {
       std::ofstream output_file(output_file_name);
       util::msg::debug("outputting fragment file [", output_file_name, "]");
 
-      fragment_function->to_glsl(output_file, mod, glsl_pretty, glsl_vulkan);
+      ast::output::Writer out;
+      {
+        const trace::Span span(tracer, "emit glsl", fragment_function->name());
+        fragment_function->to_glsl(out, mod, glsl_pretty, glsl_vulkan, names);
+      }
+      trace::add_stat(tracer, "glsl bytes", out.size());
+      output_file << out;
+    }
+
+    if (trace) {
+      instrument::report(glsl_instrument, *trace);
     }
   });
   // }
@@ -54,10 +96,18 @@ int main(const int argc, const char* const argv[]) {
   cpp_cmd->add_option("-i,--input", cpp_input_file_name, "Input file name")->required();
   std::string cpp_output_file_name;
   cpp_cmd->add_option("-o,--output", cpp_output_file_name, "Output file");
+  instrument::Options cpp_instrument;
+  instrument::add_options(cpp_cmd, cpp_instrument);
 
   cpp_cmd->final_callback([&]() {
-    parser::Lexer lex = parser::Lexer::from_file(cpp_input_file_name);
-    ast::Module   mod = parser::parse(lex);
+    std::optional<trace::Trace> trace;
+    if (cpp_instrument.enabled()) {
+      trace.emplace();
+    }
+    trace::Trace* const tracer = trace ? &trace.value() : nullptr;
+
+    const ast::Module mod =
+        instrument::parse(cpp_input_file_name, 0, parser::ParseOptions{}, tracer);
 
     if (cpp_output_file_name.size() == 0) {
       cpp_output_file_name = util::fs::replace_extension(cpp_input_file_name, "crystal", "hpp");
@@ -65,30 +115,48 @@ int main(const int argc, const char* const argv[]) {
 
     std::ofstream output_file(cpp_output_file_name);
     util::msg::debug("outputting cpphdr file [", cpp_output_file_name, "]");
-    mod.to_cpphdr(output_file, crystal::compiler::ast::CppOutputOptions{
-                                   .cpp17 = true,
-                               });
+    {
+      const trace::Span span(tracer, "emit cpphdr");
+      mod.to_cpphdr(output_file, crystal::compiler::ast::CppOutputOptions{
+                                     .cpp17 = true,
+                                 });
+    }
+    trace::add_stat(tracer, "cpphdr bytes", output_file.tellp());
+
+    if (trace) {
+      instrument::report(cpp_instrument, *trace);
+    }
   });
   // }
 
   // {  // Convert to crystallib.
   const auto lib_cmd = app.add_subcommand("lib");
 
-  std::string lib_input_file_name;
-  lib_cmd->add_option("-i,--input", lib_input_file_name, "Input file name")->required();
-  std::string lib_output_file_name;
-  lib_cmd->add_option("-o,--output", lib_output_file_name, "Output file");
+  std::vector<std::string> lib_input_file_names;
+  lib_cmd->add_option("-i,--input", lib_input_file_names, "Input file names")->required();
+  std::vector<std::string> lib_output_file_names;
+  lib_cmd->add_option("-o,--output", lib_output_file_names, "Output file names, one per input");
+  std::vector<std::string> lib_cpp_output_file_names;
+  lib_cmd->add_option("--cpp", lib_cpp_output_file_names,
+                      "Also output a cpphdr file for each input, from the same parse");
   std::string lib_glslang_validator_exe;
-  lib_cmd->add_option("--glslang_validator", lib_glslang_validator_exe,
-                      "Path to the glslangValidator executable");
+  lib_cmd->add_option(
+      "--glslang_validator", lib_glslang_validator_exe,
+      "Path to a glslangValidator executable to use instead of compiling in-process");
   std::string lib_spirv_link_exe;
-  lib_cmd->add_option("--spirv_link", lib_spirv_link_exe, "Path to the spirv-link executable");
+  lib_cmd->add_option("--spirv_link", lib_spirv_link_exe,
+                      "Path to a spirv-link executable to use instead of linking in-process");
   bool lib_opengl = true;
   lib_cmd->add_flag("--opengl,--no-opengl{false}", lib_opengl,
                     "Include opengl support in compiled library");
   bool lib_vulkan = true;
   lib_cmd->add_flag("--vulkan,--no-vulkan{false}", lib_vulkan,
                     "Include vulkan support in compiled library");
+  bool lib_minify = false;
+  lib_cmd->add_flag("--minify", lib_minify, "Shorten the identifiers in the opengl shaders");
+  bool lib_vulkan_glsl = false;
+  lib_cmd->add_flag("--vulkan-glsl", lib_vulkan_glsl,
+                    "Compile the vulkan shaders from glsl instead of emitting spir-v directly");
 #if __APPLE__
   bool lib_metal = true;
 #else   // ^^^ __APPLE__ / !__APPLE__ vvv
@@ -96,34 +164,161 @@ int main(const int argc, const char* const argv[]) {
 #endif  // ^^^ !__APPLE__
   lib_cmd->add_flag("--metal,--no-metal{false}", lib_metal,
                     "Include metal support in compiled library");
+  uint32_t lib_jobs = 1;
+  lib_cmd->add_option("-j,--jobs", lib_jobs,
+                      "Number of files, or of pipelines when there is a single file, to compile "
+                      "concurrently (0 uses every available core)");
+  uint32_t lib_opt_level = 0;
+  lib_cmd->add_option("-O", lib_opt_level,
+                      "Optimization level (1 folds constants and shares repeated expressions)");
+  std::vector<std::string> lib_import_dirs;
+  lib_cmd->add_option("-I,--import-dir", lib_import_dirs,
+                      "Directory to look for imports in when they aren't next to the importer");
+  std::string lib_cache_dir;
+  lib_cmd->add_option("--cache-dir", lib_cache_dir,
+                      "Directory used to cache compiled shader stages between runs");
+  instrument::Options lib_instrument;
+  instrument::add_options(lib_cmd, lib_instrument);
 
   lib_cmd->final_callback([&]() {
-    parser::Lexer lex = parser::Lexer::from_file(lib_input_file_name);
-    ast::Module   mod = parser::parse(lex);
+    const size_t file_count = lib_input_file_names.size();
+    if (lib_output_file_names.size() == 0) {
+      for (const auto& input_file_name : lib_input_file_names) {
+        lib_output_file_names.push_back(
+            util::fs::replace_extension(input_file_name, "crystal", "crystallib"));
+      }
+    } else if (lib_output_file_names.size() != file_count) {
+      util::msg::fatal("expected one output file per input file, got [",
+                       lib_output_file_names.size(), "] for [", file_count, "]");
+    }
+    if (lib_cpp_output_file_names.size() > 0 && lib_cpp_output_file_names.size() != file_count) {
+      util::msg::fatal("expected one cpphdr file per input file, got [",
+                       lib_cpp_output_file_names.size(), "] for [", file_count, "]");
+    }
+
+    if (lib_jobs == 0) {
+      lib_jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::optional<trace::Trace> trace;
+    if (lib_instrument.enabled()) {
+      trace.emplace();
+    }
+    trace::Trace* const tracer = trace ? &trace.value() : nullptr;
 
-    if (lib_output_file_name.size() == 0) {
-      lib_output_file_name =
-          util::fs::replace_extension(lib_input_file_name, "crystal", "crystallib");
+    std::optional<crystal::compiler::cache::Cache> cache;
+    if (lib_cache_dir.size() > 0) {
+      cache.emplace(lib_cache_dir);
     }
 
-    if (lib_vulkan) {
-      if (lib_glslang_validator_exe.size() == 0) {
-        lib_glslang_validator_exe = "glslangValidator";
+    // A batch has far more files than each file has pipelines, so the jobs are spread across the
+    // files instead, with the pipelines of each file compiled one after another.
+    const uint32_t file_jobs = file_count > 1 ? lib_jobs : 1;
+
+    const crystal::compiler::ast::CrystallibOutputOptions lib_opts{
+        .opengl                = lib_opengl,
+        .vulkan                = lib_vulkan,
+        .metal                 = lib_metal,
+        .vulkan_glsl           = lib_vulkan_glsl,
+        .minify                = lib_minify,
+        .glslang_validator_exe = lib_glslang_validator_exe,
+        .spirv_link_exe        = lib_spirv_link_exe,
+        .jobs                  = file_count > 1 ? 1 : lib_jobs,
+        .cache                 = cache ? &cache.value() : nullptr,
+        .trace                 = tracer,
+    };
+
+    ast::parallel_for(file_count, file_jobs, [&](const size_t i) {
+      const ast::Module mod = instrument::parse(lib_input_file_names[i], lib_opt_level,
+                                                parser::ParseOptions{
+                                                    .import_dirs = {lib_import_dirs.begin(),
+                                                                    lib_import_dirs.end()},
+                                                    .cache       = lib_opts.cache,
+                                                    .jobs        = lib_opts.jobs,
+                                                },
+                                                tracer);
+
+      {  // Wrap output file in additional scope to close file before writing the header.
+        std::ofstream output_file(lib_output_file_names[i],
+                                  std::ios_base::out | std::ios_base::binary);
+        util::msg::debug("outputting crystallib file [", lib_output_file_names[i], "]");
+        mod.to_crystallib(output_file, lib_opts);
       }
-      if (lib_spirv_link_exe.size() == 0) {
-        lib_spirv_link_exe = "spirv-link";
+
+      if (lib_cpp_output_file_names.size() > 0) {
+        std::ofstream output_file(lib_cpp_output_file_names[i]);
+        util::msg::debug("outputting cpphdr file [", lib_cpp_output_file_names[i], "]");
+        const trace::Span span(tracer, "emit cpphdr", lib_input_file_names[i]);
+        mod.to_cpphdr(output_file, crystal::compiler::ast::CppOutputOptions{
+                                       .cpp17 = true,
+                                   });
       }
+    });
+
+    if (cache) {
+      util::msg::info("cache: ", cache->hits(), " hits, ", cache->misses(), " misses");
+    }
+    if (trace) {
+      instrument::report(lib_instrument, *trace);
     }
+  });
+  // }
 
-    std::ofstream output_file(lib_output_file_name, std::ios_base::out | std::ios_base::binary);
-    util::msg::debug("outputting crystallib file [", lib_output_file_name, "]");
-    mod.to_crystallib(output_file, crystal::compiler::ast::CrystallibOutputOptions{
-                                       .opengl                = lib_opengl,
-                                       .vulkan                = lib_vulkan,
-                                       .metal                 = lib_metal,
-                                       .glslang_validator_exe = lib_glslang_validator_exe,
-                                       .spirv_link_exe        = lib_spirv_link_exe,
-                                   });
+  // {  // Rebuild the crystallib (and header) whenever the input changes.
+  const auto watch_cmd = app.add_subcommand("watch");
+
+  watch::Options watch_opts;
+  watch_cmd->add_option("-i,--input", watch_opts.input_file_name, "Input file name")->required();
+  watch_cmd->add_option("-o,--output", watch_opts.lib_output_file_name, "Output crystallib file");
+  watch_cmd->add_option("--cpp", watch_opts.cpp_output_file_name, "Output cpphdr file");
+  bool watch_opengl = true;
+  watch_cmd->add_flag("--opengl,--no-opengl{false}", watch_opengl,
+                      "Include opengl support in compiled library");
+  bool watch_vulkan = true;
+  watch_cmd->add_flag("--vulkan,--no-vulkan{false}", watch_vulkan,
+                      "Include vulkan support in compiled library");
+#if __APPLE__
+  bool watch_metal = true;
+#else   // ^^^ __APPLE__ / !__APPLE__ vvv
+  bool watch_metal = false;
+#endif  // ^^^ !__APPLE__
+  watch_cmd->add_flag("--metal,--no-metal{false}", watch_metal,
+                      "Include metal support in compiled library");
+  bool watch_minify = false;
+  watch_cmd->add_flag("--minify", watch_minify, "Shorten the identifiers in the opengl shaders");
+  uint32_t watch_jobs = 1;
+  watch_cmd->add_option(
+      "-j,--jobs", watch_jobs,
+      "Number of pipelines to compile concurrently (0 uses every available core)");
+  watch_cmd->add_option("-O", watch_opts.opt_level,
+                        "Optimization level (1 folds constants and shares repeated expressions)");
+  watch_cmd->add_option("-I,--import-dir", watch_opts.import_dirs,
+                        "Directory to look for imports in when they aren't next to the importer");
+  watch_cmd->add_option("--cache-dir", watch_opts.cache_dir,
+                        "Directory used to cache compiled shader stages between rebuilds");
+  instrument::add_options(watch_cmd, watch_opts.instrument);
+
+  watch_cmd->final_callback([&]() {
+    if (watch_opts.lib_output_file_name.size() == 0) {
+      watch_opts.lib_output_file_name =
+          util::fs::replace_extension(watch_opts.input_file_name, "crystal", "crystallib");
+    }
+
+    if (watch_jobs == 0) {
+      watch_jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    watch_opts.lib = crystal::compiler::ast::CrystallibOutputOptions{
+        .opengl = watch_opengl,
+        .vulkan = watch_vulkan,
+        .metal  = watch_metal,
+        .minify = watch_minify,
+        .jobs   = watch_jobs,
+    };
+    watch_opts.cpp = crystal::compiler::ast::CppOutputOptions{
+        .cpp17 = true,
+    };
+    watch::run(watch_opts);
   });
   // }
 
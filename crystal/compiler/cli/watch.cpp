@@ -0,0 +1,278 @@
+#include "crystal/compiler/cli/watch.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "crystal/compiler/cache/cache.hpp"
+#include "crystal/compiler/trace/trace.hpp"
+#include "util/msg/msg.hpp"
+
+#if __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif  // ^^^ __linux__
+
+namespace crystal::compiler::watch {
+
+namespace {
+
+// Replaces the file with `contents`, unless it already holds exactly that, so that anything
+// watching the outputs only sees the ones that changed. The new contents are written alongside and
+// then moved into place, so that a reader never sees a partially written file.
+void write_atomically(const std::string& file_name, const std::string& contents) {
+  {
+    std::ifstream in(file_name, std::ios_base::in | std::ios_base::binary);
+    if (in) {
+      std::stringstream existing;
+      existing << in.rdbuf();
+      if (existing.str() == contents) {
+        return;
+      }
+    }
+  }
+
+  const std::string tmp_file_name = file_name + ".tmp";
+  {  // Wrap output file in additional scope to close file before moving it.
+    std::ofstream out(tmp_file_name, std::ios_base::out | std::ios_base::binary);
+    out.write(contents.data(), contents.size());
+    if (!out) {
+      util::msg::fatal("writing file [", tmp_file_name, "]");
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tmp_file_name, file_name, error);
+  if (error) {
+    util::msg::fatal("writing file [", file_name, "]: ", error.message());
+  }
+}
+
+std::string read_file(const std::string& file_name) {
+  std::ifstream     in(file_name, std::ios_base::in | std::ios_base::binary);
+  std::stringstream contents;
+  contents << in.rdbuf();
+  return contents.str();
+}
+
+// Also fills `imported` with every file that the input imports, directly or not.
+void build(const Options& opts, std::vector<std::string>& imported) {
+  std::optional<trace::Trace> trace;
+  if (opts.instrument.enabled()) {
+    trace.emplace();
+  }
+  trace::Trace* const tracer = trace ? &trace.value() : nullptr;
+
+  // Only the imports and stages whose source changed are compiled again.
+  std::optional<cache::Cache> cache;
+  if (opts.cache_dir.size() > 0) {
+    cache.emplace(opts.cache_dir);
+  }
+
+  const ast::Module mod = instrument::parse(opts.input_file_name, opts.opt_level,
+                                            parser::ParseOptions{
+                                                .import_dirs = {opts.import_dirs.begin(),
+                                                                opts.import_dirs.end()},
+                                                .cache       = cache ? &cache.value() : nullptr,
+                                                .jobs        = opts.lib.jobs,
+                                                .imported    = &imported,
+                                            },
+                                            tracer);
+
+  ast::CrystallibOutputOptions lib_opts = opts.lib;
+  lib_opts.cache                        = cache ? &cache.value() : nullptr;
+  lib_opts.trace                        = tracer;
+
+  std::stringstream lib;
+  mod.to_crystallib(lib, lib_opts);
+  write_atomically(opts.lib_output_file_name, lib.str());
+
+  if (opts.cpp_output_file_name.size() > 0) {
+    std::stringstream cpp;
+    {
+      const trace::Span span(tracer, "emit cpphdr");
+      mod.to_cpphdr(cpp, opts.cpp);
+    }
+    trace::add_stat(tracer, "cpphdr bytes", cpp.tellp());
+    write_atomically(opts.cpp_output_file_name, cpp.str());
+  }
+
+  if (trace) {
+    instrument::report(opts.instrument, *trace);
+  }
+}
+
+}  // namespace
+
+#if __linux__
+
+namespace {
+
+// The directories of the watched files, by watch descriptor. Directories are watched rather than
+// files, as editors often save by writing a new file and moving it over the old one.
+using Directories = std::map<int, std::filesystem::path>;
+
+void watch_directory(const int fd, Directories& dirs, const std::filesystem::path& file) {
+  const int wd =
+      inotify_add_watch(fd, file.parent_path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+  if (wd < 0) {
+    util::msg::fatal("watching file [", file.string(), "]");
+  }
+  dirs[wd] = file.parent_path();
+}
+
+// Blocks until one of the files is written to. A single save can raise several events, so this
+// only returns once they have stopped coming for a moment.
+void wait_for_change(const int fd, const Directories& dirs, const std::set<std::string>& files) {
+  bool changed = false;
+  while (!changed) {
+    for (pollfd poll_fd{fd, POLLIN, 0}; poll(&poll_fd, 1, changed ? 10 : -1) > 0;) {
+      alignas(inotify_event) char buffer[4096];
+      const ssize_t               size = read(fd, buffer, sizeof(buffer));
+      for (ssize_t offset = 0; offset < size;) {
+        const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+        const auto  dir   = dirs.find(event->wd);
+        changed           = changed || (event->len > 0 && dir != dirs.end() &&
+                                        files.count((dir->second / event->name).string()) > 0);
+        offset += sizeof(inotify_event) + event->len;
+      }
+    }
+  }
+}
+
+// Reads the rest of the pipe, up to the other end being closed.
+std::string read_pipe(const int fd) {
+  std::string contents;
+  char        buffer[4096];
+  for (ssize_t size; (size = read(fd, buffer, sizeof(buffer))) != 0;) {
+    if (size > 0) {
+      contents.append(buffer, size);
+    } else if (errno != EINTR) {
+      break;
+    }
+  }
+  return contents;
+}
+
+void write_pipe(const int fd, const std::string_view contents) {
+  for (size_t offset = 0; offset < contents.size();) {
+    const ssize_t size = write(fd, contents.data() + offset, contents.size() - offset);
+    if (size > 0) {
+      offset += size;
+    } else if (errno != EINTR) {
+      break;
+    }
+  }
+}
+
+}  // namespace
+
+void run(const Options& opts) {
+  const std::string input_path =
+      std::filesystem::weakly_canonical(std::filesystem::absolute(opts.input_file_name)).string();
+
+  const int fd = inotify_init1(IN_CLOEXEC);
+  if (fd < 0) {
+    util::msg::fatal("watching file [", opts.input_file_name, "]");
+  }
+  Directories dirs;
+  watch_directory(fd, dirs, input_path);
+
+  // The input and everything that it imported on the last successful build.
+  std::set<std::string>              files{input_path};
+  std::map<std::string, std::string> sources;
+  for (;;) {
+    // Saving without changing anything doesn't need a rebuild.
+    std::map<std::string, std::string> new_sources;
+    for (const auto& file : files) {
+      new_sources.emplace(file, read_file(file));
+    }
+    if (sources.size() > 0 && new_sources == sources) {
+      wait_for_change(fd, dirs, files);
+      continue;
+    }
+    sources = std::move(new_sources);
+
+    // Errors in the source are fatal, so each build runs in a child process that is allowed to
+    // fail without taking the watcher down with it. The child sends back the files that the input
+    // imports, one per line, as those may have changed too.
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) < 0) {
+      util::msg::fatal("building file [", opts.input_file_name, "]");
+    }
+    fflush(nullptr);
+    const auto  start = std::chrono::steady_clock::now();
+    const pid_t pid   = fork();
+    if (pid == 0) {
+      close(fds[0]);
+      std::vector<std::string> imported;
+      build(opts, imported);
+
+      std::string paths;
+      for (const auto& path : imported) {
+        paths += path + '\n';
+      }
+      write_pipe(fds[1], paths);
+      fflush(nullptr);
+      _exit(0);
+    }
+    close(fds[1]);
+    const std::string paths = pid > 0 ? read_pipe(fds[0]) : std::string();
+    close(fds[0]);
+
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid) {
+      util::msg::fatal("building file [", opts.input_file_name, "]");
+    }
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+      util::msg::info("built [", opts.input_file_name, "] in ", ms, "ms");
+
+      // A failed build may not have found all of the imports, so the last list is kept instead.
+      files = {input_path};
+      std::istringstream lines(paths);
+      for (std::string path; std::getline(lines, path);) {
+        files.insert(path);
+        watch_directory(fd, dirs, path);
+      }
+
+      // Newly imported files are compared from now on too, as they were just built from.
+      std::map<std::string, std::string> built_sources;
+      for (const auto& file : files) {
+        const auto it = sources.find(file);
+        built_sources.emplace(file, it != sources.end() ? std::move(it->second) : read_file(file));
+      }
+      sources = std::move(built_sources);
+    } else {
+      util::msg::info("failed to build [", opts.input_file_name, "]");
+    }
+
+    wait_for_change(fd, dirs, files);
+  }
+}
+
+#else  // ^^^ __linux__ / !__linux__ vvv
+
+void run(const Options& opts) {
+  util::msg::fatal("watching files is only supported on linux");
+  std::abort();
+}
+
+#endif  // ^^^ !__linux__
+
+}  // namespace crystal::compiler::watch
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "crystal/compiler/ast/module.hpp"
+#include "crystal/compiler/cli/instrument.hpp"
+
+namespace crystal::compiler::watch {
+
+struct Options {
+  std::string input_file_name;
+  std::string lib_output_file_name;
+  std::string cpp_output_file_name;  // No header is written when empty.
+  uint32_t    opt_level = 0;
+
+  ast::CrystallibOutputOptions lib;
+  ast::CppOutputOptions        cpp;
+
+  // Further directories to look for imports in, see `parser::ParseOptions::import_dirs`.
+  std::vector<std::string> import_dirs;
+
+  // The on-disk cache of compiled stages, shared by every rebuild. Without it every stage is
+  // rebuilt each time, which is only slow when compiling with external tools.
+  std::string cache_dir;
+
+  // Reported after every build, with the trace file overwritten each time.
+  instrument::Options instrument;
+};
+
+// Builds the outputs, and then rebuilds them every time that the input file, or any file that it
+// imports, is written to. Never returns.
+[[noreturn]] void run(const Options& opts);
+
+}  // namespace crystal::compiler::watch
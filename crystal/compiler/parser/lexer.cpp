@@ -3,22 +3,112 @@
 #include <array>
 #include <tuple>
 
-#include "absl/container/flat_hash_map.h"
 #include "crystal/compiler/parser/grammar.hpp"
 
 namespace crystal::compiler::parser {
 
 namespace {
 
-static const absl::flat_hash_map<std::string, int> KEYWORDS{
-    {"namespace", TOK_KW_NAMESPACE}, {"struct", TOK_KW_STRUCT},       {"vertex", TOK_KW_VERTEX},
-    {"fragment", TOK_KW_FRAGMENT},   {"pipeline", TOK_KW_PIPELINE},   {"uniform", TOK_KW_UNIFORM},
-    {"texture", TOK_KW_TEXTURE},     {"instanced", TOK_KW_INSTANCED}, {"return", TOK_KW_RETURN},
-};
+// Returns the token type of the keyword spelled by `iden`, or 0 if it is a plain identifier.
+//
+// No two keywords share both a length and a first character, so switching on those two picks the
+// only possible candidate and a single comparison settles it.
+inline int keyword(const std::string_view iden) {
+  const auto match = [iden](const std::string_view kw, const int type) {
+    return iden == kw ? type : 0;
+  };
+
+  switch (iden.size()) {
+    case 2:
+      switch (iden[0]) {
+        case 'i':
+          return match("if", TOK_KW_IF);
+      }
+      break;
+
+    case 3:
+      switch (iden[0]) {
+        case 'f':
+          return match("for", TOK_KW_FOR);
+      }
+      break;
+
+    case 4:
+      switch (iden[0]) {
+        case 'e':
+          return match("else", TOK_KW_ELSE);
+      }
+      break;
+
+    case 5:
+      switch (iden[0]) {
+        case 'c':
+          return match("const", TOK_KW_CONST);
+      }
+      break;
+
+    case 6:
+      switch (iden[0]) {
+        case 'i':
+          return match("import", TOK_KW_IMPORT);
+        case 'r':
+          return match("return", TOK_KW_RETURN);
+        case 's':
+          return match("struct", TOK_KW_STRUCT);
+        case 'v':
+          return match("vertex", TOK_KW_VERTEX);
+      }
+      break;
+
+    case 7:
+      switch (iden[0]) {
+        case 'c':
+          return match("compute", TOK_KW_COMPUTE);
+        case 's':
+          return match("storage", TOK_KW_STORAGE);
+        case 't':
+          return match("texture", TOK_KW_TEXTURE);
+        case 'u':
+          return match("uniform", TOK_KW_UNIFORM);
+      }
+      break;
+
+    case 8:
+      switch (iden[0]) {
+        case 'f':
+          return match("fragment", TOK_KW_FRAGMENT);
+        case 'p':
+          return match("pipeline", TOK_KW_PIPELINE);
+        case 'r':
+          return match("readonly", TOK_KW_READONLY);
+      }
+      break;
 
-inline std::tuple<unsigned long long /* value */, int /* digits */,
-                  std::string::const_iterator /* next */>
-parse_int(std::string::const_iterator start, std::string::const_iterator end) {
+    case 9:
+      switch (iden[0]) {
+        case 'i':
+          return match("instanced", TOK_KW_INSTANCED);
+        case 'n':
+          return match("namespace", TOK_KW_NAMESPACE);
+      }
+      break;
+  }
+
+  return 0;
+}
+
+inline bool is_space(const char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+inline bool is_iden_start(const char c) {
+  return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+inline bool is_iden_char(const char c) { return is_iden_start(c) || (c >= '0' && c <= '9'); }
+
+inline std::tuple<unsigned long long /* value */, int /* digits */, const char* /* next */>
+parse_int(const char* start, const char* end) {
   unsigned long long value  = 0;
   int                digits = 0;
 
@@ -38,19 +128,23 @@ parse_int(std::string::const_iterator start, std::string::const_iterator end) {
 
 }  // namespace
 
-Lexer Lexer::from_file(std::string file_name) {
-  const auto contents = util::fs::read_file_string(file_name);
-  // util::msg::debug("[", file_name, "] contents:\n--- BEGIN ---\n", contents, "\n--- END ---");
-  return Lexer{contents};
+Lexer Lexer::from_file(const std::string& file_name) {
+  Lexer lex;
+  lex.file_ = SourceFile::map(file_name);
+
+  const std::string_view contents = lex.file_.contents();
+  lex.next_                       = contents.data();
+  lex.end_                        = contents.data() + contents.size();
+  return lex;
 }
 
 Token Lexer::next() {
-  const auto end = buffer_.cend();
+  const char* const end = end_;
   while (next_ != end) {
     const char c = *next_;
 
     // Ignore whitespace.
-    if (isspace(c)) {
+    if (is_space(c)) {
       ++next_;
       continue;
     }
@@ -71,7 +165,7 @@ Token Lexer::next() {
       while (next_ != end && *next_ != '\"') {
         ++next_;
       }
-      const std::string_view iden(&*start, next_ - start);
+      const std::string_view iden(start, next_ - start);
       if (next_ != end) {
         ++next_;
       }
@@ -111,15 +205,13 @@ Token Lexer::next() {
     }
 
     // [_a-zA-Z][_a-zA-Z0-9]*
-    if (c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+    if (is_iden_start(c)) {
       const auto start = next_;
       do {
         ++next_;
-      } while (next_ != end &&
-               (*next_ == '_' || (*next_ >= 'a' && *next_ <= 'z') ||
-                (*next_ >= 'A' && *next_ <= 'Z') || (*next_ >= '0' && *next_ <= '9')));
+      } while (next_ != end && is_iden_char(*next_));
 
-      const std::string_view iden(&*start, next_ - start);
+      const std::string_view iden(start, next_ - start);
 
       if (iden == "false") {
         return Token{TOK_LIT_BOOL, false};
@@ -127,9 +219,8 @@ Token Lexer::next() {
         return Token{TOK_LIT_BOOL, true};
       }
 
-      const auto it = KEYWORDS.find(iden);
-      if (it != KEYWORDS.cend()) {
-        return Token{it->second};
+      if (const int type = keyword(iden); type != 0) {
+        return Token{type};
       }
 
       return Token{TOK_LIT_IDEN, iden};
@@ -208,6 +299,10 @@ Token Lexer::next() {
           next_ += 2;
           return Token{TOK_OP_PLUSEQUAL};
         }
+        if ((next_ + 1) != end && *(next_ + 1) == '+') {
+          next_ += 2;
+          return Token{TOK_OP_PLUSPLUS};
+        }
         ++next_;
         return Token{TOK_OP_PLUS};
 
@@ -247,6 +342,14 @@ Token Lexer::next() {
         ++next_;
         return Token{TOK_OP_RRNDBRACKET};
 
+      case '[':
+        ++next_;
+        return Token{TOK_OP_LSQRBRACKET};
+
+      case ']':
+        ++next_;
+        return Token{TOK_OP_RSQRBRACKET};
+
       case '{':
         ++next_;
         return Token{TOK_OP_LCRLBRACKET};
@@ -255,6 +358,10 @@ Token Lexer::next() {
         ++next_;
         return Token{TOK_OP_RCRLBRACKET};
 
+      case '@':
+        ++next_;
+        return Token{TOK_OP_AT};
+
       default:
         break;
     }
@@ -1,28 +1,39 @@
 #pragma once
 
-#include <fstream>
 #include <string>
 #include <string_view>
 
+#include "crystal/compiler/parser/source_file.hpp"
 #include "crystal/compiler/parser/token.hpp"
-#include "util/fs/file.hpp"
 
 namespace crystal::compiler::parser {
 
+// Splits source text into tokens without copying it; identifier and string tokens point straight
+// into the source.
 struct Lexer {
-  std::string                 buffer_ = "";
-  std::string::const_iterator next_   = std::end(buffer_);
+  SourceFile  file_;
+  const char* next_ = nullptr;
+  const char* end_  = nullptr;
 
 public:
-  static Lexer from_file(std::string file_name);
+  // Maps the file into memory and lexes it in place.
+  static Lexer from_file(const std::string& file_name);
 
-  constexpr Lexer() = default;
+  Lexer() = default;
 
-  Lexer(const std::string& buffer) : buffer_(buffer), next_(buffer_.cbegin()) {}
+  // Lexes a caller-owned buffer, which must outlive the lexer and every token it produces.
+  explicit Lexer(std::string_view source)
+      : next_(source.data()), end_(source.data() + source.size()) {}
 
-  Lexer(std::string&& buffer) : buffer_(std::move(buffer)), next_(buffer_.cbegin()) {}
+  // A temporary string would be destroyed while its tokens are still in use.
+  Lexer(std::string&&) = delete;
 
   Token next();
+
+  // The source that hasn't been lexed yet, which is all of it for a new lexer.
+  [[nodiscard]] std::string_view remaining() const {
+    return std::string_view(next_, static_cast<size_t>(end_ - next_));
+  }
 };
 
 }  // namespace crystal::compiler::parser
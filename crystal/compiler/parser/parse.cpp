@@ -1,6 +1,17 @@
 #include "crystal/compiler/parser/parse.hpp"
 
+#include <algorithm>
 #include <cstdlib>  // malloc, free
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "crystal/compiler/ast/parallel.hpp"
+#include "crystal/compiler/parser/grammar.hpp"
+#include "crystal/compiler/parser/source_file.hpp"
+#include "util/msg/msg.hpp"
 
 // lemon declarations:
 void* ParseAlloc(void* (*malloc_proc)(size_t));
@@ -10,9 +21,120 @@ void  Parse(void* parser, int token_type, ::crystal::compiler::parser::Token tok
 
 namespace crystal::compiler::parser {
 
-ast::Module parse(Lexer& lex) {
+namespace {
+
+// Returns the paths of the imports at the start of the source, which the grammar only allows after
+// the namespace and before any other declaration. Stops lexing at the first token past them.
+std::vector<std::string> scan_imports(const std::string_view source) {
+  Lexer lex(source);
+  Token tok = lex.next();
+  if (tok.type == TOK_KW_NAMESPACE) {
+    do {
+      tok = lex.next();
+    } while (tok.type != 0 && tok.type != TOK_OP_SEMICOLON);
+    tok = lex.next();
+  }
+
+  std::vector<std::string> imports;
+  while (tok.type == TOK_KW_IMPORT) {
+    tok = lex.next();
+    if (tok.type != TOK_LIT_STR) {
+      util::msg::fatal("invalid syntax");
+    }
+    imports.emplace_back(tok.string_value);
+
+    tok = lex.next();
+    if (tok.type != TOK_OP_SEMICOLON) {
+      util::msg::fatal("invalid syntax");
+    }
+    tok = lex.next();
+  }
+  return imports;
+}
+
+// A file that the module imports, directly or not.
+struct Import {
+  std::string         name;  // The canonical path.
+  SourceFile          file;
+  std::vector<size_t> imports;  // The files that it imports, by index into the graph.
+
+  // The number of imports on the longest chain below this one. Imports at the same depth never
+  // depend on each other.
+  size_t depth = 0;
+};
+
+// Every file that a module imports, each one listed once and after all of its own imports.
+class ImportGraph {
+  const std::vector<std::filesystem::path>& import_dirs_;
+  std::vector<Import>                       imports_;
+  absl::flat_hash_map<std::string, size_t>  indices_;
+
+public:
+  explicit ImportGraph(const std::vector<std::filesystem::path>& import_dirs)
+      : import_dirs_(import_dirs) {}
+
+  [[nodiscard]] const std::vector<Import>& imports() const { return imports_; }
+
+  // Adds the file that `dir` imports as `import_path`, and everything that it imports in turn,
+  // unless it was already added by another import. `importers` is the chain of files that led to
+  // this one, to catch cycles.
+  size_t add(const std::filesystem::path& dir, const std::string& import_path,
+             std::vector<std::string>& importers) {
+    const std::filesystem::path path = resolve(dir, import_path);
+    const std::string           name = std::filesystem::weakly_canonical(path).string();
+    for (const auto& importer : importers) {
+      if (importer == name) {
+        util::msg::fatal("import cycle through [", path.string(), "]");
+      }
+    }
+
+    if (const auto it = indices_.find(name); it != indices_.end()) {
+      return it->second;
+    }
+
+    if (!std::filesystem::is_regular_file(path)) {
+      util::msg::fatal("imported file [", path.string(), "] does not exist");
+    }
+    Import node{name, SourceFile::map(path.string())};
+
+    importers.push_back(name);
+    for (const auto& child : scan_imports(node.file.contents())) {
+      const size_t index = add(path.parent_path(), child, importers);
+      node.imports.push_back(index);
+      node.depth = std::max(node.depth, imports_[index].depth + 1);
+    }
+    importers.pop_back();
+
+    imports_.push_back(std::move(node));
+    indices_.emplace(name, imports_.size() - 1);
+    return imports_.size() - 1;
+  }
+
+private:
+  // Imports are relative to the directory of the file that imports them, or otherwise to one of
+  // the import directories.
+  std::filesystem::path resolve(const std::filesystem::path& dir,
+                                const std::string&           import_path) const {
+    const std::filesystem::path relative = dir / import_path;
+    if (std::filesystem::is_regular_file(relative)) {
+      return relative;
+    }
+    for (const auto& import_dir : import_dirs_) {
+      std::filesystem::path path = import_dir / import_path;
+      if (std::filesystem::is_regular_file(path)) {
+        return path;
+      }
+    }
+    return relative;
+  }
+};
+
+ast::Module parse_module(Lexer& lex, const std::vector<std::string>& interfaces) {
   ast::Module mod;
   mod.add_base_types();
+  for (const auto& interface : interfaces) {
+    mod.add_interface(interface);
+  }
 
   void* lemon = ParseAlloc([](size_t size) { return calloc(1, size); });
 
@@ -23,7 +145,98 @@ ast::Module parse(Lexer& lex) {
   } while (tok.type != 0);
 
   ParseFree(lemon, free);
+
+  mod.typecheck();
   return mod;
 }
 
+// Returns the interface of the module in the file, parsing it unless it was already cached. The
+// interfaces of its own imports must already have been loaded.
+std::string load_interface(const Import& node, const std::vector<std::string>& interfaces,
+                           const ParseOptions& opts) {
+  const std::string_view source = node.file.contents();
+
+  std::vector<std::string> imported;
+  imported.reserve(node.imports.size());
+  for (const size_t index : node.imports) {
+    imported.push_back(interfaces[index]);
+  }
+
+  // The interface depends on those that the module imports, as well as on its own source.
+  std::string key_source(source);
+  for (const auto& interface : imported) {
+    key_source += interface;
+  }
+  const cache::Key key{"interface", "", node.name, ast::INTERFACE_VERSION, key_source};
+  if (opts.cache != nullptr) {
+    auto cached = opts.cache->load(key);
+    if (cached.has_value()) {
+      return std::move(cached.value());
+    }
+  }
+
+  Lexer             lex(source);
+  const ast::Module mod = parse_module(lex, imported);
+
+  std::ostringstream interface;
+  mod.to_interface(interface);
+  if (opts.cache != nullptr) {
+    opts.cache->store(key, interface.str());
+  }
+  return interface.str();
+}
+
+// Loads every import of the source, and returns the interfaces of those that it lists itself, in
+// that order.
+std::vector<std::string> load_interfaces(const std::string_view source, const ParseOptions& opts) {
+  // The whole graph is found up front, which only lexes the start of each file, so that a module
+  // imported by several others is loaded just once, and cycles are caught before any of it is.
+  ImportGraph              graph(opts.import_dirs);
+  std::vector<std::string> importers;
+  std::vector<size_t>      roots;
+  for (const auto& path : scan_imports(source)) {
+    roots.push_back(graph.add(opts.import_dir, path, importers));
+  }
+
+  const std::vector<Import>& imports = graph.imports();
+  if (opts.imported != nullptr) {
+    for (const auto& node : imports) {
+      opts.imported->push_back(node.name);
+    }
+  }
+
+  // The imports at each depth are independent of each other, so they're loaded concurrently once
+  // everything below them has been.
+  std::vector<std::string> interfaces(imports.size());
+  for (size_t depth = 0;; ++depth) {
+    std::vector<size_t> level;
+    for (size_t i = 0; i < imports.size(); ++i) {
+      if (imports[i].depth == depth) {
+        level.push_back(i);
+      }
+    }
+    if (level.empty()) {
+      break;
+    }
+
+    ast::parallel_for(level.size(), opts.jobs, [&](const size_t i) {
+      interfaces[level[i]] = load_interface(imports[level[i]], interfaces, opts);
+    });
+  }
+
+  std::vector<std::string> result;
+  result.reserve(roots.size());
+  for (const size_t index : roots) {
+    result.push_back(interfaces[index]);
+  }
+  return result;
+}
+
+}  // namespace
+
+ast::Module parse(Lexer& lex, const ParseOptions& opts) {
+  const auto interfaces = load_interfaces(lex.remaining(), opts);
+  return parse_module(lex, interfaces);
+}
+
 }  // namespace crystal::compiler::parser
@@ -1,10 +1,38 @@
 #pragma once
 
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
 #include "crystal/compiler/ast/module.hpp"
+#include "crystal/compiler/cache/cache.hpp"
 #include "crystal/compiler/parser/lexer.hpp"
 
 namespace crystal::compiler::parser {
 
-ast::Module parse(Lexer& lex);
+struct ParseOptions {
+  // The directory that the paths of imports are relative to, which is usually the one that holds
+  // the file being parsed.
+  std::filesystem::path import_dir;
+
+  // Further directories to look for an import in, when it isn't found relative to the file that
+  // imports it.
+  std::vector<std::filesystem::path> import_dirs;
+
+  // Optional cache of the interfaces of imported modules. When set, an import is only parsed again
+  // if it, or anything it imports, changed since its interface was cached.
+  cache::Cache* cache = nullptr;
+
+  // The maximum number of imports to load concurrently.
+  uint32_t jobs = 1;
+
+  // Optional list that receives the canonical path of every file that the module imports, directly
+  // or not.
+  std::vector<std::string>* imported = nullptr;
+};
+
+// Parses and type checks a module, after declaring the types of everything that it imports.
+ast::Module parse(Lexer& lex, const ParseOptions& opts = {});
 
 }  // namespace crystal::compiler::parser
@@ -0,0 +1,115 @@
+#include "crystal/compiler/parser/source_file.hpp"
+
+#include <utility>
+
+#include "util/msg/msg.hpp"
+
+#if _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else  // ^^^ _WIN32 / !_WIN32 vvv
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // ^^^ !_WIN32
+
+namespace crystal::compiler::parser {
+
+SourceFile SourceFile::map(const std::string& file_name) {
+  SourceFile file;
+
+#if _WIN32
+  const HANDLE handle = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (handle == INVALID_HANDLE_VALUE) {
+    util::msg::fatal("failed to open source file [", file_name, "]");
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(handle, &size)) {
+    CloseHandle(handle);
+    util::msg::fatal("failed to read the size of source file [", file_name, "]");
+  }
+
+  // Empty files cannot be mapped, and there is nothing to lex in them anyway.
+  if (size.QuadPart > 0) {
+    const HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+      CloseHandle(handle);
+      util::msg::fatal("failed to map source file [", file_name, "]");
+    }
+
+    // The view keeps the mapping (and the file) alive, so both handles can be closed right away.
+    const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data == nullptr) {
+      CloseHandle(handle);
+      util::msg::fatal("failed to map source file [", file_name, "]");
+    }
+
+    file.data_ = static_cast<const char*>(data);
+    file.size_ = static_cast<size_t>(size.QuadPart);
+  }
+  CloseHandle(handle);
+#else   // ^^^ _WIN32 / !_WIN32 vvv
+  const int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    util::msg::fatal("failed to open source file [", file_name, "]");
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    util::msg::fatal("failed to read the size of source file [", file_name, "]");
+  }
+
+  // Empty files cannot be mapped, and there is nothing to lex in them anyway.
+  if (st.st_size > 0) {
+    void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      util::msg::fatal("failed to map source file [", file_name, "]");
+    }
+
+    file.data_ = static_cast<const char*>(data);
+    file.size_ = static_cast<size_t>(st.st_size);
+  }
+
+  // The mapping holds its own reference to the file.
+  close(fd);
+#endif  // ^^^ !_WIN32
+
+  return file;
+}
+
+SourceFile::~SourceFile() { unmap_(); }
+
+SourceFile::SourceFile(SourceFile&& other)
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+SourceFile& SourceFile::operator=(SourceFile&& other) {
+  if (this != &other) {
+    unmap_();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+  }
+  return *this;
+}
+
+void SourceFile::unmap_() {
+  if (data_ == nullptr) {
+    return;
+  }
+
+#if _WIN32
+  UnmapViewOfFile(data_);
+#else   // ^^^ _WIN32 / !_WIN32 vvv
+  munmap(const_cast<char*>(data_), size_);
+#endif  // ^^^ !_WIN32
+
+  data_ = nullptr;
+  size_ = 0;
+}
+
+}  // namespace crystal::compiler::parser
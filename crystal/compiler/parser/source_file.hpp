@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace crystal::compiler::parser {
+
+// The contents of a source file, mapped read-only into memory instead of being read into a buffer.
+//
+// The lexer and the tokens it produces point straight into the mapping, so it must outlive both.
+class SourceFile {
+  const char* data_ = nullptr;
+  size_t      size_ = 0;
+
+public:
+  [[nodiscard]] static SourceFile map(const std::string& file_name);
+
+  SourceFile() = default;
+  ~SourceFile();
+
+  SourceFile(const SourceFile&) = delete;
+  SourceFile& operator=(const SourceFile&) = delete;
+
+  SourceFile(SourceFile&& other);
+  SourceFile& operator=(SourceFile&& other);
+
+  [[nodiscard]] std::string_view contents() const { return std::string_view(data_, size_); }
+
+private:
+  void unmap_();
+};
+
+}  // namespace crystal::compiler::parser
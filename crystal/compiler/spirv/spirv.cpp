@@ -0,0 +1,122 @@
+#include "crystal/compiler/spirv/spirv.hpp"
+
+#include <sstream>
+#include <string>
+
+#include "SPIRV/GlslangToSpv.h"
+#include "StandAlone/ResourceLimits.h"
+#include "glslang/Public/ShaderLang.h"
+#include "spirv-tools/linker.hpp"
+#include "util/msg/msg.hpp"
+
+namespace crystal::compiler::spirv {
+
+namespace {
+
+// The same glsl version used by `glslangValidator` when none is given on the command line.
+constexpr int DEFAULT_VERSION = 100;
+
+constexpr EShMessages MESSAGES = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+
+void initialize_process() {
+  // glslang must be initialized exactly once per process, before any shader is compiled. The
+  // process is never explicitly finalized, as the compiler exits as soon as it is done.
+  static const bool initialized = glslang::InitializeProcess();
+  if (!initialized) {
+    util::msg::fatal("initializing glslang");
+  }
+}
+
+EShLanguage to_glslang_stage(Stage stage) {
+  switch (stage) {
+    case Stage::Vertex:
+      return EShLangVertex;
+    case Stage::Fragment:
+      return EShLangFragment;
+    case Stage::Compute:
+      return EShLangCompute;
+    default:
+      util::msg::fatal("unhandled shader stage [", static_cast<uint32_t>(stage), "]");
+      break;
+  }
+  return EShLangCount;
+}
+
+}  // namespace
+
+std::vector<uint32_t> compile_glsl(std::string_view source, Stage stage,
+                                   std::string_view entry_point) {
+  initialize_process();
+
+  const EShLanguage glslang_stage = to_glslang_stage(stage);
+  const std::string entry_point_name(entry_point);
+
+  // The shader must outlive the program that references it.
+  glslang::TShader shader(glslang_stage);
+  const char* const source_strings[] = {source.data()};
+  const int         source_lengths[] = {static_cast<int>(source.size())};
+  shader.setStringsWithLengths(source_strings, source_lengths, 1);
+  shader.setEntryPoint(entry_point_name.c_str());
+  shader.setSourceEntryPoint("main");
+  shader.setEnvInput(glslang::EShSourceGlsl, glslang_stage, glslang::EShClientVulkan,
+                     DEFAULT_VERSION);
+  shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_0);
+  shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_0);
+
+  if (!shader.parse(&glslang::DefaultTBuiltInResource, DEFAULT_VERSION, false, MESSAGES)) {
+    util::msg::fatal("compiling shader [", entry_point, "]:\n", shader.getInfoLog());
+  }
+
+  glslang::TProgram program;
+  program.addShader(&shader);
+  if (!program.link(MESSAGES)) {
+    util::msg::fatal("linking shader [", entry_point, "]:\n", program.getInfoLog());
+  }
+
+  std::vector<uint32_t> spv;
+  spv::SpvBuildLogger   logger;
+  glslang::GlslangToSpv(*program.getIntermediate(glslang_stage), spv, &logger);
+
+  return spv;
+}
+
+std::vector<uint32_t> link(const std::vector<std::vector<uint32_t>>& modules) {
+  // Use the same target environment as the `spirv-link` executable defaults to.
+  spvtools::Context context(SPV_ENV_UNIVERSAL_1_5);
+
+  // Errors are collected for the fatal message below, anything less severe is reported as it comes.
+  std::string errors;
+  context.SetMessageConsumer([&](spv_message_level_t level, const char* source,
+                                 const spv_position_t& position, const char* message) {
+    std::ostringstream diagnostic;
+    if (source != nullptr && source[0] != '\0') {
+      diagnostic << source << ":";
+    }
+    diagnostic << position.line << ":" << position.column << ": " << message;
+
+    switch (level) {
+      case SPV_MSG_FATAL:
+      case SPV_MSG_INTERNAL_ERROR:
+      case SPV_MSG_ERROR:
+        errors += diagnostic.str();
+        errors += "\n";
+        break;
+      case SPV_MSG_WARNING:
+      case SPV_MSG_INFO:
+        util::msg::info("linking spir-v modules: ", diagnostic.str());
+        break;
+      default:
+        util::msg::debug("linking spir-v modules: ", diagnostic.str());
+        break;
+    }
+  });
+
+  std::vector<uint32_t> linked;
+  if (spvtools::Link(context, modules, &linked) != SPV_SUCCESS) {
+    util::msg::fatal("linking spir-v modules:\n", errors);
+  }
+
+  return linked;
+}
+
+}  // namespace crystal::compiler::spirv
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace crystal::compiler::spirv {
+
+enum class Stage {
+  Undefined = 0,
+  Vertex,
+  Fragment,
+  Compute,
+};
+
+// The short name of the stage, as glslangValidator spells it.
+constexpr std::string_view stage_name(const Stage stage) {
+  switch (stage) {
+    case Stage::Vertex:
+      return "vert";
+    case Stage::Fragment:
+      return "frag";
+    case Stage::Compute:
+      return "comp";
+    default:
+      return "";
+  }
+}
+
+// Identifies the in-process glsl compiler and linker. This must be changed whenever the glslang or
+// SPIRV-Tools dependencies are updated, so that any previously cached output is invalidated.
+constexpr std::string_view TOOL_VERSION =
+    "glslang@701d46d3496df266413749efa79c2b093c241cd2,"
+    "spirv_tools@4879e3b7851e4c0c165b0364fc748d0be598c0af";
+
+// Compiles a single glsl shader stage to spir-v in memory. The `main` function in the source is
+// renamed to `entry_point`.
+//
+// This is the in-process equivalent of:
+//   glslangValidator -Os -V -S <stage> -e <entry_point> --source-entrypoint main
+[[nodiscard]] std::vector<uint32_t> compile_glsl(std::string_view source, Stage stage,
+                                                 std::string_view entry_point);
+
+// Merges the individual spir-v modules into a single monolithic library.
+//
+// This is the in-process equivalent of:
+//   spirv-link -o <out> <modules...>
+[[nodiscard]] std::vector<uint32_t> link(const std::vector<std::vector<uint32_t>>& modules);
+
+}  // namespace crystal::compiler::spirv
@@ -0,0 +1,180 @@
+#include "crystal/compiler/trace/trace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+#include "util/msg/msg.hpp"
+
+#if __linux__ || __APPLE__
+#include <sys/resource.h>
+#endif  // ^^^ __linux__ || __APPLE__
+
+namespace crystal::compiler::trace {
+
+namespace {
+
+void write_json_string(std::ostream& out, const std::string_view str) {
+  out << '"';
+  for (const char c : str) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buffer[8];
+      std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+      out << buffer;
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+// Eg: "12.345ms".
+std::string format_ms(const int64_t us) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.3fms", static_cast<double>(us) / 1000.0);
+  return buffer;
+}
+
+}  // namespace
+
+int64_t Trace::now() const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                               start_)
+      .count();
+}
+
+void Trace::add_event(Event event) {
+  std::lock_guard lock(mutex_);
+  events_.emplace_back(std::move(event));
+}
+
+void Trace::add_stat(const std::string_view name, const int64_t value) {
+  std::lock_guard lock(mutex_);
+  const auto      it = std::find_if(stats_.begin(), stats_.end(),
+                                    [&](const Stat& stat) { return stat.name == name; });
+  if (it == stats_.end()) {
+    stats_.push_back(Stat{std::string(name), value});
+  } else {
+    it->value += value;
+  }
+}
+
+void Trace::report_times() {
+  struct Total {
+    std::string_view name;
+    int64_t          duration_us;
+    uint32_t         count;
+  };
+
+  std::lock_guard lock(mutex_);
+
+  // Events are added as they end, so a phase is listed after the ones nested inside of it unless
+  // they are sorted by when they started.
+  std::vector<const Event*> events;
+  for (const auto& event : events_) {
+    events.push_back(&event);
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const Event* a, const Event* b) { return a->start_us < b->start_us; });
+
+  std::vector<Total> totals;
+  for (const auto event : events) {
+    const auto it = std::find_if(totals.begin(), totals.end(),
+                                 [&](const Total& total) { return total.name == event->name; });
+    if (it == totals.end()) {
+      totals.push_back(Total{event->name, event->duration_us, 1});
+    } else {
+      it->duration_us += event->duration_us;
+      ++it->count;
+    }
+  }
+
+  // Phases that ran concurrently, once for each pipeline, are summed across every job.
+  util::msg::info("time passes:");
+  for (const auto& total : totals) {
+    if (total.count == 1) {
+      util::msg::info("  ", total.name, ": ", format_ms(total.duration_us));
+    } else {
+      util::msg::info("  ", total.name, ": ", format_ms(total.duration_us), " (", total.count,
+                      " times)");
+    }
+  }
+}
+
+void Trace::report_stats() {
+  std::lock_guard lock(mutex_);
+  util::msg::info("stats:");
+  for (const auto& stat : stats_) {
+    util::msg::info("  ", stat.name, ": ", stat.value);
+  }
+
+  const int64_t rss = peak_rss();
+  if (rss > 0) {
+    util::msg::info("  peak rss: ", rss / 1024, " KiB");
+  }
+}
+
+void Trace::write_chrome_trace(std::ostream& out) {
+  std::lock_guard lock(mutex_);
+
+  // Thread ids are numbered in the order that they're first seen, so that the compiling thread is
+  // always listed first.
+  std::vector<std::thread::id> threads;
+
+  out << "{\"traceEvents\":[";
+  for (size_t i = 0; i < events_.size(); ++i) {
+    const Event& event = events_[i];
+    auto         it    = std::find(threads.begin(), threads.end(), event.thread);
+    if (it == threads.end()) {
+      it = threads.insert(threads.end(), event.thread);
+    }
+
+    out << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+    write_json_string(out, event.name);
+    out << ",\"cat\":\"crystal\",\"ph\":\"X\",\"ts\":" << event.start_us
+        << ",\"dur\":" << event.duration_us << ",\"pid\":1,\"tid\":" << (it - threads.begin() + 1);
+    if (!event.detail.empty()) {
+      out << ",\"args\":{\"detail\":";
+      write_json_string(out, event.detail);
+      out << "}";
+    }
+    out << "}";
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+Span::Span(Trace* const trace, const std::string_view name, const std::string_view detail)
+    : trace_(trace) {
+  if (trace_ != nullptr) {
+    name_     = name;
+    detail_   = detail;
+    start_us_ = trace_->now();
+  }
+}
+
+Span::~Span() {
+  if (trace_ != nullptr) {
+    trace_->add_event(Event{std::move(name_), std::move(detail_), start_us_,
+                            trace_->now() - start_us_, std::this_thread::get_id()});
+  }
+}
+
+int64_t peak_rss() {
+#if __linux__ || __APPLE__
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if __APPLE__
+  return static_cast<int64_t>(usage.ru_maxrss);
+#else   // ^^^ __APPLE__ / !__APPLE__ vvv
+  return static_cast<int64_t>(usage.ru_maxrss) * 1024;
+#endif  // ^^^ !__APPLE__
+#else   // ^^^ __linux__ || __APPLE__ / !(__linux__ || __APPLE__) vvv
+  return 0;
+#endif  // ^^^ !(__linux__ || __APPLE__)
+}
+
+}  // namespace crystal::compiler::trace
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace crystal::compiler::trace {
+
+// A timed phase of the compiler, eg: "parse", or "opengl" for a single pipeline.
+struct Event {
+  std::string     name;
+  std::string     detail;
+  int64_t         start_us;
+  int64_t         duration_us;
+  std::thread::id thread;
+};
+
+// A named quantity measured along the way, eg: the number of bytes of glsl emitted.
+struct Stat {
+  std::string name;
+  int64_t     value;
+};
+
+// Collects the events and stats of a single compile. It is safe to use from multiple threads.
+class Trace {
+  const std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+
+  std::mutex         mutex_;
+  std::vector<Event> events_;
+  std::vector<Stat>  stats_;
+
+public:
+  // Microseconds since the trace was created.
+  [[nodiscard]] int64_t now() const;
+
+  void add_event(Event event);
+
+  // Adds `value` to the stat, which starts out at 0.
+  void add_stat(std::string_view name, int64_t value);
+
+  // Prints the total time spent in each phase, in the order that they first started.
+  void report_times();
+
+  // Prints every stat, along with the peak memory usage of the process.
+  void report_stats();
+
+  // Writes the events in the chrome trace event format, which can be opened by `chrome://tracing`
+  // or https://ui.perfetto.dev.
+  void write_chrome_trace(std::ostream& out);
+};
+
+// Records an event covering its own lifetime. A null trace is allowed, and records nothing.
+class Span {
+  Trace* const trace_;
+  std::string  name_;
+  std::string  detail_;
+  int64_t      start_us_ = 0;
+
+public:
+  Span(Trace* trace, std::string_view name, std::string_view detail = {});
+  ~Span();
+
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+};
+
+// Adds to a stat of the trace, if there is one.
+inline void add_stat(Trace* const trace, const std::string_view name, const int64_t value) {
+  if (trace != nullptr) {
+    trace->add_stat(name, value);
+  }
+}
+
+// The most memory that the process has had resident at once, in bytes, or 0 if it isn't known.
+[[nodiscard]] int64_t peak_rss();
+
+}  // namespace crystal::compiler::trace
@@ -19,6 +19,7 @@ concept Context = requires(T& t, const T& ct) {
   typename T::Mesh;
   typename T::Pipeline;
   typename T::RenderPass;
+  typename T::StorageBuffer;
   typename T::Texture;
   typename T::UniformBuffer;
   typename T::VertexBuffer;
@@ -91,6 +92,18 @@ concept Context = requires(T& t, const T& ct) {
   }
   ->std::same_as<void>;
 
+  { t.create_storage_buffer(std::declval<size_t>()) }
+  ->std::same_as<typename T::StorageBuffer>;
+
+  { t.create_storage_buffer(std::declval<const void* const>(), std::declval<const size_t>()) }
+  ->std::same_as<typename T::StorageBuffer>;
+
+  {
+    t.update_storage_buffer(std::declval<typename T::StorageBuffer&>(),
+                            std::declval<const void* const>(), std::declval<const size_t>())
+  }
+  ->std::same_as<void>;
+
   { t.create_index_buffer(std::declval<const size_t>()) }
   ->std::same_as<typename T::IndexBuffer>;
 
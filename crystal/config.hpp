@@ -6,6 +6,7 @@ namespace crystal {
 
 constexpr const uint32_t MAX_UNIFORM_BINDINGS       = 8;
 constexpr const uint32_t MAX_TEXTURE_BINDINGS       = 8;
+constexpr const uint32_t MAX_STORAGE_BINDINGS       = 8;
 constexpr const uint32_t MAX_VERTEX_BUFFER_BINDINGS = 8;
 constexpr const uint32_t MAX_VERTEX_ATTRIBUTES      = 16;
 constexpr const uint32_t MAX_RENDER_TEXTURES        = 4;
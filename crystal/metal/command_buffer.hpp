@@ -10,6 +10,7 @@ class Context;
 class Mesh;
 class Pipeline;
 class RenderPass;
+class StorageBuffer;
 class UniformBuffer;
 class Texture;
 
@@ -32,6 +33,7 @@ public:
   void use_render_pass(const RenderPass& render_pass);
   void use_pipeline(const Pipeline& pipeline);
   void use_uniform_buffer(const UniformBuffer& uniform_buffer, uint32_t binding);
+  void use_storage_buffer(const StorageBuffer& storage_buffer, uint32_t binding);
   void use_texture(const Texture& texture, uint32_t binding);
 
   void draw(const Mesh& mesh, uint32_t vertex_or_index_count, uint32_t instance_count);
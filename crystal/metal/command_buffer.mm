@@ -5,6 +5,7 @@
 #include "crystal/metal/mesh.hpp"
 #include "crystal/metal/pipeline.hpp"
 #include "crystal/metal/render_pass.hpp"
+#include "crystal/metal/storage_buffer.hpp"
 #include "crystal/metal/texture.hpp"
 #include "crystal/metal/uniform_buffer.hpp"
 #include "util/msg/msg.hpp"
@@ -62,6 +63,16 @@ void CommandBuffer::use_uniform_buffer(const UniformBuffer& uniform_buffer, uint
   [render_encoder_ setFragmentBuffer:uniform_buffer.buffer_ offset:0 atIndex:index];
 }
 
+void CommandBuffer::use_storage_buffer(const StorageBuffer& storage_buffer, uint32_t binding) {
+  if (pipeline_ == nullptr) {
+    util::msg::fatal("using storage buffer at binding [", binding, "] without a pipeline bound");
+  }
+
+  const auto index = pipeline_->storage_[binding];
+  [render_encoder_ setVertexBuffer:storage_buffer.buffer_ offset:0 atIndex:index];
+  [render_encoder_ setFragmentBuffer:storage_buffer.buffer_ offset:0 atIndex:index];
+}
+
 void CommandBuffer::use_texture(const Texture& texture, uint32_t binding) {
   [render_encoder_ setFragmentTexture:texture.texture_ atIndex:binding];
   [render_encoder_ setFragmentSamplerState:texture.sampler_ atIndex:binding];
@@ -13,6 +13,7 @@
 #include "crystal/metal/mtl.hpp"
 #include "crystal/metal/pipeline.hpp"
 #include "crystal/metal/render_pass.hpp"
+#include "crystal/metal/storage_buffer.hpp"
 #include "crystal/metal/texture.hpp"
 #include "crystal/metal/uniform_buffer.hpp"
 #include "crystal/metal/vertex_buffer.hpp"
@@ -31,6 +32,7 @@ class Library;
 class Mesh;
 class Pipeline;
 class RenderPass;
+class StorageBuffer;
 class Texture;
 class UniformBuffer;
 class VertexBuffer;
@@ -43,6 +45,7 @@ public:
   using Mesh          = ::crystal::metal::Mesh;
   using Pipeline      = ::crystal::metal::Pipeline;
   using RenderPass    = ::crystal::metal::RenderPass;
+  using StorageBuffer = ::crystal::metal::StorageBuffer;
   using Texture       = ::crystal::metal::Texture;
   using UniformBuffer = ::crystal::metal::UniformBuffer;
   using VertexBuffer  = ::crystal::metal::VertexBuffer;
@@ -84,6 +87,7 @@ private:
   friend Mesh;
   friend Pipeline;
   friend RenderPass;
+  friend StorageBuffer;
   friend Texture;
   friend UniformBuffer;
   friend VertexBuffer;
@@ -147,6 +151,20 @@ inline void Context::update_vertex_buffer(VertexBuffer& vertex_buffer, const voi
   vertex_buffer.update(data_ptr, byte_length);
 }
 
+inline StorageBuffer Context::create_storage_buffer(size_t byte_length) {
+  return StorageBuffer(device_, byte_length);
+}
+
+inline StorageBuffer Context::create_storage_buffer(const void* const data_ptr,
+                                                    const size_t      byte_length) {
+  return StorageBuffer(device_, data_ptr, byte_length);
+}
+
+inline void Context::update_storage_buffer(StorageBuffer&    storage_buffer,
+                                           const void* const data_ptr, const size_t byte_length) {
+  storage_buffer.update(data_ptr, byte_length);
+}
+
 inline IndexBuffer Context::create_index_buffer(size_t byte_length) {
   return IndexBuffer(device_, byte_length);
 }
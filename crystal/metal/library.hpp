@@ -2,6 +2,7 @@
 
 #include <string_view>
 
+#include "crystal/common/pipeline_index.hpp"
 #include "crystal/common/proto/proto.hpp"
 #include "crystal/metal/mtl.hpp"
 
@@ -14,6 +15,7 @@ class Pipeline;
 class Library {
   OBJC(MTLLibrary) library_ = nullptr;
   common::proto::Library lib_pb_;
+  common::PipelineIndex  index_;
 
 public:
   Library() = default;
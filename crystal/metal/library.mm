@@ -14,6 +14,7 @@ Library::Library(OBJC(MTLDevice) device, const std::string_view file_path) {
   if (!lib_pb_.ParseFromIstream(&input_file)) {
     util::msg::fatal("parsing crystal library from file [", file_path, "]");
   }
+  index_ = common::PipelineIndex(lib_pb_, lib_pb_.metal().pipelines());
 
   dispatch_data_t data =
       dispatch_data_create(lib_pb_.metal().library().c_str(), lib_pb_.metal().library().size(),
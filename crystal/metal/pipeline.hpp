@@ -19,9 +19,10 @@ class RenderPass;
 class Pipeline {
   OBJC(MTLRenderPipelineState) render_pipeline_        = nullptr;
   OBJC(MTLDepthStencilState) depth_stencil_state_      = nullptr;
-  MTLCullMode                               cull_mode_ = {};
-  MTLWinding                                winding_   = {};
-  std::array<uint32_t, MAX_UNIFORM_BUFFERS> uniforms_  = {};
+  MTLCullMode                                cull_mode_ = {};
+  MTLWinding                                 winding_   = {};
+  std::array<uint32_t, MAX_UNIFORM_BINDINGS> uniforms_  = {};
+  std::array<uint32_t, MAX_STORAGE_BINDINGS> storage_   = {};
 
 public:
   constexpr Pipeline() = default;
@@ -13,12 +13,14 @@ Pipeline::Pipeline(Pipeline&& other)
       depth_stencil_state_(other.depth_stencil_state_),
       cull_mode_(other.cull_mode_),
       winding_(other.winding_),
-      uniforms_(std::move(other.uniforms_)) {
+      uniforms_(std::move(other.uniforms_)),
+      storage_(std::move(other.storage_)) {
   other.render_pipeline_     = nullptr;
   other.depth_stencil_state_ = nullptr;
   other.cull_mode_           = MTLCullModeNone;
   other.winding_             = MTLWindingClockwise;
   other.uniforms_            = {};
+  other.storage_             = {};
 }
 
 Pipeline& Pipeline::operator=(Pipeline&& other) {
@@ -29,12 +31,14 @@ Pipeline& Pipeline::operator=(Pipeline&& other) {
   cull_mode_           = other.cull_mode_;
   winding_             = other.winding_;
   uniforms_            = std::move(other.uniforms_);
+  storage_             = std::move(other.storage_);
 
   other.render_pipeline_     = nullptr;
   other.depth_stencil_state_ = nullptr;
   other.cull_mode_           = MTLCullModeNone;
   other.winding_             = MTLWindingClockwise;
   other.uniforms_            = {};
+  other.storage_             = {};
 
   return *this;
 }
@@ -47,6 +51,7 @@ void Pipeline::destroy() noexcept {
   cull_mode_           = MTLCullModeNone;
   winding_             = MTLWindingClockwise;
   uniforms_            = {};
+  storage_             = {};
 }
 
 Pipeline::Pipeline(OBJC(MTLDevice) device, Library& library, RenderPass& render_pass,
@@ -77,38 +82,97 @@ Pipeline::Pipeline(OBJC(MTLDevice) device, Library& library, RenderPass& render_
                           : MTLVertexStepFunctionPerInstance;
                 });
 
-  std::string vertex_name;
-  std::string fragment_name;
-  const auto& metal_pb = library.lib_pb_.metal();
-  for (int i = 0; i < metal_pb.pipelines_size(); ++i) {
-    const auto& pipeline_pb = metal_pb.pipelines(i);
-    if (pipeline_pb.name() != desc.name) {
-      continue;
-    }
+  const int index = library.index_.find(desc.name, desc.features);
+  if (index < 0) {
+    util::msg::fatal("pipeline named [", desc.name, "] with features [", desc.features,
+                     "] not found");
+  }
+  const auto& pipeline_pb = library.lib_pb_.metal().pipelines(index);
 
-    vertex_name   = pipeline_pb.vertex_name();
-    fragment_name = pipeline_pb.fragment_name();
+  const std::string          vertex_name     = pipeline_pb.vertex_name();
+  const std::string          fragment_name   = pipeline_pb.fragment_name();
+  MTLFunctionConstantValues* constant_values = nullptr;
+
+  // Initialize the uniforms.
+  uniforms_ = {};
+  for (int i = 0; i < pipeline_pb.uniforms_size(); ++i) {
+    const auto& uniform_pb          = pipeline_pb.uniforms(i);
+    uniforms_[uniform_pb.binding()] = uniform_pb.actual();
+  }
 
-    // Initialize the uniforms.
-    uniforms_ = {};
-    for (int i = 0; i < pipeline_pb.uniforms_size(); ++i) {
-      const auto& uniform_pb          = pipeline_pb.uniforms(i);
-      uniforms_[uniform_pb.binding()] = uniform_pb.actual();
+  // Initialize the storage buffers, which follow the uniforms.
+  storage_ = {};
+  for (int i = 0; i < pipeline_pb.storage_size(); ++i) {
+    const auto& storage_pb         = pipeline_pb.storage(i);
+    storage_[storage_pb.binding()] = storage_pb.actual();
+  }
+
+  // Set the overridden constants. The functions fall back to the defaults for the others, but
+  // still have to be specialized.
+  if (pipeline_pb.constants_size() > 0) {
+    constant_values = [[MTLFunctionConstantValues alloc] init];
+  }
+  for (const auto& constant : desc.constants) {
+    const crystal::common::proto::MTLConstant* constant_pb = nullptr;
+    for (const auto& check_constant_pb : pipeline_pb.constants()) {
+      if (check_constant_pb.id() == constant.id) {
+        constant_pb = &check_constant_pb;
+        break;
+      }
+    }
+    if (constant_pb == nullptr) {
+      util::msg::fatal("pipeline [", desc.name, "] has no constant [", constant.id, "]");
     }
 
-    break;
+    switch (constant_pb->type()) {
+      case crystal::common::proto::CONSTANT_BOOL: {
+        const bool value = constant.value != 0.0;
+        [constant_values setConstantValue:&value
+                                     type:MTLDataTypeBool
+                                  atIndex:constant_pb->actual()];
+        break;
+      }
+      case crystal::common::proto::CONSTANT_INT: {
+        const int32_t value = static_cast<int32_t>(constant.value);
+        [constant_values setConstantValue:&value
+                                     type:MTLDataTypeInt
+                                  atIndex:constant_pb->actual()];
+        break;
+      }
+      default: {
+        const float value = static_cast<float>(constant.value);
+        [constant_values setConstantValue:&value
+                                     type:MTLDataTypeFloat
+                                  atIndex:constant_pb->actual()];
+        break;
+      }
+    }
   }
 
+  const auto make_function = [&](const std::string& name) -> id<MTLFunction> {
+    NSString* const ns_name = [NSString stringWithCString:name.c_str()
+                                                 encoding:NSUTF8StringEncoding];
+    if (constant_values == nullptr) {
+      return [library.library_ newFunctionWithName:ns_name];
+    }
+
+    NSError*        error    = nullptr;
+    id<MTLFunction> function = [library.library_ newFunctionWithName:ns_name
+                                                      constantValues:constant_values
+                                                               error:&error];
+    if (error != nullptr) {
+      const char* error_message = [[error localizedDescription] UTF8String];
+      util::msg::fatal("specializing function [", name, "]: ", error_message);
+    }
+    return function;
+  };
+
   MTLRenderPipelineDescriptor* pipeline_state_desc = [[MTLRenderPipelineDescriptor alloc] init];
-  id<MTLFunction>              vertex_function =
-      [library.library_ newFunctionWithName:[NSString stringWithCString:vertex_name.c_str()
-                                                               encoding:NSUTF8StringEncoding]];
-  id<MTLFunction> fragment_function = nullptr;
+  id<MTLFunction>              vertex_function     = make_function(vertex_name);
+  id<MTLFunction>              fragment_function   = nullptr;
 
   if (fragment_name.size() > 0) {
-    fragment_function =
-        [library.library_ newFunctionWithName:[NSString stringWithCString:fragment_name.c_str()
-                                                                 encoding:NSUTF8StringEncoding]];
+    fragment_function = make_function(fragment_name);
   }
 
   [pipeline_state_desc setVertexDescriptor:vertex_descriptor];
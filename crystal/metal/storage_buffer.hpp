@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+
+#include "crystal/metal/mtl.hpp"
+
+namespace crystal::metal {
+
+class Context;
+class CommandBuffer;
+
+// A buffer that the vertex and fragment functions read from, such as one holding a transform per
+// instance.
+class StorageBuffer {
+  OBJC(MTLBuffer) buffer_ = nullptr;
+  size_t capacity_        = 0;
+
+public:
+  constexpr StorageBuffer() = default;
+
+  StorageBuffer(const StorageBuffer&) = delete;
+  StorageBuffer& operator=(const StorageBuffer&) = delete;
+
+  StorageBuffer(StorageBuffer&& other);
+  StorageBuffer& operator=(StorageBuffer&& other);
+
+  ~StorageBuffer();
+
+  void destroy() noexcept;
+
+  void update(const void* const data_ptr, const size_t byte_length) noexcept;
+
+private:
+  friend class ::crystal::metal::Context;
+  friend class ::crystal::metal::CommandBuffer;
+
+  StorageBuffer(OBJC(MTLDevice) device, const size_t byte_length);
+  StorageBuffer(OBJC(MTLDevice) device, const void* const data_ptr, const size_t byte_length);
+};
+
+}  // namespace crystal::metal
@@ -0,0 +1,56 @@
+#include "crystal/metal/storage_buffer.hpp"
+
+#include "crystal/metal/context.hpp"
+#include "util/msg/msg.hpp"
+
+namespace crystal::metal {
+
+StorageBuffer::StorageBuffer(StorageBuffer&& other)
+    : buffer_(other.buffer_), capacity_(other.capacity_) {
+  other.buffer_   = nullptr;
+  other.capacity_ = 0;
+}
+
+StorageBuffer& StorageBuffer::operator=(StorageBuffer&& other) {
+  destroy();
+
+  buffer_   = other.buffer_;
+  capacity_ = other.capacity_;
+
+  other.buffer_   = nullptr;
+  other.capacity_ = 0;
+
+  return *this;
+}
+
+StorageBuffer::~StorageBuffer() { destroy(); }
+
+void StorageBuffer::destroy() noexcept {
+  buffer_   = nullptr;
+  capacity_ = 0;
+}
+
+void StorageBuffer::update(const void* const data_ptr, const size_t byte_length) noexcept {
+  if (byte_length > capacity_) {
+    util::msg::fatal("updating storage buffer that has capacity [", capacity_,
+                     "] with data that exceeds that capacity at length [", byte_length, "]");
+  }
+
+  memcpy([buffer_ contents], data_ptr, byte_length);
+  [buffer_ didModifyRange:NSRange{0, byte_length}];
+}
+
+StorageBuffer::StorageBuffer(OBJC(MTLDevice) device, const size_t byte_length)
+    : buffer_(nullptr), capacity_(byte_length) {
+  buffer_ = [device newBufferWithLength:byte_length options:MTLResourceStorageModeManaged];
+}
+
+StorageBuffer::StorageBuffer(OBJC(MTLDevice) device, const void* const data_ptr,
+                             const size_t byte_length)
+    : buffer_(nullptr), capacity_(byte_length) {
+  buffer_ = [device newBufferWithBytes:data_ptr
+                                length:byte_length
+                               options:MTLResourceStorageModeManaged];
+}
+
+}  // namespace crystal::metal
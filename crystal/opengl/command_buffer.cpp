@@ -5,6 +5,7 @@
 #include "crystal/opengl/mesh.hpp"
 #include "crystal/opengl/pipeline.hpp"
 #include "crystal/opengl/render_pass.hpp"
+#include "crystal/opengl/storage_buffer.hpp"
 #include "crystal/opengl/texture.hpp"
 #include "crystal/opengl/uniform_buffer.hpp"
 
@@ -87,7 +88,8 @@ void CommandBuffer::use_render_pass(const RenderPass& render_pass) {
 }
 
 void CommandBuffer::use_pipeline(const Pipeline& pipeline) {
-  pipeline_ = &pipeline;
+  pipeline_         = &pipeline;
+  compute_pipeline_ = nullptr;
 
   GL_ASSERT(glUseProgram(pipeline.program_), "changing active shader program");
 
@@ -138,7 +140,23 @@ void CommandBuffer::use_pipeline(const Pipeline& pipeline) {
   }
 }
 
+void CommandBuffer::use_compute_pipeline(const ComputePipeline& compute_pipeline) {
+  pipeline_         = nullptr;
+  compute_pipeline_ = &compute_pipeline;
+
+  GL_ASSERT(glUseProgram(compute_pipeline.program_), "changing active shader program");
+}
+
 void CommandBuffer::use_uniform_buffer(const UniformBuffer& uniform_buffer, uint32_t binding) {
+  if (compute_pipeline_ != nullptr) {
+    GL_ASSERT(glBindBufferBase(GL_UNIFORM_BUFFER, binding, uniform_buffer.buffer_),
+              "setting uniform buffer base");
+    GL_ASSERT(glUniformBlockBinding(compute_pipeline_->program_,
+                                    compute_pipeline_->uniforms_[binding], binding),
+              "binding uniform buffer block");
+    return;
+  }
+
   if (pipeline_ == nullptr) {
     util::msg::fatal("setting uniform buffer with no pipeline bound");
   }
@@ -149,6 +167,16 @@ void CommandBuffer::use_uniform_buffer(const UniformBuffer& uniform_buffer, uint
             "binding uniform buffer block");
 }
 
+void CommandBuffer::use_storage_buffer(const StorageBuffer& storage_buffer, uint32_t binding) {
+  if (pipeline_ == nullptr && compute_pipeline_ == nullptr) {
+    util::msg::fatal("setting storage buffer with no pipeline bound");
+  }
+
+  // The block bindings are fixed in the source, so only the buffer has to be bound.
+  GL_ASSERT(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, storage_buffer.buffer_),
+            "setting storage buffer base");
+}
+
 void CommandBuffer::use_texture(const Texture& texture, uint32_t binding) {
   if (pipeline_ == nullptr) {
     util::msg::fatal("setting texture with no pipeline bound");
@@ -215,4 +243,13 @@ void CommandBuffer::draw(const Mesh& mesh, uint32_t vertex_or_index_count,
   }
 }
 
+void CommandBuffer::dispatch(uint32_t x, uint32_t y, uint32_t z) {
+  if (compute_pipeline_ == nullptr) {
+    util::msg::fatal("dispatching with no compute pipeline bound");
+  }
+
+  GL_ASSERT(gl_dispatch_compute(x, y, z), "dispatching compute");
+  GL_ASSERT(gl_memory_barrier(GL_ALL_BARRIER_BITS), "waiting for compute writes");
+}
+
 }  // namespace crystal::opengl
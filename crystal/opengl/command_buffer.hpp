@@ -14,10 +14,12 @@ typedef struct GLFWwindow GLFWwindow;
 
 namespace crystal::opengl {
 
+class ComputePipeline;
 class Context;
 class Mesh;
 class Pipeline;
 class RenderPass;
+class StorageBuffer;
 class Texture;
 class UniformBuffer;
 
@@ -30,8 +32,9 @@ class CommandBuffer {
   GLFWwindow* glfw_window_ = nullptr;
 #endif  // ^^^ CRYSTAL_USE_GLFW
 
-  const RenderPass* render_pass_ = nullptr;
-  const Pipeline*   pipeline_    = nullptr;
+  const RenderPass*      render_pass_      = nullptr;
+  const Pipeline*        pipeline_         = nullptr;
+  const ComputePipeline* compute_pipeline_ = nullptr;
 
 public:
   CommandBuffer(const CommandBuffer&) = delete;
@@ -44,11 +47,17 @@ public:
 
   void use_render_pass(const RenderPass& render_pass);
   void use_pipeline(const Pipeline& pipeline);
+  void use_compute_pipeline(const ComputePipeline& compute_pipeline);
   void use_uniform_buffer(const UniformBuffer& uniform_buffer, uint32_t binding);
+  void use_storage_buffer(const StorageBuffer& storage_buffer, uint32_t binding);
   void use_texture(const Texture& texture, uint32_t binding);
 
   void draw(const Mesh& mesh, uint32_t vertex_or_index_count, uint32_t instance_count);
 
+  // Runs the compute pipeline in use over a grid of `x` by `y` by `z` workgroups. Everything it
+  // writes is visible to the commands that follow.
+  void dispatch(uint32_t x, uint32_t y, uint32_t z);
+
 private:
   friend class ::crystal::opengl::Context;
   friend class ::crystal::opengl::RenderPass;
@@ -22,6 +22,7 @@ Context::Context(const Context::Desc& desc) : screen_render_pass_(*this) {
 
     // gladLoadGLES2Loader(SDL_GL_GetProcAddress);
     gladLoadGLLoader(SDL_GL_GetProcAddress);
+    load_gl43(SDL_GL_GetProcAddress);
 
     SDL_GetWindowSize(sdl_window_, &width, &height);
     goto init_resize;
@@ -35,6 +36,7 @@ Context::Context(const Context::Desc& desc) : screen_render_pass_(*this) {
 
     // gladLoadGLES2Loader(glfwGetProcAddress);
     gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+    load_gl43(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
 
     glfwGetWindowSize(glfw_window_, &width, &height);
 
@@ -13,6 +13,7 @@
 #include "crystal/opengl/mesh.hpp"
 #include "crystal/opengl/pipeline.hpp"
 #include "crystal/opengl/render_pass.hpp"
+#include "crystal/opengl/storage_buffer.hpp"
 #include "crystal/opengl/texture.hpp"
 #include "crystal/opengl/uniform_buffer.hpp"
 #include "crystal/opengl/vertex_buffer.hpp"
@@ -30,26 +31,30 @@ typedef struct GLFWwindow GLFWwindow;
 namespace crystal::opengl {
 
 class CommandBuffer;
+class ComputePipeline;
 class IndexBuffer;
 class Library;
 class Mesh;
 class Pipeline;
 class RenderPass;
+class StorageBuffer;
 class Texture;
 class UniformBuffer;
 class VertexBuffer;
 
 class Context {
 public:
-  using CommandBuffer = ::crystal::opengl::CommandBuffer;
-  using IndexBuffer   = ::crystal::opengl::IndexBuffer;
-  using Library       = ::crystal::opengl::Library;
-  using Mesh          = ::crystal::opengl::Mesh;
-  using Pipeline      = ::crystal::opengl::Pipeline;
-  using RenderPass    = ::crystal::opengl::RenderPass;
-  using Texture       = ::crystal::opengl::Texture;
-  using UniformBuffer = ::crystal::opengl::UniformBuffer;
-  using VertexBuffer  = ::crystal::opengl::VertexBuffer;
+  using CommandBuffer   = ::crystal::opengl::CommandBuffer;
+  using ComputePipeline = ::crystal::opengl::ComputePipeline;
+  using IndexBuffer     = ::crystal::opengl::IndexBuffer;
+  using Library         = ::crystal::opengl::Library;
+  using Mesh            = ::crystal::opengl::Mesh;
+  using Pipeline        = ::crystal::opengl::Pipeline;
+  using RenderPass      = ::crystal::opengl::RenderPass;
+  using StorageBuffer   = ::crystal::opengl::StorageBuffer;
+  using Texture         = ::crystal::opengl::Texture;
+  using UniformBuffer   = ::crystal::opengl::UniformBuffer;
+  using VertexBuffer    = ::crystal::opengl::VertexBuffer;
 
   struct Desc {
 #if CRYSTAL_USE_SDL2
@@ -104,13 +109,19 @@ public:
 
 #include "crystal/common/context_methods.inl"
 
+  // Compute pipelines require OpenGL 4.3.
+
+  ComputePipeline create_compute_pipeline(Library& library, const ComputePipelineDesc& desc);
+
 private:
   friend CommandBuffer;
+  friend ComputePipeline;
   friend IndexBuffer;
   friend Library;
   friend Mesh;
   friend Pipeline;
   friend RenderPass;
+  friend StorageBuffer;
   friend Texture;
   friend UniformBuffer;
   friend VertexBuffer;
@@ -152,6 +163,11 @@ inline Pipeline Context::create_pipeline(Library& library, RenderPass& render_pa
   return Pipeline(*this, library, desc);
 }
 
+inline ComputePipeline Context::create_compute_pipeline(Library&                   library,
+                                                       const ComputePipelineDesc& desc) {
+  return ComputePipeline(*this, library, desc);
+}
+
 inline UniformBuffer Context::create_uniform_buffer(const size_t byte_length) {
   return UniformBuffer(*this, byte_length);
 }
@@ -166,6 +182,20 @@ inline void Context::update_uniform_buffer(UniformBuffer&    uniform_buffer,
   uniform_buffer.update(data_ptr, byte_length);
 }
 
+inline StorageBuffer Context::create_storage_buffer(const size_t byte_length) {
+  return StorageBuffer(*this, byte_length);
+}
+
+inline StorageBuffer Context::create_storage_buffer(const void* const data_ptr,
+                                                    const size_t      byte_length) {
+  return StorageBuffer(*this, data_ptr, byte_length);
+}
+
+inline void Context::update_storage_buffer(StorageBuffer&    storage_buffer,
+                                           const void* const data_ptr, const size_t byte_length) {
+  storage_buffer.update(data_ptr, byte_length);
+}
+
 inline VertexBuffer Context::create_vertex_buffer(const size_t byte_length) {
   return VertexBuffer(*this, byte_length);
 }
@@ -3,6 +3,30 @@
 #include <cstdio>
 
 #include "glad/glad_gl41.h"
+
+// Compute shaders and storage buffers need OpenGL 4.3, which the 4.1 loader leaves out. Their entry
+// points are loaded by `load_gl43`, and stay null when the driver doesn't provide them.
+
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif  // ^^^ !GL_COMPUTE_SHADER
+
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif  // ^^^ !GL_SHADER_STORAGE_BUFFER
+
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif  // ^^^ !GL_SHADER_STORAGE_BARRIER_BIT
+
+#ifndef GL_ALL_BARRIER_BITS
+#define GL_ALL_BARRIER_BITS 0xFFFFFFFF
+#endif  // ^^^ !GL_ALL_BARRIER_BITS
+
+typedef void(APIENTRYP PFNCRYSTALGLDISPATCHCOMPUTEPROC)(GLuint num_groups_x, GLuint num_groups_y,
+                                                        GLuint num_groups_z);
+typedef void(APIENTRYP PFNCRYSTALGLMEMORYBARRIERPROC)(GLbitfield barriers);
+
 #undef APIENTRY
 
 #include "util/msg/msg.hpp"
@@ -25,6 +49,23 @@
 
 #endif  // CRYSTAL_RELEASE
 
+namespace crystal::opengl {
+
+inline PFNCRYSTALGLDISPATCHCOMPUTEPROC gl_dispatch_compute = nullptr;
+inline PFNCRYSTALGLMEMORYBARRIERPROC   gl_memory_barrier   = nullptr;
+
+// Loads the OpenGL 4.3 entry points, with the same loader that was given to glad.
+inline void load_gl43(GLADloadproc load) {
+  gl_dispatch_compute =
+      reinterpret_cast<PFNCRYSTALGLDISPATCHCOMPUTEPROC>(load("glDispatchCompute"));
+  gl_memory_barrier = reinterpret_cast<PFNCRYSTALGLMEMORYBARRIERPROC>(load("glMemoryBarrier"));
+}
+
+// Returns whether the context supports compute shaders and storage buffers.
+inline bool has_gl43() { return gl_dispatch_compute != nullptr && gl_memory_barrier != nullptr; }
+
+}  // namespace crystal::opengl
+
 inline const char* glResultToString(GLenum result) {
   const char* err_msg = "<unknown>";
   switch (result) {
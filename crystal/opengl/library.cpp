@@ -14,6 +14,7 @@ Library::Library(const std::string_view file_path) {
   if (!lib_pb_.ParseFromIstream(&input_file)) {
     util::msg::fatal("parsing crystal library from file [", file_path, "]");
   }
+  index_ = common::PipelineIndex(lib_pb_, lib_pb_.opengl().pipelines());
 }
 
 }  // namespace crystal::opengl
@@ -2,16 +2,19 @@
 
 #include <string_view>
 
+#include "crystal/common/pipeline_index.hpp"
 #include "crystal/common/proto/proto.hpp"
 
 namespace crystal::opengl {
 
+class ComputePipeline;
 class Context;
 class Shader;
 class Pipeline;
 
 class Library {
   common::proto::Library lib_pb_;
+  common::PipelineIndex  index_;
 
 public:
   Library() = default;
@@ -27,6 +30,7 @@ public:
   void destroy() noexcept {}
 
 private:
+  friend class ::crystal::opengl::ComputePipeline;
   friend class ::crystal::opengl::Context;
   friend class ::crystal::opengl::Shader;
   friend class ::crystal::opengl::Pipeline;
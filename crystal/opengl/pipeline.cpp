@@ -1,5 +1,8 @@
 #include "crystal/opengl/pipeline.hpp"
 
+#include <cstdio>
+#include <string>
+
 #include "crystal/opengl/context.hpp"
 #include "crystal/opengl/library.hpp"
 #include "util/fs/file.hpp"
@@ -109,6 +112,87 @@ GLuint compile_program(GLuint program, const std::string& vertex_source,
   return program;
 }
 
+GLuint compile_compute_program(GLuint program, const std::string& compute_source) {
+  GLuint compute_shader = compile_shader(GL_COMPUTE_SHADER, compute_source);
+
+  GL_ASSERT(glAttachShader(program, compute_shader), "attaching compute shader to shader program");
+  GL_ASSERT(glDeleteShader(compute_shader), "deleting compute shader");
+
+  GL_ASSERT(glLinkProgram(program), "linking shader program");
+
+  GLint log_length = 0;
+  GL_ASSERT(glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_length),
+            "getting shader program info log length");
+  if (log_length > 0) {
+    std::vector<GLchar> log(log_length);
+    GL_ASSERT(glGetProgramInfoLog(program, log_length, &log_length, log.data()),
+              "getting shader info log");
+    std::cerr << "[OpenGL] Program link log:\n" << log.data() << "\n";
+  }
+
+  GLint status = 0;
+  GL_ASSERT(glGetProgramiv(program, GL_LINK_STATUS, &status), "getting shader program link status");
+  if (status == 0) {
+    std::cerr << "[OpenGL] Failed to link shader\n";
+    GL_ASSERT(glDeleteProgram(program), "deleting shader program");
+    return 0;
+  }
+
+  return program;
+}
+
+// Writes the value of a constant as a glsl literal of its type.
+std::string format_constant(const crystal::common::proto::ConstantType type, const double value) {
+  switch (type) {
+    case crystal::common::proto::CONSTANT_BOOL:
+      return value != 0.0 ? "true" : "false";
+    case crystal::common::proto::CONSTANT_INT:
+      return std::to_string(static_cast<int32_t>(value));
+    default: {
+      // Always with a decimal point or an exponent, so that it isn't read as an integer.
+      char buffer[32];
+      std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+      std::string str(buffer);
+      if (str.find_first_of(".e") == std::string::npos) {
+        str += ".0";
+      }
+      return str;
+    }
+  }
+}
+
+// Inserts the definitions of the overridden constants after the version line, which has to come
+// first. The sources only fall back to the defaults when these are missing.
+std::string specialize(const std::string& source, const std::string& defines) {
+  if (defines.empty()) {
+    return source;
+  }
+  const size_t line_end = source.find('\n') + 1;
+  return source.substr(0, line_end) + defines + source.substr(line_end);
+}
+
+// Returns the `#define` lines that override the defaults of the constants in `constants`.
+std::string constant_defines(const crystal::common::proto::GLPipeline& pipeline_pb,
+                             const std::string_view                   name,
+                             const std::initializer_list<ConstantDesc> constants) {
+  std::string defines;
+  for (const auto& constant : constants) {
+    const crystal::common::proto::GLConstant* constant_pb = nullptr;
+    for (const auto& check_constant_pb : pipeline_pb.constants()) {
+      if (check_constant_pb.id() == constant.id) {
+        constant_pb = &check_constant_pb;
+        break;
+      }
+    }
+    if (constant_pb == nullptr) {
+      util::msg::fatal("pipeline [", name, "] has no constant [", constant.id, "]");
+    }
+    defines += "#define " + constant_pb->name() + " " +
+               format_constant(constant_pb->type(), constant.value) + "\n";
+  }
+  return defines;
+}
+
 }  // namespace
 
 uint32_t Pipeline::next_id_ = 0;
@@ -210,45 +294,43 @@ Pipeline::Pipeline(Context& ctx, Library& library, const PipelineDesc& desc)
       depth_slope_scale_(desc.depth_slope_scale),
       blend_src_(desc.blend_src),
       blend_dst_(desc.blend_dst) {
-  const auto& opengl_pb = library.lib_pb_.opengl();
-  for (int i = 0; i < opengl_pb.pipelines_size(); ++i) {
-    const auto& pipeline_pb = opengl_pb.pipelines(i);
-    if (pipeline_pb.name() != desc.name) {
-      continue;
-    }
-
-    if (pipeline_pb.fragment_source().size() > 0) {
-      GLuint program = 0;
-      GL_ASSERT(program = glCreateProgram(), "creating shader program");
-      program_ =
-          compile_program(program, pipeline_pb.vertex_source(), pipeline_pb.fragment_source());
-    } else {
-      GLuint program = 0;
-      GL_ASSERT(program = glCreateProgram(), "creating shader program");
-      program_ = compile_program(program, pipeline_pb.vertex_source());
-    }
-
-    // Initialize the uniforms bindings.
-    uniforms_ = {};
-    for (const auto& uniform_pb : pipeline_pb.uniforms()) {
-      GL_ASSERT(uniforms_[uniform_pb.binding()] =
-                    glGetUniformBlockIndex(program_, uniform_pb.name().c_str()),
-                "getting uniform block index");
-    }
+  const int index = library.index_.find(desc.name, desc.features);
+  if (index < 0) {
+    util::msg::fatal("pipeline named [", desc.name, "] with features [", desc.features,
+                     "] not found");
+  }
+  const auto& pipeline_pb = library.lib_pb_.opengl().pipelines(index);
+  if (pipeline_pb.storage_size() > 0 && !has_gl43()) {
+    util::msg::fatal("pipeline [", desc.name, "] with storage buffers requires OpenGL 4.3");
+  }
 
-    // Initialize the texture bindings.
-    textures_ = {};
-    for (const auto& texture_pb : pipeline_pb.textures()) {
-      GL_ASSERT(textures_[texture_pb.binding()] =
-                    glGetUniformLocation(program_, texture_pb.name().c_str()),
-                "getting texture uniform location");
-    }
+  const std::string defines = constant_defines(pipeline_pb, desc.name, desc.constants);
+
+  if (pipeline_pb.fragment_source().size() > 0) {
+    GLuint program = 0;
+    GL_ASSERT(program = glCreateProgram(), "creating shader program");
+    program_ = compile_program(program, specialize(pipeline_pb.vertex_source(), defines),
+                               specialize(pipeline_pb.fragment_source(), defines));
+  } else {
+    GLuint program = 0;
+    GL_ASSERT(program = glCreateProgram(), "creating shader program");
+    program_ = compile_program(program, specialize(pipeline_pb.vertex_source(), defines));
+  }
 
-    break;
+  // Initialize the uniforms bindings.
+  uniforms_ = {};
+  for (const auto& uniform_pb : pipeline_pb.uniforms()) {
+    GL_ASSERT(uniforms_[uniform_pb.binding()] =
+                  glGetUniformBlockIndex(program_, uniform_pb.name().c_str()),
+              "getting uniform block index");
   }
 
-  if (program_ == 0) {
-    util::msg::fatal("pipeline named [", desc.name, "] not found");
+  // Initialize the texture bindings.
+  textures_ = {};
+  for (const auto& texture_pb : pipeline_pb.textures()) {
+    GL_ASSERT(textures_[texture_pb.binding()] =
+                  glGetUniformLocation(program_, texture_pb.name().c_str()),
+              "getting texture uniform location");
   }
 
   if (desc.vertex_attributes.size() > MAX_VERTEX_ATTRIBUTES) {
@@ -273,4 +355,70 @@ Pipeline::Pipeline(Context& ctx, Library& library, const PipelineDesc& desc)
   }
 }
 
+ComputePipeline::ComputePipeline(ComputePipeline&& other)
+    : ctx_(other.ctx_), program_(other.program_), uniforms_(std::move(other.uniforms_)) {
+  other.ctx_      = nullptr;
+  other.program_  = 0;
+  other.uniforms_ = {};
+}
+
+ComputePipeline& ComputePipeline::operator=(ComputePipeline&& other) {
+  destroy();
+
+  ctx_      = other.ctx_;
+  program_  = other.program_;
+  uniforms_ = std::move(other.uniforms_);
+
+  other.ctx_      = nullptr;
+  other.program_  = 0;
+  other.uniforms_ = {};
+
+  return *this;
+}
+
+ComputePipeline::~ComputePipeline() { destroy(); }
+
+void ComputePipeline::destroy() noexcept {
+  if (ctx_ == nullptr) {
+    return;
+  }
+
+  GL_ASSERT(glDeleteProgram(program_), "deleting program");
+
+  ctx_      = nullptr;
+  program_  = 0;
+  uniforms_ = {};
+}
+
+ComputePipeline::ComputePipeline(Context& ctx, Library& library, const ComputePipelineDesc& desc)
+    : ctx_(&ctx) {
+  if (!has_gl43()) {
+    util::msg::fatal("compute pipeline [", desc.name, "] requires OpenGL 4.3");
+  }
+
+  const int index = library.index_.find(desc.name, desc.features);
+  if (index < 0) {
+    util::msg::fatal("pipeline named [", desc.name, "] with features [", desc.features,
+                     "] not found");
+  }
+  const auto& pipeline_pb = library.lib_pb_.opengl().pipelines(index);
+  if (pipeline_pb.compute_source().empty()) {
+    util::msg::fatal("pipeline [", desc.name, "] is not a compute pipeline");
+  }
+
+  const std::string defines = constant_defines(pipeline_pb, desc.name, desc.constants);
+
+  GLuint program = 0;
+  GL_ASSERT(program = glCreateProgram(), "creating shader program");
+  program_ = compile_compute_program(program, specialize(pipeline_pb.compute_source(), defines));
+
+  // Initialize the uniforms bindings. The storage buffers have their bindings in the source.
+  uniforms_ = {};
+  for (const auto& uniform_pb : pipeline_pb.uniforms()) {
+    GL_ASSERT(uniforms_[uniform_pb.binding()] =
+                  glGetUniformBlockIndex(program_, uniform_pb.name().c_str()),
+              "getting uniform block index");
+  }
+}
+
 }  // namespace crystal::opengl
@@ -60,4 +60,31 @@ private:
   Pipeline(Context& ctx, Library& library, const PipelineDesc& desc);
 };
 
+// A pipeline with a compute shader, which is run with `CommandBuffer::dispatch` rather than drawn.
+// Requires OpenGL 4.3.
+class ComputePipeline {
+  Context*                                 ctx_     = nullptr;
+  GLuint                                   program_ = 0;
+  std::array<GLuint, MAX_UNIFORM_BINDINGS> uniforms_ = {};
+
+public:
+  constexpr ComputePipeline() = default;
+
+  ComputePipeline(const ComputePipeline&) = delete;
+  ComputePipeline& operator=(const ComputePipeline&) = delete;
+
+  ComputePipeline(ComputePipeline&& other);
+  ComputePipeline& operator=(ComputePipeline&& other);
+
+  ~ComputePipeline();
+
+  void destroy() noexcept;
+
+private:
+  friend class ::crystal::opengl::Context;
+  friend class ::crystal::opengl::CommandBuffer;
+
+  ComputePipeline(Context& ctx, Library& library, const ComputePipelineDesc& desc);
+};
+
 }  // namespace crystal::opengl
@@ -0,0 +1,74 @@
+#include "crystal/opengl/storage_buffer.hpp"
+
+#include "crystal/opengl/context.hpp"
+
+namespace crystal::opengl {
+
+StorageBuffer::StorageBuffer(StorageBuffer&& other)
+    : ctx_(other.ctx_), buffer_(other.buffer_), capacity_(other.capacity_) {
+  other.ctx_      = nullptr;
+  other.buffer_   = 0;
+  other.capacity_ = 0;
+}
+
+StorageBuffer& StorageBuffer::operator=(StorageBuffer&& other) {
+  destroy();
+
+  ctx_      = other.ctx_;
+  buffer_   = other.buffer_;
+  capacity_ = other.capacity_;
+
+  other.ctx_      = nullptr;
+  other.buffer_   = 0;
+  other.capacity_ = 0;
+
+  return *this;
+}
+
+StorageBuffer::~StorageBuffer() { destroy(); }
+
+void StorageBuffer::destroy() noexcept {
+  if (ctx_ == nullptr) {
+    return;
+  }
+
+  ctx_->release_buffer_(buffer_);
+
+  ctx_      = nullptr;
+  buffer_   = 0;
+  capacity_ = 0;
+}
+
+void StorageBuffer::update(const void* const data_ptr, const size_t byte_length) noexcept {
+  if (byte_length > capacity_) {
+    util::msg::fatal("updating storage buffer that has capacity [", capacity_,
+                     "] with data that exceeds that capacity at length [", byte_length, "]");
+  }
+
+  // Only replaces the start of the buffer, as compute functions may have written to the rest.
+  GL_ASSERT(glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer_), "binding storage buffer");
+  GL_ASSERT(glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, byte_length, data_ptr),
+            "updating storage buffer data");
+}
+
+StorageBuffer::StorageBuffer(Context& ctx, const size_t byte_length)
+    : ctx_(&ctx), buffer_(0), capacity_(byte_length) {
+  GL_ASSERT(glGenBuffers(1, &buffer_), "generating storage buffer");
+  ctx_->add_buffer_(buffer_);
+
+  GL_ASSERT(glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer_), "binding storage buffer");
+  GL_ASSERT(glBufferData(GL_SHADER_STORAGE_BUFFER, byte_length, nullptr, GL_DYNAMIC_COPY),
+            "reserving storage buffer capacity");
+}
+
+StorageBuffer::StorageBuffer(Context& ctx, const void* const data_ptr, const size_t byte_length)
+    : ctx_(&ctx), buffer_(0), capacity_(byte_length) {
+  GL_ASSERT(glGenBuffers(1, &buffer_), "generating storage buffer");
+  ctx_->add_buffer_(buffer_);
+
+  GL_ASSERT(glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer_), "binding storage buffer");
+  GL_ASSERT(glBufferData(GL_SHADER_STORAGE_BUFFER, byte_length, data_ptr, GL_DYNAMIC_COPY),
+            "updating storage buffer data");
+}
+
+}  // namespace crystal::opengl
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+
+#include "crystal/opengl/gl.hpp"
+
+namespace crystal::opengl {
+
+class Context;
+class CommandBuffer;
+
+// A buffer that compute functions read from and write to. Requires OpenGL 4.3.
+class StorageBuffer {
+  Context* ctx_      = nullptr;
+  GLuint   buffer_   = 0;
+  size_t   capacity_ = 0;
+
+public:
+  constexpr StorageBuffer() = default;
+
+  StorageBuffer(const StorageBuffer&) = delete;
+  StorageBuffer& operator=(const StorageBuffer&) = delete;
+
+  StorageBuffer(StorageBuffer&& other);
+  StorageBuffer& operator=(StorageBuffer&& other);
+
+  ~StorageBuffer();
+
+  void destroy() noexcept;
+
+  void update(const void* const data_ptr, const size_t byte_length) noexcept;
+
+private:
+  friend class ::crystal::opengl::Context;
+  friend class ::crystal::opengl::CommandBuffer;
+
+  StorageBuffer(Context& ctx, const size_t byte_length);
+  StorageBuffer(Context& ctx, const void* const data_ptr, const size_t byte_length);
+};
+
+}  // namespace crystal::opengl
@@ -2,6 +2,7 @@
 
 #include "crystal/vulkan/context.hpp"
 #include "crystal/vulkan/render_pass.hpp"
+#include "crystal/vulkan/storage_buffer.hpp"
 
 namespace crystal::vulkan {
 
@@ -22,10 +23,13 @@ CommandBuffer::CommandBuffer(Context& ctx, internal::Frame& frame, uint32_t fram
       frame_index_(frame_index),
       update_uniform_descriptor_set_(false),
       update_texture_descriptor_set_(false),
+      update_storage_descriptor_set_(false),
       in_render_pass_(false) {}
 
 CommandBuffer::~CommandBuffer() {
-  vkCmdEndRenderPass(command_buffer_);
+  if (in_render_pass_) {
+    vkCmdEndRenderPass(command_buffer_);
+  }
   VK_ASSERT(vkEndCommandBuffer(command_buffer_), "ending command buffer");
 
   const VkPipelineStageFlags wait_stages[1] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
@@ -148,6 +152,16 @@ void CommandBuffer::use_pipeline(const Pipeline& pipeline) {
   pipeline_layout_        = pipeline.pipeline_layout_;
   uniform_descriptor_set_ = pipeline.uniform_descriptor_sets_[frame_index_];
   texture_descriptor_set_ = pipeline.texture_descriptor_sets_[frame_index_];
+  storage_descriptor_set_ = pipeline.storage_descriptor_sets_[frame_index_];
+}
+
+void CommandBuffer::use_compute_pipeline(const ComputePipeline& compute_pipeline) {
+  vkCmdBindPipeline(command_buffer_, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline.pipeline_);
+
+  pipeline_layout_        = compute_pipeline.pipeline_layout_;
+  uniform_descriptor_set_ = compute_pipeline.uniform_descriptor_sets_[frame_index_];
+  texture_descriptor_set_ = VK_NULL_HANDLE;
+  storage_descriptor_set_ = compute_pipeline.storage_descriptor_sets_[frame_index_];
 }
 
 void CommandBuffer::use_uniform_buffer(const UniformBuffer& uniform_buffer, uint32_t binding) {
@@ -176,6 +190,36 @@ void CommandBuffer::use_uniform_buffer(const UniformBuffer& uniform_buffer, uint
   update_uniform_descriptor_set_ = true;
 }
 
+void CommandBuffer::use_storage_buffer(const StorageBuffer& storage_buffer, uint32_t binding) {
+  if (storage_descriptor_set_ == VK_NULL_HANDLE) {
+    util::msg::fatal("setting storage buffer with no pipeline that uses storage buffers bound");
+  }
+
+  {  // Update the descriptor set.
+    const VkDescriptorBufferInfo buffer_info = {
+        /* .buffer = */ storage_buffer.buffer_,
+        /* .offset = */ 0,
+        /* .range  = */ VK_WHOLE_SIZE,
+    };
+    const VkWriteDescriptorSet write_descriptor = {
+        /* .sType = */ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        /* .pNext            = */ nullptr,
+        /* .dstSet           = */ storage_descriptor_set_,
+        /* .dstBinding       = */ binding,
+        /* .dstArrayElement  = */ 0,
+        /* .descriptorCount  = */ 1,
+        /* .descriptorType   = */ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        /* .pImageInfo       = */ nullptr,
+        /* .pBufferInfo      = */ &buffer_info,
+        /* .pTexelBufferView = */ nullptr,
+    };
+
+    vkUpdateDescriptorSets(device_, 1, &write_descriptor, 0, nullptr);
+  }
+
+  update_storage_descriptor_set_ = true;
+}
+
 void CommandBuffer::use_texture(const Texture& texture, uint32_t binding) {
   {  // Update the descriptor set.
     const VkDescriptorImageInfo image_info = {
@@ -226,6 +270,12 @@ void CommandBuffer::draw(const Mesh& mesh, uint32_t vertex_or_index_count,
 
     update_texture_descriptor_set_ = false;
   }
+  if (update_storage_descriptor_set_) {
+    vkCmdBindDescriptorSets(command_buffer_, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 2,
+                            1, &storage_descriptor_set_, 0, nullptr);
+
+    update_storage_descriptor_set_ = false;
+  }
 
   const VkDeviceSize offsets[] = {0};
   for (uint32_t i = 0; i < mesh.binding_count_; ++i) {
@@ -241,4 +291,41 @@ void CommandBuffer::draw(const Mesh& mesh, uint32_t vertex_or_index_count,
   }
 }
 
+void CommandBuffer::dispatch(uint32_t x, uint32_t y, uint32_t z) {
+  if (in_render_pass_) {
+    util::msg::fatal("dispatching compute inside of a render pass");
+  }
+
+  if (update_uniform_descriptor_set_) {
+    vkCmdBindDescriptorSets(command_buffer_, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0,
+                            1, &uniform_descriptor_set_, 0, nullptr);
+
+    update_uniform_descriptor_set_ = false;
+  }
+  if (update_storage_descriptor_set_) {
+    vkCmdBindDescriptorSets(command_buffer_, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 2,
+                            1, &storage_descriptor_set_, 0, nullptr);
+
+    update_storage_descriptor_set_ = false;
+  }
+
+  vkCmdDispatch(command_buffer_, x, y, z);
+
+  {  // Make the writes visible to the shaders and vertex inputs of the commands that follow.
+    const VkMemoryBarrier barrier = {
+        /* .sType = */ VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        /* .pNext         = */ nullptr,
+        /* .srcAccessMask = */ VK_ACCESS_SHADER_WRITE_BIT,
+        /* .dstAccessMask = */ VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+            VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+    };
+
+    vkCmdPipelineBarrier(command_buffer_, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+  }
+}
+
 }  // namespace crystal::vulkan
@@ -7,10 +7,12 @@
 
 namespace crystal::vulkan {
 
+class ComputePipeline;
 class Context;
 class Mesh;
 class Pipeline;
 class RenderPass;
+class StorageBuffer;
 class Texture;
 class UniformBuffer;
 
@@ -32,8 +34,10 @@ class CommandBuffer {
   VkPipelineLayout pipeline_layout_               = VK_NULL_HANDLE;
   VkDescriptorSet  uniform_descriptor_set_        = VK_NULL_HANDLE;
   VkDescriptorSet  texture_descriptor_set_        = VK_NULL_HANDLE;
+  VkDescriptorSet  storage_descriptor_set_        = VK_NULL_HANDLE;
   bool             update_uniform_descriptor_set_ = false;
   bool             update_texture_descriptor_set_ = false;
+  bool             update_storage_descriptor_set_ = false;
   bool             in_render_pass_                = false;
 
 public:
@@ -49,11 +53,18 @@ public:
 
   void use_render_pass(const RenderPass& render_pass);
   void use_pipeline(const Pipeline& pipeline);
+  void use_compute_pipeline(const ComputePipeline& compute_pipeline);
   void use_uniform_buffer(const UniformBuffer& uniform_buffer, uint32_t binding);
+  void use_storage_buffer(const StorageBuffer& storage_buffer, uint32_t binding);
   void use_texture(const Texture& texture, uint32_t binding);
 
   void draw(const Mesh& mesh, uint32_t vertex_or_index_count, uint32_t instance_count);
 
+  // Runs the compute pipeline in use over a grid of `x` by `y` by `z` workgroups. Everything it
+  // writes is visible to the commands that follow. Compute work can't be recorded in a render
+  // pass, so it has to be dispatched before `use_render_pass`.
+  void dispatch(uint32_t x, uint32_t y, uint32_t z);
+
 private:
   friend class ::crystal::vulkan::Context;
   friend class ::crystal::vulkan::RenderPass;
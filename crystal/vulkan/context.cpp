@@ -137,8 +137,10 @@ Context::Context(const Context::Desc& desc) {
     for (uint32_t i = 0; i < queue_property_count; ++i) {
       const VkQueueFamilyProperties* queue_property = &queue_properties[i];
       if (queue_property->queueCount > 0) {
-        // If this queue supports graphics, cache the index of the queue.
-        if (queue_property->queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        // If this queue supports graphics and compute, cache the index of the queue. Compute
+        // pipelines are dispatched in the same command buffers as the draws.
+        if ((queue_property->queueFlags & VK_QUEUE_GRAPHICS_BIT) &&
+            (queue_property->queueFlags & VK_QUEUE_COMPUTE_BIT)) {
           graphics_queue_index = i;
         }
         // Use the function pointer retrieved from the instance above to query
@@ -253,6 +255,10 @@ Context::Context(const Context::Desc& desc) {
             /* .type            = */ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
             /* .descriptorCount = */ desc.texture_descriptor_count,
         },
+        VkDescriptorPoolSize{
+            /* .type            = */ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            /* .descriptorCount = */ desc.storage_descriptor_count,
+        },
     };
 
     const VkDescriptorPoolCreateInfo create_info = {
@@ -260,7 +266,7 @@ Context::Context(const Context::Desc& desc) {
         /* .pNext         = */ nullptr,
         /* .flags         = */ VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
         /* .maxSets       = */ desc.max_descriptor_set_count,
-        /* .poolSizeCount = */ 2,
+        /* .poolSizeCount = */ desc.storage_descriptor_count > 0 ? 3u : 2u,
         /* .pPoolSizes    = */ pool_sizes,
     };
 
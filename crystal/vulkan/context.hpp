@@ -13,6 +13,7 @@
 #include "crystal/vulkan/mesh.hpp"
 #include "crystal/vulkan/pipeline.hpp"
 #include "crystal/vulkan/render_pass.hpp"
+#include "crystal/vulkan/storage_buffer.hpp"
 #include "crystal/vulkan/texture.hpp"
 #include "crystal/vulkan/uniform_buffer.hpp"
 #include "crystal/vulkan/vertex_buffer.hpp"
@@ -31,26 +32,30 @@ typedef struct GLFWwindow GLFWwindow;
 namespace crystal::vulkan {
 
 class CommandBuffer;
+class ComputePipeline;
 class IndexBuffer;
 class Library;
 class Mesh;
 class Pipeline;
 class RenderPass;
+class StorageBuffer;
 class Texture;
 class UniformBuffer;
 class VertexBuffer;
 
 class Context {
 public:
-  using CommandBuffer = ::crystal::vulkan::CommandBuffer;
-  using IndexBuffer   = ::crystal::vulkan::IndexBuffer;
-  using Library       = ::crystal::vulkan::Library;
-  using Mesh          = ::crystal::vulkan::Mesh;
-  using Pipeline      = ::crystal::vulkan::Pipeline;
-  using RenderPass    = ::crystal::vulkan::RenderPass;
-  using Texture       = ::crystal::vulkan::Texture;
-  using UniformBuffer = ::crystal::vulkan::UniformBuffer;
-  using VertexBuffer  = ::crystal::vulkan::VertexBuffer;
+  using CommandBuffer   = ::crystal::vulkan::CommandBuffer;
+  using ComputePipeline = ::crystal::vulkan::ComputePipeline;
+  using IndexBuffer     = ::crystal::vulkan::IndexBuffer;
+  using Library         = ::crystal::vulkan::Library;
+  using Mesh            = ::crystal::vulkan::Mesh;
+  using Pipeline        = ::crystal::vulkan::Pipeline;
+  using RenderPass      = ::crystal::vulkan::RenderPass;
+  using StorageBuffer   = ::crystal::vulkan::StorageBuffer;
+  using Texture         = ::crystal::vulkan::Texture;
+  using UniformBuffer   = ::crystal::vulkan::UniformBuffer;
+  using VertexBuffer    = ::crystal::vulkan::VertexBuffer;
 
   struct Desc {
 #if CRYSTAL_USE_SDL2
@@ -63,6 +68,7 @@ public:
     uint32_t    max_descriptor_set_count;
     uint32_t    buffer_descriptor_count;
     uint32_t    texture_descriptor_count;
+    uint32_t    storage_descriptor_count = 0;
   };
 
 private:
@@ -104,13 +110,17 @@ public:
 
 #include "crystal/common/context_methods.inl"
 
+  ComputePipeline create_compute_pipeline(Library& library, const ComputePipelineDesc& desc);
+
 private:
   friend CommandBuffer;
+  friend ComputePipeline;
   friend IndexBuffer;
   friend Library;
   friend Mesh;
   friend Pipeline;
   friend RenderPass;
+  friend StorageBuffer;
   friend Texture;
   friend UniformBuffer;
   friend VertexBuffer;
@@ -153,6 +163,11 @@ inline Pipeline Context::create_pipeline(Library& library, RenderPass& render_pa
   return Pipeline(*this, library, render_pass, desc);
 }
 
+inline ComputePipeline Context::create_compute_pipeline(Library&                   library,
+                                                       const ComputePipelineDesc& desc) {
+  return ComputePipeline(*this, library, desc);
+}
+
 inline UniformBuffer Context::create_uniform_buffer(const size_t byte_length) {
   return UniformBuffer(*this, byte_length);
 }
@@ -167,6 +182,20 @@ inline void Context::update_uniform_buffer(UniformBuffer&    uniform_buffer,
   uniform_buffer.update(data_ptr, byte_length);
 }
 
+inline StorageBuffer Context::create_storage_buffer(const size_t byte_length) {
+  return StorageBuffer(*this, byte_length);
+}
+
+inline StorageBuffer Context::create_storage_buffer(const void* const data_ptr,
+                                                    const size_t      byte_length) {
+  return StorageBuffer(*this, data_ptr, byte_length);
+}
+
+inline void Context::update_storage_buffer(StorageBuffer&    storage_buffer,
+                                           const void* const data_ptr, const size_t byte_length) {
+  storage_buffer.update(data_ptr, byte_length);
+}
+
 inline VertexBuffer Context::create_vertex_buffer(const size_t byte_length) {
   return VertexBuffer(*this, byte_length);
 }
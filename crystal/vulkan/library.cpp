@@ -9,7 +9,8 @@ namespace crystal::vulkan {
 Library::Library(Library&& other)
     : device_(other.device_),
       shader_module_(other.shader_module_),
-      lib_pb_(std::move(other.lib_pb_)) {
+      lib_pb_(std::move(other.lib_pb_)),
+      index_(std::move(other.index_)) {
   other.device_        = VK_NULL_HANDLE;
   other.shader_module_ = VK_NULL_HANDLE;
 }
@@ -20,6 +21,7 @@ Library& Library::operator=(Library&& other) {
   device_        = other.device_;
   shader_module_ = other.shader_module_;
   lib_pb_        = std::move(other.lib_pb_);
+  index_         = std::move(other.index_);
 
   other.device_        = VK_NULL_HANDLE;
   other.shader_module_ = VK_NULL_HANDLE;
@@ -48,6 +50,7 @@ Library::Library(const VkDevice device, const std::string_view file_path) : devi
   if (!lib_pb_.ParseFromIstream(&input_file)) {
     util::msg::fatal("parsing crystal library from file [", file_path, "]");
   }
+  index_ = common::PipelineIndex(lib_pb_, lib_pb_.vulkan().pipelines());
 
   const std::string& spv = lib_pb_.vulkan().library();
 
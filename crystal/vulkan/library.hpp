@@ -2,11 +2,13 @@
 
 #include <string_view>
 
+#include "crystal/common/pipeline_index.hpp"
 #include "crystal/common/proto/proto.hpp"
 #include "crystal/vulkan/vk.hpp"
 
 namespace crystal::vulkan {
 
+class ComputePipeline;
 class Context;
 class Shader;
 class Pipeline;
@@ -15,6 +17,7 @@ class Library {
   VkDevice               device_        = VK_NULL_HANDLE;
   VkShaderModule         shader_module_ = VK_NULL_HANDLE;
   common::proto::Library lib_pb_;
+  common::PipelineIndex  index_;
 
 public:
   Library() = default;
@@ -30,6 +33,7 @@ public:
   void destroy() noexcept;
 
 private:
+  friend class ::crystal::vulkan::ComputePipeline;
   friend class ::crystal::vulkan::Context;
   friend class ::crystal::vulkan::Shader;
   friend class ::crystal::vulkan::Pipeline;
@@ -1,5 +1,9 @@
 #include "crystal/vulkan/pipeline.hpp"
 
+#include <cstring>
+#include <string_view>
+#include <vector>
+
 #include "crystal/common/proto/proto.hpp"
 #include "crystal/vulkan/context.hpp"
 #include "crystal/vulkan/library.hpp"
@@ -7,21 +11,111 @@
 
 namespace crystal::vulkan {
 
+namespace {
+
+// Packs the overridden constants of a pipeline as specialization constants.
+void specialize(const crystal::common::proto::VKPipeline& pipeline_pb, const std::string_view name,
+                const std::initializer_list<ConstantDesc> constants,
+                std::vector<VkSpecializationMapEntry>&    specialization_entries,
+                std::vector<uint32_t>&                    specialization_data) {
+  for (const auto& constant : constants) {
+    const crystal::common::proto::VKConstant* constant_pb = nullptr;
+    for (const auto& check_constant_pb : pipeline_pb.constants()) {
+      if (check_constant_pb.id() == constant.id) {
+        constant_pb = &check_constant_pb;
+        break;
+      }
+    }
+    if (constant_pb == nullptr) {
+      util::msg::fatal("pipeline [", name, "] has no constant [", constant.id, "]");
+    }
+
+    uint32_t data = 0;
+    switch (constant_pb->type()) {
+      case crystal::common::proto::CONSTANT_BOOL:
+        data = constant.value != 0.0 ? VK_TRUE : VK_FALSE;
+        break;
+      case crystal::common::proto::CONSTANT_INT: {
+        const int32_t value = static_cast<int32_t>(constant.value);
+        std::memcpy(&data, &value, sizeof(data));
+        break;
+      }
+      default: {
+        const float value = static_cast<float>(constant.value);
+        std::memcpy(&data, &value, sizeof(data));
+        break;
+      }
+    }
+
+    specialization_entries.push_back(VkSpecializationMapEntry{
+        /* .constantID = */ constant_pb->actual(),
+        /* .offset     = */ static_cast<uint32_t>(specialization_data.size() * sizeof(uint32_t)),
+        /* .size       = */ sizeof(uint32_t),
+    });
+    specialization_data.push_back(data);
+  }
+}
+
+// Creates a descriptor set layout, and allocates a descriptor set with it for each frame.
+VkDescriptorSetLayout create_descriptor_sets(
+    VkDevice device, VkDescriptorPool descriptor_pool,
+    const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+    std::array<VkDescriptorSet, 4>&                  descriptor_sets) {
+  VkDescriptorSetLayout descriptor_set_layout = VK_NULL_HANDLE;
+
+  const VkDescriptorSetLayoutCreateInfo create_info = {
+      /* sType = */ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      /* pNext        = */ nullptr,
+      /* flags        = */ 0,
+      /* bindingCount = */ static_cast<uint32_t>(bindings.size()),
+      /* pBindings    = */ bindings.data(),
+  };
+
+  VK_ASSERT(vkCreateDescriptorSetLayout(device, &create_info, nullptr, &descriptor_set_layout),
+            "creating descriptor set layout");
+
+  const std::array<VkDescriptorSetLayout, 4> descriptor_set_layouts{
+      descriptor_set_layout,
+      descriptor_set_layout,
+      descriptor_set_layout,
+      descriptor_set_layout,
+  };
+  const VkDescriptorSetAllocateInfo allocate_info = {
+      /* sType = */ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      /* pNext              = */ nullptr,
+      /* descriptorPool     = */ descriptor_pool,
+      /* descriptorSetCount = */ static_cast<uint32_t>(descriptor_set_layouts.size()),
+      /* pSetLayouts        = */ descriptor_set_layouts.data(),
+  };
+
+  VK_ASSERT(vkAllocateDescriptorSets(device, &allocate_info, descriptor_sets.data()),
+            "allocating descriptor sets");
+
+  return descriptor_set_layout;
+}
+
+}  // namespace
+
 Pipeline::Pipeline(Pipeline&& other)
     : device_(other.device_),
       descriptor_pool_(other.descriptor_pool_),
       render_pass_(other.render_pass_),
+      empty_descriptor_set_layout_(other.empty_descriptor_set_layout_),
       uniform_descriptor_set_layout_(other.uniform_descriptor_set_layout_),
       uniform_descriptor_sets_(std::move(other.uniform_descriptor_sets_)),
       texture_descriptor_set_layout_(other.texture_descriptor_set_layout_),
       texture_descriptor_sets_(std::move(other.texture_descriptor_sets_)),
+      storage_descriptor_set_layout_(other.storage_descriptor_set_layout_),
+      storage_descriptor_sets_(std::move(other.storage_descriptor_sets_)),
       pipeline_layout_(other.pipeline_layout_),
       pipeline_(other.pipeline_) {
   other.device_                        = VK_NULL_HANDLE;
   other.descriptor_pool_               = VK_NULL_HANDLE;
   other.render_pass_                   = VK_NULL_HANDLE;
+  other.empty_descriptor_set_layout_   = VK_NULL_HANDLE;
   other.uniform_descriptor_set_layout_ = VK_NULL_HANDLE;
   other.texture_descriptor_set_layout_ = VK_NULL_HANDLE;
+  other.storage_descriptor_set_layout_ = VK_NULL_HANDLE;
   other.pipeline_layout_               = VK_NULL_HANDLE;
   other.pipeline_                      = VK_NULL_HANDLE;
 }
@@ -32,20 +126,26 @@ Pipeline& Pipeline::operator=(Pipeline&& other) {
   device_                        = other.device_;
   descriptor_pool_               = other.descriptor_pool_;
   render_pass_                   = other.render_pass_;
+  empty_descriptor_set_layout_   = other.empty_descriptor_set_layout_;
   uniform_descriptor_set_layout_ = other.uniform_descriptor_set_layout_;
   uniform_descriptor_sets_       = std::move(other.uniform_descriptor_sets_);
   texture_descriptor_set_layout_ = other.texture_descriptor_set_layout_;
   texture_descriptor_sets_       = std::move(other.texture_descriptor_sets_);
+  storage_descriptor_set_layout_ = other.storage_descriptor_set_layout_;
+  storage_descriptor_sets_       = std::move(other.storage_descriptor_sets_);
   pipeline_layout_               = other.pipeline_layout_;
   pipeline_                      = other.pipeline_;
 
   other.device_                        = VK_NULL_HANDLE;
   other.descriptor_pool_               = VK_NULL_HANDLE;
   other.render_pass_                   = VK_NULL_HANDLE;
+  other.empty_descriptor_set_layout_   = VK_NULL_HANDLE;
   other.uniform_descriptor_set_layout_ = VK_NULL_HANDLE;
   other.uniform_descriptor_sets_       = {};
   other.texture_descriptor_set_layout_ = VK_NULL_HANDLE;
   other.texture_descriptor_sets_       = {};
+  other.storage_descriptor_set_layout_ = VK_NULL_HANDLE;
+  other.storage_descriptor_sets_       = {};
   other.pipeline_layout_               = VK_NULL_HANDLE;
   other.pipeline_                      = VK_NULL_HANDLE;
 
@@ -59,6 +159,12 @@ void Pipeline::destroy() noexcept {
     return;
   }
 
+  if (storage_descriptor_set_layout_ != VK_NULL_HANDLE) {
+    VK_ASSERT(vkFreeDescriptorSets(device_, descriptor_pool_, storage_descriptor_sets_.size(),
+                                   storage_descriptor_sets_.data()),
+              "freeing descriptor sets");
+    vkDestroyDescriptorSetLayout(device_, storage_descriptor_set_layout_, nullptr);
+  }
   if (texture_descriptor_set_layout_ != VK_NULL_HANDLE) {
     VK_ASSERT(vkFreeDescriptorSets(device_, descriptor_pool_, texture_descriptor_sets_.size(),
                                    texture_descriptor_sets_.data()),
@@ -71,14 +177,19 @@ void Pipeline::destroy() noexcept {
               "freeing descriptor sets");
     vkDestroyDescriptorSetLayout(device_, uniform_descriptor_set_layout_, nullptr);
   }
+  if (empty_descriptor_set_layout_ != VK_NULL_HANDLE) {
+    vkDestroyDescriptorSetLayout(device_, empty_descriptor_set_layout_, nullptr);
+  }
   vkDestroyPipeline(device_, pipeline_, nullptr);
   vkDestroyPipelineLayout(device_, pipeline_layout_, nullptr);
 
   device_                        = VK_NULL_HANDLE;
   descriptor_pool_               = VK_NULL_HANDLE;
   render_pass_                   = VK_NULL_HANDLE;
+  empty_descriptor_set_layout_   = VK_NULL_HANDLE;
   uniform_descriptor_set_layout_ = VK_NULL_HANDLE;
   texture_descriptor_set_layout_ = VK_NULL_HANDLE;
+  storage_descriptor_set_layout_ = VK_NULL_HANDLE;
   pipeline_layout_               = VK_NULL_HANDLE;
   pipeline_                      = VK_NULL_HANDLE;
 }
@@ -89,22 +200,15 @@ Pipeline::Pipeline(Context& ctx, Library& library, RenderPass& render_pass,
       descriptor_pool_(ctx.descriptor_pool_),
       render_pass_(render_pass.render_pass_),
       uniform_descriptor_set_layout_(VK_NULL_HANDLE),
-      texture_descriptor_set_layout_(VK_NULL_HANDLE) {
-  const crystal::common::proto::VKPipeline* pipeline_pb = nullptr;
-  const auto&                               vulkan_pb   = library.lib_pb_.vulkan();
-  for (int i = 0; i < vulkan_pb.pipelines_size(); ++i) {
-    const auto& check_pipeline_pb = vulkan_pb.pipelines(i);
-    if (check_pipeline_pb.name() != desc.name) {
-      continue;
-    }
-
-    pipeline_pb = &check_pipeline_pb;
-    break;
-  }
-
-  if (pipeline_pb == nullptr) {
-    util::msg::fatal("could not find pipeline [", desc.name, "]");
+      texture_descriptor_set_layout_(VK_NULL_HANDLE),
+      storage_descriptor_set_layout_(VK_NULL_HANDLE) {
+  const int index = library.index_.find(desc.name, desc.features);
+  if (index < 0) {
+    util::msg::fatal("could not find pipeline [", desc.name, "] with features [", desc.features,
+                     "]");
   }
+  const crystal::common::proto::VKPipeline* pipeline_pb =
+      &library.lib_pb_.vulkan().pipelines(index);
 
   if (pipeline_pb->uniforms_size() > 0) {
     {  // Create uniform descriptor set layout.
@@ -200,17 +304,58 @@ Pipeline::Pipeline(Context& ctx, Library& library, RenderPass& render_pass,
     }
   }
 
+  if (pipeline_pb->storage_size() > 0) {
+    // Only read, so neither stage needs the optional features for writing them.
+    std::vector<VkDescriptorSetLayoutBinding> bindings(pipeline_pb->storage_size());
+    for (int i = 0; i < pipeline_pb->storage_size(); ++i) {
+      bindings[i] = VkDescriptorSetLayoutBinding{
+          /* binding            = */ pipeline_pb->storage(i).binding(),
+          /* descriptorType     = */ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+          /* descriptorCount    = */ 1,
+          /* stageFlags         = */ VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+          /* pImmutableSamplers = */ nullptr,
+      };
+    }
+    storage_descriptor_set_layout_ =
+        create_descriptor_sets(device_, descriptor_pool_, bindings, storage_descriptor_sets_);
+
+    // Stands in for the uniform or texture sets ahead of it, when the pipeline doesn't use them.
+    const VkDescriptorSetLayoutCreateInfo create_info = {
+        /* sType = */ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        /* pNext        = */ nullptr,
+        /* flags        = */ 0,
+        /* bindingCount = */ 0,
+        /* pBindings    = */ nullptr,
+    };
+
+    VK_ASSERT(vkCreateDescriptorSetLayout(device_, &create_info, nullptr,
+                                          &empty_descriptor_set_layout_),
+              "creating empty descriptor set layout");
+  }
+
   {  // Create pipeline layout.
-    std::array<VkDescriptorSetLayout, 2> descriptor_set_layouts;
+    std::array<VkDescriptorSetLayout, 3> descriptor_set_layouts;
     uint32_t                             descriptor_set_count = 0;
 
-    if (pipeline_pb->uniforms_size() > 0) {
-      descriptor_set_layouts[descriptor_set_count] = uniform_descriptor_set_layout_;
-      ++descriptor_set_count;
-    }
-    if (pipeline_pb->textures_size() > 0) {
-      descriptor_set_layouts[descriptor_set_count] = texture_descriptor_set_layout_;
-      ++descriptor_set_count;
+    if (pipeline_pb->storage_size() > 0) {
+      // The storage buffers are always in set 2, so every set is in the layout.
+      descriptor_set_layouts = {
+          uniform_descriptor_set_layout_ != VK_NULL_HANDLE ? uniform_descriptor_set_layout_
+                                                           : empty_descriptor_set_layout_,
+          texture_descriptor_set_layout_ != VK_NULL_HANDLE ? texture_descriptor_set_layout_
+                                                           : empty_descriptor_set_layout_,
+          storage_descriptor_set_layout_,
+      };
+      descriptor_set_count = 3;
+    } else {
+      if (pipeline_pb->uniforms_size() > 0) {
+        descriptor_set_layouts[descriptor_set_count] = uniform_descriptor_set_layout_;
+        ++descriptor_set_count;
+      }
+      if (pipeline_pb->textures_size() > 0) {
+        descriptor_set_layouts[descriptor_set_count] = texture_descriptor_set_layout_;
+        ++descriptor_set_count;
+      }
     }
 
     const VkPipelineLayoutCreateInfo create_info = {
@@ -228,8 +373,22 @@ Pipeline::Pipeline(Context& ctx, Library& library, RenderPass& render_pass,
               "creating pipeline layout");
   }
 
+  // The overridden constants, which both stages share.
+  std::vector<VkSpecializationMapEntry> specialization_entries;
+  std::vector<uint32_t>                 specialization_data;
+  specialize(*pipeline_pb, desc.name, desc.constants, specialization_entries, specialization_data);
+
+  const VkSpecializationInfo specialization_info = {
+      /* .mapEntryCount = */ static_cast<uint32_t>(specialization_entries.size()),
+      /* .pMapEntries   = */ specialization_entries.data(),
+      /* .dataSize      = */ specialization_data.size() * sizeof(uint32_t),
+      /* .pData         = */ specialization_data.data(),
+  };
+  const VkSpecializationInfo* const specialization =
+      specialization_entries.empty() ? nullptr : &specialization_info;
+
   {  // Create pipeline.
-    const std::string name(desc.name);
+    const std::string& name = pipeline_pb->name();
 
     const uint32_t shader_stage_create_info_count                     = 1 + pipeline_pb->fragment();
     const VkPipelineShaderStageCreateInfo shader_stage_create_infos[] = {
@@ -240,7 +399,7 @@ Pipeline::Pipeline(Context& ctx, Library& library, RenderPass& render_pass,
             /* .stage               = */ VK_SHADER_STAGE_VERTEX_BIT,
             /* .module              = */ library.shader_module_,
             /* .pName               = */ name.c_str(),
-            /* .pSpecializationInfo = */ nullptr,
+            /* .pSpecializationInfo = */ specialization,
         },
         {
             /* .sType = */ VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
@@ -249,7 +408,7 @@ Pipeline::Pipeline(Context& ctx, Library& library, RenderPass& render_pass,
             /* .stage               = */ VK_SHADER_STAGE_FRAGMENT_BIT,
             /* .module              = */ library.shader_module_,
             /* .pName               = */ name.c_str(),
-            /* .pSpecializationInfo = */ nullptr,
+            /* .pSpecializationInfo = */ specialization,
         },
     };
 
@@ -420,4 +579,201 @@ Pipeline::Pipeline(Context& ctx, Library& library, RenderPass& render_pass,
   }
 }
 
+ComputePipeline::ComputePipeline(ComputePipeline&& other)
+    : device_(other.device_),
+      descriptor_pool_(other.descriptor_pool_),
+      empty_descriptor_set_layout_(other.empty_descriptor_set_layout_),
+      uniform_descriptor_set_layout_(other.uniform_descriptor_set_layout_),
+      uniform_descriptor_sets_(std::move(other.uniform_descriptor_sets_)),
+      storage_descriptor_set_layout_(other.storage_descriptor_set_layout_),
+      storage_descriptor_sets_(std::move(other.storage_descriptor_sets_)),
+      pipeline_layout_(other.pipeline_layout_),
+      pipeline_(other.pipeline_) {
+  other.device_                        = VK_NULL_HANDLE;
+  other.descriptor_pool_               = VK_NULL_HANDLE;
+  other.empty_descriptor_set_layout_   = VK_NULL_HANDLE;
+  other.uniform_descriptor_set_layout_ = VK_NULL_HANDLE;
+  other.storage_descriptor_set_layout_ = VK_NULL_HANDLE;
+  other.pipeline_layout_               = VK_NULL_HANDLE;
+  other.pipeline_                      = VK_NULL_HANDLE;
+}
+
+ComputePipeline& ComputePipeline::operator=(ComputePipeline&& other) {
+  destroy();
+
+  device_                        = other.device_;
+  descriptor_pool_               = other.descriptor_pool_;
+  empty_descriptor_set_layout_   = other.empty_descriptor_set_layout_;
+  uniform_descriptor_set_layout_ = other.uniform_descriptor_set_layout_;
+  uniform_descriptor_sets_       = std::move(other.uniform_descriptor_sets_);
+  storage_descriptor_set_layout_ = other.storage_descriptor_set_layout_;
+  storage_descriptor_sets_       = std::move(other.storage_descriptor_sets_);
+  pipeline_layout_               = other.pipeline_layout_;
+  pipeline_                      = other.pipeline_;
+
+  other.device_                        = VK_NULL_HANDLE;
+  other.descriptor_pool_               = VK_NULL_HANDLE;
+  other.empty_descriptor_set_layout_   = VK_NULL_HANDLE;
+  other.uniform_descriptor_set_layout_ = VK_NULL_HANDLE;
+  other.uniform_descriptor_sets_       = {};
+  other.storage_descriptor_set_layout_ = VK_NULL_HANDLE;
+  other.storage_descriptor_sets_       = {};
+  other.pipeline_layout_               = VK_NULL_HANDLE;
+  other.pipeline_                      = VK_NULL_HANDLE;
+
+  return *this;
+}
+
+ComputePipeline::~ComputePipeline() { destroy(); }
+
+void ComputePipeline::destroy() noexcept {
+  if (device_ == VK_NULL_HANDLE) {
+    return;
+  }
+
+  if (storage_descriptor_set_layout_ != VK_NULL_HANDLE) {
+    VK_ASSERT(vkFreeDescriptorSets(device_, descriptor_pool_, storage_descriptor_sets_.size(),
+                                   storage_descriptor_sets_.data()),
+              "freeing descriptor sets");
+    vkDestroyDescriptorSetLayout(device_, storage_descriptor_set_layout_, nullptr);
+  }
+  if (uniform_descriptor_set_layout_ != VK_NULL_HANDLE) {
+    VK_ASSERT(vkFreeDescriptorSets(device_, descriptor_pool_, uniform_descriptor_sets_.size(),
+                                   uniform_descriptor_sets_.data()),
+              "freeing descriptor sets");
+    vkDestroyDescriptorSetLayout(device_, uniform_descriptor_set_layout_, nullptr);
+  }
+  vkDestroyDescriptorSetLayout(device_, empty_descriptor_set_layout_, nullptr);
+  vkDestroyPipeline(device_, pipeline_, nullptr);
+  vkDestroyPipelineLayout(device_, pipeline_layout_, nullptr);
+
+  device_                        = VK_NULL_HANDLE;
+  descriptor_pool_               = VK_NULL_HANDLE;
+  empty_descriptor_set_layout_   = VK_NULL_HANDLE;
+  uniform_descriptor_set_layout_ = VK_NULL_HANDLE;
+  storage_descriptor_set_layout_ = VK_NULL_HANDLE;
+  pipeline_layout_               = VK_NULL_HANDLE;
+  pipeline_                      = VK_NULL_HANDLE;
+}
+
+ComputePipeline::ComputePipeline(Context& ctx, Library& library, const ComputePipelineDesc& desc)
+    : device_(ctx.device_), descriptor_pool_(ctx.descriptor_pool_) {
+  const int index = library.index_.find(desc.name, desc.features);
+  if (index < 0) {
+    util::msg::fatal("could not find pipeline [", desc.name, "] with features [", desc.features,
+                     "]");
+  }
+  const crystal::common::proto::VKPipeline* pipeline_pb =
+      &library.lib_pb_.vulkan().pipelines(index);
+  if (!pipeline_pb->compute()) {
+    util::msg::fatal("pipeline [", desc.name, "] is not a compute pipeline");
+  }
+
+  {  // Create the layout that stands in for the sets that the pipeline doesn't use.
+    const VkDescriptorSetLayoutCreateInfo create_info = {
+        /* sType = */ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        /* pNext        = */ nullptr,
+        /* flags        = */ 0,
+        /* bindingCount = */ 0,
+        /* pBindings    = */ nullptr,
+    };
+
+    VK_ASSERT(vkCreateDescriptorSetLayout(device_, &create_info, nullptr,
+                                          &empty_descriptor_set_layout_),
+              "creating empty descriptor set layout");
+  }
+
+  if (pipeline_pb->uniforms_size() > 0) {
+    std::vector<VkDescriptorSetLayoutBinding> bindings(pipeline_pb->uniforms_size());
+    for (int i = 0; i < pipeline_pb->uniforms_size(); ++i) {
+      bindings[i] = VkDescriptorSetLayoutBinding{
+          /* binding            = */ pipeline_pb->uniforms(i).binding(),
+          /* descriptorType     = */ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+          /* descriptorCount    = */ 1,
+          /* stageFlags         = */ VK_SHADER_STAGE_COMPUTE_BIT,
+          /* pImmutableSamplers = */ nullptr,
+      };
+    }
+    uniform_descriptor_set_layout_ =
+        create_descriptor_sets(device_, descriptor_pool_, bindings, uniform_descriptor_sets_);
+  }
+
+  if (pipeline_pb->storage_size() > 0) {
+    std::vector<VkDescriptorSetLayoutBinding> bindings(pipeline_pb->storage_size());
+    for (int i = 0; i < pipeline_pb->storage_size(); ++i) {
+      bindings[i] = VkDescriptorSetLayoutBinding{
+          /* binding            = */ pipeline_pb->storage(i).binding(),
+          /* descriptorType     = */ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+          /* descriptorCount    = */ 1,
+          /* stageFlags         = */ VK_SHADER_STAGE_COMPUTE_BIT,
+          /* pImmutableSamplers = */ nullptr,
+      };
+    }
+    storage_descriptor_set_layout_ =
+        create_descriptor_sets(device_, descriptor_pool_, bindings, storage_descriptor_sets_);
+  }
+
+  {  // Create pipeline layout.
+    const std::array<VkDescriptorSetLayout, 3> descriptor_set_layouts{
+        uniform_descriptor_set_layout_ != VK_NULL_HANDLE ? uniform_descriptor_set_layout_
+                                                         : empty_descriptor_set_layout_,
+        empty_descriptor_set_layout_,
+        storage_descriptor_set_layout_,
+    };
+    const uint32_t descriptor_set_count = pipeline_pb->storage_size() > 0   ? 3
+                                          : pipeline_pb->uniforms_size() > 0 ? 1
+                                                                             : 0;
+
+    const VkPipelineLayoutCreateInfo create_info = {
+        /* .sType = */ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        /* .pNext                  = */ nullptr,
+        /* .flags                  = */ 0,
+        /* .setLayoutCount         = */ descriptor_set_count,
+        /* .pSetLayouts            = */ descriptor_set_layouts.data(),
+        /* .pushConstantRangeCount = */ 0,
+        /* .pPushConstantRanges    = */ nullptr,
+    };
+
+    VK_ASSERT(vkCreatePipelineLayout(device_, &create_info, nullptr, &pipeline_layout_),
+              "creating pipeline layout");
+  }
+
+  std::vector<VkSpecializationMapEntry> specialization_entries;
+  std::vector<uint32_t>                 specialization_data;
+  specialize(*pipeline_pb, desc.name, desc.constants, specialization_entries, specialization_data);
+
+  const VkSpecializationInfo specialization_info = {
+      /* .mapEntryCount = */ static_cast<uint32_t>(specialization_entries.size()),
+      /* .pMapEntries   = */ specialization_entries.data(),
+      /* .dataSize      = */ specialization_data.size() * sizeof(uint32_t),
+      /* .pData         = */ specialization_data.data(),
+  };
+
+  {  // Create pipeline.
+    const VkComputePipelineCreateInfo pipeline_create_info = {
+        /* .sType = */ VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        /* .pNext              = */ nullptr,
+        /* .flags              = */ 0,
+        /* .stage              = */
+        {
+            /* .sType = */ VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            /* .pNext               = */ nullptr,
+            /* .flags               = */ 0,
+            /* .stage               = */ VK_SHADER_STAGE_COMPUTE_BIT,
+            /* .module              = */ library.shader_module_,
+            /* .pName               = */ pipeline_pb->name().c_str(),
+            /* .pSpecializationInfo = */
+            specialization_entries.empty() ? nullptr : &specialization_info,
+        },
+        /* .layout             = */ pipeline_layout_,
+        /* .basePipelineHandle = */ VK_NULL_HANDLE,
+        /* .basePipelineIndex  = */ -1,
+    };
+
+    VK_ASSERT(vkCreateComputePipelines(device_, nullptr, 1, &pipeline_create_info, nullptr,
+                                       &pipeline_),
+              "creating compute pipeline");
+  }
+}
+
 }  // namespace crystal::vulkan
@@ -12,17 +12,22 @@ class CommandBuffer;
 class Library;
 class RenderPass;
 
+// A pipeline with vertex and fragment shaders. The uniforms are in descriptor set 0, the textures
+// in set 1 and the (readonly) storage buffers in set 2.
 class Pipeline {
   VkDevice         device_          = VK_NULL_HANDLE;
   VkDescriptorPool descriptor_pool_ = VK_NULL_HANDLE;
   VkRenderPass     render_pass_     = VK_NULL_HANDLE;
 
+  VkDescriptorSetLayout          empty_descriptor_set_layout_   = VK_NULL_HANDLE;
   VkDescriptorSetLayout          uniform_descriptor_set_layout_ = VK_NULL_HANDLE;
-  std::array<VkDescriptorSet, 4> uniform_descriptor_sets_;
+  std::array<VkDescriptorSet, 4> uniform_descriptor_sets_       = {};
   VkDescriptorSetLayout          texture_descriptor_set_layout_ = VK_NULL_HANDLE;
-  std::array<VkDescriptorSet, 4> texture_descriptor_sets_;
-  VkPipelineLayout               pipeline_layout_ = VK_NULL_HANDLE;
-  VkPipeline                     pipeline_        = VK_NULL_HANDLE;
+  std::array<VkDescriptorSet, 4> texture_descriptor_sets_       = {};
+  VkDescriptorSetLayout          storage_descriptor_set_layout_ = VK_NULL_HANDLE;
+  std::array<VkDescriptorSet, 4> storage_descriptor_sets_       = {};
+  VkPipelineLayout               pipeline_layout_               = VK_NULL_HANDLE;
+  VkPipeline                     pipeline_                      = VK_NULL_HANDLE;
 
 public:
   Pipeline() = default;
@@ -44,4 +49,39 @@ private:
   Pipeline(Context& ctx, Library& library, RenderPass& render_pass, const PipelineDesc& desc);
 };
 
+// A pipeline with a compute shader, which is run with `CommandBuffer::dispatch` rather than drawn.
+// The uniforms are in descriptor set 0 and the storage buffers in set 2, with set 1 left empty to
+// match the textures of graphics pipelines.
+class ComputePipeline {
+  VkDevice         device_          = VK_NULL_HANDLE;
+  VkDescriptorPool descriptor_pool_ = VK_NULL_HANDLE;
+
+  VkDescriptorSetLayout          empty_descriptor_set_layout_   = VK_NULL_HANDLE;
+  VkDescriptorSetLayout          uniform_descriptor_set_layout_ = VK_NULL_HANDLE;
+  std::array<VkDescriptorSet, 4> uniform_descriptor_sets_       = {};
+  VkDescriptorSetLayout          storage_descriptor_set_layout_ = VK_NULL_HANDLE;
+  std::array<VkDescriptorSet, 4> storage_descriptor_sets_       = {};
+  VkPipelineLayout               pipeline_layout_               = VK_NULL_HANDLE;
+  VkPipeline                     pipeline_                      = VK_NULL_HANDLE;
+
+public:
+  ComputePipeline() = default;
+
+  ComputePipeline(const ComputePipeline&) = delete;
+  ComputePipeline& operator=(const ComputePipeline&) = delete;
+
+  ComputePipeline(ComputePipeline&& other);
+  ComputePipeline& operator=(ComputePipeline&& other);
+
+  ~ComputePipeline();
+
+  void destroy() noexcept;
+
+private:
+  friend class ::crystal::vulkan::Context;
+  friend class ::crystal::vulkan::CommandBuffer;
+
+  ComputePipeline(Context& ctx, Library& library, const ComputePipelineDesc& desc);
+};
+
 }  // namespace crystal::vulkan
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "crystal/vulkan/vk.hpp"
+
+namespace crystal::vulkan {
+
+class Context;
+class CommandBuffer;
+
+// A buffer that compute functions read from and write to. It stays mapped, like a uniform buffer.
+class StorageBuffer {
+  Context*      ctx_               = nullptr;
+  VkBuffer      buffer_            = VK_NULL_HANDLE;
+  VmaAllocation buffer_allocation_ = VK_NULL_HANDLE;
+  void*         ptr_               = nullptr;
+  size_t        capacity_          = 0;
+
+public:
+  constexpr StorageBuffer() = default;
+
+  StorageBuffer(const StorageBuffer&) = delete;
+  StorageBuffer& operator=(const StorageBuffer&) = delete;
+
+  StorageBuffer(StorageBuffer&& other);
+  StorageBuffer& operator=(StorageBuffer&& other);
+
+  ~StorageBuffer();
+
+  void destroy() noexcept;
+
+  void update(const void* const data_ptr, const size_t byte_length) noexcept;
+
+private:
+  friend class ::crystal::vulkan::Context;
+  friend class ::crystal::vulkan::CommandBuffer;
+
+  StorageBuffer(Context& ctx, const size_t byte_length);
+  StorageBuffer(Context& ctx, const void* const data_ptr, const size_t byte_length);
+};
+
+}  // namespace crystal::vulkan
@@ -3,32 +3,24 @@ def _crystal_library_impl(ctx):
     lib = ctx.outputs.lib
     hpp = ctx.outputs.hpp
 
+    # Both outputs come from a single run of the compiler, which only parses the source once.
     args = ctx.actions.args()
     args.add("lib")
     args.add("-i", src.path)
     args.add("-o", lib.path)
-    args.add("--glslang_validator", ctx.executable._glslangValidator.path)
-    args.add("--spirv_link", ctx.executable._spirvLink.path)
+    args.add("--cpp", hpp.path)
 
-    ctx.actions.run(
-        outputs = [lib],
-        inputs = [
-            src,
-            ctx.executable._glslangValidator,
-            ctx.executable._spirvLink,
-        ],
-        executable = ctx.executable._compiler,
-        arguments = [args],
-    )
-
-    args = ctx.actions.args()
-    args.add("cpp")
-    args.add("-i", src.path)
-    args.add("-o", hpp.path)
+    # Imports are found next to the importing file first, and otherwise by their path from the
+    # root that the dependencies are under, which differs for generated files.
+    roots = {}
+    for dep in ctx.files.deps:
+        roots[dep.root.path or "."] = True
+    for root in sorted(roots.keys()):
+        args.add("-I", root)
 
     ctx.actions.run(
-        outputs = [hpp],
-        inputs = [src],
+        outputs = [lib, hpp],
+        inputs = [src] + ctx.files.deps,
         executable = ctx.executable._compiler,
         arguments = [args],
     )
@@ -49,24 +41,14 @@ crystal_library = rule(
     implementation = _crystal_library_impl,
     attrs = {
         "src": attr.label(allow_single_file = True),
+        # Every file that the source imports, directly or not.
+        "deps": attr.label_list(allow_files = [".crystal"]),
         "_compiler": attr.label(
             default = Label("//crystal/compiler/cli"),
             allow_single_file = True,
             executable = True,
             cfg = "host",
         ),
-        "_glslangValidator": attr.label(
-            default = Label("@org_khronos_glslang//:glslangValidator_opt"),
-            allow_single_file = True,
-            executable = True,
-            cfg = "host",
-        ),
-        "_spirvLink": attr.label(
-            default = Label("@spirv_tools//:spirv-link"),
-            allow_single_file = True,
-            executable = True,
-            cfg = "host",
-        ),
     },
     outputs = {
         "lib": "%{name}.crystallib",